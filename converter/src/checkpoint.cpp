@@ -0,0 +1,332 @@
+#include "checkpoint.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "routing_core/checksum.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kNodesMagic[4] = {'L', 'X', 'C', 'N'};
+constexpr char kTilesMagic[4] = {'L', 'X', 'C', 'T'};
+constexpr uint32_t kFormatVersion = 7; // 2: SimpleEdge.speed_kmh, 3: запреты манёвров, 4: имена рёбер, 5: водные рёбра, 6: маска открытой воды, 7: счётчики ридера
+
+class BinWriter {
+public:
+  explicit BinWriter(const std::string& path) : path_(path), tmp_(path + ".tmp"), out_(tmp_, std::ios::binary | std::ios::trunc) {
+    if (!out_) throw std::runtime_error("Failed to create checkpoint file: " + tmp_);
+  }
+  template <typename T> void put(const T& v) { out_.write(reinterpret_cast<const char*>(&v), sizeof(T)); }
+  void raw(const void* p, size_t n) { out_.write(static_cast<const char*>(p), static_cast<std::streamsize>(n)); }
+  void str(const std::string& s) {
+    put<uint32_t>(static_cast<uint32_t>(s.size()));
+    raw(s.data(), s.size());
+  }
+  void commit() {
+    out_.flush();
+    if (!out_) throw std::runtime_error("Failed to write checkpoint file: " + tmp_);
+    out_.close();
+    fs::rename(tmp_, path_);
+  }
+
+private:
+  std::string path_;
+  std::string tmp_;
+  std::ofstream out_;
+};
+
+class BinReader {
+public:
+  explicit BinReader(const std::string& path) : path_(path), in_(path, std::ios::binary) {
+    if (!in_) throw std::runtime_error("Failed to open checkpoint file: " + path);
+  }
+  template <typename T> T get() {
+    T v {};
+    in_.read(reinterpret_cast<char*>(&v), sizeof(T));
+    if (!in_) throw std::runtime_error("Truncated checkpoint file: " + path_);
+    return v;
+  }
+  std::string str() {
+    std::string s(get<uint32_t>(), '\0');
+    in_.read(s.data(), static_cast<std::streamsize>(s.size()));
+    if (!in_) throw std::runtime_error("Truncated checkpoint file: " + path_);
+    return s;
+  }
+  void expectHeader(const char (&magic)[4]) {
+    char m[4];
+    in_.read(m, 4);
+    if (!in_ || std::string(m, 4) != std::string(magic, 4) || get<uint32_t>() != kFormatVersion) {
+      throw std::runtime_error("Unsupported checkpoint file: " + path_);
+    }
+  }
+
+private:
+  std::string path_;
+  std::ifstream in_;
+};
+
+void putNode(BinWriter& w, const SimpleNode& n) {
+  w.put<int64_t>(n.id);
+  w.put<double>(n.lat);
+  w.put<double>(n.lon);
+}
+
+SimpleNode getNode(BinReader& r) {
+  SimpleNode n;
+  n.id = r.get<int64_t>();
+  n.lat = r.get<double>();
+  n.lon = r.get<double>();
+  return n;
+}
+
+} // namespace
+
+Checkpoint::Checkpoint(std::string dir) : dir_(std::move(dir)) {}
+
+std::string Checkpoint::fingerprint(const std::string& input_path, const std::string& params) {
+  std::ifstream in(input_path, std::ios::binary);
+  if (!in) throw std::runtime_error("Failed to open input for hashing: " + input_path);
+  routing_core::Sha256 h;
+  std::vector<char> buf(1 << 20);
+  while (in) {
+    in.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+    h.update(buf.data(), static_cast<size_t>(in.gcount()));
+  }
+  h.update(params.data(), params.size());
+  return h.finishHex();
+}
+
+bool Checkpoint::open(const std::string& fingerprint) {
+  fingerprint_ = fingerprint;
+  stages_.clear();
+
+  std::ifstream in(path("manifest"));
+  std::string line;
+  bool matches = false;
+  if (in && std::getline(in, line) && line == "fingerprint " + fingerprint) {
+    matches = true;
+    while (std::getline(in, line)) {
+      if (line.rfind("stage ", 0) == 0) stages_.push_back(line.substr(6));
+    }
+  }
+  in.close();
+
+  if (!matches) {
+    fs::remove_all(dir_);
+    fs::create_directories(dir_);
+    writeManifest();
+  }
+  return matches;
+}
+
+bool Checkpoint::hasStage(const std::string& stage) const {
+  for (const auto& s : stages_) {
+    if (s == stage) return true;
+  }
+  return false;
+}
+
+void Checkpoint::markStage(const std::string& stage) {
+  if (hasStage(stage)) return;
+  stages_.push_back(stage);
+  writeManifest();
+}
+
+void Checkpoint::remove() {
+  std::error_code ec;
+  fs::remove_all(dir_, ec);
+}
+
+void Checkpoint::writeManifest() const {
+  const std::string tmp = path("manifest.tmp");
+  {
+    std::ofstream out(tmp, std::ios::trunc);
+    out << "fingerprint " << fingerprint_ << "\n";
+    for (const auto& s : stages_) out << "stage " << s << "\n";
+    out.flush();
+    if (!out) throw std::runtime_error("Failed to write checkpoint manifest: " + tmp);
+  }
+  fs::rename(tmp, path("manifest"));
+}
+
+void saveNodeIndex(const std::string& path, const std::unordered_map<int64_t, SimpleNode>& index,
+                   const std::vector<RestrictionRelation>& restrictions) {
+  BinWriter w(path);
+  w.raw(kNodesMagic, 4);
+  w.put<uint32_t>(kFormatVersion);
+  w.put<uint64_t>(index.size());
+  for (const auto& kv : index) putNode(w, kv.second);
+  w.put<uint64_t>(restrictions.size());
+  for (const auto& rr : restrictions) {
+    w.put<int64_t>(rr.from_way);
+    w.put<int64_t>(rr.via_node);
+    w.put<int64_t>(rr.to_way);
+    w.put<uint8_t>(rr.only ? 1 : 0);
+  }
+  w.commit();
+}
+
+void loadNodeIndex(const std::string& path, std::unordered_map<int64_t, SimpleNode>& index,
+                   std::vector<RestrictionRelation>& restrictions) {
+  BinReader r(path);
+  r.expectHeader(kNodesMagic);
+  const uint64_t count = r.get<uint64_t>();
+  index.clear();
+  index.reserve(static_cast<size_t>(count));
+  for (uint64_t i = 0; i < count; ++i) {
+    SimpleNode n = getNode(r);
+    index.emplace(n.id, n);
+  }
+  const uint64_t rcount = r.get<uint64_t>();
+  restrictions.clear();
+  restrictions.reserve(static_cast<size_t>(rcount));
+  for (uint64_t i = 0; i < rcount; ++i) {
+    RestrictionRelation rr;
+    rr.from_way = r.get<int64_t>();
+    rr.via_node = r.get<int64_t>();
+    rr.to_way = r.get<int64_t>();
+    rr.only = r.get<uint8_t>() != 0;
+    restrictions.push_back(rr);
+  }
+}
+
+void saveTileBuckets(const std::string& path,
+                     const std::unordered_map<long long, TileData>& tiles,
+                     const std::unordered_map<int64_t, std::vector<long long>>& way_tiles,
+                     const PbfReaderStats& stats) {
+  BinWriter w(path);
+  w.raw(kTilesMagic, 4);
+  w.put<uint32_t>(kFormatVersion);
+
+  w.put<uint64_t>(tiles.size());
+  for (const auto& [key, t] : tiles) {
+    w.put<int64_t>(key);
+    w.put<double>(t.bbox.lat_min);
+    w.put<double>(t.bbox.lon_min);
+    w.put<double>(t.bbox.lat_max);
+    w.put<double>(t.bbox.lon_max);
+    w.put<uint64_t>(t.edges.size());
+    for (const auto& e : t.edges) {
+      w.put<int64_t>(e.way_id);
+      w.put<int64_t>(e.from_node_id);
+      w.put<int64_t>(e.to_node_id);
+      w.put<int32_t>(e.road_class);
+      const uint8_t flags = (e.oneway ? 0x1 : 0) | (e.car_access ? 0x2 : 0) | (e.foot_access ? 0x4 : 0) |
+                            (e.boat_access ? 0x8 : 0) | (e.against_flow ? 0x10 : 0);
+      w.put<uint8_t>(flags);
+      w.put<uint16_t>(e.speed_kmh);
+      w.str(e.name);
+      w.put<uint32_t>(static_cast<uint32_t>(e.shape.size()));
+      for (const auto& n : e.shape) putNode(w, n);
+    }
+    w.put<uint32_t>(static_cast<uint32_t>(t.restrictions.size()));
+    for (const auto& tr : t.restrictions) {
+      putNode(w, tr.from);
+      putNode(w, tr.via);
+      putNode(w, tr.to);
+      w.put<uint8_t>(tr.only ? 1 : 0);
+    }
+    w.put<uint8_t>(t.water_depth);
+    w.put<uint32_t>(static_cast<uint32_t>(t.water_cells.size()));
+    w.raw(t.water_cells.data(), t.water_cells.size());
+  }
+
+  w.put<uint64_t>(way_tiles.size());
+  for (const auto& [way_id, keys] : way_tiles) {
+    w.put<int64_t>(way_id);
+    w.put<uint32_t>(static_cast<uint32_t>(keys.size()));
+    for (long long k : keys) w.put<int64_t>(k);
+  }
+
+  w.put<uint64_t>(stats.nodes);
+  w.put<uint64_t>(stats.ways);
+  w.put<uint64_t>(stats.highway_ways);
+  w.put<uint64_t>(stats.edges);
+  w.put<uint64_t>(stats.restriction_relations);
+  w.put<uint64_t>(stats.restrictions);
+  w.put<uint64_t>(stats.water_ways);
+  w.put<uint64_t>(stats.water_edges);
+  w.commit();
+}
+
+void loadTileBuckets(const std::string& path,
+                     std::unordered_map<long long, TileData>& tiles,
+                     std::unordered_map<int64_t, std::vector<long long>>& way_tiles,
+                     PbfReaderStats& stats) {
+  BinReader r(path);
+  r.expectHeader(kTilesMagic);
+  tiles.clear();
+  way_tiles.clear();
+
+  const uint64_t tile_count = r.get<uint64_t>();
+  tiles.reserve(static_cast<size_t>(tile_count));
+  for (uint64_t i = 0; i < tile_count; ++i) {
+    const long long key = r.get<int64_t>();
+    TileData& t = tiles[key];
+    t.key = unpackTileKey(key);
+    t.bbox.lat_min = r.get<double>();
+    t.bbox.lon_min = r.get<double>();
+    t.bbox.lat_max = r.get<double>();
+    t.bbox.lon_max = r.get<double>();
+    const uint64_t edge_count = r.get<uint64_t>();
+    t.edges.reserve(static_cast<size_t>(edge_count));
+    for (uint64_t k = 0; k < edge_count; ++k) {
+      SimpleEdge e;
+      e.way_id = r.get<int64_t>();
+      e.from_node_id = r.get<int64_t>();
+      e.to_node_id = r.get<int64_t>();
+      e.road_class = r.get<int32_t>();
+      const uint8_t flags = r.get<uint8_t>();
+      e.oneway = (flags & 0x1) != 0;
+      e.car_access = (flags & 0x2) != 0;
+      e.foot_access = (flags & 0x4) != 0;
+      e.boat_access = (flags & 0x8) != 0;
+      e.against_flow = (flags & 0x10) != 0;
+      e.speed_kmh = r.get<uint16_t>();
+      e.name = r.str();
+      const uint32_t shape_size = r.get<uint32_t>();
+      e.shape.reserve(shape_size);
+      for (uint32_t s = 0; s < shape_size; ++s) e.shape.push_back(getNode(r));
+      if (!e.shape.empty()) {
+        t.nodes.push_back(e.shape.front());
+        t.nodes.push_back(e.shape.back());
+      }
+      t.edges.push_back(std::move(e));
+    }
+    const uint32_t restriction_count = r.get<uint32_t>();
+    t.restrictions.reserve(restriction_count);
+    for (uint32_t k = 0; k < restriction_count; ++k) {
+      TurnRestrictionData tr;
+      tr.from = getNode(r);
+      tr.via = getNode(r);
+      tr.to = getNode(r);
+      tr.only = r.get<uint8_t>() != 0;
+      t.restrictions.push_back(tr);
+    }
+    t.water_depth = r.get<uint8_t>();
+    t.water_cells.resize(r.get<uint32_t>());
+    for (auto& c : t.water_cells) c = r.get<uint8_t>();
+  }
+
+  const uint64_t way_count = r.get<uint64_t>();
+  way_tiles.reserve(static_cast<size_t>(way_count));
+  for (uint64_t i = 0; i < way_count; ++i) {
+    const int64_t way_id = r.get<int64_t>();
+    const uint32_t n = r.get<uint32_t>();
+    auto& keys = way_tiles[way_id];
+    keys.reserve(n);
+    for (uint32_t k = 0; k < n; ++k) keys.push_back(r.get<int64_t>());
+  }
+
+  stats.nodes = r.get<uint64_t>();
+  stats.ways = r.get<uint64_t>();
+  stats.highway_ways = r.get<uint64_t>();
+  stats.edges = r.get<uint64_t>();
+  stats.restriction_relations = r.get<uint64_t>();
+  stats.restrictions = r.get<uint64_t>();
+  stats.water_ways = r.get<uint64_t>();
+  stats.water_edges = r.get<uint64_t>();
+}
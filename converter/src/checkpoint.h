@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pbf_reader.h"
+
+// Каталог чекпоинтов конвертера (--resume).
+//
+//   manifest       — fingerprint входа и список завершённых стадий
+//   nodes.bin      — индекс узлов и отношения-запреты после первого прохода
+//   tiles.bin      — корзины тайлов, way_id -> тайлы и счётчики ридера после второго прохода
+//   water.bin      — водные тайлы (рёбра и маски открытой воды), профиль boat
+//
+// Прогресс записи тайлов хранится в самом routingdb (metadata build_state),
+// в той же транзакции, что и очередная порция тайлов.
+class Checkpoint {
+public:
+  explicit Checkpoint(std::string dir);
+
+  // SHA-256 входного файла + параметров конвертации
+  static std::string fingerprint(const std::string& input_path, const std::string& params);
+
+  // Возвращает true, если в каталоге есть чекпоинт с тем же fingerprint.
+  // Иначе каталог очищается и начинается новый чекпоинт.
+  bool open(const std::string& fingerprint);
+
+  bool hasStage(const std::string& stage) const;
+  void markStage(const std::string& stage);
+  std::string path(const std::string& file) const { return dir_ + "/" + file; }
+
+  // Удалить каталог после успешной конвертации
+  void remove();
+
+private:
+  void writeManifest() const;
+
+  std::string dir_;
+  std::string fingerprint_;
+  std::vector<std::string> stages_;
+};
+
+// Бинарные дампы; пишутся во временный файл и переименовываются,
+// поэтому оборванная запись не оставляет битый чекпоинт.
+void saveNodeIndex(const std::string& path, const std::unordered_map<int64_t, SimpleNode>& index,
+                   const std::vector<RestrictionRelation>& restrictions);
+void loadNodeIndex(const std::string& path, std::unordered_map<int64_t, SimpleNode>& index,
+                   std::vector<RestrictionRelation>& restrictions);
+
+// Счётчики ридера сохраняются вместе с корзинами: при возобновлении второй
+// проход не выполняется, и без них отчёт --stats был бы нулевым.
+void saveTileBuckets(const std::string& path,
+                     const std::unordered_map<long long, TileData>& tiles,
+                     const std::unordered_map<int64_t, std::vector<long long>>& way_tiles,
+                     const PbfReaderStats& stats);
+void loadTileBuckets(const std::string& path,
+                     std::unordered_map<long long, TileData>& tiles,
+                     std::unordered_map<int64_t, std::vector<long long>>& way_tiles,
+                     PbfReaderStats& stats);
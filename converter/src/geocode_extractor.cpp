@@ -0,0 +1,183 @@
+#include "geocode_extractor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+
+#include "routing_core/geocoder.h"
+#include "tiler.h"
+
+#ifdef HAVE_LIBOSMIUM
+#  include <osmium/io/any_input.hpp>
+#  include <osmium/osm/entity_bits.hpp>
+#  include <osmium/osm/node.hpp>
+#  include <osmium/osm/way.hpp>
+#endif
+
+using routing_core::GeoKind;
+
+namespace {
+
+// Куски одной улицы (разные way с тем же name) схлопываются в пределах клетки этого зума (~5 км)
+constexpr int kStreetDedupZoom = 13;
+
+constexpr double kPoiImportance = 0.3;
+constexpr double kStreetImportance = 0.25;
+constexpr double kAddressImportance = 0.2;
+
+struct PlaceRank {
+  const char* value;
+  double importance;
+};
+const PlaceRank kPlaces[] = {
+  {"city", 1.0}, {"town", 0.8}, {"village", 0.6}, {"suburb", 0.5}, {"quarter", 0.4},
+  {"hamlet", 0.4}, {"neighbourhood", 0.35}, {"locality", 0.3}, {"isolated_dwelling", 0.2},
+};
+
+const char* const kPoiKeys[] = {
+  "amenity", "shop", "tourism", "leisure", "office", "historic", "craft", "healthcare",
+};
+
+// highway=* без «настоящей» улицы за ними
+const char* const kSkipHighway[] = {
+  "proposed", "construction", "abandoned", "razed", "platform", "bus_stop", "elevator",
+};
+
+#ifdef HAVE_LIBOSMIUM
+std::string tagValue(const osmium::TagList& tags, const char* key) {
+  const char* v = tags.get_value_by_key(key);
+  return v ? std::string(v) : std::string();
+}
+
+bool isTag(const osmium::TagList& tags, const char* key, const char* value) {
+  const char* v = tags.get_value_by_key(key);
+  return v && std::strcmp(v, value) == 0;
+}
+
+// Вид объекта по тегам; false — в индекс не попадает. Координаты заполняет вызывающий.
+bool classify(const osmium::TagList& tags, bool isWay, GeoEntity& e) {
+  e.name = tagValue(tags, "name");
+  e.street = tagValue(tags, "addr:street");
+  if (e.street.empty()) e.street = tagValue(tags, "addr:place");
+  e.housenumber = tagValue(tags, "addr:housenumber");
+  e.city = tagValue(tags, "addr:city");
+  e.postcode = tagValue(tags, "addr:postcode");
+
+  if (!e.name.empty()) {
+    if (const char* place = tags.get_value_by_key("place")) {
+      for (const auto& p : kPlaces) {
+        if (std::strcmp(place, p.value) != 0) continue;
+        e.kind = static_cast<int>(GeoKind::PLACE);
+        e.category = std::string("place=") + place;
+        e.importance = p.importance;
+        return true;
+      }
+    }
+    for (const char* key : kPoiKeys) {
+      if (const char* v = tags.get_value_by_key(key)) {
+        e.kind = static_cast<int>(GeoKind::POI);
+        e.category = std::string(key) + "=" + v;
+        e.importance = kPoiImportance;
+        return true;
+      }
+    }
+    if (isTag(tags, "railway", "station") || isTag(tags, "aeroway", "aerodrome")) {
+      e.kind = static_cast<int>(GeoKind::POI);
+      e.category = isTag(tags, "railway", "station") ? "railway=station" : "aeroway=aerodrome";
+      e.importance = kPoiImportance;
+      return true;
+    }
+    const char* highway = isWay ? tags.get_value_by_key("highway") : nullptr;
+    if (highway) {
+      for (const char* skip : kSkipHighway) {
+        if (std::strcmp(highway, skip) == 0) return false;
+      }
+      e.kind = static_cast<int>(GeoKind::STREET);
+      e.category = std::string("highway=") + highway;
+      e.importance = kStreetImportance;
+      e.street.clear();
+      e.housenumber.clear();
+      return true;
+    }
+  }
+
+  if (!e.housenumber.empty() && !e.street.empty()) {
+    e.kind = static_cast<int>(GeoKind::ADDRESS);
+    e.name = e.street + " " + e.housenumber;
+    e.category = tags.has_key("building") ? "building" : "address";
+    e.importance = kAddressImportance;
+    return true;
+  }
+  return false;
+}
+#endif
+
+} // namespace
+
+std::vector<GeoEntity> GeocodeExtractor::extract(const std::unordered_map<int64_t, SimpleNode>& node_index) {
+  std::vector<GeoEntity> out;
+  stats_ = GeocodeStats{};
+
+#ifdef HAVE_LIBOSMIUM
+  std::unordered_set<std::string> streetKeys;
+  std::vector<const SimpleNode*> shape;
+  osmium::io::Reader reader{input_path_, osmium::osm_entity_bits::node | osmium::osm_entity_bits::way};
+  while (osmium::memory::Buffer buffer = reader.read()) {
+    for (const osmium::OSMEntity& entity : buffer) {
+      GeoEntity e;
+      if (entity.type() == osmium::item_type::node) {
+        const auto& n = static_cast<const osmium::Node&>(entity);
+        if (n.tags().empty() || !n.location().valid() || !classify(n.tags(), false, e)) continue;
+        e.lat = n.location().lat();
+        e.lon = n.location().lon();
+      } else if (entity.type() == osmium::item_type::way) {
+        const auto& w = static_cast<const osmium::Way&>(entity);
+        if (w.tags().empty() || !classify(w.tags(), true, e)) continue;
+        shape.clear();
+        for (const auto& nd_ref : w.nodes()) {
+          auto it = node_index.find(nd_ref.positive_ref());
+          if (it != node_index.end()) shape.push_back(&it->second);
+        }
+        if (shape.empty()) continue;
+        if (e.kind == static_cast<int>(GeoKind::STREET)) {
+          // Точка улицы — узел в середине пути: центр масс изогнутой улицы может лечь мимо неё
+          const SimpleNode& mid = *shape[shape.size() / 2];
+          const std::string key = routing_core::normalizeGeoText(e.name) + "|" +
+                                  std::to_string(packTileKey(tileKeyFor(mid.lat, mid.lon, kStreetDedupZoom)));
+          if (!streetKeys.insert(key).second) continue;
+          e.lat = mid.lat;
+          e.lon = mid.lon;
+        } else {
+          // Площадной объект: среднее узлов контура без замыкающего повтора
+          size_t count = shape.size();
+          if (count > 1 && shape.front() == shape.back()) --count;
+          for (size_t i = 0; i < count; ++i) {
+            e.lat += shape[i]->lat;
+            e.lon += shape[i]->lon;
+          }
+          e.lat /= static_cast<double>(count);
+          e.lon /= static_cast<double>(count);
+        }
+      } else {
+        continue;
+      }
+
+      switch (static_cast<GeoKind>(e.kind)) {
+        case GeoKind::PLACE: ++stats_.places; break;
+        case GeoKind::STREET: ++stats_.streets; break;
+        case GeoKind::ADDRESS: ++stats_.addresses; break;
+        case GeoKind::POI: ++stats_.pois; break;
+      }
+      out.push_back(std::move(e));
+    }
+  }
+  reader.close();
+  // По убыванию важности: Geocoder ранжирует первые по rowid совпадения, а подсказки
+  // сливают постинги по номеру, и города должны идти раньше тысяч одноимённых адресов
+  std::stable_sort(out.begin(), out.end(),
+                   [](const GeoEntity& a, const GeoEntity& b) { return a.importance > b.importance; });
+#else
+  (void)node_index;
+#endif
+  return out;
+}
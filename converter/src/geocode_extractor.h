@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pbf_reader.h"
+
+// Запись индекса геокодера (строка geo_entities). kind — routing_core::GeoKind.
+struct GeoEntity {
+  int kind {0};
+  std::string name;        // отображаемое имя; для адреса — "улица дом"
+  std::string street;
+  std::string housenumber;
+  std::string city;
+  std::string postcode;
+  std::string category;    // "ключ=значение" тега, по которому объект попал в индекс
+  double lat {0.0};
+  double lon {0.0};
+  double importance {0.0}; // 0..1, добавка к текстовому рангу
+};
+
+struct GeocodeStats {
+  uint64_t places {0};
+  uint64_t streets {0};
+  uint64_t addresses {0};
+  uint64_t pois {0};
+};
+
+// Проход по PBF: населённые пункты, именованные улицы, адреса (addr:housenumber)
+// и POI из узлов и путей. Координаты путей — среднее их узлов по индексу
+// PbfReader, поэтому вызывать до buildTiles(), который индекс освобождает.
+// Мультиполигоны и границы районов не разбираются: город берётся из addr:city.
+// Результат упорядочен по убыванию importance: позиция + 1 — id объекта в пакете.
+class GeocodeExtractor {
+public:
+  explicit GeocodeExtractor(std::string input_path) : input_path_(std::move(input_path)) {}
+
+  std::vector<GeoEntity> extract(const std::unordered_map<int64_t, SimpleNode>& node_index);
+  const GeocodeStats& stats() const { return stats_; }
+
+private:
+  std::string input_path_;
+  GeocodeStats stats_;
+};
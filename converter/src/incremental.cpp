@@ -0,0 +1,101 @@
+#include "incremental.h"
+
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+
+#include "osm_change.h"
+#include "pbf_reader.h"
+#include "serializer.h"
+#include "sqlite_writer.h"
+#include "tiler.h"
+#include "routing_core/checksum.h"
+
+IncrementalReport applyIncrementalUpdate(const IncrementalOptions& opt) {
+  IncrementalReport report;
+
+  OsmChange change = readOsmChange(opt.change_path);
+
+  RoutingDbWriter writer(opt.base_db);
+  if (!writer.hasWayIndex()) {
+    throw std::runtime_error("Base routingdb has no osm_way_tiles index (rebuild it with --way-index): " +
+                             opt.base_db);
+  }
+  int zoom = opt.zoom;
+  if (auto z = writer.readMetadata("tile_zoom")) zoom = std::stoi(*z);
+
+  uint32_t profile_mask = opt.profile_mask;
+  if (auto m = writer.readMetadata("profile_mask")) profile_mask = static_cast<uint32_t>(std::stoul(*m));
+  // Водный слой (пути рек вне osm_way_tiles, маски воды из полигонов) обновление
+  // не пересобирает: такой пакет после --update разошёлся бы с данными
+  if (profile_mask & kProfileBoat) {
+    throw std::runtime_error("--update does not rebuild water_tiles; rebuild packages with the boat profile in full: " +
+                             opt.base_db);
+  }
+
+  PbfReader reader(opt.pbf_path, zoom);
+  reader.setProfileMask(profile_mask);
+  if (auto oz = writer.readMetadata("overview_zoom")) reader.setOverviewZoom(std::stoi(*oz));
+  reader.setTouched(change.nodes, change.ways);
+  reader.readNodes();
+  // Сначала только затронутые пути: тайлы остальных дорог в памяти не собираются
+  reader.findTouchedWays();
+
+  // Затронутые тайлы: старое положение путей (индекс) + новое (PBF)
+  std::unordered_set<int64_t> ways = reader.touchedWays();
+  ways.insert(change.deleted_ways.begin(), change.deleted_ways.end());
+  std::unordered_set<long long> affected;
+  for (int64_t way_id : ways) {
+    for (long long key : writer.wayTiles(way_id)) affected.insert(key);
+    auto it = reader.wayTiles().find(way_id);
+    if (it != reader.wayTiles().end()) affected.insert(it->second.begin(), it->second.end());
+  }
+  report.touched_ways = ways.size();
+  report.affected_tiles = affected.size();
+
+  // Второй проход по путям собирает рёбра только затронутых тайлов
+  reader.setTileFilter(affected);
+  auto tiles = reader.buildTiles();
+
+  writer.beginTransaction();
+  try {
+    for (long long key : affected) {
+      const TileKey tk = unpackTileKey(key);
+      auto it = tiles.find(key);
+      const uint32_t tile_mask = it == tiles.end() ? 0 : tileProfileMask(it->second);
+      if (tile_mask == 0) {
+        writer.deleteLandTile(tk.z, tk.x, tk.y);
+        ++report.removed_tiles;
+        continue;
+      }
+      const TileData& t = it->second;
+      const int version = writer.landTileVersion(tk.z, tk.x, tk.y).value_or(0) + 1;
+      auto blob = buildLandTileBlob(t, static_cast<uint32_t>(version), tile_mask);
+      const std::string checksum = routing_core::sha256Hex(blob.data(), blob.size());
+      writer.upsertLandTile(tk.z, tk.x, tk.y, t.bbox, version, checksum,
+                            static_cast<int>(tile_mask), blob.data(), blob.size());
+      ++report.rewritten_tiles;
+    }
+
+    for (int64_t way_id : ways) {
+      writer.deleteWayTiles(way_id);
+      auto it = reader.wayTiles().find(way_id);
+      if (it != reader.wayTiles().end()) writer.insertWayTiles(way_id, it->second);
+    }
+
+    const std::string prevVersion = writer.readMetadata("data_version").value_or("1");
+    // геокодер --update не пересобирает: его версия остаётся прежней
+    if (writer.readMetadata("geocoder_entities") && !writer.readMetadata("geocoder_data_version")) {
+      writer.writeMetadata("geocoder_data_version", prevVersion);
+    }
+    const int data_version = std::stoi(prevVersion) + 1;
+    writer.writeMetadata("data_version", std::to_string(data_version));
+    writer.writeMetadata("source", opt.pbf_path);
+    writer.writeMetadata("last_change", opt.change_path);
+    writer.commitTransaction();
+  } catch (...) {
+    writer.rollbackTransaction();
+    throw;
+  }
+  return report;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct IncrementalOptions {
+  std::string base_db;     // routingdb, собранный с --way-index; обновляется на месте
+  std::string change_path; // OSM change (.osc)
+  std::string pbf_path;    // актуальный PBF (снимок с уже применённым .osc)
+  int zoom {14};
+  uint32_t profile_mask {0x3}; // если в metadata нет profile_mask (старые пакеты)
+};
+
+struct IncrementalReport {
+  size_t affected_tiles {0};
+  size_t rewritten_tiles {0};
+  size_t removed_tiles {0};
+  size_t touched_ways {0};
+};
+
+// Пересобирает только тайлы, затронутые изменёнными узлами/путями:
+// старые тайлы берутся из индекса osm_way_tiles, новые — из геометрии PBF.
+// Рёбра собираются только для затронутых тайлов (PbfReader::setTileFilter).
+// Все изменения применяются одной транзакцией.
+IncrementalReport applyIncrementalUpdate(const IncrementalOptions& opt);
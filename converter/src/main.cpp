@@ -3,19 +3,45 @@
 #include <string>
 #include <vector>
 #include <filesystem>
-#include <vector>
-#if __APPLE__
-#  include <CommonCrypto/CommonDigest.h>
-#endif
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <unordered_set>
 
 #include "sqlite_writer.h"
 #include "pbf_reader.h"
 #include "serializer.h"
+#include "incremental.h"
+#include "stats.h"
+#include "checkpoint.h"
+#include "geocode_extractor.h"
+#include "water_areas.h"
+#include "water_mask.h"
+#include "routing_core/checksum.h"
 
 namespace fs = std::filesystem;
 
 static void printUsage(const char* argv0) {
-  std::fprintf(stderr, "Usage: %s [--z ZOOM] input.osm.pbf output.routingdb\n", argv0);
+  std::fprintf(stderr,
+    "Usage: %s [--z ZOOM] [--overview-z ZOOM] [--profiles car,foot,boat] [--way-index] [--no-geocoder]\n"
+    "          [--stats report.json [--stats-top N]] [--resume [--checkpoint-dir DIR]] [--threads N]\n"
+    "          input.osm.pbf output.routingdb\n"
+    "       %s --update base.routingdb --changes changes.osc [--z ZOOM] input.osm.pbf\n"
+    "--overview-z: zoom of the motorway/primary/secondary overview layer (default 10, 0 = off)\n"
+    "--profiles  : comma-separated list of car, foot, boat (default car,foot);\n"
+    "              edges and tiles no listed profile can use are dropped;\n"
+    "              boat adds water_tiles built from waterway=river/canal and\n"
+    "              an open-water mask from natural=water/coastline\n"
+    "--way-index : store osm_way_tiles index (required for --update)\n"
+    "--no-geocoder: skip the offline search index (places, streets, addresses, POIs)\n"
+    "--stats     : write per-stage time/memory, counters and tile size histograms as JSON\n"
+    "--stats-top : number of heaviest tiles listed in the report (default 20)\n"
+    "--threads   : worker threads for water polygon assembly and masks (default: all cores)\n"
+    "--resume    : checkpoint stages and continue an interrupted run of the same command\n"
+    "--checkpoint-dir: checkpoint location (default output.routingdb.ckpt)\n"
+    "--update    : rebuild only tiles touched by changes.osc, in place\n",
+    argv0, argv0);
 }
 
 int main(int argc, char** argv) {
@@ -25,6 +51,17 @@ int main(int argc, char** argv) {
   }
 
   int zoom = 14;
+  int overviewZoom = 10;
+  std::string profiles = "car,foot";
+  std::string statsPath;
+  size_t statsTop = 20;
+  bool resume = false;
+  std::string checkpointDir;
+  bool wayIndex = false;
+  bool geocoder = true;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  std::string updateDbPath;
+  std::string changesPath;
   std::vector<std::string> args;
   for (int i = 1; i < argc; ++i) args.emplace_back(argv[i]);
   for (size_t i = 0; i < args.size();) {
@@ -32,11 +69,78 @@ int main(int argc, char** argv) {
       if (i + 1 >= args.size()) { printUsage(argv[0]); return 1; }
       zoom = std::stoi(args[i + 1]);
       args.erase(args.begin() + i, args.begin() + i + 2);
+    } else if (args[i] == "--overview-z") {
+      if (i + 1 >= args.size()) { printUsage(argv[0]); return 1; }
+      overviewZoom = std::stoi(args[i + 1]);
+      args.erase(args.begin() + i, args.begin() + i + 2);
+    } else if (args[i] == "--profiles") {
+      if (i + 1 >= args.size()) { printUsage(argv[0]); return 1; }
+      profiles = args[i + 1];
+      args.erase(args.begin() + i, args.begin() + i + 2);
+    } else if (args[i] == "--stats") {
+      if (i + 1 >= args.size()) { printUsage(argv[0]); return 1; }
+      statsPath = args[i + 1];
+      args.erase(args.begin() + i, args.begin() + i + 2);
+    } else if (args[i] == "--stats-top") {
+      if (i + 1 >= args.size()) { printUsage(argv[0]); return 1; }
+      statsTop = static_cast<size_t>(std::stoul(args[i + 1]));
+      args.erase(args.begin() + i, args.begin() + i + 2);
+    } else if (args[i] == "--resume") {
+      resume = true;
+      args.erase(args.begin() + i);
+    } else if (args[i] == "--checkpoint-dir") {
+      if (i + 1 >= args.size()) { printUsage(argv[0]); return 1; }
+      checkpointDir = args[i + 1];
+      args.erase(args.begin() + i, args.begin() + i + 2);
+    } else if (args[i] == "--way-index") {
+      wayIndex = true;
+      args.erase(args.begin() + i);
+    } else if (args[i] == "--threads") {
+      if (i + 1 >= args.size()) { printUsage(argv[0]); return 1; }
+      threads = std::max(1u, static_cast<unsigned>(std::stoul(args[i + 1])));
+      args.erase(args.begin() + i, args.begin() + i + 2);
+    } else if (args[i] == "--no-geocoder") {
+      geocoder = false;
+      args.erase(args.begin() + i);
+    } else if (args[i] == "--update" || args[i] == "--changes") {
+      if (i + 1 >= args.size()) { printUsage(argv[0]); return 1; }
+      (args[i] == "--update" ? updateDbPath : changesPath) = args[i + 1];
+      args.erase(args.begin() + i, args.begin() + i + 2);
     } else {
       ++i;
     }
   }
+
+  uint32_t profile_mask = 0;
+  try {
+    profile_mask = parseProfileList(profiles);
+  } catch (const std::exception& ex) {
+    std::fprintf(stderr, "Error: %s\n", ex.what());
+    return 1;
+  }
+
+  if (!updateDbPath.empty()) {
+    if (changesPath.empty() || args.size() < 1) { printUsage(argv[0]); return 1; }
+    try {
+      IncrementalOptions opt;
+      opt.base_db = updateDbPath;
+      opt.change_path = changesPath;
+      opt.pbf_path = args[0];
+      opt.zoom = zoom;
+      opt.profile_mask = profile_mask;
+      auto report = applyIncrementalUpdate(opt);
+      std::printf("Touched ways: %zu\n", report.touched_ways);
+      std::printf("Affected tiles: %zu (rewritten %zu, removed %zu)\n",
+                  report.affected_tiles, report.rewritten_tiles, report.removed_tiles);
+      return 0;
+    } catch (const std::exception& ex) {
+      std::fprintf(stderr, "Error: %s\n", ex.what());
+      return 2;
+    }
+  }
+
   if (args.size() < 2) { printUsage(argv[0]); return 1; }
+  if (overviewZoom >= zoom) overviewZoom = 0; // обзорный слой должен быть грубее основного
 
   const std::string inputPbfPath = args[0];
   const std::string outputDbPath = args[1];
@@ -47,53 +151,265 @@ int main(int argc, char** argv) {
     if (outPath.has_parent_path()) {
       fs::create_directories(outPath.parent_path());
     }
-    if (fs::exists(outPath)) {
+
+    // --resume: стадии сохраняются в каталог чекпоинта; повторный запуск той же
+    // команды (тот же PBF и параметры) продолжает с последней завершённой стадии.
+    std::unique_ptr<Checkpoint> ckpt;
+    bool resumed = false;
+    if (resume) {
+      ckpt = std::make_unique<Checkpoint>(checkpointDir.empty() ? outputDbPath + ".ckpt" : checkpointDir);
+      const std::string params = "z=" + std::to_string(zoom) + ";overview_z=" + std::to_string(overviewZoom) +
+                                 ";profiles=" + std::to_string(profile_mask) + ";way_index=" + (wayIndex ? "1" : "0") +
+                                 ";geocoder=" + (geocoder ? "1" : "0");
+      resumed = ckpt->open(Checkpoint::fingerprint(inputPbfPath, params));
+      if (resumed) std::printf("Resuming from checkpoint %s\n", ckpt->path("").c_str());
+    }
+    if (!resumed && fs::exists(outPath)) {
       fs::remove(outPath);
+      fs::remove(outputDbPath + ".ac");
     }
 
+    std::unique_ptr<ConverterStats> stats;
+    if (!statsPath.empty()) stats = std::make_unique<ConverterStats>();
+
     RoutingDbWriter writer(outputDbPath);
     writer.createSchemaIfNeeded();
+    if (wayIndex) writer.createWayIndexSchema();
+    if (resumed && writer.readMetadata("build_state").value_or("") == "complete") {
+      ckpt->remove();
+      std::puts("Output is already complete");
+      return 0;
+    }
 
     PbfReader reader(inputPbfPath, zoom);
-    auto tiles = reader.readAndTile();
+    reader.setCollectWayTiles(wayIndex);
+    reader.setOverviewZoom(overviewZoom);
+    reader.setProfileMask(profile_mask);
+    std::unordered_map<long long, TileData> tiles;
+    std::unordered_map<long long, TileData> waterTiles;
+    std::unordered_map<int64_t, std::vector<long long>> restoredWayTiles;
+    std::optional<GeocodeStats> geocodeStats;
+    std::optional<WaterAreaStats> waterAreaStats;
+    std::optional<WaterMaskStats> waterMaskStats;
+    const auto* wayTiles = &reader.wayTiles();
+    if (ckpt && ckpt->hasStage("tiles")) {
+      ScopedStage stage(stats.get(), "load_checkpoint");
+      PbfReaderStats readerStats;
+      loadTileBuckets(ckpt->path("tiles.bin"), tiles, restoredWayTiles, readerStats);
+      reader.setStats(readerStats);
+      if (profile_mask & kProfileBoat) {
+        std::unordered_map<int64_t, std::vector<long long>> unused;
+        PbfReaderStats unusedStats;
+        loadTileBuckets(ckpt->path("water.bin"), waterTiles, unused, unusedStats);
+      }
+      wayTiles = &restoredWayTiles;
+    } else {
+      {
+        ScopedStage stage(stats.get(), "read_nodes");
+        if (ckpt && ckpt->hasStage("nodes")) {
+          std::unordered_map<int64_t, SimpleNode> index;
+          std::vector<RestrictionRelation> restrictions;
+          loadNodeIndex(ckpt->path("nodes.bin"), index, restrictions);
+          reader.setNodeIndex(std::move(index), std::move(restrictions));
+        } else {
+          reader.readNodes();
+          if (ckpt) {
+            saveNodeIndex(ckpt->path("nodes.bin"), reader.nodeIndex(), reader.restrictionRelations());
+            ckpt->markStage("nodes");
+          }
+        }
+      }
+      // Геокодер читает координаты путей из индекса узлов — до buildTiles(),
+      // который индекс освобождает. Таблицы пишутся своей транзакцией целиком.
+      if (geocoder && !(ckpt && ckpt->hasStage("geocoder"))) {
+        ScopedStage stage(stats.get(), "geocoder");
+        GeocodeExtractor extractor(inputPbfPath);
+        const auto entities = extractor.extract(reader.nodeIndex());
+        writer.beginTransaction();
+        const size_t acBytes = writer.writeGeocoder(entities, outputDbPath, "1");
+        writer.commitTransaction();
+        geocodeStats = extractor.stats();
+        std::printf("Geocoder entities: %zu (autocomplete %zu KB)\n", entities.size(), acBytes / 1024);
+        if (ckpt) ckpt->markStage("geocoder");
+      }
+      // Полигоны воды тоже берут координаты из индекса узлов
+      std::vector<WaterArea> waterAreas;
+      if (profile_mask & kProfileBoat) {
+        ScopedStage stage(stats.get(), "water_areas");
+        WaterAreaExtractor extractor(inputPbfPath, threads);
+        waterAreas = extractor.extract(reader.nodeIndex());
+        waterAreaStats = extractor.stats();
+        std::printf("Water areas: %llu polygons, %llu multipolygons, %llu coastlines (%llu failed)\n",
+                    static_cast<unsigned long long>(waterAreaStats->polygons),
+                    static_cast<unsigned long long>(waterAreaStats->multipolygons),
+                    static_cast<unsigned long long>(waterAreaStats->coastlines),
+                    static_cast<unsigned long long>(waterAreaStats->failed));
+      }
+      {
+        ScopedStage stage(stats.get(), "build_tiles");
+        tiles = reader.buildTiles();
+        waterTiles = reader.takeWaterTiles();
+      }
+      if (profile_mask & kProfileBoat) {
+        ScopedStage stage(stats.get(), "water_mask");
+        waterMaskStats = buildWaterMasks(waterAreas, zoom, kWaterMaskDepth, threads, waterTiles);
+        waterAreas = {};
+        std::printf("Open water tiles: %llu (full %llu, %llu KB)\n",
+                    static_cast<unsigned long long>(waterMaskStats->tiles),
+                    static_cast<unsigned long long>(waterMaskStats->full_tiles),
+                    static_cast<unsigned long long>(waterMaskStats->bytes / 1024));
+      }
+      if (ckpt) {
+        ScopedStage stage(stats.get(), "save_checkpoint");
+        saveTileBuckets(ckpt->path("tiles.bin"), tiles, reader.wayTiles(), reader.stats());
+        if (profile_mask & kProfileBoat) saveTileBuckets(ckpt->path("water.bin"), waterTiles, {}, {});
+        ckpt->markStage("tiles");
+      }
+    }
 
     // Пока только пишем metadata, чтобы DB был валиден
     writer.writeMetadata("schema_version", "1");
     writer.writeMetadata("source", inputPbfPath);
+    writer.writeMetadata("tile_zoom", std::to_string(zoom));
+    if (overviewZoom > 0) writer.writeMetadata("overview_zoom", std::to_string(overviewZoom));
+    writer.writeMetadata("data_version", "1");
+    writer.writeMetadata("profiles", profileListName(profile_mask));
+    writer.writeMetadata("profile_mask", std::to_string(profile_mask));
 
     std::printf("Parsed tiles: %zu\n", tiles.size());
+
+    // Тайлы пишутся в порядке ключей. С --resume — порциями по kResumeChunkTiles,
+    // и в той же транзакции в metadata.build_state фиксируется, сколько уже записано.
+    constexpr size_t kResumeChunkTiles = 2000;
+    std::vector<long long> order;
+    order.reserve(tiles.size());
+    for (const auto& kv : tiles) order.push_back(kv.first);
+    std::sort(order.begin(), order.end());
+
+    size_t done = 0;
+    if (resumed) {
+      const std::string state = writer.readMetadata("build_state").value_or("");
+      if (state.rfind("tiles:", 0) == 0) done = std::min<size_t>(std::stoul(state.substr(6)), order.size());
+      if (done > 0) std::printf("Skipping %zu tiles written before the restart\n", done);
+    }
+
     // Serialize and write
     const uint32_t version = 1;
-    const uint32_t profile_mask = 0x3; // car|foot
     int count_written = 0;
-    for (auto& [key, t] : tiles) {
-      auto blob = buildLandTileBlob(t, version, profile_mask);
-
-      // checksum
-      std::string checksum_hex;
-#if __APPLE__
-      unsigned char digest[CC_SHA256_DIGEST_LENGTH];
-      CC_SHA256(blob.data(), static_cast<CC_LONG>(blob.size()), digest);
-      static const char* hex = "0123456789abcdef";
-      checksum_hex.resize(CC_SHA256_DIGEST_LENGTH * 2);
-      for (int i = 0; i < CC_SHA256_DIGEST_LENGTH; ++i) {
-        checksum_hex[2*i] = hex[(digest[i] >> 4) & 0xF];
-        checksum_hex[2*i+1] = hex[digest[i] & 0xF];
+    writer.beginTransaction();
+    {
+      ScopedStage stage(stats.get(), "write_tiles");
+      for (size_t i = done; i < order.size(); ++i) {
+        const TileData& t = tiles[order[i]];
+        // profile_mask тайла — фактически присутствующие профили, а не весь пакет
+        const uint32_t tile_mask = tileProfileMask(t);
+        if (tile_mask != 0) {
+          auto blob = buildLandTileBlob(t, version, tile_mask);
+          const std::string checksum_hex = routing_core::sha256Hex(blob.data(), blob.size());
+
+          // Use real WebMercator z/x/y
+          int z = t.key.z;
+          int x = t.key.x;
+          int y = t.key.y;
+
+          writer.insertLandTile(z, x, y, t.bbox, version, checksum_hex, static_cast<int>(tile_mask),
+                                blob.data(), blob.size());
+          ++count_written;
+
+          if (stats) {
+            TileStat ts;
+            ts.key = t.key;
+            ts.bytes = blob.size();
+            ts.edges = t.edges.size();
+            std::unordered_set<int64_t> endpoints;
+            for (const auto& e : t.edges) {
+              endpoints.insert(e.from_node_id);
+              endpoints.insert(e.to_node_id);
+              ts.shape_points += e.shape.size();
+            }
+            ts.nodes = endpoints.size();
+            stats->addTile(ts);
+          }
+        }
+
+        if (ckpt && (i + 1) % kResumeChunkTiles == 0 && i + 1 < order.size()) {
+          writer.writeMetadata("build_state", "tiles:" + std::to_string(i + 1));
+          writer.commitTransaction();
+          writer.beginTransaction();
+        }
+      }
+    }
+    // Водный граф: те же тайлы и сериализация, своя таблица. Пишется целиком
+    // в последней транзакции (он на порядки меньше дорожного).
+    size_t waterWritten = 0;
+    if (profile_mask & kProfileBoat) {
+      ScopedStage stage(stats.get(), "write_water_tiles");
+      writer.createWaterSchema();
+      std::vector<long long> waterOrder;
+      waterOrder.reserve(waterTiles.size());
+      for (const auto& kv : waterTiles) waterOrder.push_back(kv.first);
+      std::sort(waterOrder.begin(), waterOrder.end());
+      for (long long key : waterOrder) {
+        const TileData& t = waterTiles[key];
+        const uint32_t tile_mask = tileProfileMask(t);
+        if (tile_mask == 0) continue;
+        auto blob = buildLandTileBlob(t, version, tile_mask);
+        writer.insertWaterTile(t.key.z, t.key.x, t.key.y, t.bbox, version,
+                               routing_core::sha256Hex(blob.data(), blob.size()), static_cast<int>(tile_mask),
+                               blob.data(), blob.size());
+        ++waterWritten;
       }
-#else
-      checksum_hex = "";
-#endif
-
-      // Use real WebMercator z/x/y
-      int z = t.key.z;
-      int x = t.key.x;
-      int y = t.key.y;
-
-      writer.insertLandTile(z, x, y, t.bbox, version, checksum_hex, profile_mask,
-                            blob.data(), blob.size());
-      ++count_written;
+      writer.writeMetadata("water_tiles", std::to_string(waterWritten));
     }
+    if (wayIndex) {
+      ScopedStage stage(stats.get(), "way_index");
+      for (const auto& [way_id, keys] : *wayTiles) writer.insertWayTiles(way_id, keys);
+    }
+    if (ckpt) writer.writeMetadata("build_state", "complete");
+    {
+      ScopedStage stage(stats.get(), "commit");
+      writer.commitTransaction();
+    }
+    if (ckpt) ckpt->remove();
     std::printf("Written tiles: %d\n", count_written);
+    if (profile_mask & kProfileBoat) std::printf("Written water tiles: %zu\n", waterWritten);
+
+    if (stats) {
+      const auto& rs = reader.stats();
+      stats->setCounter("osm_nodes", rs.nodes);
+      stats->setCounter("osm_ways", rs.ways);
+      stats->setCounter("highway_ways", rs.highway_ways);
+      stats->setCounter("edges", rs.edges);
+      stats->setCounter("restriction_relations", rs.restriction_relations);
+      stats->setCounter("restrictions", rs.restrictions);
+      if (profile_mask & kProfileBoat) {
+        stats->setCounter("water_ways", rs.water_ways);
+        stats->setCounter("water_edges", rs.water_edges);
+        stats->setCounter("water_tiles_written", waterWritten);
+      }
+      if (waterAreaStats) {
+        stats->setCounter("water_polygons", waterAreaStats->polygons);
+        stats->setCounter("water_multipolygons", waterAreaStats->multipolygons);
+        stats->setCounter("water_coastlines", waterAreaStats->coastlines);
+        stats->setCounter("water_areas_failed", waterAreaStats->failed);
+      }
+      if (waterMaskStats) {
+        stats->setCounter("water_mask_runs", waterMaskStats->runs);
+        stats->setCounter("water_mask_tiles", waterMaskStats->tiles);
+        stats->setCounter("water_mask_full_tiles", waterMaskStats->full_tiles);
+        stats->setCounter("water_mask_bytes", waterMaskStats->bytes);
+      }
+      stats->setCounter("tiles_parsed", tiles.size());
+      stats->setCounter("tiles_written", static_cast<uint64_t>(count_written));
+      if (geocodeStats) {
+        stats->setCounter("geo_places", geocodeStats->places);
+        stats->setCounter("geo_streets", geocodeStats->streets);
+        stats->setCounter("geo_addresses", geocodeStats->addresses);
+        stats->setCounter("geo_pois", geocodeStats->pois);
+      }
+      stats->writeJson(statsPath, statsTop);
+      std::printf("Stats report: %s\n", statsPath.c_str());
+    }
     std::puts("Created routing SQLite container with schema (metadata + land_tiles)");
     return 0;
   } catch (const std::exception& ex) {
@@ -101,5 +417,3 @@ int main(int argc, char** argv) {
     return 2;
   }
 }
-
-
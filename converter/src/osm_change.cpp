@@ -0,0 +1,52 @@
+#include "osm_change.h"
+
+#include <stdexcept>
+
+#ifdef HAVE_LIBOSMIUM
+#  include <osmium/io/any_input.hpp>
+#  include <osmium/osm/node.hpp>
+#  include <osmium/osm/relation.hpp>
+#  include <osmium/osm/way.hpp>
+#endif
+
+#include <cstring>
+
+OsmChange readOsmChange(const std::string& path) {
+  OsmChange change;
+#ifdef HAVE_LIBOSMIUM
+  // Формат определяется по расширению (.osc, .osc.gz, .osc.bz2)
+  osmium::io::Reader reader{path, osmium::osm_entity_bits::node | osmium::osm_entity_bits::way |
+                                  osmium::osm_entity_bits::relation};
+  while (osmium::memory::Buffer buffer = reader.read()) {
+    for (const osmium::OSMEntity& entity : buffer) {
+      if (entity.type() == osmium::item_type::node) {
+        const auto& n = static_cast<const osmium::Node&>(entity);
+        change.nodes.insert(n.id());
+      } else if (entity.type() == osmium::item_type::way) {
+        const auto& w = static_cast<const osmium::Way&>(entity);
+        if (w.visible()) {
+          change.ways.insert(w.id());
+        } else {
+          change.deleted_ways.insert(w.id());
+        }
+      } else if (entity.type() == osmium::item_type::relation) {
+        const auto& r = static_cast<const osmium::Relation&>(entity);
+        const char* type = r.tags().get_value_by_key("type");
+        // у удалённого отношения тегов может не быть — смотрим на роли членов
+        if (type && std::strcmp(type, "restriction") != 0) continue;
+        for (const auto& m : r.members()) {
+          const char* role = m.role();
+          const bool via = std::strcmp(role, "via") == 0;
+          if (!via && std::strcmp(role, "from") != 0) continue;
+          if (m.type() == osmium::item_type::way) change.ways.insert(m.ref());
+          else if (via && m.type() == osmium::item_type::node) change.nodes.insert(m.ref());
+        }
+      }
+    }
+  }
+  reader.close();
+#else
+  throw std::runtime_error("Reading OSM change files requires libosmium: " + path);
+#endif
+  return change;
+}
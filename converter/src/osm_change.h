@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+
+// Содержимое OSM change-файла (.osc), сведённое к затронутым объектам.
+struct OsmChange {
+  // Изменённые запреты манёвров (type=restriction) добавляют свои from/via:
+  // запрет хранится в тайле ребра from -> via, его нужно пересобрать. У удалённого
+  // отношения без членов (в .osc delete их обычно нет) затронутые пути не узнать.
+  std::unordered_set<int64_t> nodes;        // созданные, изменённые и удалённые узлы; via-узлы запретов
+  std::unordered_set<int64_t> ways;         // созданные и изменённые пути; from/via-пути запретов
+  std::unordered_set<int64_t> deleted_ways; // удалённые пути
+};
+
+OsmChange readOsmChange(const std::string& path);
@@ -1,9 +1,17 @@
 #include "pbf_reader.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <stdexcept>
 #include <unordered_map>
 
+#include "tag_table.h"
+
+static_assert(tag_table::kCar == kProfileCar && tag_table::kFoot == kProfileFoot &&
+              tag_table::kBoat == kProfileBoat,
+              "tag_table access bits must match profile_mask bits");
+
 #ifdef HAVE_LIBOSMIUM
 #  include <osmium/io/any_input.hpp>
 #  include <osmium/handler.hpp>
@@ -11,90 +19,284 @@
 #  include <osmium/osm/types.hpp>
 #  include <osmium/osm/way.hpp>
 #  include <osmium/osm/node.hpp>
+#  include <osmium/osm/relation.hpp>
 #endif
 
+#ifdef HAVE_LIBOSMIUM
+// type=restriction с via-узлом; via-путь и restriction:conditional не поддерживаются,
+// отношения с except=motorcar к авто не применяются.
+static bool parseRestriction(const osmium::Relation& r, RestrictionRelation& out) {
+  const char* type = r.tags().get_value_by_key("type");
+  if (!type || std::strcmp(type, "restriction") != 0) return false;
+  const char* kind = r.tags().get_value_by_key("restriction");
+  if (!kind) kind = r.tags().get_value_by_key("restriction:motorcar");
+  if (!kind) return false;
+  const char* except = r.tags().get_value_by_key("except");
+  if (except && std::strstr(except, "motorcar")) return false;
+  if (std::strncmp(kind, "no_", 3) == 0) out.only = false;
+  else if (std::strncmp(kind, "only_", 5) == 0) out.only = true;
+  else return false;
+
+  int from = 0, via = 0, to = 0;
+  for (const auto& m : r.members()) {
+    const char* role = m.role();
+    if (std::strcmp(role, "from") == 0 && m.type() == osmium::item_type::way) {
+      out.from_way = m.ref();
+      ++from;
+    } else if (std::strcmp(role, "to") == 0 && m.type() == osmium::item_type::way) {
+      out.to_way = m.ref();
+      ++to;
+    } else if (std::strcmp(role, "via") == 0) {
+      if (m.type() != osmium::item_type::node) return false;
+      out.via_node = m.ref();
+      ++via;
+    }
+  }
+  return from == 1 && via == 1 && to == 1;
+}
+#endif
+
+uint32_t parseProfileList(const std::string& list) {
+  uint32_t mask = 0;
+  size_t pos = 0;
+  while (pos <= list.size()) {
+    size_t comma = list.find(',', pos);
+    if (comma == std::string::npos) comma = list.size();
+    const std::string name = list.substr(pos, comma - pos);
+    if (name == "car") mask |= kProfileCar;
+    else if (name == "foot") mask |= kProfileFoot;
+    else if (name == "boat") mask |= kProfileBoat;
+    else throw std::runtime_error("Unknown profile: '" + name + "' (expected car, foot, boat)");
+    pos = comma + 1;
+  }
+  return mask;
+}
+
+std::string profileListName(uint32_t mask) {
+  std::string out;
+  if (mask & kProfileCar) out += "car";
+  if (mask & kProfileFoot) out += out.empty() ? "foot" : ",foot";
+  if (mask & kProfileBoat) out += out.empty() ? "boat" : ",boat";
+  return out;
+}
+
+uint32_t tileProfileMask(const TileData& tile) {
+  uint32_t mask = 0;
+  for (const auto& e : tile.edges) {
+    if (e.car_access) mask |= kProfileCar;
+    if (e.foot_access) mask |= kProfileFoot;
+    if (e.boat_access) mask |= kProfileBoat;
+  }
+  if (!tile.water_cells.empty()) mask |= kProfileBoat;
+  return mask;
+}
+
 PbfReader::PbfReader(std::string input_path, int zoom)
   : input_path_(std::move(input_path)), zoom_(zoom) {}
 
-static inline long long make_key(const TileKey& k) {
-  return (static_cast<long long>(k.z) << 58) ^ (static_cast<long long>(k.x) << 29) ^ static_cast<long long>(k.y);
+void PbfReader::setTouched(std::unordered_set<int64_t> nodes, std::unordered_set<int64_t> ways) {
+  touched_nodes_ = std::move(nodes);
+  touched_ways_ = std::move(ways);
 }
 
 std::unordered_map<long long, TileData> PbfReader::readAndTile() {
-  std::unordered_map<long long, TileData> result;
+  readNodes();
+  return buildTiles();
+}
+
+void PbfReader::readNodes() {
+  stats_ = PbfReaderStats{};
+  node_index_.clear();
+  restriction_relations_.clear();
 
 #ifdef HAVE_LIBOSMIUM
   osmium::io::Reader reader{input_path_};
 
-  std::unordered_map<osmium::object_id_type, SimpleNode> node_index;
-
   // Первый проход: собрать узлы
   while (osmium::memory::Buffer buffer = reader.read()) {
     for (const osmium::OSMEntity& entity : buffer) {
       if (entity.type() == osmium::item_type::node) {
         const auto& n = static_cast<const osmium::Node&>(entity);
         SimpleNode sn{n.id(), n.location().lat(), n.location().lon()};
-        node_index[sn.id] = sn;
+        node_index_[sn.id] = sn;
+        ++stats_.nodes;
+      } else if (entity.type() == osmium::item_type::relation) {
+        RestrictionRelation rr;
+        if (parseRestriction(static_cast<const osmium::Relation&>(entity), rr)) {
+          restriction_relations_.push_back(rr);
+          ++stats_.restriction_relations;
+        }
       }
     }
   }
   reader.close();
+#endif
+}
+
+void PbfReader::resolveRestrictions(const std::unordered_map<int64_t, std::vector<int64_t>>& way_nodes,
+                                    std::unordered_map<long long, TileData>& result) {
+  // Соседи via на пути (обычно путь начинается/заканчивается в via — сосед один)
+  auto neighbours = [](const std::vector<int64_t>& nodes, int64_t via) {
+    std::vector<int64_t> out;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      if (nodes[i] != via) continue;
+      if (i > 0) out.push_back(nodes[i - 1]);
+      if (i + 1 < nodes.size()) out.push_back(nodes[i + 1]);
+    }
+    return out;
+  };
 
+  for (const auto& rel : restriction_relations_) {
+    auto fw = way_nodes.find(rel.from_way);
+    auto tw = way_nodes.find(rel.to_way);
+    auto vn = node_index_.find(rel.via_node);
+    if (fw == way_nodes.end() || tw == way_nodes.end() || vn == node_index_.end()) continue;
+    const SimpleNode& via = vn->second;
+
+    for (int64_t f : neighbours(fw->second, rel.via_node)) {
+      auto fn = node_index_.find(f);
+      if (fn == node_index_.end()) continue;
+      const SimpleNode& from = fn->second;
+      // Тайл ребра from -> via: по центру сегмента, как в buildTiles
+      const double lat_c = 0.5 * (from.lat + via.lat);
+      const double lon_c = 0.5 * (from.lon + via.lon);
+      for (int64_t t : neighbours(tw->second, rel.via_node)) {
+        auto tn = node_index_.find(t);
+        if (tn == node_index_.end()) continue;
+        const TurnRestrictionData tr{from, via, tn->second, rel.only};
+        bool stored = false;
+        for (int z : {zoom_, overview_zoom_}) {
+          if (z <= 0) continue;
+          auto it = result.find(packTileKey(tileKeyFor(lat_c, lon_c, z)));
+          if (it == result.end()) continue;
+          it->second.restrictions.push_back(tr);
+          stored = true;
+        }
+        if (stored) ++stats_.restrictions;
+      }
+    }
+  }
+}
+
+std::unordered_map<long long, TileData> PbfReader::buildTiles() {
+  std::unordered_map<long long, TileData> result;
+  water_tiles_.clear();
+
+  // Пути, участвующие в запретах манёвров: нужны их узлы для разрешения отношений
+  std::unordered_set<int64_t> restriction_ways;
+  for (const auto& rel : restriction_relations_) {
+    restriction_ways.insert(rel.from_way);
+    restriction_ways.insert(rel.to_way);
+  }
+  std::unordered_map<int64_t, std::vector<int64_t>> restriction_way_nodes;
+  scanWays(&result, restriction_ways, restriction_way_nodes);
+
+  resolveRestrictions(restriction_way_nodes, result);
+  node_index_ = {};
+  return result;
+}
+
+void PbfReader::findTouchedWays() {
+  std::unordered_map<int64_t, std::vector<int64_t>> unused;
+  scanWays(nullptr, {}, unused);
+}
+
+void PbfReader::scanWays(std::unordered_map<long long, TileData>* result,
+                         const std::unordered_set<int64_t>& restriction_ways,
+                         std::unordered_map<int64_t, std::vector<int64_t>>& restriction_way_nodes) {
+  const auto& node_index = node_index_;
+  // без result — только затронутые пути и их тайлы, ни рёбер, ни счётчиков
+  const bool build = result != nullptr;
+
+#ifdef HAVE_LIBOSMIUM
   // Второй проход: собрать ways c highway=*
   osmium::io::Reader reader2{input_path_};
   while (osmium::memory::Buffer buffer = reader2.read()) {
     for (const osmium::OSMEntity& entity : buffer) {
       if (entity.type() == osmium::item_type::way) {
         const auto& w = static_cast<const osmium::Way&>(entity);
-        const char* highway = w.tags().get_value_by_key("highway");
-        if (!highway) continue;
-
-        // Простейший маппинг классов
-        int road_class = 3; // RESIDENTIAL default
-        if (std::strcmp(highway, "motorway") == 0) road_class = 0;
-        else if (std::strcmp(highway, "primary") == 0) road_class = 1;
-        else if (std::strcmp(highway, "secondary") == 0) road_class = 2;
-        else if (std::strcmp(highway, "footway") == 0) road_class = 4;
-        else if (std::strcmp(highway, "path") == 0) road_class = 5;
-        else if (std::strcmp(highway, "steps") == 0) road_class = 6;
+        if (build) ++stats_.ways;
+        // Класс, доступ, oneway и скорость — по таблице тегов (tag_table.h)
+        tag_table::WayTagClassifier classifier;
+        for (const osmium::Tag& tag : w.tags()) classifier.add(tag.key(), tag.value());
+        const tag_table::WayAttributes attrs = classifier.result();
+        if (attrs.road_class < 0) continue;
+        if (restriction_ways.count(w.id())) {
+          auto& ids = restriction_way_nodes[w.id()];
+          for (const auto& nd_ref : w.nodes()) ids.push_back(nd_ref.ref());
+        }
 
-        const bool oneway = w.tags().has_tag("oneway", "yes");
+        const int road_class = attrs.road_class;
+        const bool oneway = attrs.oneway != tag_table::kOnewayNo;
+        const bool reversed = attrs.oneway == tag_table::kOnewayBackward;
+        const bool water = road_class >= tag_table::kFirstWaterClass;
+        const bool car_access = !water && (attrs.access & profile_mask_ & kProfileCar) != 0;
+        const bool foot_access = !water && (attrs.access & profile_mask_ & kProfileFoot) != 0;
+        const bool boat_access = water && (attrs.access & profile_mask_ & kProfileBoat) != 0;
+        if (!car_access && !foot_access && !boat_access) continue;
 
+        bool touched = touched_ways_.count(w.id()) != 0;
         std::vector<SimpleNode> shape;
         shape.reserve(w.nodes().size());
         for (const auto& nd_ref : w.nodes()) {
+          if (!touched && !touched_nodes_.empty() &&
+              touched_nodes_.count(static_cast<int64_t>(nd_ref.positive_ref()))) {
+            touched = true;
+          }
           auto it = node_index.find(nd_ref.positive_ref());
           if (it == node_index.end()) continue;
           shape.push_back(it->second);
         }
-        if (shape.size() < 2) continue;
+        if (touched) touched_ways_.insert(w.id());
+        if (shape.size() < 2 || (!build && !touched)) continue;
+        if (build) ++(water ? stats_.water_ways : stats_.highway_ways);
+        const char* wayName = w.tags().get_value_by_key("name");
+        std::vector<long long>* way_tiles = nullptr;
+        if (!water && (touched || collect_all_way_tiles_)) way_tiles = &way_tiles_[w.id()];
 
-        // Разложить по сегментам между последовательными точками
+        // Разложить по сегментам между последовательными точками. Водные пути
+        // рисуются по течению, поэтому ребро from -> to водного графа идёт вниз по реке.
         for (size_t s = 1; s < shape.size(); ++s) {
-          const SimpleNode& a = shape[s - 1];
-          const SimpleNode& b = shape[s];
+          // oneway=-1: ребро направляем против порядка узлов пути
+          const SimpleNode& a = reversed ? shape[s] : shape[s - 1];
+          const SimpleNode& b = reversed ? shape[s - 1] : shape[s];
           // Тайл по центру сегмента
           const double lat_c = 0.5 * (a.lat + b.lat);
           const double lon_c = 0.5 * (a.lon + b.lon);
-          TileKey tk = tileKeyFor(lat_c, lon_c, zoom_);
-          long long key = make_key(tk);
-          auto& td = result[key];
-          td.key = tk;
-          td.bbox = tileBounds(tk);
-
-          // Добавить вершины (уникальность по id в будущем, пока просто пушим)
-          td.nodes.push_back(a);
-          td.nodes.push_back(b);
-
           SimpleEdge e;
+          e.way_id = w.id();
           e.from_node_id = a.id;
           e.to_node_id = b.id;
           e.shape = {a, b};
           e.oneway = oneway;
           e.road_class = road_class;
-          e.car_access = !(road_class >= 4); // нет для чисто пешеходных
-          e.foot_access = true;
-          td.edges.push_back(std::move(e));
+          e.car_access = car_access;
+          e.foot_access = foot_access;
+          e.boat_access = boat_access;
+          e.against_flow = water && reversed;
+          e.speed_kmh = attrs.speed_kmh;
+          if (wayName) e.name = wayName;
+
+          auto addToTile = [&](const TileKey& tk) {
+            long long key = packTileKey(tk);
+            if (way_tiles && std::find(way_tiles->begin(), way_tiles->end(), key) == way_tiles->end()) {
+              way_tiles->push_back(key);
+            }
+            if (!build || (tile_filter_ && !tile_filter_->count(key))) return;
+            auto& td = (water ? water_tiles_ : *result)[key];
+            td.key = tk;
+            td.bbox = tileBounds(tk);
+
+            // Добавить вершины (уникальность по id в будущем, пока просто пушим)
+            td.nodes.push_back(a);
+            td.nodes.push_back(b);
+            td.edges.push_back(e);
+          };
+          if (build) ++(water ? stats_.water_edges : stats_.edges);
+          addToTile(tileKeyFor(lat_c, lon_c, zoom_));
+          if (overview_zoom_ > 0 && road_class <= kOverviewMaxRoadClass) {
+            addToTile(tileKeyFor(lat_c, lon_c, overview_zoom_));
+          }
         }
       }
     }
@@ -102,9 +304,11 @@ std::unordered_map<long long, TileData> PbfReader::readAndTile() {
   reader2.close();
 #else
   (void)result; // подавить предупреждения в окружении без libosmium
+  (void)node_index;
+  (void)restriction_ways;
+  (void)restriction_way_nodes;
+  (void)build;
 #endif
-
-  return result;
 }
 
 
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <optional>
 
@@ -23,6 +25,7 @@ struct SimpleNode {
 };
 
 struct SimpleEdge {
+  int64_t way_id {0};
   int64_t from_node_id;
   int64_t to_node_id;
   std::vector<SimpleNode> shape; // includes endpoints
@@ -30,6 +33,26 @@ struct SimpleEdge {
   int road_class {3}; // default RESIDENTIAL
   bool car_access {true};
   bool foot_access {true};
+  bool boat_access {false}; // водные рёбра (RIVER/CANAL) — только в water_tiles
+  bool against_flow {false}; // водное ребро направлено против течения (oneway=-1)
+  uint16_t speed_kmh {0}; // maxspeed или типичная скорость highway=*; 0 — скорость класса
+  std::string name;       // name пути
+};
+
+// Запрет манёвра from -> via -> to (узлы — соседи via на путях from/to)
+struct TurnRestrictionData {
+  SimpleNode from;
+  SimpleNode via;
+  SimpleNode to;
+  bool only {false}; // only_*; иначе no_*
+};
+
+// Отношение type=restriction до разрешения в узлы (via — только узел)
+struct RestrictionRelation {
+  int64_t from_way {0};
+  int64_t via_node {0};
+  int64_t to_way {0};
+  bool only {false};
 };
 
 struct TileData {
@@ -37,17 +60,109 @@ struct TileData {
   std::vector<SimpleNode> nodes;
   std::vector<SimpleEdge> edges;
   BBox bbox;
+  std::vector<TurnRestrictionData> restrictions; // хранятся в тайле ребра from -> via
+  // Открытая вода (только water_tiles): квадродерево в кодировке LandTile.water_cells
+  uint8_t water_depth {0};
+  std::vector<uint8_t> water_cells;
+};
+
+// Профили пакета: биты совпадают с Edge.access_mask и колонкой profile_mask
+constexpr uint32_t kProfileCar = 0x1;
+constexpr uint32_t kProfileFoot = 0x2;
+constexpr uint32_t kProfileBoat = 0x4; // слой water_tiles
+
+// "car", "foot", "car,foot", "car,foot,boat" -> маска; неизвестный профиль — исключение
+uint32_t parseProfileList(const std::string& list);
+std::string profileListName(uint32_t mask);
+// Объединение access-масок рёбер тайла (0 — тайл пуст для пакета); маска открытой воды — boat
+uint32_t tileProfileMask(const TileData& tile);
+
+// Счётчики последнего readAndTile()
+struct PbfReaderStats {
+  uint64_t nodes {0};        // узлов в PBF
+  uint64_t ways {0};         // путей в PBF
+  uint64_t highway_ways {0}; // дорог, попавших в граф (после фильтра профилей)
+  uint64_t edges {0};        // сегментов (без учёта копий в обзорном слое)
+  uint64_t restriction_relations {0}; // поддерживаемых отношений type=restriction
+  uint64_t restrictions {0};          // записанных в тайлы манёвров
+  uint64_t water_ways {0};   // waterway=river/canal, попавших в водный граф
+  uint64_t water_edges {0};
 };
 
 class PbfReader {
 public:
   explicit PbfReader(std::string input_path, int zoom);
-  // Возвращает карту тайл-ключ -> данные тайла
+  // Возвращает карту тайл-ключ -> данные тайла (readNodes + buildTiles)
   std::unordered_map<long long, TileData> readAndTile();
 
+  // Первый проход: индекс узлов id -> координаты и отношения type=restriction
+  void readNodes();
+  // Второй проход: пути highway=* по индексу узлов; индекс освобождается.
+  // Водные пути (при профиле boat) собираются отдельно — см. takeWaterTiles().
+  std::unordered_map<long long, TileData> buildTiles();
+  // Тайлы водного графа последнего buildTiles() (того же зума, без обзорного слоя)
+  std::unordered_map<long long, TileData> takeWaterTiles() { return std::move(water_tiles_); }
+  // Индекс узлов для чекпоинта/возобновления (--resume)
+  const std::unordered_map<int64_t, SimpleNode>& nodeIndex() const { return node_index_; }
+  const std::vector<RestrictionRelation>& restrictionRelations() const { return restriction_relations_; }
+  void setNodeIndex(std::unordered_map<int64_t, SimpleNode> index,
+                    std::vector<RestrictionRelation> restrictions) {
+    node_index_ = std::move(index);
+    restriction_relations_ = std::move(restrictions);
+    stats_ = PbfReaderStats{};
+    stats_.nodes = node_index_.size();
+    stats_.restriction_relations = restriction_relations_.size();
+  }
+
+  // Обзорный слой: рёбра MOTORWAY/PRIMARY/SECONDARY дублируются в тайлы
+  // этого зума (0 — выключен). Стыковка со слоем zoom по общим узлам.
+  void setOverviewZoom(int z) { overview_zoom_ = z; }
+  static constexpr int kOverviewMaxRoadClass = 2;
+
+  const PbfReaderStats& stats() const { return stats_; }
+  // Счётчики из чекпоинта, когда проходы по PBF пропущены (--resume)
+  void setStats(const PbfReaderStats& s) { stats_ = s; }
+
+  // Профили пакета: рёбра без доступа ни для одного из них не попадают в тайлы
+  void setProfileMask(uint32_t mask) { profile_mask_ = mask; }
+
+  // Собирать way_id -> тайлы для всех путей (индекс osm_way_tiles)
+  void setCollectWayTiles(bool on) { collect_all_way_tiles_ = on; }
+  // Инкрементальный режим: узлы/пути из .osc. Путь, ссылающийся на
+  // затронутый узел, тоже считается затронутым; для затронутых путей
+  // тайлы собираются всегда.
+  void setTouched(std::unordered_set<int64_t> nodes, std::unordered_set<int64_t> ways);
+  // Проход по путям после readNodes() без сборки тайлов: заполняет touchedWays()
+  // и wayTiles() затронутых путей, чтобы выбрать тайлы к пересборке до buildTiles()
+  void findTouchedWays();
+  // buildTiles() собирает рёбра только этих тайлов (ключи packTileKey любого зума);
+  // wayTiles() затронутых путей остаются полными. nullopt — все тайлы.
+  void setTileFilter(std::optional<std::unordered_set<long long>> keys) { tile_filter_ = std::move(keys); }
+
+  const std::unordered_map<int64_t, std::vector<long long>>& wayTiles() const { return way_tiles_; }
+  const std::unordered_set<int64_t>& touchedWays() const { return touched_ways_; }
+
 private:
   std::string input_path_;
   int zoom_ {14};
+  int overview_zoom_ {0};
+  uint32_t profile_mask_ {kProfileCar | kProfileFoot};
+  PbfReaderStats stats_;
+  bool collect_all_way_tiles_ {false};
+  std::unordered_set<int64_t> touched_nodes_;
+  std::unordered_set<int64_t> touched_ways_;
+  std::unordered_map<int64_t, std::vector<long long>> way_tiles_;
+  std::optional<std::unordered_set<long long>> tile_filter_;
+  std::unordered_map<long long, TileData> water_tiles_;
+  std::unordered_map<int64_t, SimpleNode> node_index_;
+  std::vector<RestrictionRelation> restriction_relations_;
+
+  // Второй проход; result == nullptr — только затронутые пути (findTouchedWays)
+  void scanWays(std::unordered_map<long long, TileData>* result,
+                const std::unordered_set<int64_t>& restriction_ways,
+                std::unordered_map<int64_t, std::vector<int64_t>>& restriction_way_nodes);
+  void resolveRestrictions(const std::unordered_map<int64_t, std::vector<int64_t>>& way_nodes,
+                           std::unordered_map<long long, TileData>& result);
 };
 
 
@@ -0,0 +1,116 @@
+#include "polygon.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+bool ringContains(const Polygon::Ring& ring, double lat, double lon) {
+  bool inside = false;
+  const size_t n = ring.size();
+  for (size_t i = 0, j = n - 1; i < n; j = i++) {
+    const auto& a = ring[i];
+    const auto& b = ring[j];
+    if ((a.lat > lat) != (b.lat > lat)) {
+      const double x = (b.lon - a.lon) * (lat - a.lat) / (b.lat - a.lat) + a.lon;
+      if (lon < x) inside = !inside;
+    }
+  }
+  return inside;
+}
+
+double cross(double ax, double ay, double bx, double by, double cx, double cy) {
+  return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+bool segmentsIntersect(const Polygon::Point& p1, const Polygon::Point& p2,
+                       const Polygon::Point& q1, const Polygon::Point& q2) {
+  const double d1 = cross(q1.lon, q1.lat, q2.lon, q2.lat, p1.lon, p1.lat);
+  const double d2 = cross(q1.lon, q1.lat, q2.lon, q2.lat, p2.lon, p2.lat);
+  const double d3 = cross(p1.lon, p1.lat, p2.lon, p2.lat, q1.lon, q1.lat);
+  const double d4 = cross(p1.lon, p1.lat, p2.lon, p2.lat, q2.lon, q2.lat);
+  return ((d1 > 0) != (d2 > 0)) && ((d3 > 0) != (d4 > 0));
+}
+
+bool ringCrossesBox(const Polygon::Ring& ring, const BBox& box) {
+  const Polygon::Point c[4] = {{box.lat_min, box.lon_min}, {box.lat_min, box.lon_max},
+                               {box.lat_max, box.lon_max}, {box.lat_max, box.lon_min}};
+  const size_t n = ring.size();
+  for (size_t i = 0, j = n - 1; i < n; j = i++) {
+    const auto& p = ring[i];
+    if (p.lat >= box.lat_min && p.lat <= box.lat_max && p.lon >= box.lon_min && p.lon <= box.lon_max) {
+      return true;
+    }
+    for (int k = 0; k < 4; ++k) {
+      if (segmentsIntersect(ring[j], ring[i], c[k], c[(k + 1) % 4])) return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+Polygon Polygon::fromBBox(const BBox& box) {
+  Polygon p;
+  p.outers_.push_back({{box.lat_min, box.lon_min}, {box.lat_min, box.lon_max},
+                       {box.lat_max, box.lon_max}, {box.lat_max, box.lon_min}});
+  return p;
+}
+
+Polygon Polygon::loadPolyFile(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) throw std::runtime_error("Failed to open poly file: " + path);
+  Polygon p;
+  std::string line;
+  std::getline(in, line); // имя полигона
+  while (std::getline(in, line)) {
+    if (line.empty()) continue;
+    if (line.rfind("END", 0) == 0) break; // конец файла
+    const bool hole = line[0] == '!';
+    Ring ring;
+    while (std::getline(in, line) && line.rfind("END", 0) != 0) {
+      std::istringstream ls(line);
+      double lon = 0.0, lat = 0.0;
+      if (ls >> lon >> lat) ring.push_back({lat, lon});
+    }
+    if (ring.size() >= 3) (hole ? p.holes_ : p.outers_).push_back(std::move(ring));
+  }
+  if (p.outers_.empty()) throw std::runtime_error("Poly file has no outer rings: " + path);
+  return p;
+}
+
+bool Polygon::contains(double lat, double lon) const {
+  bool in = false;
+  for (const auto& r : outers_) {
+    if (ringContains(r, lat, lon)) { in = true; break; }
+  }
+  if (!in) return false;
+  for (const auto& r : holes_) {
+    if (ringContains(r, lat, lon)) return false;
+  }
+  return true;
+}
+
+Polygon::Relation Polygon::classify(const BBox& box) const {
+  for (const auto& r : outers_) if (ringCrossesBox(r, box)) return Relation::PARTIAL;
+  for (const auto& r : holes_)  if (ringCrossesBox(r, box)) return Relation::PARTIAL;
+  // границы не пересекают bbox — он целиком внутри или целиком снаружи
+  const double lat = 0.5 * (box.lat_min + box.lat_max);
+  const double lon = 0.5 * (box.lon_min + box.lon_max);
+  return contains(lat, lon) ? Relation::INSIDE : Relation::OUTSIDE;
+}
+
+BBox Polygon::bounds() const {
+  BBox b{90.0, 180.0, -90.0, -180.0};
+  for (const auto& r : outers_) {
+    for (const auto& p : r) {
+      b.lat_min = std::min(b.lat_min, p.lat);
+      b.lat_max = std::max(b.lat_max, p.lat);
+      b.lon_min = std::min(b.lon_min, p.lon);
+      b.lon_max = std::max(b.lon_max, p.lon);
+    }
+  }
+  return b;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "tiler.h"
+
+// Полигон области (внешние кольца + дыры) в градусах; кольца замыкаются неявно.
+class Polygon {
+public:
+  struct Point { double lat; double lon; };
+  using Ring = std::vector<Point>;
+
+  enum class Relation { OUTSIDE, INSIDE, PARTIAL };
+
+  static Polygon fromBBox(const BBox& box);
+  // Формат Osmosis .poly (секции "!..." — дыры)
+  static Polygon loadPolyFile(const std::string& path);
+
+  bool contains(double lat, double lon) const;
+  // Положение прямоугольника (bbox тайла) относительно полигона
+  Relation classify(const BBox& box) const;
+  BBox bounds() const;
+  bool empty() const { return outers_.empty(); }
+
+private:
+  std::vector<Ring> outers_;
+  std::vector<Ring> holes_;
+};
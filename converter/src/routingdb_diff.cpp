@@ -0,0 +1,260 @@
+#include <sqlite3.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "routing_core/checksum.h"
+#include "routing_core/package_update.h"
+#include "routing_core/tile_delta.h"
+
+namespace fs = std::filesystem;
+using routing_core::DeltaOp;
+
+// Сравнивает две версии routingdb по checksum тайлов и пишет дельта-пакет
+// (SQLite: delta_metadata + delta_tiles, водный слой — delta_water_tiles),
+// который применяется на устройстве routing_core::applyDeltaPackage. Дельта
+// несёт только тайлы: индекс геокодера и файл .ac обновляются полным пакетом
+// (версия индекса — geocoder_data_version).
+
+static void printUsage(const char* argv0) {
+  std::fprintf(stderr,
+    "Usage: %s [--binary-diff] old.routingdb new.routingdb out.delta\n"
+    "--binary-diff : store changed tiles as binary diffs against the old blob when smaller\n",
+    argv0);
+}
+
+static void exec(sqlite3* db, const std::string& sql) {
+  char* err = nullptr;
+  if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+    std::string msg = "SQLite error: ";
+    if (err) { msg += err; sqlite3_free(err); }
+    throw std::runtime_error(msg);
+  }
+}
+
+static sqlite3_stmt* prepare(sqlite3* db, const char* sql) {
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    throw std::runtime_error(std::string("Failed to prepare statement: ") + sqlite3_errmsg(db));
+  }
+  return stmt;
+}
+
+static std::string quoteSql(const std::string& s) {
+  std::string out = "'";
+  for (char c : s) { if (c == '\'') out += '\''; out += c; }
+  out += '\'';
+  return out;
+}
+
+static std::string metadataValue(sqlite3* db, const char* table, const char* key) {
+  std::string sql = std::string("SELECT value FROM ") + table + " WHERE key=?;";
+  sqlite3_stmt* st = prepare(db, sql.c_str());
+  sqlite3_bind_text(st, 1, key, -1, SQLITE_TRANSIENT);
+  std::string out;
+  if (sqlite3_step(st) == SQLITE_ROW && sqlite3_column_text(st, 0)) {
+    out = reinterpret_cast<const char*>(sqlite3_column_text(st, 0));
+  }
+  sqlite3_finalize(st);
+  return out;
+}
+
+static bool hasTable(sqlite3* db, const char* schema, const char* table) {
+  std::string sql = std::string("SELECT 1 FROM ") + schema + ".sqlite_master WHERE type='table' AND name=?;";
+  sqlite3_stmt* st = prepare(db, sql.c_str());
+  sqlite3_bind_text(st, 1, table, -1, SQLITE_TRANSIENT);
+  const bool found = sqlite3_step(st) == SQLITE_ROW;
+  sqlite3_finalize(st);
+  return found;
+}
+
+// Различаются ли объекты геокодера старой и новой версии
+static bool geocoderChanged(sqlite3* db) {
+  const bool inOld = hasTable(db, "old", "geo_entities");
+  const bool inNew = hasTable(db, "new", "geo_entities");
+  if (!inOld || !inNew) return inOld != inNew;
+  const char* cols = "kind, name, street, housenumber, city, postcode, category, lat, lon, importance";
+  const std::string sql =
+      std::string("SELECT EXISTS (SELECT ") + cols + " FROM new.geo_entities EXCEPT SELECT " + cols +
+      " FROM old.geo_entities) OR EXISTS (SELECT " + cols + " FROM old.geo_entities EXCEPT SELECT " + cols +
+      " FROM new.geo_entities);";
+  sqlite3_stmt* st = prepare(db, sql.c_str());
+  const bool changed = sqlite3_step(st) == SQLITE_ROW && sqlite3_column_int(st, 0) != 0;
+  sqlite3_finalize(st);
+  return changed;
+}
+
+static std::string columnText(sqlite3_stmt* st, int col) {
+  const auto* t = sqlite3_column_text(st, col);
+  return t ? reinterpret_cast<const char*>(t) : "";
+}
+
+constexpr const char* kDeltaTilesColumns =
+    " (\n"
+    "  z INTEGER NOT NULL, x INTEGER NOT NULL, y INTEGER NOT NULL,\n"
+    "  op INTEGER NOT NULL,\n"
+    "  lat_min REAL, lon_min REAL, lat_max REAL, lon_max REAL,\n"
+    "  version INTEGER, checksum TEXT, profile_mask INTEGER,\n"
+    "  base_checksum TEXT,\n"
+    "  data BLOB\n"
+    ");";
+
+struct DiffCounts {
+  size_t put {0}, patched {0}, removed {0};
+  size_t newBytes {0}, deltaBytes {0};
+};
+
+// Тайлы oldTable -> newTable в deltaTable (схема delta_tiles)
+static void diffTiles(sqlite3* db, const std::string& oldTable, const std::string& newTable,
+                      const std::string& deltaTable, bool binaryDiff, DiffCounts& counts) {
+  // Добавленные и изменённые тайлы. Пустой checksum (старые сборки) — сравниваем данные.
+  sqlite3_stmt* changed = prepare(db, (std::string(
+    "SELECT n.z, n.x, n.y, n.lat_min, n.lon_min, n.lat_max, n.lon_max, n.version, n.checksum,\n"
+    "       n.profile_mask, n.data, o.data\n"
+    "FROM ") + newTable + " n LEFT JOIN " + oldTable + " o ON o.z=n.z AND o.x=n.x AND o.y=n.y\n"
+    "WHERE o.z IS NULL OR o.checksum != n.checksum OR (n.checksum = '' AND o.data != n.data);").c_str());
+  sqlite3_stmt* insert = prepare(db, (std::string(
+    "INSERT INTO ") + deltaTable + "(z,x,y,op,lat_min,lon_min,lat_max,lon_max,version,checksum,profile_mask,base_checksum,data)\n"
+    "VALUES(?,?,?,?,?,?,?,?,?,?,?,?,?);").c_str());
+
+  while (sqlite3_step(changed) == SQLITE_ROW) {
+    const auto* data = static_cast<const uint8_t*>(sqlite3_column_blob(changed, 10));
+    const size_t size = static_cast<size_t>(sqlite3_column_bytes(changed, 10));
+    const auto* oldData = static_cast<const uint8_t*>(sqlite3_column_blob(changed, 11));
+    const size_t oldSize = static_cast<size_t>(sqlite3_column_bytes(changed, 11));
+    std::string checksum = columnText(changed, 8);
+    if (checksum.empty()) checksum = routing_core::sha256Hex(data, size);
+
+    DeltaOp op = DeltaOp::PUT;
+    std::vector<uint8_t> delta;
+    std::string baseChecksum;
+    if (binaryDiff && oldData && oldSize > 0) {
+      delta = routing_core::encodeBinaryDelta(oldData, oldSize, data, size);
+      // дифф выгоден только при заметной экономии
+      if (delta.size() * 4 < size * 3) {
+        op = DeltaOp::PATCH;
+        baseChecksum = routing_core::sha256Hex(oldData, oldSize);
+      }
+    }
+    const void* payload = (op == DeltaOp::PATCH) ? static_cast<const void*>(delta.data()) : data;
+    const size_t payloadSize = (op == DeltaOp::PATCH) ? delta.size() : size;
+
+    for (int c = 0; c < 3; ++c) sqlite3_bind_int(insert, c + 1, sqlite3_column_int(changed, c));
+    sqlite3_bind_int(insert, 4, static_cast<int>(op));
+    for (int c = 3; c < 7; ++c) sqlite3_bind_double(insert, c + 2, sqlite3_column_double(changed, c));
+    sqlite3_bind_int(insert, 9, sqlite3_column_int(changed, 7));
+    sqlite3_bind_text(insert, 10, checksum.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(insert, 11, sqlite3_column_int(changed, 9));
+    if (op == DeltaOp::PATCH) sqlite3_bind_text(insert, 12, baseChecksum.c_str(), -1, SQLITE_TRANSIENT);
+    else sqlite3_bind_null(insert, 12);
+    sqlite3_bind_blob(insert, 13, payload, static_cast<int>(payloadSize), SQLITE_TRANSIENT);
+    if (sqlite3_step(insert) != SQLITE_DONE) {
+      throw std::runtime_error(std::string("Failed to insert delta tile: ") + sqlite3_errmsg(db));
+    }
+    sqlite3_reset(insert);
+    counts.newBytes += size;
+    counts.deltaBytes += payloadSize;
+    if (op == DeltaOp::PATCH) ++counts.patched; else ++counts.put;
+  }
+  sqlite3_finalize(changed);
+
+  // Удалённые тайлы
+  sqlite3_stmt* gone = prepare(db, (std::string(
+    "SELECT o.z, o.x, o.y FROM ") + oldTable + " o\n"
+    "WHERE NOT EXISTS (SELECT 1 FROM " + newTable + " n WHERE n.z=o.z AND n.x=o.x AND n.y=o.y);").c_str());
+  while (sqlite3_step(gone) == SQLITE_ROW) {
+    for (int c = 0; c < 3; ++c) sqlite3_bind_int(insert, c + 1, sqlite3_column_int(gone, c));
+    sqlite3_bind_int(insert, 4, static_cast<int>(DeltaOp::REMOVE));
+    for (int c = 5; c <= 13; ++c) sqlite3_bind_null(insert, c);
+    if (sqlite3_step(insert) != SQLITE_DONE) {
+      throw std::runtime_error(std::string("Failed to insert delta tile: ") + sqlite3_errmsg(db));
+    }
+    sqlite3_reset(insert);
+    ++counts.removed;
+  }
+  sqlite3_finalize(gone);
+  sqlite3_finalize(insert);
+}
+
+int main(int argc, char** argv) {
+  bool binaryDiff = false;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    std::string a = argv[i];
+    if (a == "--binary-diff") binaryDiff = true;
+    else args.push_back(a);
+  }
+  if (args.size() != 3) { printUsage(argv[0]); return 1; }
+  const std::string oldPath = args[0];
+  const std::string newPath = args[1];
+  const std::string outPath = args[2];
+
+  sqlite3* db = nullptr;
+  try {
+    if (fs::exists(outPath)) fs::remove(outPath);
+    if (sqlite3_open(outPath.c_str(), &db) != SQLITE_OK) {
+      throw std::runtime_error(std::string("Failed to open output: ") + sqlite3_errmsg(db));
+    }
+    exec(db, "ATTACH DATABASE " + quoteSql(oldPath) + " AS old;");
+    exec(db, "ATTACH DATABASE " + quoteSql(newPath) + " AS new;");
+    exec(db, "CREATE TABLE delta_metadata (key TEXT PRIMARY KEY, value TEXT);");
+    exec(db, std::string("CREATE TABLE delta_tiles") + kDeltaTilesColumns);
+
+    std::string fromVersion = metadataValue(db, "old.metadata", "data_version");
+    std::string toVersion = metadataValue(db, "new.metadata", "data_version");
+    if (fromVersion.empty()) fromVersion = "1";
+    if (toVersion.empty() || toVersion == fromVersion) toVersion = std::to_string(std::stoi(fromVersion) + 1);
+
+    exec(db, "BEGIN TRANSACTION;");
+    {
+      sqlite3_stmt* meta = prepare(db, "INSERT INTO delta_metadata(key, value) VALUES(?, ?);");
+      const std::pair<std::string, std::string> rows[] = {
+        {"format", "1"}, {"from_data_version", fromVersion}, {"to_data_version", toVersion}};
+      for (const auto& [k, v] : rows) {
+        sqlite3_bind_text(meta, 1, k.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(meta, 2, v.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_step(meta);
+        sqlite3_reset(meta);
+      }
+      sqlite3_finalize(meta);
+    }
+
+    DiffCounts counts;
+    diffTiles(db, "old.land_tiles", "new.land_tiles", "delta_tiles", binaryDiff, counts);
+    // Водный слой (профиль boat) — в delta_water_tiles той же схемы; слой, которого
+    // нет в одной из версий, сравнивается с пустой таблицей
+    const bool oldWater = hasTable(db, "old", "water_tiles");
+    const bool newWater = hasTable(db, "new", "water_tiles");
+    if (oldWater || newWater) {
+      exec(db, std::string("CREATE TABLE delta_water_tiles") + kDeltaTilesColumns);
+      exec(db, std::string("CREATE TEMP TABLE no_water_tiles AS SELECT * FROM ") + (newWater ? "new" : "old") +
+               ".water_tiles WHERE 0;");
+      diffTiles(db, oldWater ? "old.water_tiles" : "temp.no_water_tiles",
+                newWater ? "new.water_tiles" : "temp.no_water_tiles", "delta_water_tiles", binaryDiff, counts);
+    }
+    exec(db, "COMMIT;");
+    const bool geocoderStale = geocoderChanged(db);
+    exec(db, "DETACH DATABASE old;");
+    exec(db, "DETACH DATABASE new;");
+    exec(db, "VACUUM;");
+    sqlite3_close(db);
+    db = nullptr;
+
+    std::printf("data_version %s -> %s\n", fromVersion.c_str(), toVersion.c_str());
+    std::printf("Tiles: put %zu, patched %zu, removed %zu\n", counts.put, counts.patched, counts.removed);
+    std::printf("Payload: %zu bytes (changed tiles %zu bytes)\n", counts.deltaBytes, counts.newBytes);
+    std::printf("Delta package: %ju bytes\n", static_cast<uintmax_t>(fs::file_size(outPath)));
+    if (geocoderStale) {
+      std::fprintf(stderr, "Warning: geocoder index differs between versions; deltas carry tiles only, "
+                           "ship the full package to update it\n");
+    }
+    return 0;
+  } catch (const std::exception& ex) {
+    if (db) sqlite3_close(db);
+    std::fprintf(stderr, "Error: %s\n", ex.what());
+    return 2;
+  }
+}
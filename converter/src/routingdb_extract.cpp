@@ -0,0 +1,141 @@
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "polygon.h"
+#include "routingdb_reader.h"
+#include "serializer.h"
+#include "sqlite_writer.h"
+#include "tile_decoder.h"
+#include "routing_core/checksum.h"
+
+namespace fs = std::filesystem;
+
+// Вырезает из routingdb область по bbox или .poly без повторной конвертации OSM:
+// тайлы внутри копируются как есть, пограничные декодируются и обрезаются
+// (остаются рёбра, у которых хотя бы один конец внутри области); водный слой
+// water_tiles — так же. Индекс геокодера пересобирается из объектов внутри
+// области вместе с файлом .ac.
+
+static void printUsage(const char* argv0) {
+  std::fprintf(stderr,
+    "Usage: %s (--bbox LAT_MIN,LON_MIN,LAT_MAX,LON_MAX | --poly area.poly) input.routingdb output.routingdb\n",
+    argv0);
+}
+
+static std::optional<BBox> parseBBox(const std::string& s) {
+  BBox b{};
+  char c1 = 0, c2 = 0, c3 = 0;
+  std::istringstream in(s);
+  if (!(in >> b.lat_min >> c1 >> b.lon_min >> c2 >> b.lat_max >> c3 >> b.lon_max)) return std::nullopt;
+  if (c1 != ',' || c2 != ',' || c3 != ',' || b.lat_min >= b.lat_max || b.lon_min >= b.lon_max) return std::nullopt;
+  return b;
+}
+
+int main(int argc, char** argv) {
+  std::optional<Polygon> area;
+  std::vector<std::string> args;
+  try {
+    for (int i = 1; i < argc; ++i) {
+      std::string a = argv[i];
+      if (a == "--bbox" && i + 1 < argc) {
+        auto b = parseBBox(argv[++i]);
+        if (!b) { printUsage(argv[0]); return 1; }
+        area = Polygon::fromBBox(*b);
+      } else if (a == "--poly" && i + 1 < argc) {
+        area = Polygon::loadPolyFile(argv[++i]);
+      } else {
+        args.push_back(a);
+      }
+    }
+  } catch (const std::exception& ex) {
+    std::fprintf(stderr, "Error: %s\n", ex.what());
+    return 2;
+  }
+  if (!area || args.size() != 2) { printUsage(argv[0]); return 1; }
+
+  const std::string inputPath = args[0];
+  const std::string outputPath = args[1];
+
+  try {
+    RoutingDbReader reader(inputPath);
+    if (fs::exists(outputPath)) fs::remove(outputPath);
+    RoutingDbWriter writer(outputPath);
+    writer.createSchemaIfNeeded();
+    writer.beginTransaction();
+    // geocoder_* пишутся заново вместе с индексом; его версия — как во входе
+    std::string dataVersion = "1", geocoderVersion;
+    for (const auto& [k, v] : reader.metadata()) {
+      if (k == "data_version") dataVersion = v;
+      if (k == "geocoder_data_version") geocoderVersion = v;
+      if (k.rfind("geocoder_", 0) != 0) writer.writeMetadata(k, v);
+    }
+
+    // Водный слой (профиль boat) режется так же; тайлы только с маской воды
+    // остаются целиком — маска покрывает тайл, рёбер у них нет
+    const bool water = reader.hasTable("water_tiles");
+    if (water) writer.createWaterSchema();
+    size_t copied = 0, clipped = 0, dropped = 0, waterTiles = 0;
+    for (const char* table : {"land_tiles", "water_tiles"}) {
+      const bool isWater = table[0] == 'w';
+      if (isWater && !water) continue;
+      auto insert = [&](const StoredTile& t, const std::string& checksum, const void* data, size_t size) {
+        if (isWater) {
+          writer.insertWaterTile(t.key.z, t.key.x, t.key.y, t.bbox, t.version, checksum, t.profile_mask, data, size);
+          ++waterTiles;
+        } else {
+          writer.insertLandTile(t.key.z, t.key.x, t.key.y, t.bbox, t.version, checksum, t.profile_mask, data, size);
+        }
+      };
+      reader.forEachTile([&](const StoredTile& t) {
+        const auto rel = area->classify(t.bbox);
+        if (rel == Polygon::Relation::OUTSIDE) return;
+        if (rel == Polygon::Relation::INSIDE) {
+          insert(t, t.checksum, t.data.data(), t.data.size());
+          ++copied;
+          return;
+        }
+        auto td = decodeLandTile(t.data.data(), t.data.size());
+        if (!td) {
+          std::fprintf(stderr, "Skipping undecodable tile z=%d x=%d y=%d\n", t.key.z, t.key.x, t.key.y);
+          ++dropped;
+          return;
+        }
+        std::vector<SimpleEdge> kept;
+        kept.reserve(td->edges.size());
+        for (auto& e : td->edges) {
+          const auto& a = e.shape.front();
+          const auto& b = e.shape.back();
+          if (area->contains(a.lat, a.lon) || area->contains(b.lat, b.lon)) kept.push_back(std::move(e));
+        }
+        if (kept.empty() && td->water_cells.empty()) { ++dropped; return; }
+        td->edges = std::move(kept);
+        td->bbox = t.bbox;
+        auto blob = buildLandTileBlob(*td, static_cast<uint32_t>(t.version), static_cast<uint32_t>(t.profile_mask));
+        insert(t, routing_core::sha256Hex(blob.data(), blob.size()), blob.data(), blob.size());
+        ++clipped;
+      }, area->bounds(), table);
+    }
+    if (water) writer.writeMetadata("water_tiles", std::to_string(waterTiles));
+
+    if (auto entities = reader.geoEntities()) {
+      std::vector<GeoEntity> kept;
+      for (auto& e : *entities) {
+        if (area->contains(e.lat, e.lon)) kept.push_back(std::move(e));
+      }
+      writer.writeGeocoder(kept, outputPath, geocoderVersion.empty() ? dataVersion : geocoderVersion);
+      std::printf("Geocoder entities: %zu of %zu\n", kept.size(), entities->size());
+    }
+
+    writer.writeMetadata("source", "extract:" + inputPath);
+    writer.commitTransaction();
+    std::printf("Tiles: copied %zu, clipped %zu, dropped %zu (water %zu)\n", copied, clipped, dropped, waterTiles);
+    return 0;
+  } catch (const std::exception& ex) {
+    std::fprintf(stderr, "Error: %s\n", ex.what());
+    return 2;
+  }
+}
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "routingdb_reader.h"
+#include "serializer.h"
+#include "sqlite_writer.h"
+#include "tile_decoder.h"
+#include "routing_core/checksum.h"
+
+namespace fs = std::filesystem;
+
+// Объединяет соседние routingdb в один пакет. Тайлы, которые есть только в
+// одном входе, копируются как есть; общие (пограничные) тайлы декодируются и
+// сшиваются объединением рёбер без дублей; водный слой water_tiles — так же,
+// маски открытой воды общих тайлов объединяются. Индексы геокодера объединяются
+// (объекты пограничья без дублей) и пересобираются вместе с файлом .ac.
+
+static void printUsage(const char* argv0) {
+  std::fprintf(stderr, "Usage: %s output.routingdb input1.routingdb input2.routingdb [...]\n", argv0);
+}
+
+using EdgeKey = std::tuple<int64_t, int64_t, int, bool, size_t>;
+
+static EdgeKey edgeKey(const SimpleEdge& e) {
+  return {e.from_node_id, e.to_node_id, e.road_class, e.oneway, e.shape.size()};
+}
+
+// Объединение двух квадродеревьев маски воды (LandTile.water_cells, 2 бита на
+// узел в прямом порядке: 0 — суша, 1 — вода, 2 — деление на 4)
+class WaterCellsUnion {
+public:
+  WaterCellsUnion(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) : a_{a, 0}, b_{b, 0} {}
+
+  std::vector<uint8_t> run() {
+    merge();
+    return std::move(out_);
+  }
+
+private:
+  struct Cursor { const std::vector<uint8_t>& cells; size_t pos; };
+
+  static uint8_t next(Cursor& c) {
+    if (c.pos >= c.cells.size() * 4) throw std::runtime_error("corrupted water_cells");
+    const uint8_t code = (c.cells[c.pos >> 2] >> ((c.pos & 3) * 2)) & 3;
+    ++c.pos;
+    return code;
+  }
+
+  void put(uint8_t code) {
+    if ((n_ & 3) == 0) out_.push_back(0);
+    out_.back() |= static_cast<uint8_t>(code << ((n_ & 3) * 2));
+    ++n_;
+  }
+
+  // Поддерево с уже прочитанным кодом: копируется (copy) или пропускается
+  void subtree(Cursor& c, uint8_t code, bool copy) {
+    if (copy) put(code);
+    if (code != 2) return;
+    for (int i = 0; i < 4; ++i) subtree(c, next(c), copy);
+  }
+
+  void merge() {
+    const uint8_t ca = next(a_), cb = next(b_);
+    if (ca == 1 || cb == 1) {
+      put(1);
+      subtree(a_, ca, false);
+      subtree(b_, cb, false);
+    } else if (ca == 0) {
+      subtree(b_, cb, true);
+    } else if (cb == 0) {
+      subtree(a_, ca, true);
+    } else {
+      put(2);
+      for (int i = 0; i < 4; ++i) merge();
+    }
+  }
+
+  Cursor a_, b_;
+  std::vector<uint8_t> out_;
+  size_t n_ {0};
+};
+
+static std::vector<uint8_t> unionWaterCells(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+  return WaterCellsUnion(a, b).run();
+}
+
+// Один объект из двух пакетов (пограничье) — то же имя, вид и точка до ~1 см
+using GeoKey = std::tuple<int, std::string, std::string, int64_t, int64_t>;
+
+static GeoKey geoKey(const GeoEntity& e) {
+  return {e.kind, e.name, e.city, std::llround(e.lat * 1e7), std::llround(e.lon * 1e7)};
+}
+
+int main(int argc, char** argv) {
+  if (argc < 4) { printUsage(argv[0]); return 1; }
+  const std::string outputPath = argv[1];
+
+  try {
+    std::vector<std::unique_ptr<RoutingDbReader>> inputs;
+    for (int i = 2; i < argc; ++i) inputs.push_back(std::make_unique<RoutingDbReader>(argv[i]));
+
+    if (fs::exists(outputPath)) fs::remove(outputPath);
+    RoutingDbWriter writer(outputPath);
+    writer.createSchemaIfNeeded();
+    writer.beginTransaction();
+    // geocoder_* пишутся заново вместе с объединённым индексом
+    std::string dataVersion = "1", geocoderVersion;
+    for (const auto& [k, v] : inputs.front()->metadata()) {
+      if (k == "data_version") dataVersion = v;
+      if (k == "geocoder_data_version") geocoderVersion = v;
+      if (k.rfind("geocoder_", 0) != 0) writer.writeMetadata(k, v);
+    }
+
+    // Водный слой (water_tiles) сшивается так же; маски воды общих тайлов объединяются
+    size_t copied = 0, stitched = 0, waterTiles = 0;
+    bool water = false;
+    for (const char* table : {"land_tiles", "water_tiles"}) {
+      const bool isWater = table[0] == 'w';
+      if (isWater && std::none_of(inputs.begin(), inputs.end(), [&](const auto& in) { return in->hasTable(table); })) {
+        continue;
+      }
+      if (isWater) { writer.createWaterSchema(); water = true; }
+      // ключ тайла -> входы, в которых он есть
+      std::map<std::tuple<int, int, int>, std::vector<size_t>> sources;
+      for (size_t i = 0; i < inputs.size(); ++i) {
+        if (isWater && !inputs[i]->hasTable(table)) continue;
+        for (const auto& k : inputs[i]->tileKeys(table)) sources[{k.z, k.x, k.y}].push_back(i);
+      }
+      auto insert = [&](int z, int x, int y, const BBox& bbox, int version, const std::string& checksum,
+                        int profile_mask, const void* data, size_t size) {
+        if (isWater) {
+          writer.insertWaterTile(z, x, y, bbox, version, checksum, profile_mask, data, size);
+          ++waterTiles;
+        } else {
+          writer.insertLandTile(z, x, y, bbox, version, checksum, profile_mask, data, size);
+        }
+      };
+
+      for (const auto& [key, from] : sources) {
+        const auto [z, x, y] = key;
+        if (from.size() == 1) {
+          auto t = inputs[from.front()]->tile(z, x, y, table);
+          if (!t) continue;
+          insert(z, x, y, t->bbox, t->version, t->checksum, t->profile_mask, t->data.data(), t->data.size());
+          ++copied;
+          continue;
+        }
+
+        std::optional<TileData> merged;
+        std::set<EdgeKey> seen;
+        int version = 0;
+        int profile_mask = 0;
+        BBox bbox{};
+        for (size_t idx : from) {
+          auto t = inputs[idx]->tile(z, x, y, table);
+          if (!t) continue;
+          auto td = decodeLandTile(t->data.data(), t->data.size());
+          if (!td) {
+            std::fprintf(stderr, "Skipping undecodable tile z=%d x=%d y=%d in %s\n",
+                         z, x, y, inputs[idx]->path().c_str());
+            continue;
+          }
+          version = std::max(version, t->version);
+          profile_mask |= t->profile_mask;
+          bbox = t->bbox;
+          if (!merged) {
+            merged = TileData{td->key, {}, {}, td->bbox, {}, 0, {}};
+          }
+          for (auto& e : td->edges) {
+            if (seen.insert(edgeKey(e)).second) merged->edges.push_back(std::move(e));
+          }
+          // дубли запретов отбрасывает сериализатор
+          merged->restrictions.insert(merged->restrictions.end(), td->restrictions.begin(), td->restrictions.end());
+          if (td->water_cells.empty()) continue;
+          if (merged->water_cells.empty()) {
+            merged->water_depth = td->water_depth;
+            merged->water_cells = std::move(td->water_cells);
+          } else if (merged->water_depth == td->water_depth) {
+            merged->water_cells = unionWaterCells(merged->water_cells, td->water_cells);
+          }
+        }
+        if (!merged || (merged->edges.empty() && merged->water_cells.empty())) continue;
+        merged->bbox = bbox;
+        auto blob = buildLandTileBlob(*merged, static_cast<uint32_t>(version), static_cast<uint32_t>(profile_mask));
+        const std::string checksum = routing_core::sha256Hex(blob.data(), blob.size());
+        insert(z, x, y, bbox, version, checksum, profile_mask, blob.data(), blob.size());
+        ++stitched;
+      }
+    }
+    if (water) writer.writeMetadata("water_tiles", std::to_string(waterTiles));
+
+    std::vector<GeoEntity> entities;
+    std::set<GeoKey> seenEntities;
+    bool anyGeocoder = false;
+    for (const auto& in : inputs) {
+      auto list = in->geoEntities();
+      if (!list) {
+        std::fprintf(stderr, "No geocoder index in %s\n", in->path().c_str());
+        continue;
+      }
+      anyGeocoder = true;
+      for (auto& e : *list) {
+        if (seenEntities.insert(geoKey(e)).second) entities.push_back(std::move(e));
+      }
+    }
+    if (anyGeocoder) {
+      // insertGeoEntities ждёт порядок по убыванию важности
+      std::stable_sort(entities.begin(), entities.end(),
+                       [](const GeoEntity& a, const GeoEntity& b) { return a.importance > b.importance; });
+      writer.writeGeocoder(entities, outputPath, geocoderVersion.empty() ? dataVersion : geocoderVersion);
+      std::printf("Geocoder entities: %zu\n", entities.size());
+    }
+
+    std::string source = "merge:";
+    for (int i = 2; i < argc; ++i) { if (i > 2) source += ","; source += argv[i]; }
+    writer.writeMetadata("source", source);
+    writer.commitTransaction();
+    std::printf("Tiles: copied %zu, stitched %zu (water %zu)\n", copied, stitched, waterTiles);
+    return 0;
+  } catch (const std::exception& ex) {
+    std::fprintf(stderr, "Error: %s\n", ex.what());
+    return 2;
+  }
+}
@@ -0,0 +1,170 @@
+#include "routingdb_reader.h"
+
+#include <cstring>
+
+#include "sqlite_writer.h"
+
+namespace {
+
+StoredTile readRow(sqlite3_stmt* stmt) {
+  StoredTile t;
+  t.key = TileKey{sqlite3_column_int(stmt, 0), sqlite3_column_int(stmt, 1), sqlite3_column_int(stmt, 2)};
+  t.bbox = BBox{sqlite3_column_double(stmt, 3), sqlite3_column_double(stmt, 4),
+                sqlite3_column_double(stmt, 5), sqlite3_column_double(stmt, 6)};
+  t.version = sqlite3_column_int(stmt, 7);
+  const auto* checksum = sqlite3_column_text(stmt, 8);
+  if (checksum) t.checksum = reinterpret_cast<const char*>(checksum);
+  t.profile_mask = sqlite3_column_int(stmt, 9);
+  const void* blob = sqlite3_column_blob(stmt, 10);
+  const int size = sqlite3_column_bytes(stmt, 10);
+  if (blob && size > 0) {
+    t.data.resize(static_cast<size_t>(size));
+    std::memcpy(t.data.data(), blob, static_cast<size_t>(size));
+  }
+  return t;
+}
+
+constexpr const char* kTileColumns =
+    "SELECT z,x,y,lat_min,lon_min,lat_max,lon_max,version,checksum,profile_mask,data FROM ";
+
+} // namespace
+
+RoutingDbReader::RoutingDbReader(const std::string& dbPath) : path_(dbPath) {
+  if (sqlite3_open_v2(dbPath.c_str(), &db_, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+    std::string msg = "Failed to open SQLite DB: ";
+    msg += sqlite3_errmsg(db_);
+    sqlite3_close(db_);
+    db_ = nullptr;
+    throw SqliteError(msg);
+  }
+}
+
+RoutingDbReader::~RoutingDbReader() {
+  if (db_) {
+    sqlite3_close(db_);
+    db_ = nullptr;
+  }
+}
+
+void RoutingDbReader::forEachTile(const std::function<void(const StoredTile&)>& fn,
+                                  const std::optional<BBox>& filter, const char* table) {
+  std::string sql = std::string(kTileColumns) + table;
+  if (filter) sql += " WHERE lat_max >= ? AND lat_min <= ? AND lon_max >= ? AND lon_min <= ?";
+  sql += " ORDER BY z,x,y;";
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    std::string msg = "Failed to prepare statement: ";
+    msg += sqlite3_errmsg(db_);
+    throw SqliteError(msg);
+  }
+  if (filter) {
+    sqlite3_bind_double(stmt, 1, filter->lat_min);
+    sqlite3_bind_double(stmt, 2, filter->lat_max);
+    sqlite3_bind_double(stmt, 3, filter->lon_min);
+    sqlite3_bind_double(stmt, 4, filter->lon_max);
+  }
+  try {
+    while (sqlite3_step(stmt) == SQLITE_ROW) fn(readRow(stmt));
+  } catch (...) {
+    sqlite3_finalize(stmt);
+    throw;
+  }
+  sqlite3_finalize(stmt);
+}
+
+std::optional<StoredTile> RoutingDbReader::tile(int z, int x, int y, const char* table) {
+  std::string sql = std::string(kTileColumns) + table + " WHERE z=? AND x=? AND y=? LIMIT 1;";
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    std::string msg = "Failed to prepare statement: ";
+    msg += sqlite3_errmsg(db_);
+    throw SqliteError(msg);
+  }
+  sqlite3_bind_int(stmt, 1, z);
+  sqlite3_bind_int(stmt, 2, x);
+  sqlite3_bind_int(stmt, 3, y);
+  std::optional<StoredTile> out;
+  if (sqlite3_step(stmt) == SQLITE_ROW) out = readRow(stmt);
+  sqlite3_finalize(stmt);
+  return out;
+}
+
+std::vector<TileKey> RoutingDbReader::tileKeys(const char* table) {
+  sqlite3_stmt* stmt = nullptr;
+  const std::string sql = std::string("SELECT z,x,y FROM ") + table + " ORDER BY z,x,y;";
+  if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    std::string msg = "Failed to prepare statement: ";
+    msg += sqlite3_errmsg(db_);
+    throw SqliteError(msg);
+  }
+  std::vector<TileKey> out;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    out.push_back(TileKey{sqlite3_column_int(stmt, 0), sqlite3_column_int(stmt, 1), sqlite3_column_int(stmt, 2)});
+  }
+  sqlite3_finalize(stmt);
+  return out;
+}
+
+std::vector<std::pair<std::string, std::string>> RoutingDbReader::metadata() {
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db_, "SELECT key, value FROM metadata;", -1, &stmt, nullptr) != SQLITE_OK) {
+    std::string msg = "Failed to prepare statement: ";
+    msg += sqlite3_errmsg(db_);
+    throw SqliteError(msg);
+  }
+  std::vector<std::pair<std::string, std::string>> out;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    const auto* k = sqlite3_column_text(stmt, 0);
+    const auto* v = sqlite3_column_text(stmt, 1);
+    out.emplace_back(k ? reinterpret_cast<const char*>(k) : "", v ? reinterpret_cast<const char*>(v) : "");
+  }
+  sqlite3_finalize(stmt);
+  return out;
+}
+
+bool RoutingDbReader::hasTable(const char* table) {
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db_, "SELECT 1 FROM sqlite_master WHERE type='table' AND name=?;",
+                         -1, &stmt, nullptr) != SQLITE_OK) {
+    std::string msg = "Failed to prepare statement: ";
+    msg += sqlite3_errmsg(db_);
+    throw SqliteError(msg);
+  }
+  sqlite3_bind_text(stmt, 1, table, -1, SQLITE_TRANSIENT);
+  const bool present = sqlite3_step(stmt) == SQLITE_ROW;
+  sqlite3_finalize(stmt);
+  return present;
+}
+
+std::optional<std::vector<GeoEntity>> RoutingDbReader::geoEntities() {
+  if (!hasTable("geo_entities")) return std::nullopt;
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db_,
+                         "SELECT kind, name, street, housenumber, city, postcode, category, lat, lon, importance\n"
+                         "FROM geo_entities ORDER BY id;", -1, &stmt, nullptr) != SQLITE_OK) {
+    std::string msg = "Failed to prepare statement: ";
+    msg += sqlite3_errmsg(db_);
+    throw SqliteError(msg);
+  }
+  auto text = [&](int col) {
+    const auto* t = sqlite3_column_text(stmt, col);
+    return t ? std::string(reinterpret_cast<const char*>(t)) : std::string();
+  };
+  std::vector<GeoEntity> out;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    GeoEntity e;
+    e.kind = sqlite3_column_int(stmt, 0);
+    e.name = text(1);
+    e.street = text(2);
+    e.housenumber = text(3);
+    e.city = text(4);
+    e.postcode = text(5);
+    e.category = text(6);
+    e.lat = sqlite3_column_double(stmt, 7);
+    e.lon = sqlite3_column_double(stmt, 8);
+    e.importance = sqlite3_column_double(stmt, 9);
+    out.push_back(std::move(e));
+  }
+  sqlite3_finalize(stmt);
+  return out;
+}
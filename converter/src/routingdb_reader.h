@@ -0,0 +1,49 @@
+#pragma once
+
+#include <sqlite3.h>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "geocode_extractor.h"
+#include "tiler.h"
+
+// Строка таблицы land_tiles как есть (BLOB не декодируется).
+struct StoredTile {
+  TileKey key {};
+  BBox bbox {};
+  int version {0};
+  std::string checksum;
+  int profile_mask {0};
+  std::vector<uint8_t> data;
+};
+
+// Чтение готового routingdb (утилиты extract/merge работают без OSM).
+class RoutingDbReader {
+public:
+  explicit RoutingDbReader(const std::string& dbPath);
+  ~RoutingDbReader();
+
+  RoutingDbReader(const RoutingDbReader&) = delete;
+  RoutingDbReader& operator=(const RoutingDbReader&) = delete;
+
+  // Тайлы, чей bbox пересекает заданный (nullopt — все тайлы). table — land_tiles
+  // или water_tiles (водный слой, та же схема)
+  void forEachTile(const std::function<void(const StoredTile&)>& fn,
+                   const std::optional<BBox>& filter = std::nullopt, const char* table = "land_tiles");
+  std::optional<StoredTile> tile(int z, int x, int y, const char* table = "land_tiles");
+  std::vector<TileKey> tileKeys(const char* table = "land_tiles");
+  bool hasTable(const char* table);
+  std::vector<std::pair<std::string, std::string>> metadata();
+  // Объекты геокодера в порядке id (по убыванию важности); nullopt — индекса в пакете нет
+  std::optional<std::vector<GeoEntity>> geoEntities();
+
+  const std::string& path() const { return path_; }
+
+private:
+  sqlite3* db_ {nullptr};
+  std::string path_;
+};
@@ -1,15 +1,28 @@
 #include "serializer.h"
 
+#include <algorithm>
 #include <cmath>
+#include <stdexcept>
+#include <string>
+#include <tuple>
 #include <unordered_map>
 #include <flatbuffers/flatbuffers.h>
 #include "land_tile_generated.h"
+#include "routing_core/edge_id.h"
 
 using namespace Routing;
 
 std::vector<uint8_t> buildLandTileBlob(const TileData& tile,
                                        uint32_t version,
                                        uint32_t profile_mask) {
+  // edge_id хранит индекс ребра в 16 битах: лишние рёбра молча совпали бы
+  // с первыми (маршруты, пробки, перекрытия)
+  if (tile.edges.size() > routing_core::edgeid::kMaxTileEdges) {
+    throw std::runtime_error("tile " + std::to_string(tile.key.z) + "/" + std::to_string(tile.key.x) + "/" +
+                             std::to_string(tile.key.y) + " has " + std::to_string(tile.edges.size()) +
+                             " edges, edge ids hold " + std::to_string(routing_core::edgeid::kMaxTileEdges) +
+                             "; use a larger zoom (--z / --overview-z) for this layer");
+  }
   flatbuffers::FlatBufferBuilder fbb(1024);
 
   // Build local node index used by edges
@@ -75,12 +88,26 @@ std::vector<uint8_t> buildLandTileBlob(const TileData& tile,
     }
   };
 
+  // Течение по умолчанию: в OSM его нет, берём типичное для равнинной реки.
+  // Каналы считаем стоячей водой.
+  auto flow_for_class = [](int road_class) -> float {
+    switch (road_class) {
+      case 7: return 1.0f;   // RIVER
+      default: return 0.0f;  // CANAL и суша
+    }
+  };
+
   for (const auto& e : tile.edges) {
     float length_m = haversine(e.shape.front().lat, e.shape.front().lon,
                                e.shape.back().lat,  e.shape.back().lon);
-    float speed_mps = e.car_access ? car_speed_for_class(e.road_class) : 0.0f;
+    float speed_mps = 0.0f;
+    if (e.car_access) speed_mps = e.speed_kmh > 0 ? static_cast<float>(e.speed_kmh) / 3.6f : car_speed_for_class(e.road_class);
+    // на воде speed_mps — только явный maxspeed (относительно берега), 0 — без ограничения
+    else if (e.boat_access && e.speed_kmh > 0) speed_mps = static_cast<float>(e.speed_kmh) / 3.6f;
     float foot_speed_mps = e.foot_access ? 1.4f : 0.0f; // ~5 km/h
-    uint16_t access_mask = (e.car_access ? 0x1 : 0) | (e.foot_access ? 0x2 : 0);
+    uint16_t access_mask = (e.car_access ? 0x1 : 0) | (e.foot_access ? 0x2 : 0) | (e.boat_access ? 0x4 : 0);
+    float flow_mps = e.boat_access ? flow_for_class(e.road_class) : 0.0f;
+    if (e.against_flow) flow_mps = -flow_mps;
 
     // shapes
     uint32_t shape_start = static_cast<uint32_t>(shape_offsets.size());
@@ -96,6 +123,9 @@ std::vector<uint8_t> buildLandTileBlob(const TileData& tile,
     uint32_t to_local   = node_id_to_local[e.shape.back().id];
 
     auto enc = fbb.CreateString("");
+    // Имя повторяется на каждом сегменте пути — в буфере хранится один раз
+    flatbuffers::Offset<flatbuffers::String> name;
+    if (!e.name.empty()) name = fbb.CreateSharedString(e.name);
     fb_edges.push_back(CreateEdge(fbb,
       from_local,
       to_local,
@@ -107,11 +137,42 @@ std::vector<uint8_t> buildLandTileBlob(const TileData& tile,
       access_mask,
       shape_start,
       shape_count,
-      enc));
+      enc,
+      name,
+      flow_mps));
   }
   auto edges_vec = fbb.CreateVector(fb_edges);
   auto shapes_vec = fbb.CreateVector(shape_offsets);
 
+  // Запреты манёвров: по via, без дублей (компактная таблица на узел)
+  struct QRestriction { int via_lat, via_lon, from_lat, from_lon, to_lat, to_lon; bool only; };
+  auto q = [](double deg) { return static_cast<int>(std::lround(deg * 1e6)); };
+  std::vector<QRestriction> qr;
+  qr.reserve(tile.restrictions.size());
+  for (const auto& r : tile.restrictions) {
+    qr.push_back(QRestriction{q(r.via.lat), q(r.via.lon), q(r.from.lat), q(r.from.lon),
+                              q(r.to.lat), q(r.to.lon), r.only});
+  }
+  auto tie = [](const QRestriction& r) {
+    return std::tie(r.via_lat, r.via_lon, r.from_lat, r.from_lon, r.to_lat, r.to_lon, r.only);
+  };
+  std::sort(qr.begin(), qr.end(), [&](const QRestriction& a, const QRestriction& b) { return tie(a) < tie(b); });
+  qr.erase(std::unique(qr.begin(), qr.end(), [&](const QRestriction& a, const QRestriction& b) { return tie(a) == tie(b); }),
+           qr.end());
+  flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<TurnRestriction>>> restrictions_vec;
+  if (!qr.empty()) {
+    std::vector<flatbuffers::Offset<TurnRestriction>> offsets;
+    offsets.reserve(qr.size());
+    for (const auto& r : qr) {
+      offsets.push_back(CreateTurnRestriction(fbb, r.via_lat, r.via_lon, r.from_lat, r.from_lon,
+                                              r.to_lat, r.to_lon, r.only));
+    }
+    restrictions_vec = fbb.CreateVector(offsets);
+  }
+
+  flatbuffers::Offset<flatbuffers::Vector<uint8_t>> water_cells_vec;
+  if (!tile.water_cells.empty()) water_cells_vec = fbb.CreateVector(tile.water_cells);
+
   auto checksum_str = fbb.CreateString("");
   auto land = CreateLandTile(fbb,
                              static_cast<uint16_t>(tile.key.z),
@@ -122,7 +183,10 @@ std::vector<uint8_t> buildLandTileBlob(const TileData& tile,
                              shapes_vec,
                              version,
                              checksum_str,
-                             profile_mask);
+                             profile_mask,
+                             restrictions_vec,
+                             tile.water_depth,
+                             water_cells_vec);
   fbb.Finish(land);
 
   auto ptr = fbb.GetBufferPointer();
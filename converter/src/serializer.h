@@ -6,7 +6,8 @@
 
 #include "pbf_reader.h"
 
-// Возвращает FlatBuffers blob для одного тайла
+// Возвращает FlatBuffers blob для одного тайла.
+// Исключение, если рёбер больше edgeid::kMaxTileEdges (индекс в edge_id — 16 бит).
 std::vector<uint8_t> buildLandTileBlob(const TileData& tile,
                                        uint32_t version,
                                        uint32_t profile_mask);
@@ -1,8 +1,12 @@
 #include "sqlite_writer.h"
 
+#include <algorithm>
 #include <cstdio>
+#include <filesystem>
 #include <string>
 #include "tiler.h"
+#include "routing_core/autocomplete.h"
+#include "routing_core/geocoder.h"
 
 static int noop_callback(void*, int, char**, char**) { return 0; }
 
@@ -36,6 +40,26 @@ void RoutingDbWriter::exec(const char* sql) {
   }
 }
 
+sqlite3_stmt* RoutingDbWriter::prepare(const char* sql) {
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    std::string msg = "Failed to prepare statement: ";
+    msg += sqlite3_errmsg(db_);
+    throw SqliteError(msg);
+  }
+  return stmt;
+}
+
+void RoutingDbWriter::stepDone(sqlite3_stmt* stmt, const char* what) {
+  if (sqlite3_step(stmt) != SQLITE_DONE) {
+    std::string msg = std::string("Failed to ") + what + ": ";
+    msg += sqlite3_errmsg(db_);
+    sqlite3_finalize(stmt);
+    throw SqliteError(msg);
+  }
+  sqlite3_finalize(stmt);
+}
+
 void RoutingDbWriter::createSchemaIfNeeded() {
   const char* create_tiles =
       "CREATE TABLE IF NOT EXISTS land_tiles (\n"
@@ -98,6 +122,18 @@ void RoutingDbWriter::writeMetadata(const std::string& key, const std::string& v
   sqlite3_finalize(stmt);
 }
 
+std::optional<std::string> RoutingDbWriter::readMetadata(const std::string& key) {
+  sqlite3_stmt* stmt = prepare("SELECT value FROM metadata WHERE key=?;");
+  sqlite3_bind_text(stmt, 1, key.c_str(), -1, SQLITE_TRANSIENT);
+  std::optional<std::string> out;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    const auto* text = sqlite3_column_text(stmt, 0);
+    if (text) out = std::string(reinterpret_cast<const char*>(text));
+  }
+  sqlite3_finalize(stmt);
+  return out;
+}
+
 void RoutingDbWriter::insertLandTile(int z, int x, int y,
                                      const BBox& bbox,
                                      int version,
@@ -108,6 +144,27 @@ void RoutingDbWriter::insertLandTile(int z, int x, int y,
   const char* sql =
       "INSERT INTO land_tiles(z,x,y,lat_min,lon_min,lat_max,lon_max,version,checksum,profile_mask,data)\n"
       "VALUES(?,?,?,?,?,?,?,?,?,?,?);";
+  writeLandTile(sql, z, x, y, bbox, version, checksum, profile_mask, blob_data, blob_size);
+}
+
+void RoutingDbWriter::upsertLandTile(int z, int x, int y,
+                                     const BBox& bbox,
+                                     int version,
+                                     const std::string& checksum,
+                                     int profile_mask,
+                                     const void* blob_data,
+                                     size_t blob_size) {
+  const char* sql =
+      "INSERT INTO land_tiles(z,x,y,lat_min,lon_min,lat_max,lon_max,version,checksum,profile_mask,data)\n"
+      "VALUES(?,?,?,?,?,?,?,?,?,?,?)\n"
+      "ON CONFLICT(z,x,y) DO UPDATE SET version=excluded.version, checksum=excluded.checksum,\n"
+      "  profile_mask=excluded.profile_mask, data=excluded.data;";
+  writeLandTile(sql, z, x, y, bbox, version, checksum, profile_mask, blob_data, blob_size);
+}
+
+void RoutingDbWriter::writeLandTile(const char* sql, int z, int x, int y,
+                                    const BBox& bbox, int version, const std::string& checksum,
+                                    int profile_mask, const void* blob_data, size_t blob_size) {
   sqlite3_stmt* stmt = nullptr;
   if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
     std::string msg = "Failed to prepare tile insert: ";
@@ -135,4 +192,208 @@ void RoutingDbWriter::insertLandTile(int z, int x, int y,
   sqlite3_finalize(stmt);
 }
 
+void RoutingDbWriter::deleteLandTile(int z, int x, int y) {
+  sqlite3_stmt* stmt = prepare("DELETE FROM land_tiles WHERE z=? AND x=? AND y=?;");
+  sqlite3_bind_int(stmt, 1, z);
+  sqlite3_bind_int(stmt, 2, x);
+  sqlite3_bind_int(stmt, 3, y);
+  stepDone(stmt, "delete tile");
+}
+
+void RoutingDbWriter::createWaterSchema() {
+  exec("CREATE TABLE IF NOT EXISTS water_tiles (\n"
+       "  z INTEGER NOT NULL,\n"
+       "  x INTEGER NOT NULL,\n"
+       "  y INTEGER NOT NULL,\n"
+       "  lat_min REAL NOT NULL,\n"
+       "  lon_min REAL NOT NULL,\n"
+       "  lat_max REAL NOT NULL,\n"
+       "  lon_max REAL NOT NULL,\n"
+       "  version INTEGER NOT NULL,\n"
+       "  checksum TEXT NOT NULL,\n"
+       "  profile_mask INTEGER NOT NULL,\n"
+       "  data BLOB NOT NULL\n"
+       ");");
+  exec("CREATE UNIQUE INDEX IF NOT EXISTS idx_water_tiles_zxy ON water_tiles(z,x,y);");
+}
+
+void RoutingDbWriter::insertWaterTile(int z, int x, int y,
+                                      const BBox& bbox,
+                                      int version,
+                                      const std::string& checksum,
+                                      int profile_mask,
+                                      const void* blob_data,
+                                      size_t blob_size) {
+  const char* sql =
+      "INSERT INTO water_tiles(z,x,y,lat_min,lon_min,lat_max,lon_max,version,checksum,profile_mask,data)\n"
+      "VALUES(?,?,?,?,?,?,?,?,?,?,?);";
+  writeLandTile(sql, z, x, y, bbox, version, checksum, profile_mask, blob_data, blob_size);
+}
+
+std::optional<int> RoutingDbWriter::landTileVersion(int z, int x, int y) {
+  sqlite3_stmt* stmt = prepare("SELECT version FROM land_tiles WHERE z=? AND x=? AND y=?;");
+  sqlite3_bind_int(stmt, 1, z);
+  sqlite3_bind_int(stmt, 2, x);
+  sqlite3_bind_int(stmt, 3, y);
+  std::optional<int> out;
+  if (sqlite3_step(stmt) == SQLITE_ROW) out = sqlite3_column_int(stmt, 0);
+  sqlite3_finalize(stmt);
+  return out;
+}
+
+void RoutingDbWriter::createWayIndexSchema() {
+  exec("CREATE TABLE IF NOT EXISTS osm_way_tiles (\n"
+       "  way_id INTEGER NOT NULL,\n"
+       "  tile_key INTEGER NOT NULL,\n"
+       "  PRIMARY KEY(way_id, tile_key)\n"
+       ") WITHOUT ROWID;");
+}
+
+bool RoutingDbWriter::hasWayIndex() {
+  sqlite3_stmt* stmt = prepare(
+      "SELECT 1 FROM sqlite_master WHERE type='table' AND name='osm_way_tiles';");
+  bool has = sqlite3_step(stmt) == SQLITE_ROW;
+  sqlite3_finalize(stmt);
+  return has;
+}
+
+void RoutingDbWriter::insertWayTiles(int64_t way_id, const std::vector<long long>& tile_keys) {
+  sqlite3_stmt* stmt = prepare(
+      "INSERT OR IGNORE INTO osm_way_tiles(way_id, tile_key) VALUES(?, ?);");
+  for (long long key : tile_keys) {
+    sqlite3_bind_int64(stmt, 1, way_id);
+    sqlite3_bind_int64(stmt, 2, key);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+      std::string msg = "Failed to insert way tile: ";
+      msg += sqlite3_errmsg(db_);
+      sqlite3_finalize(stmt);
+      throw SqliteError(msg);
+    }
+    sqlite3_reset(stmt);
+  }
+  sqlite3_finalize(stmt);
+}
+
+void RoutingDbWriter::deleteWayTiles(int64_t way_id) {
+  sqlite3_stmt* stmt = prepare("DELETE FROM osm_way_tiles WHERE way_id=?;");
+  sqlite3_bind_int64(stmt, 1, way_id);
+  stepDone(stmt, "delete way tiles");
+}
+
+std::vector<long long> RoutingDbWriter::wayTiles(int64_t way_id) {
+  sqlite3_stmt* stmt = prepare("SELECT tile_key FROM osm_way_tiles WHERE way_id=?;");
+  sqlite3_bind_int64(stmt, 1, way_id);
+  std::vector<long long> out;
+  while (sqlite3_step(stmt) == SQLITE_ROW) out.push_back(sqlite3_column_int64(stmt, 0));
+  sqlite3_finalize(stmt);
+  return out;
+}
+
+void RoutingDbWriter::createGeocoderSchema() {
+  exec("DROP TABLE IF EXISTS geo_fts;");
+  exec("DROP TABLE IF EXISTS geo_rtree;");
+  exec("DROP TABLE IF EXISTS geo_entities;");
+  exec("CREATE TABLE geo_entities (\n"
+       "  id INTEGER PRIMARY KEY,\n"
+       "  kind INTEGER NOT NULL,\n"
+       "  name TEXT NOT NULL,\n"
+       "  street TEXT,\n"
+       "  housenumber TEXT,\n"
+       "  city TEXT,\n"
+       "  postcode TEXT,\n"
+       "  category TEXT,\n"
+       "  lat REAL NOT NULL,\n"
+       "  lon REAL NOT NULL,\n"
+       "  importance REAL NOT NULL\n"
+       ");");
+  // Тексты уже лежат в geo_entities, поэтому FTS без собственной копии (content='').
+  // prefix='2 3 4' — отдельные индексы коротких префиксов для автодополнения: без них
+  // префикс разворачивается во все слова индекса с этим началом.
+  exec("CREATE VIRTUAL TABLE geo_fts USING fts5(\n"
+       "  name, address, content='', prefix='2 3 4',\n"
+       "  tokenize='unicode61 remove_diacritics 2'\n"
+       ");");
+  exec("CREATE VIRTUAL TABLE geo_rtree USING rtree(id, lat_min, lat_max, lon_min, lon_max);");
+}
+
+void RoutingDbWriter::insertGeoEntities(const std::vector<GeoEntity>& entities) {
+  sqlite3_stmt* entity = prepare(
+      "INSERT INTO geo_entities(id, kind, name, street, housenumber, city, postcode, category, lat, lon, importance)\n"
+      "VALUES(?,?,?,?,?,?,?,?,?,?,?);");
+  sqlite3_stmt* fts = prepare("INSERT INTO geo_fts(rowid, name, address) VALUES(?,?,?);");
+  sqlite3_stmt* rtree = prepare("INSERT INTO geo_rtree(id, lat_min, lat_max, lon_min, lon_max) VALUES(?,?,?,?,?);");
+  auto bindOptional = [](sqlite3_stmt* st, int idx, const std::string& v) {
+    if (v.empty()) sqlite3_bind_null(st, idx);
+    else sqlite3_bind_text(st, idx, v.c_str(), static_cast<int>(v.size()), SQLITE_TRANSIENT);
+  };
+  auto step = [&](sqlite3_stmt* st) {
+    if (sqlite3_step(st) != SQLITE_DONE) {
+      std::string msg = "Failed to insert geocoder entity: ";
+      msg += sqlite3_errmsg(db_);
+      sqlite3_finalize(entity);
+      sqlite3_finalize(fts);
+      sqlite3_finalize(rtree);
+      throw SqliteError(msg);
+    }
+    sqlite3_reset(st);
+  };
+
+  // id = позиция + 1: extract() уже упорядочил объекты по убыванию важности
+  int64_t id = 0;
+  for (const GeoEntity& e : entities) {
+    ++id;
+    sqlite3_bind_int64(entity, 1, id);
+    sqlite3_bind_int(entity, 2, e.kind);
+    sqlite3_bind_text(entity, 3, e.name.c_str(), static_cast<int>(e.name.size()), SQLITE_TRANSIENT);
+    bindOptional(entity, 4, e.street);
+    bindOptional(entity, 5, e.housenumber);
+    bindOptional(entity, 6, e.city);
+    bindOptional(entity, 7, e.postcode);
+    bindOptional(entity, 8, e.category);
+    sqlite3_bind_double(entity, 9, e.lat);
+    sqlite3_bind_double(entity, 10, e.lon);
+    sqlite3_bind_double(entity, 11, e.importance);
+    step(entity);
 
+    // У адреса улица и дом уже в имени — в колонку address идут только город и индекс
+    std::string address;
+    if (e.kind != static_cast<int>(routing_core::GeoKind::ADDRESS)) address = e.street + " " + e.housenumber + " ";
+    address += e.city + " " + e.postcode;
+    const std::string name = routing_core::geoIndexText(e.name);
+    address = routing_core::geoIndexText(address);
+    sqlite3_bind_int64(fts, 1, id);
+    sqlite3_bind_text(fts, 2, name.c_str(), static_cast<int>(name.size()), SQLITE_TRANSIENT);
+    sqlite3_bind_text(fts, 3, address.c_str(), static_cast<int>(address.size()), SQLITE_TRANSIENT);
+    step(fts);
+
+    sqlite3_bind_int64(rtree, 1, id);
+    sqlite3_bind_double(rtree, 2, e.lat);
+    sqlite3_bind_double(rtree, 3, e.lat);
+    sqlite3_bind_double(rtree, 4, e.lon);
+    sqlite3_bind_double(rtree, 5, e.lon);
+    step(rtree);
+  }
+  sqlite3_finalize(entity);
+  sqlite3_finalize(fts);
+  sqlite3_finalize(rtree);
+  // Слияние сегментов FTS после массовой вставки: меньше b-деревьев на запрос
+  exec("INSERT INTO geo_fts(geo_fts) VALUES('optimize');");
+}
+
+size_t RoutingDbWriter::writeGeocoder(const std::vector<GeoEntity>& entities, const std::string& dbPath,
+                                      const std::string& dataVersion) {
+  createGeocoderSchema();
+  insertGeoEntities(entities);
+  writeMetadata("geocoder_entities", std::to_string(entities.size()));
+  writeMetadata("geocoder_data_version", dataVersion);
+  // Подсказки при наборе — отдельным файлом рядом с пакетом: его отображают
+  // в память, а страницы SQLite так не прочитать
+  std::vector<routing_core::AutocompleteSource> acSources;
+  acSources.reserve(entities.size());
+  for (const auto& e : entities) {
+    acSources.push_back({static_cast<routing_core::GeoKind>(e.kind), e.name, e.city, e.lat, e.lon, e.importance});
+  }
+  const size_t acBytes = routing_core::writeAutocompleteIndex(acSources, dbPath + ".ac");
+  writeMetadata("geocoder_autocomplete", std::filesystem::path(dbPath).filename().string() + ".ac");
+  return acBytes;
+}
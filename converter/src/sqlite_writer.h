@@ -1,10 +1,13 @@
 #pragma once
 
 #include <sqlite3.h>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "tiler.h"
+#include "geocode_extractor.h"
 
 class SqliteError : public std::runtime_error {
 public:
@@ -18,6 +21,11 @@ public:
 
   void createSchemaIfNeeded();
   void writeMetadata(const std::string& key, const std::string& value);
+  std::optional<std::string> readMetadata(const std::string& key);
+
+  void beginTransaction() { exec("BEGIN TRANSACTION;"); }
+  void commitTransaction() { exec("COMMIT;"); }
+  void rollbackTransaction() { exec("ROLLBACK;"); }
 
   // Future: insertTile(z,x,y, bbox, version, checksum, profile_mask, data)
   void insertLandTile(int z, int x, int y,
@@ -27,10 +35,52 @@ public:
                       int profile_mask,
                       const void* blob_data,
                       size_t blob_size);
+  // Вставка или замена тайла по (z,x,y) — инкрементальные обновления
+  void upsertLandTile(int z, int x, int y,
+                      const BBox& bbox,
+                      int version,
+                      const std::string& checksum,
+                      int profile_mask,
+                      const void* blob_data,
+                      size_t blob_size);
+  void deleteLandTile(int z, int x, int y);
+  std::optional<int> landTileVersion(int z, int x, int y);
+
+  // Водный граф (профиль boat): water_tiles со схемой land_tiles, тот же формат BLOB
+  void createWaterSchema();
+  void insertWaterTile(int z, int x, int y,
+                       const BBox& bbox,
+                       int version,
+                       const std::string& checksum,
+                       int profile_mask,
+                       const void* blob_data,
+                       size_t blob_size);
+
+  // Индекс osm_way_tiles: way_id -> упакованные ключи тайлов (packTileKey)
+  void createWayIndexSchema();
+  bool hasWayIndex();
+  void insertWayTiles(int64_t way_id, const std::vector<long long>& tile_keys);
+  void deleteWayTiles(int64_t way_id);
+  std::vector<long long> wayTiles(int64_t way_id);
+
+  // Индекс геокодера: geo_entities + geo_fts (FTS5) + geo_rtree (R-tree).
+  // Схема пересоздаётся — стадия всегда пишет полный набор объектов.
+  void createGeocoderSchema();
+  void insertGeoEntities(const std::vector<GeoEntity>& entities);
+  // Весь индекс пакета dbPath: схема, объекты, метаданные geocoder_* и файл
+  // подсказок dbPath + ".ac". geocoder_data_version — data_version, по которой
+  // собран индекс: --update и дельты его не трогают. Возвращает размер .ac.
+  size_t writeGeocoder(const std::vector<GeoEntity>& entities, const std::string& dbPath,
+                       const std::string& dataVersion);
 
 private:
   sqlite3* db_ {nullptr};
   void exec(const char* sql);
+  sqlite3_stmt* prepare(const char* sql);
+  void stepDone(sqlite3_stmt* stmt, const char* what);
+  void writeLandTile(const char* sql, int z, int x, int y,
+                     const BBox& bbox, int version, const std::string& checksum,
+                     int profile_mask, const void* blob_data, size_t blob_size);
 };
 
 
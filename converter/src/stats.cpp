@@ -0,0 +1,179 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+#include <sys/resource.h>
+
+namespace {
+
+double cpuSeconds() {
+  rusage ru {};
+  getrusage(RUSAGE_SELF, &ru);
+  auto tv = [](const timeval& t) { return static_cast<double>(t.tv_sec) + static_cast<double>(t.tv_usec) / 1e6; };
+  return tv(ru.ru_utime) + tv(ru.ru_stime);
+}
+
+#ifdef __linux__
+// Сброс пика RSS процесса (VmHWM) до текущего RSS; false — ядро старше 4.0 или нет прав
+bool resetPeakRss() {
+  FILE* f = std::fopen("/proc/self/clear_refs", "w");
+  if (!f) return false;
+  const bool written = std::fputs("5", f) >= 0;
+  return std::fclose(f) == 0 && written;
+}
+
+// VmHWM из /proc/self/status: пик RSS с последнего сброса
+uint64_t hwmRssBytes() {
+  FILE* f = std::fopen("/proc/self/status", "r");
+  if (!f) return 0;
+  char line[256];
+  unsigned long long kb = 0;
+  while (std::fgets(line, sizeof(line), f)) {
+    if (std::sscanf(line, "VmHWM: %llu kB", &kb) == 1) break;
+  }
+  std::fclose(f);
+  return static_cast<uint64_t>(kb) * 1024;
+}
+#endif
+
+uint64_t peakRssBytes() {
+  rusage ru {};
+  getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+  return static_cast<uint64_t>(ru.ru_maxrss);        // macOS: байты
+#else
+  return static_cast<uint64_t>(ru.ru_maxrss) * 1024; // Linux: килобайты
+#endif
+}
+
+// Гистограмма по степеням двойки: bucket "le" = 2^k
+void writeHistogram(FILE* f, const char* name, const std::vector<size_t>& values, bool last) {
+  std::vector<size_t> sorted(values);
+  std::sort(sorted.begin(), sorted.end());
+  auto pct = [&](double p) -> size_t {
+    if (sorted.empty()) return 0;
+    size_t idx = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[idx];
+  };
+  uint64_t sum = 0;
+  for (size_t v : sorted) sum += v;
+
+  std::fprintf(f, "    \"%s\": {\n", name);
+  std::fprintf(f, "      \"min\": %zu, \"max\": %zu, \"mean\": %.1f, \"p50\": %zu, \"p95\": %zu, \"p99\": %zu,\n",
+               sorted.empty() ? 0 : sorted.front(), sorted.empty() ? 0 : sorted.back(),
+               sorted.empty() ? 0.0 : static_cast<double>(sum) / static_cast<double>(sorted.size()),
+               pct(0.50), pct(0.95), pct(0.99));
+  std::fprintf(f, "      \"buckets\": [");
+  size_t i = 0;
+  bool first = true;
+  for (uint64_t le = 1; i < sorted.size(); le <<= 1) {
+    size_t count = 0;
+    while (i < sorted.size() && sorted[i] <= le) { ++count; ++i; }
+    if (count == 0) continue;
+    std::fprintf(f, "%s{\"le\": %llu, \"count\": %zu}", first ? "" : ", ",
+                 static_cast<unsigned long long>(le), count);
+    first = false;
+  }
+  std::fprintf(f, "]\n    }%s\n", last ? "" : ",");
+}
+
+} // namespace
+
+void ConverterStats::beginStage(const std::string& name) {
+  if (in_stage_) endStage();
+  stages_.push_back(Stage{name});
+  in_stage_ = true;
+  wall_start_ = std::chrono::steady_clock::now();
+  cpu_start_ = cpuSeconds();
+#ifdef __linux__
+  peak_reset_ = resetPeakRss();
+#endif
+}
+
+void ConverterStats::endStage() {
+  if (!in_stage_) return;
+  Stage& s = stages_.back();
+  s.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start_).count();
+  s.cpu_s = cpuSeconds() - cpu_start_;
+  s.peak_rss_bytes = peakRssBytes();
+#ifdef __linux__
+  if (peak_reset_) {
+    if (const uint64_t hwm = hwmRssBytes()) {
+      s.peak_rss_bytes = hwm;
+      s.per_stage = true;
+    }
+  }
+#endif
+  max_peak_ = std::max(max_peak_, s.peak_rss_bytes);
+  in_stage_ = false;
+}
+
+void ConverterStats::setCounter(const std::string& name, uint64_t value) {
+  for (auto& c : counters_) {
+    if (c.first == name) { c.second = value; return; }
+  }
+  counters_.emplace_back(name, value);
+}
+
+void ConverterStats::writeJson(const std::string& path, size_t topN) const {
+  FILE* f = std::fopen(path.c_str(), "w");
+  if (!f) throw std::runtime_error("Failed to open stats report for writing: " + path);
+
+  std::fprintf(f, "{\n  \"stages\": [\n");
+  double total_wall = 0.0, total_cpu = 0.0;
+  for (size_t i = 0; i < stages_.size(); ++i) {
+    const Stage& s = stages_[i];
+    total_wall += s.wall_s;
+    total_cpu += s.cpu_s;
+    std::fprintf(f, "    {\"name\": \"%s\", \"wall_s\": %.3f, \"cpu_s\": %.3f, \"%s\": %llu}%s\n",
+                 s.name.c_str(), s.wall_s, s.cpu_s, s.per_stage ? "peak_rss_bytes" : "process_peak_rss_bytes",
+                 static_cast<unsigned long long>(s.peak_rss_bytes), i + 1 < stages_.size() ? "," : "");
+  }
+  std::fprintf(f, "  ],\n  \"total\": {\"wall_s\": %.3f, \"cpu_s\": %.3f, \"peak_rss_bytes\": %llu},\n",
+               total_wall, total_cpu, static_cast<unsigned long long>(std::max(max_peak_, peakRssBytes())));
+
+  std::fprintf(f, "  \"counters\": {");
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    std::fprintf(f, "%s\n    \"%s\": %llu", i ? "," : "", counters_[i].first.c_str(),
+                 static_cast<unsigned long long>(counters_[i].second));
+  }
+  std::fprintf(f, "\n  },\n");
+
+  std::vector<size_t> bytes, nodes, edges, shapes;
+  uint64_t total_bytes = 0;
+  for (const auto& t : tiles_) {
+    bytes.push_back(t.bytes);
+    nodes.push_back(t.nodes);
+    edges.push_back(t.edges);
+    shapes.push_back(t.shape_points);
+    total_bytes += t.bytes;
+  }
+  std::fprintf(f, "  \"tiles\": {\n    \"count\": %zu,\n    \"total_bytes\": %llu,\n",
+               tiles_.size(), static_cast<unsigned long long>(total_bytes));
+  writeHistogram(f, "bytes", bytes, false);
+  writeHistogram(f, "nodes", nodes, false);
+  writeHistogram(f, "edges", edges, false);
+  writeHistogram(f, "shape_points", shapes, true);
+  std::fprintf(f, "  },\n");
+
+  std::vector<const TileStat*> heaviest;
+  heaviest.reserve(tiles_.size());
+  for (const auto& t : tiles_) heaviest.push_back(&t);
+  const size_t n = std::min(topN, heaviest.size());
+  std::partial_sort(heaviest.begin(), heaviest.begin() + static_cast<std::ptrdiff_t>(n), heaviest.end(),
+                    [](const TileStat* a, const TileStat* b) { return a->bytes > b->bytes; });
+  std::fprintf(f, "  \"heaviest_tiles\": [\n");
+  for (size_t i = 0; i < n; ++i) {
+    const TileStat& t = *heaviest[i];
+    std::fprintf(f, "    {\"z\": %d, \"x\": %d, \"y\": %d, \"bytes\": %zu, \"nodes\": %zu, \"edges\": %zu, \"shape_points\": %zu}%s\n",
+                 t.key.z, t.key.x, t.key.y, t.bytes, t.nodes, t.edges, t.shape_points,
+                 i + 1 < n ? "," : "");
+  }
+  std::fprintf(f, "  ]\n}\n");
+
+  const bool failed = std::ferror(f) != 0;
+  std::fclose(f);
+  if (failed) throw std::runtime_error("Failed to write stats report: " + path);
+}
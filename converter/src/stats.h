@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tiler.h"
+
+// Метрики одного записанного тайла
+struct TileStat {
+  TileKey key {};
+  size_t bytes {0};
+  size_t nodes {0};
+  size_t edges {0};
+  size_t shape_points {0};
+};
+
+// Отчёт конвертера (--stats): время/память по стадиям, счётчики,
+// гистограммы размеров тайлов и самые тяжёлые тайлы.
+class ConverterStats {
+public:
+  void beginStage(const std::string& name);
+  void endStage();
+
+  void setCounter(const std::string& name, uint64_t value);
+  void addTile(const TileStat& tile) { tiles_.push_back(tile); }
+
+  // Пишет JSON-отчёт; topN — сколько самых больших (по байтам) тайлов перечислить
+  void writeJson(const std::string& path, size_t topN) const;
+
+private:
+  struct Stage {
+    std::string name;
+    double wall_s {0.0};
+    double cpu_s {0.0};
+    // Пик RSS за стадию: на Linux пик процесса (VmHWM) сбрасывается в начале
+    // стадии. Где сброс недоступен — пик процесса с запуска (per_stage = false),
+    // в отчёте он пишется как process_peak_rss_bytes.
+    uint64_t peak_rss_bytes {0};
+    bool per_stage {false};
+  };
+
+  std::vector<Stage> stages_;
+  std::vector<std::pair<std::string, uint64_t>> counters_;
+  std::vector<TileStat> tiles_;
+
+  bool in_stage_ {false};
+  std::chrono::steady_clock::time_point wall_start_ {};
+  double cpu_start_ {0.0};
+  bool peak_reset_ {false};  // сброс пика в beginStage удался
+  uint64_t max_peak_ {0};    // наибольший пик стадий: сброс обнуляет и ru_maxrss
+};
+
+// RAII-стадия; stats может быть nullptr (отчёт не запрошен)
+class ScopedStage {
+public:
+  ScopedStage(ConverterStats* stats, const std::string& name) : stats_(stats) {
+    if (stats_) stats_->beginStage(name);
+  }
+  ~ScopedStage() { if (stats_) stats_->endStage(); }
+  ScopedStage(const ScopedStage&) = delete;
+  ScopedStage& operator=(const ScopedStage&) = delete;
+
+private:
+  ConverterStats* stats_;
+};
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Табличная интерпретация OSM-тегов пути.
+//
+// Все интерпретируемые пары (key, value) лежат в kTagRules; по ним на этапе
+// компиляции подбирается seed идеального хеша, так что разбор одного тега —
+// одна проба в таблице и одно сравнение строк. Новый тег/значение — новая
+// строка в kTagRules, без ветвлений в PbfReader.
+namespace tag_table {
+
+// Биты доступа совпадают с Edge.access_mask / profile_mask
+constexpr uint8_t kCar = 0x1;
+constexpr uint8_t kFoot = 0x2;
+constexpr uint8_t kBoat = 0x4;
+
+constexpr int8_t kOnewayNo = 0;
+constexpr int8_t kOnewayForward = 1;
+constexpr int8_t kOnewayBackward = -1;
+constexpr int8_t kOnewayReversible = 2; // направление меняется по времени — авто не пускаем
+
+enum class TagKind : uint8_t {
+  HIGHWAY,     // класс дороги, доступ и oneway по умолчанию, подсказка скорости
+  WATERWAY,    // класс водного пути (река/канал), доступ для лодки
+  ACCESS,      // access=* — общий доступ
+  MODE_ACCESS, // motor_vehicle/motorcar/vehicle/foot/boat=* — доступ конкретного профиля (приоритетнее access)
+  ONEWAY,      // oneway=* — явное направление
+  JUNCTION,    // junction=roundabout — неявный oneway
+  MAXSPEED,    // символьные maxspeed (walk, RU:urban, ...); числа разбираются parseMaxspeed
+  WATER_AREA   // площадная вода и береговая линия — для маски открытой воды, не граф
+};
+
+// WATER_AREA: замкнутый контур воды или береговая линия (вода справа по ходу пути)
+constexpr uint8_t kAreaWater = 1;
+constexpr uint8_t kAreaCoastline = 2;
+
+struct TagRule {
+  std::string_view key;
+  std::string_view value;
+  TagKind kind;
+  int8_t road_class {-1};   // HIGHWAY: Routing::RoadClass
+  uint8_t access {0};       // HIGHWAY: доступ по умолчанию; *ACCESS: затрагиваемые профили
+  bool allow {false};       // *ACCESS: разрешить/запретить
+  int8_t oneway {kOnewayNo};
+  uint16_t speed_kmh {0};   // HIGHWAY: типичная скорость; MAXSPEED: значение (0 — без ограничения)
+  uint8_t area {0};         // WATER_AREA: kAreaWater / kAreaCoastline
+};
+
+constexpr TagRule highway(std::string_view v, int8_t cls, uint8_t access, uint16_t kmh, int8_t oneway = kOnewayNo) {
+  return TagRule{"highway", v, TagKind::HIGHWAY, cls, access, false, oneway, kmh};
+}
+constexpr TagRule waterway(std::string_view v, int8_t cls) {
+  return TagRule{"waterway", v, TagKind::WATERWAY, cls, kBoat, false, kOnewayNo, 0};
+}
+constexpr TagRule access(std::string_view k, std::string_view v, uint8_t modes, bool allow) {
+  return TagRule{k, v, k == "access" ? TagKind::ACCESS : TagKind::MODE_ACCESS, -1, modes, allow};
+}
+constexpr TagRule oneway(std::string_view k, std::string_view v, int8_t dir) {
+  return TagRule{k, v, k == "oneway" ? TagKind::ONEWAY : TagKind::JUNCTION, -1, 0, false, dir};
+}
+constexpr TagRule maxspeed(std::string_view v, uint16_t kmh) {
+  return TagRule{"maxspeed", v, TagKind::MAXSPEED, -1, 0, false, kOnewayNo, kmh};
+}
+constexpr TagRule waterArea(std::string_view k, std::string_view v, uint8_t area) {
+  return TagRule{k, v, TagKind::WATER_AREA, -1, 0, false, kOnewayNo, 0, area};
+}
+
+// RoadClass: 0 MOTORWAY, 1 PRIMARY, 2 SECONDARY, 3 RESIDENTIAL, 4 FOOTWAY, 5 PATH, 6 STEPS,
+// 7 RIVER, 8 CANAL (водные классы идут в отдельный слой water_tiles)
+constexpr int kFirstWaterClass = 7;
+
+inline constexpr TagRule kTagRules[] = {
+  highway("motorway",       0, kCar,         110, kOnewayForward),
+  highway("motorway_link",  0, kCar,          60, kOnewayForward),
+  highway("trunk",          1, kCar | kFoot,  90),
+  highway("trunk_link",     1, kCar | kFoot,  50),
+  highway("primary",        1, kCar | kFoot,  80),
+  highway("primary_link",   1, kCar | kFoot,  50),
+  highway("secondary",      2, kCar | kFoot,  60),
+  highway("secondary_link", 2, kCar | kFoot,  40),
+  highway("tertiary",       3, kCar | kFoot,  50),
+  highway("tertiary_link",  3, kCar | kFoot,  40),
+  highway("unclassified",   3, kCar | kFoot,  40),
+  highway("residential",    3, kCar | kFoot,  30),
+  highway("living_street",  3, kCar | kFoot,  10),
+  highway("service",        3, kCar | kFoot,  20),
+  highway("road",           3, kCar | kFoot,  30),
+  highway("track",          3, kCar | kFoot,  15),
+  highway("pedestrian",     4, kFoot,          0),
+  highway("footway",        4, kFoot,          0),
+  highway("bridleway",      4, kFoot,          0),
+  highway("path",           5, kFoot,          0),
+  highway("cycleway",       5, kFoot,          0),
+  highway("steps",          6, kFoot,          0),
+
+  waterway("river", 7),
+  waterway("canal", 8),
+
+  waterArea("natural", "water", kAreaWater),
+  waterArea("waterway", "riverbank", kAreaWater),
+  waterArea("landuse", "reservoir", kAreaWater),
+  waterArea("natural", "coastline", kAreaCoastline),
+
+  access("access", "yes", kCar | kFoot, true),
+  access("access", "permissive", kCar | kFoot, true),
+  access("access", "designated", kCar | kFoot, true),
+  access("access", "destination", kCar | kFoot, true),
+  access("access", "delivery", kCar | kFoot, true),
+  access("access", "no", kCar | kFoot, false),
+  access("access", "private", kCar | kFoot, false),
+  access("access", "agricultural", kCar | kFoot, false),
+  access("access", "forestry", kCar | kFoot, false),
+
+  access("vehicle", "yes", kCar, true),
+  access("vehicle", "permissive", kCar, true),
+  access("vehicle", "destination", kCar, true),
+  access("vehicle", "delivery", kCar, true),
+  access("vehicle", "no", kCar, false),
+  access("vehicle", "private", kCar, false),
+  access("vehicle", "agricultural", kCar, false),
+  access("vehicle", "forestry", kCar, false),
+
+  access("motor_vehicle", "yes", kCar, true),
+  access("motor_vehicle", "permissive", kCar, true),
+  access("motor_vehicle", "designated", kCar, true),
+  access("motor_vehicle", "destination", kCar, true),
+  access("motor_vehicle", "delivery", kCar, true),
+  access("motor_vehicle", "no", kCar, false),
+  access("motor_vehicle", "private", kCar, false),
+  access("motor_vehicle", "agricultural", kCar, false),
+  access("motor_vehicle", "forestry", kCar, false),
+
+  access("motorcar", "yes", kCar, true),
+  access("motorcar", "permissive", kCar, true),
+  access("motorcar", "designated", kCar, true),
+  access("motorcar", "destination", kCar, true),
+  access("motorcar", "no", kCar, false),
+  access("motorcar", "private", kCar, false),
+
+  access("foot", "yes", kFoot, true),
+  access("foot", "permissive", kFoot, true),
+  access("foot", "designated", kFoot, true),
+  access("foot", "destination", kFoot, true),
+  access("foot", "no", kFoot, false),
+  access("foot", "private", kFoot, false),
+  access("foot", "use_sidepath", kFoot, false),
+
+  access("boat", "yes", kBoat, true),
+  access("boat", "permissive", kBoat, true),
+  access("boat", "designated", kBoat, true),
+  access("boat", "no", kBoat, false),
+  access("boat", "private", kBoat, false),
+  access("motorboat", "yes", kBoat, true),
+  access("motorboat", "designated", kBoat, true),
+  access("motorboat", "no", kBoat, false),
+  access("motorboat", "private", kBoat, false),
+
+  oneway("oneway", "yes", kOnewayForward),
+  oneway("oneway", "true", kOnewayForward),
+  oneway("oneway", "1", kOnewayForward),
+  oneway("oneway", "-1", kOnewayBackward),
+  oneway("oneway", "reverse", kOnewayBackward),
+  oneway("oneway", "reversible", kOnewayReversible),
+  oneway("oneway", "alternating", kOnewayReversible),
+  oneway("oneway", "no", kOnewayNo),
+  oneway("oneway", "false", kOnewayNo),
+  oneway("oneway", "0", kOnewayNo),
+  oneway("junction", "roundabout", kOnewayForward),
+  oneway("junction", "circular", kOnewayForward),
+
+  maxspeed("walk", 6),
+  maxspeed("none", 0),
+  maxspeed("signals", 0),
+  maxspeed("RU:living_street", 20),
+  maxspeed("RU:urban", 60),
+  maxspeed("RU:rural", 90),
+  maxspeed("RU:motorway", 110),
+  maxspeed("DE:living_street", 7),
+  maxspeed("DE:urban", 50),
+  maxspeed("DE:rural", 100),
+  maxspeed("AT:urban", 50),
+  maxspeed("AT:rural", 100),
+  maxspeed("CH:urban", 50),
+  maxspeed("CH:rural", 80),
+  maxspeed("CH:motorway", 120),
+};
+
+inline constexpr size_t kRuleCount = sizeof(kTagRules) / sizeof(kTagRules[0]);
+inline constexpr size_t kSlotCount = 1024; // степень двойки, ~10x от числа правил
+
+constexpr uint32_t hashTag(std::string_view key, std::string_view value, uint32_t seed) {
+  uint32_t h = 2166136261u ^ seed;
+  for (char c : key) { h ^= static_cast<uint8_t>(c); h *= 16777619u; }
+  h ^= 0xffu; h *= 16777619u; // разделитель key/value
+  for (char c : value) { h ^= static_cast<uint8_t>(c); h *= 16777619u; }
+  h ^= h >> 15; h *= 0x2c1b3c6du; h ^= h >> 12;
+  return h;
+}
+
+struct PerfectTable {
+  uint32_t seed {0};
+  std::array<int16_t, kSlotCount> slots {}; // индекс в kTagRules или -1
+};
+
+// Перебор seed до первого без коллизий (выполняется компилятором)
+constexpr PerfectTable buildTable() {
+  for (uint32_t seed = 1; seed < 100000; ++seed) {
+    PerfectTable t;
+    t.seed = seed;
+    for (auto& s : t.slots) s = -1;
+    bool ok = true;
+    for (size_t i = 0; i < kRuleCount && ok; ++i) {
+      const size_t slot = hashTag(kTagRules[i].key, kTagRules[i].value, seed) & (kSlotCount - 1);
+      if (t.slots[slot] >= 0) ok = false;
+      else t.slots[slot] = static_cast<int16_t>(i);
+    }
+    if (ok) return t;
+  }
+  return PerfectTable{};
+}
+
+inline constexpr PerfectTable kTable = buildTable();
+static_assert(kTable.seed != 0, "tag_table: no collision-free seed, increase kSlotCount");
+
+// nullptr — пара не интерпретируется
+constexpr const TagRule* lookup(std::string_view key, std::string_view value) {
+  const int16_t idx = kTable.slots[hashTag(key, value, kTable.seed) & (kSlotCount - 1)];
+  if (idx < 0) return nullptr;
+  const TagRule& r = kTagRules[idx];
+  return (r.key == key && r.value == value) ? &r : nullptr;
+}
+
+static_assert(lookup("highway", "primary") && lookup("highway", "primary")->road_class == 1);
+static_assert(lookup("oneway", "-1") && lookup("oneway", "-1")->oneway == kOnewayBackward);
+static_assert(lookup("highway", "platform") == nullptr);
+static_assert(lookup("waterway", "canal") && lookup("waterway", "canal")->road_class == 8);
+static_assert(lookup("natural", "coastline") && lookup("natural", "coastline")->area == kAreaCoastline);
+
+// Числовой maxspeed: "50", "50 km/h", "30 mph", "6 knots" (на воде); 0 — не распознан
+constexpr uint16_t parseMaxspeed(std::string_view v) {
+  uint32_t n = 0;
+  size_t i = 0;
+  while (i < v.size() && v[i] >= '0' && v[i] <= '9' && n < 1000) { n = n * 10 + static_cast<uint32_t>(v[i] - '0'); ++i; }
+  if (i == 0) return 0;
+  while (i < v.size() && v[i] == ' ') ++i;
+  if (v.substr(i) == "mph") n = n * 1609 / 1000;
+  else if (v.substr(i) == "knots") n = n * 1852 / 1000;
+  else if (!v.substr(i).empty() && v.substr(i) != "km/h" && v.substr(i) != "kmh") return 0;
+  return static_cast<uint16_t>(n);
+}
+
+static_assert(parseMaxspeed("50") == 50 && parseMaxspeed("30 mph") == 48 && parseMaxspeed("RU:urban") == 0);
+static_assert(parseMaxspeed("6 knots") == 11);
+
+// Итог по всем тегам пути
+struct WayAttributes {
+  int road_class {-1};       // -1 — не дорога и не водный путь (или значение не интерпретируется)
+  uint8_t access {0};        // kCar | kFoot | kBoat
+  int8_t oneway {kOnewayNo};
+  uint16_t speed_kmh {0};    // maxspeed, иначе типичная скорость класса; 0 — не задано
+  uint8_t water_area {0};    // kAreaWater / kAreaCoastline; независимо от road_class
+};
+
+// Накопитель: add() на каждый тег пути, затем result()
+class WayTagClassifier {
+public:
+  constexpr void add(std::string_view key, std::string_view value) {
+    const TagRule* r = lookup(key, value);
+    if (!r) {
+      if (key == "maxspeed") maxspeed_ = parseMaxspeed(value);
+      return;
+    }
+    switch (r->kind) {
+      case TagKind::HIGHWAY: highway_ = r; break;
+      case TagKind::WATERWAY: waterway_ = r; break;
+      case TagKind::ACCESS: apply(general_allow_, general_deny_, *r); break;
+      case TagKind::MODE_ACCESS: apply(mode_allow_, mode_deny_, *r); break;
+      case TagKind::ONEWAY: oneway_ = r->oneway; has_oneway_ = true; break;
+      case TagKind::JUNCTION: implied_oneway_ = r->oneway; break;
+      case TagKind::MAXSPEED: maxspeed_ = r->speed_kmh; break;
+      case TagKind::WATER_AREA: water_area_ = r->area; break;
+    }
+  }
+
+  constexpr WayAttributes result() const {
+    WayAttributes a;
+    a.water_area = water_area_;
+    // highway на пути-плотине или шлюзе важнее waterway: это дорога
+    const TagRule* cls = highway_ ? highway_ : waterway_;
+    if (!cls) return a;
+    a.road_class = cls->road_class;
+    uint8_t acc = cls->access;
+    acc = static_cast<uint8_t>((acc | general_allow_) & ~general_deny_);
+    acc = static_cast<uint8_t>((acc | mode_allow_) & ~mode_deny_);
+    a.oneway = has_oneway_ ? oneway_ : (implied_oneway_ != kOnewayNo ? implied_oneway_ : cls->oneway);
+    if (a.oneway == kOnewayReversible) {
+      acc = static_cast<uint8_t>(acc & ~kCar);
+      a.oneway = kOnewayNo;
+    }
+    a.access = acc;
+    a.speed_kmh = maxspeed_ ? maxspeed_ : cls->speed_kmh;
+    return a;
+  }
+
+private:
+  static constexpr void apply(uint8_t& allow, uint8_t& deny, const TagRule& r) {
+    if (r.allow) { allow |= r.access; deny = static_cast<uint8_t>(deny & ~r.access); }
+    else { deny |= r.access; allow = static_cast<uint8_t>(allow & ~r.access); }
+  }
+
+  const TagRule* highway_ {nullptr};
+  const TagRule* waterway_ {nullptr};
+  uint8_t general_allow_ {0}, general_deny_ {0};
+  uint8_t mode_allow_ {0}, mode_deny_ {0};
+  int8_t oneway_ {kOnewayNo};
+  bool has_oneway_ {false};
+  int8_t implied_oneway_ {kOnewayNo};
+  uint16_t maxspeed_ {0};
+  uint8_t water_area_ {0};
+};
+
+} // namespace tag_table
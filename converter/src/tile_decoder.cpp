@@ -0,0 +1,83 @@
+#include "tile_decoder.h"
+
+#include <cmath>
+
+#include <flatbuffers/flatbuffers.h>
+#include "land_tile_generated.h"
+
+using namespace Routing;
+
+int64_t quantizedNodeId(int32_t lat_q, int32_t lon_q) {
+  return static_cast<int64_t>((static_cast<uint64_t>(static_cast<uint32_t>(lat_q)) << 32) |
+                              static_cast<uint64_t>(static_cast<uint32_t>(lon_q)));
+}
+
+std::optional<TileData> decodeLandTile(const uint8_t* data, size_t size) {
+  if (!data || size == 0) return std::nullopt;
+  flatbuffers::Verifier verifier(data, size);
+  if (!VerifyLandTileBuffer(verifier)) return std::nullopt;
+  const LandTile* tile = GetLandTile(data);
+
+  TileData td;
+  td.key = TileKey{static_cast<int>(tile->z()), static_cast<int>(tile->x()), static_cast<int>(tile->y())};
+  td.bbox = tileBounds(td.key);
+
+  auto point = [](int32_t lat_q, int32_t lon_q) {
+    return SimpleNode{quantizedNodeId(lat_q, lon_q), lat_q / 1e6, lon_q / 1e6};
+  };
+
+  if (tile->water_cells()) {
+    td.water_depth = tile->water_depth();
+    td.water_cells.assign(tile->water_cells()->data(), tile->water_cells()->data() + tile->water_cells()->size());
+  }
+
+  if (tile->nodes()) {
+    td.nodes.reserve(tile->nodes()->size());
+    for (const auto* n : *tile->nodes()) td.nodes.push_back(point(n->lat_q(), n->lon_q()));
+  }
+  if (!tile->edges() || !tile->nodes()) return td;
+
+  const auto* nodes = tile->nodes();
+  const auto* shapes = tile->shapes();
+  td.edges.reserve(tile->edges()->size());
+  for (const auto* e : *tile->edges()) {
+    if (e->from_node() >= nodes->size() || e->to_node() >= nodes->size()) continue;
+    SimpleEdge se;
+    const auto* from = nodes->Get(e->from_node());
+    const auto* to = nodes->Get(e->to_node());
+    se.from_node_id = quantizedNodeId(from->lat_q(), from->lon_q());
+    se.to_node_id = quantizedNodeId(to->lat_q(), to->lon_q());
+    if (shapes && e->shape_count() >= 2 && e->shape_start() + e->shape_count() <= shapes->size()) {
+      for (uint32_t k = 0; k < e->shape_count(); ++k) {
+        const auto* sp = shapes->Get(e->shape_start() + k);
+        se.shape.push_back(point(sp->lat_q(), sp->lon_q()));
+      }
+      // концы формы — это узлы ребра
+      se.shape.front().id = se.from_node_id;
+      se.shape.back().id = se.to_node_id;
+    } else {
+      se.shape = {point(from->lat_q(), from->lon_q()), point(to->lat_q(), to->lon_q())};
+    }
+    se.oneway = e->oneway();
+    se.road_class = static_cast<int>(e->road_class());
+    se.car_access = (e->access_mask() & 0x1) != 0;
+    se.foot_access = (e->access_mask() & 0x2) != 0;
+    se.boat_access = (e->access_mask() & 0x4) != 0;
+    se.against_flow = e->flow_mps() < 0.0f;
+    if ((se.car_access || se.boat_access) && e->speed_mps() > 0.0f) {
+      se.speed_kmh = static_cast<uint16_t>(std::lround(e->speed_mps() * 3.6f));
+    }
+    if (e->name()) se.name = e->name()->str();
+    td.edges.push_back(std::move(se));
+  }
+  if (tile->restrictions()) {
+    td.restrictions.reserve(tile->restrictions()->size());
+    for (const auto* r : *tile->restrictions()) {
+      td.restrictions.push_back(TurnRestrictionData{point(r->from_lat_q(), r->from_lon_q()),
+                                                    point(r->via_lat_q(), r->via_lon_q()),
+                                                    point(r->to_lat_q(), r->to_lon_q()),
+                                                    r->only()});
+    }
+  }
+  return td;
+}
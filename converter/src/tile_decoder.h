@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "pbf_reader.h"
+
+// Обратное преобразование FlatBuffers-тайла в TileData (для extract/merge).
+// OSM-идентификаторов в тайле нет: id узла = упакованные lat_q/lon_q, поэтому
+// узлы на стыке тайлов и пакетов совпадают так же, как при сшивке в роутере.
+std::optional<TileData> decodeLandTile(const uint8_t* data, size_t size);
+
+int64_t quantizedNodeId(int32_t lat_q, int32_t lon_q);
@@ -27,6 +27,16 @@ inline TileKey tileKeyFor(double lat_deg, double lon_deg, int z = 14) {
   return {z, x, y};
 }
 
+// Упакованный ключ тайла [z:6][x:29][y:29] (ключ карты тайлов и индекса osm_way_tiles)
+inline long long packTileKey(const TileKey& k) {
+  return (static_cast<long long>(k.z) << 58) ^ (static_cast<long long>(k.x) << 29) ^ static_cast<long long>(k.y);
+}
+
+inline TileKey unpackTileKey(long long key) {
+  const long long mask = (1LL << 29) - 1;
+  return {static_cast<int>((key >> 58) & 0x3F), static_cast<int>((key >> 29) & mask), static_cast<int>(key & mask)};
+}
+
 inline BBox tileBounds(const TileKey& key) {
   const int n = 1 << key.z;
   const double unit = 1.0 / static_cast<double>(n);
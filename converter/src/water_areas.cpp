@@ -0,0 +1,180 @@
+#include "water_areas.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <unordered_set>
+
+#include "tag_table.h"
+
+#ifdef HAVE_LIBOSMIUM
+#  include <osmium/area/assembler.hpp>
+#  include <osmium/io/any_input.hpp>
+#  include <osmium/osm/area.hpp>
+#  include <osmium/osm/entity_bits.hpp>
+#  include <osmium/osm/relation.hpp>
+#  include <osmium/osm/way.hpp>
+#endif
+
+namespace {
+
+#ifdef HAVE_LIBOSMIUM
+uint8_t waterTags(const osmium::TagList& tags) {
+  tag_table::WayTagClassifier classifier;
+  for (const osmium::Tag& tag : tags) classifier.add(tag.key(), tag.value());
+  return classifier.result().water_area;
+}
+
+template <typename Ring>
+std::vector<SimpleNode> ringNodes(const Ring& ring) {
+  std::vector<SimpleNode> out;
+  out.reserve(ring.size());
+  for (const osmium::NodeRef& nr : ring) {
+    if (nr.location().valid()) out.push_back(SimpleNode{0, nr.location().lat(), nr.location().lon()});
+  }
+  return out;
+}
+#endif
+
+} // namespace
+
+std::vector<WaterArea> WaterAreaExtractor::extract(const std::unordered_map<int64_t, SimpleNode>& node_index) {
+  std::vector<WaterArea> out;
+  stats_ = WaterAreaStats{};
+
+#ifdef HAVE_LIBOSMIUM
+  using osmium::memory::Buffer;
+
+  // Проход 1: мультиполигоны воды. Не-пути среди членов обнуляются, как в
+  // MultipolygonManager: сборщик сопоставляет ненулевые члены списку путей.
+  Buffer relations{1 << 20, Buffer::auto_grow::yes};
+  std::vector<size_t> relationOffsets;
+  std::unordered_set<int64_t> memberWays;
+  {
+    osmium::io::Reader reader{input_path_, osmium::osm_entity_bits::relation};
+    while (Buffer buffer = reader.read()) {
+      for (const osmium::OSMEntity& entity : buffer) {
+        if (entity.type() != osmium::item_type::relation) continue;
+        const auto& rel = static_cast<const osmium::Relation&>(entity);
+        const char* type = rel.tags().get_value_by_key("type");
+        if (!type || std::strcmp(type, "multipolygon") != 0) continue;
+        if (waterTags(rel.tags()) != tag_table::kAreaWater) continue;
+        const size_t offset = relations.committed();
+        relations.add_item(rel);
+        relations.commit();
+        relationOffsets.push_back(offset);
+        for (osmium::RelationMember& m : relations.get<osmium::Relation>(offset).members()) {
+          if (m.type() == osmium::item_type::way) memberWays.insert(m.ref());
+          else m.set_ref(0);
+        }
+      }
+    }
+    reader.close();
+  }
+
+  // Проход 2: пути. Копии в общем буфере получают координаты узлов — сборщику
+  // нужны location у NodeRef, а сам PBF их не несёт.
+  Buffer ways{1 << 24, Buffer::auto_grow::yes};
+  std::unordered_map<int64_t, size_t> wayOffsets; // члены мультиполигонов
+  std::vector<size_t> closedWays;
+  {
+    osmium::io::Reader reader{input_path_, osmium::osm_entity_bits::way};
+    while (Buffer buffer = reader.read()) {
+      for (osmium::OSMEntity& entity : buffer) {
+        if (entity.type() != osmium::item_type::way) continue;
+        auto& w = static_cast<osmium::Way&>(entity);
+        const uint8_t area = waterTags(w.tags());
+        const bool member = memberWays.count(w.id()) != 0;
+        if (!area && !member) continue;
+        for (osmium::NodeRef& nr : w.nodes()) {
+          auto it = node_index.find(nr.positive_ref());
+          if (it != node_index.end()) nr.set_location(osmium::Location(it->second.lon, it->second.lat));
+        }
+        if (area == tag_table::kAreaCoastline) {
+          WaterArea coast;
+          coast.coastline = true;
+          coast.rings.push_back(ringNodes(w.nodes()));
+          if (coast.rings[0].size() >= 2) {
+            out.push_back(std::move(coast));
+            ++stats_.coastlines;
+          }
+          if (!member) continue;
+        }
+        const size_t offset = ways.committed();
+        ways.add_item(w);
+        ways.commit();
+        if (member) wayOffsets.emplace(w.id(), offset);
+        // Замкнутый путь-член мультиполигона (outer с тегами воды) собирается в
+        // составе отношения: отдельный полигон залил бы его острова (inner)
+        if (area == tag_table::kAreaWater && !member && w.nodes().size() >= 4 && w.ends_have_same_id()) {
+          closedWays.push_back(offset);
+        }
+      }
+    }
+    reader.close();
+  }
+
+  // Сборка: задания [0, closedWays) — пути, дальше — отношения
+  const size_t jobs = closedWays.size() + relationOffsets.size();
+  const unsigned threads = static_cast<unsigned>(std::min<size_t>(threads_, std::max<size_t>(jobs, 1)));
+  std::atomic<size_t> next{0};
+  std::vector<std::vector<WaterArea>> results(threads);
+  std::vector<WaterAreaStats> counts(threads);
+  auto worker = [&](unsigned t) {
+    osmium::area::AssemblerConfig config;
+    osmium::area::Assembler assembler{config};
+    Buffer assembled{1 << 16, Buffer::auto_grow::yes};
+    std::vector<const osmium::Way*> members;
+    for (size_t i = next.fetch_add(1); i < jobs; i = next.fetch_add(1)) {
+      assembled.clear();
+      bool ok = false;
+      if (i < closedWays.size()) {
+        ok = assembler(ways.get<osmium::Way>(closedWays[i]), assembled);
+      } else {
+        const auto& rel = relations.get<osmium::Relation>(relationOffsets[i - closedWays.size()]);
+        members.clear();
+        ok = true;
+        for (const osmium::RelationMember& m : rel.members()) {
+          if (m.ref() == 0) continue;
+          auto it = wayOffsets.find(m.ref());
+          if (it == wayOffsets.end()) {
+            ok = false; // часть контура за границей выгрузки
+            break;
+          }
+          members.push_back(&ways.get<osmium::Way>(it->second));
+        }
+        ok = ok && !members.empty() && assembler(rel, members, assembled);
+      }
+      for (const osmium::Area& a : assembled.select<osmium::Area>()) {
+        WaterArea area;
+        for (const osmium::OuterRing& outer : a.outer_rings()) {
+          area.rings.push_back(ringNodes(outer));
+          for (const osmium::InnerRing& inner : a.inner_rings(outer)) area.rings.push_back(ringNodes(inner));
+        }
+        area.rings.erase(std::remove_if(area.rings.begin(), area.rings.end(),
+                                        [](const std::vector<SimpleNode>& r) { return r.size() < 4; }),
+                         area.rings.end());
+        if (area.rings.empty()) ok = false;
+        else results[t].push_back(std::move(area));
+      }
+      if (!ok) ++counts[t].failed;
+      else ++(i < closedWays.size() ? counts[t].polygons : counts[t].multipolygons);
+    }
+  };
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+  worker(0);
+  for (auto& th : pool) th.join();
+
+  for (unsigned t = 0; t < threads; ++t) {
+    stats_.polygons += counts[t].polygons;
+    stats_.multipolygons += counts[t].multipolygons;
+    stats_.failed += counts[t].failed;
+    for (auto& area : results[t]) out.push_back(std::move(area));
+  }
+#else
+  (void)node_index;
+#endif
+  return out;
+}
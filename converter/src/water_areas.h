@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pbf_reader.h"
+
+// Площадная вода (natural=water и т.п.): внешние и внутренние кольца полигона,
+// острова — по правилу чёт/нечет. Береговая линия natural=coastline — одна
+// ломаная в rings[0] (суша слева, вода справа по ходу пути).
+struct WaterArea {
+  std::vector<std::vector<SimpleNode>> rings;
+  bool coastline {false};
+};
+
+struct WaterAreaStats {
+  uint64_t polygons {0};        // замкнутые пути natural=water и т.п.
+  uint64_t multipolygons {0};   // отношения type=multipolygon с тегами воды
+  uint64_t coastlines {0};      // пути natural=coastline
+  uint64_t failed {0};          // не собрались: разрывы колец, члены вне выгрузки
+};
+
+// Сборка контуров открытой воды для маски water_tiles (water_mask.h).
+//
+// Два прохода по PBF: отношения-мультиполигоны воды, затем пути — контуры
+// воды, их члены и береговая линия — с координатами из индекса узлов
+// PbfReader, поэтому вызывать до buildTiles(). Полигоны собирает
+// osmium::area::Assembler в threads потоках (у каждого свой сборщик и выходной
+// буфер, задания раздаются счётчиком), так что время стадии делится на ядра.
+// Береговую линию в кольца не собираем: маска заливает её по направлению пути.
+class WaterAreaExtractor {
+public:
+  WaterAreaExtractor(std::string input_path, unsigned threads)
+    : input_path_(std::move(input_path)), threads_(threads ? threads : 1) {}
+
+  std::vector<WaterArea> extract(const std::unordered_map<int64_t, SimpleNode>& node_index);
+  const WaterAreaStats& stats() const { return stats_; }
+
+private:
+  std::string input_path_;
+  unsigned threads_;
+  WaterAreaStats stats_;
+};
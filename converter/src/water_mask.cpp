@@ -0,0 +1,275 @@
+#include "water_mask.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+// Отрезок контура в пикселях сетки; y0 < y1, north — исходное направление к меньшему y.
+// group — полигон, рёбра которого заливаются вместе; береговая линия — одна группа.
+struct ScanEdge {
+  double x0, y0, x1, y1;
+  uint32_t group;
+  bool north;
+};
+
+struct Group {
+  double xmin, xmax;
+  bool coastline;
+};
+
+struct Crossing {
+  double x;
+  bool north;
+};
+
+// Отрезок воды в строке ячеек тайла: [x0, x1)
+struct Run {
+  uint32_t row, x0, x1;
+};
+
+struct TileMask {
+  long long key;
+  std::vector<uint8_t> cells;
+};
+
+class WaterRasterizer {
+public:
+  WaterRasterizer(int zoom, int depth)
+    : zoom_(zoom), depth_(depth), side_(1 << depth), scale_(std::ldexp(1.0, zoom + depth)) {}
+
+  double px(double lon) const { return (lon + 180.0) / 360.0 * scale_; }
+  double py(double lat) const {
+    const double r = lat * M_PI / 180.0;
+    return (1.0 - std::log(std::tan(r) + 1.0 / std::cos(r)) / M_PI) / 2.0 * scale_;
+  }
+
+  void addRing(const std::vector<SimpleNode>& ring, uint32_t group, std::vector<ScanEdge>& out, Group& g) const {
+    for (size_t i = 1; i < ring.size(); ++i) {
+      const double ax = px(ring[i - 1].lon), ay = py(ring[i - 1].lat);
+      const double bx = px(ring[i].lon), by = py(ring[i].lat);
+      g.xmin = std::min({g.xmin, ax, bx});
+      g.xmax = std::max({g.xmax, ax, bx});
+      if (ay == by) continue; // горизонтальный отрезок строку центров не пересекает
+      if (ay < by) out.push_back(ScanEdge{ax, ay, bx, by, group, false});
+      else out.push_back(ScanEdge{bx, by, ax, ay, group, true});
+    }
+  }
+
+  // Строки ячеек [first, last), чьи центры y + 0.5 пересекает ребро
+  std::pair<int64_t, int64_t> rows(const ScanEdge& e) const {
+    const int64_t limit = static_cast<int64_t>(scale_);
+    return {std::clamp<int64_t>(cell(e.y0), 0, limit), std::clamp<int64_t>(cell(e.y1), 0, limit)};
+  }
+
+  // Строки [rowLo, rowHi) по рёбрам одной группы, отсортированным по y0.
+  // Ячейка x — вода, если её центр внутри интервала; для береговой линии после
+  // пересечения с ребром "на север" восточнее — вода, "на юг" — суша.
+  void scan(const ScanEdge* const* edges, size_t count, const Group& g, int64_t rowLo, int64_t rowHi,
+            std::unordered_map<int64_t, std::vector<Run>>& out) const {
+    const int64_t xlo = cell(g.xmin);
+    const int64_t xhi = cell(g.xmax);
+    std::vector<const ScanEdge*> active;
+    std::vector<Crossing> xs;
+    size_t next = 0;
+    int64_t row = std::max(rowLo, cell(edges[0]->y0));
+    while (row < rowHi && (next < count || !active.empty())) {
+      const double yc = static_cast<double>(row) + 0.5;
+      while (next < count && edges[next]->y0 <= yc) active.push_back(edges[next++]);
+      active.erase(std::remove_if(active.begin(), active.end(), [&](const ScanEdge* e) { return e->y1 <= yc; }),
+                   active.end());
+      if (active.empty()) {
+        if (next >= count) break;
+        row = cell(edges[next]->y0);
+        continue;
+      }
+      xs.clear();
+      for (const ScanEdge* e : active) {
+        xs.push_back(Crossing{e->x0 + (yc - e->y0) * (e->x1 - e->x0) / (e->y1 - e->y0), e->north});
+      }
+      std::sort(xs.begin(), xs.end(), [](const Crossing& a, const Crossing& b) { return a.x < b.x; });
+      if (!g.coastline) {
+        for (size_t i = 0; i + 1 < xs.size(); i += 2) addRun(row, cell(xs[i].x), cell(xs[i + 1].x), out);
+      } else {
+        if (!xs.front().north) addRun(row, xlo, cell(xs.front().x), out);
+        for (size_t i = 0; i < xs.size(); ++i) {
+          if (!xs[i].north) continue;
+          addRun(row, cell(xs[i].x), i + 1 < xs.size() ? cell(xs[i + 1].x) : xhi, out);
+        }
+      }
+      ++row;
+    }
+  }
+
+  // Квадродерево тайла по его отрезкам; пусто, если воды нет
+  std::vector<uint8_t> encode(std::vector<Run>& runs) const {
+    std::sort(runs.begin(), runs.end(),
+              [](const Run& a, const Run& b) { return a.row != b.row ? a.row < b.row : a.x0 < b.x0; });
+    // Слить пересечения разных полигонов: в строке — непересекающиеся, по возрастанию
+    size_t n = 0;
+    for (const Run& r : runs) {
+      if (n > 0 && runs[n - 1].row == r.row && r.x0 <= runs[n - 1].x1) runs[n - 1].x1 = std::max(runs[n - 1].x1, r.x1);
+      else runs[n++] = r;
+    }
+    runs.resize(n);
+    std::vector<uint32_t> rowStart(static_cast<size_t>(side_) + 1, 0);
+    for (const Run& r : runs) ++rowStart[r.row + 1];
+    for (int i = 0; i < side_; ++i) rowStart[i + 1] += rowStart[i];
+
+    std::vector<uint8_t> cells;
+    size_t count = 0;
+    encode(runs, rowStart, 0, 0, static_cast<uint32_t>(side_), cells, count);
+    if (cells.size() == 1 && cells[0] == 0) cells.clear();
+    return cells;
+  }
+
+  long long key(int64_t tx, int64_t ty) const {
+    return packTileKey(TileKey{zoom_, static_cast<int>(tx), static_cast<int>(ty)});
+  }
+
+private:
+  static int64_t cell(double x) { return static_cast<int64_t>(std::ceil(x - 0.5)); }
+
+  void addRun(int64_t row, int64_t x0, int64_t x1, std::unordered_map<int64_t, std::vector<Run>>& out) const {
+    x0 = std::max<int64_t>(x0, 0);
+    x1 = std::min<int64_t>(x1, static_cast<int64_t>(scale_));
+    if (x0 >= x1) return;
+    const uint32_t cy = static_cast<uint32_t>(row & (side_ - 1));
+    for (int64_t tx = x0 >> depth_; tx <= (x1 - 1) >> depth_; ++tx) {
+      const int64_t base = tx << depth_;
+      out[tx].push_back(Run{cy, static_cast<uint32_t>(std::max(x0, base) - base),
+                            static_cast<uint32_t>(std::min(x1, base + side_) - base)});
+    }
+  }
+
+  static uint64_t countWater(const std::vector<Run>& runs, const std::vector<uint32_t>& rowStart,
+                             uint32_t x, uint32_t y, uint32_t size) {
+    uint64_t water = 0;
+    for (uint32_t r = y; r < y + size; ++r) {
+      for (uint32_t i = rowStart[r]; i < rowStart[r + 1]; ++i) {
+        const uint32_t lo = std::max(runs[i].x0, x);
+        const uint32_t hi = std::min(runs[i].x1, x + size);
+        if (lo < hi) water += hi - lo;
+      }
+    }
+    return water;
+  }
+
+  static void put(std::vector<uint8_t>& cells, size_t& n, uint8_t code) {
+    if ((n & 3) == 0) cells.push_back(0);
+    cells.back() |= static_cast<uint8_t>(code << ((n & 3) * 2));
+    ++n;
+  }
+
+  void encode(const std::vector<Run>& runs, const std::vector<uint32_t>& rowStart, uint32_t x, uint32_t y,
+              uint32_t size, std::vector<uint8_t>& cells, size_t& n) const {
+    const uint64_t water = countWater(runs, rowStart, x, y, size);
+    if (water == 0) return put(cells, n, 0);
+    if (water == static_cast<uint64_t>(size) * size) return put(cells, n, 1);
+    put(cells, n, 2);
+    const uint32_t h = size / 2;
+    encode(runs, rowStart, x, y, h, cells, n);
+    encode(runs, rowStart, x + h, y, h, cells, n);
+    encode(runs, rowStart, x, y + h, h, cells, n);
+    encode(runs, rowStart, x + h, y + h, h, cells, n);
+  }
+
+  int zoom_;
+  int depth_;
+  int side_;
+  double scale_;
+};
+
+} // namespace
+
+WaterMaskStats buildWaterMasks(const std::vector<WaterArea>& areas, int zoom, int depth, unsigned threads,
+                               std::unordered_map<long long, TileData>& tiles) {
+  WaterRasterizer raster(zoom, depth);
+  std::vector<ScanEdge> edges;
+  std::vector<Group> groups;
+  // Береговая линия — общая группа 0: направление пересечений имеет смысл только по всем кускам сразу
+  groups.push_back(Group{HUGE_VAL, -HUGE_VAL, true});
+  for (const auto& area : areas) {
+    if (area.coastline) {
+      for (const auto& ring : area.rings) raster.addRing(ring, 0, edges, groups[0]);
+      continue;
+    }
+    const size_t first = edges.size();
+    Group g{HUGE_VAL, -HUGE_VAL, false};
+    const uint32_t id = static_cast<uint32_t>(groups.size());
+    for (const auto& ring : area.rings) raster.addRing(ring, id, edges, g);
+    if (g.xmax - g.xmin < 2.0) {
+      edges.resize(first); // пруды уже пары ячеек лодке не нужны
+      continue;
+    }
+    groups.push_back(g);
+  }
+
+  // Полосы — строки тайлов; ребро попадает во все полосы, чьи строки ячеек пересекает
+  std::unordered_map<int64_t, std::vector<uint32_t>> bands;
+  for (uint32_t i = 0; i < edges.size(); ++i) {
+    const auto [r0, r1] = raster.rows(edges[i]);
+    if (r0 >= r1) continue;
+    for (int64_t ty = r0 >> depth; ty <= (r1 - 1) >> depth; ++ty) bands[ty].push_back(i);
+  }
+  std::vector<int64_t> order;
+  order.reserve(bands.size());
+  for (const auto& kv : bands) order.push_back(kv.first);
+  std::sort(order.begin(), order.end());
+  std::vector<std::vector<uint32_t>> bandEdges(order.size());
+  for (size_t b = 0; b < order.size(); ++b) bandEdges[b] = std::move(bands[order[b]]);
+  bands.clear();
+
+  std::vector<std::vector<TileMask>> masks(order.size());
+  std::vector<uint64_t> runCounts(order.size(), 0);
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    std::vector<const ScanEdge*> band;
+    std::unordered_map<int64_t, std::vector<Run>> runs; // по tx
+    for (size_t b = next.fetch_add(1); b < order.size(); b = next.fetch_add(1)) {
+      const int64_t ty = order[b];
+      band.clear();
+      for (uint32_t i : bandEdges[b]) band.push_back(&edges[i]);
+      std::sort(band.begin(), band.end(), [](const ScanEdge* a, const ScanEdge* c) {
+        return a->group != c->group ? a->group < c->group : a->y0 < c->y0;
+      });
+      runs.clear();
+      const int64_t rowLo = ty << depth;
+      const int64_t rowHi = (ty + 1) << depth;
+      for (size_t i = 0; i < band.size();) {
+        size_t j = i;
+        while (j < band.size() && band[j]->group == band[i]->group) ++j;
+        raster.scan(band.data() + i, j - i, groups[band[i]->group], rowLo, rowHi, runs);
+        i = j;
+      }
+      for (auto& [tx, tileRuns] : runs) {
+        runCounts[b] += tileRuns.size();
+        std::vector<uint8_t> cells = raster.encode(tileRuns);
+        if (!cells.empty()) masks[b].push_back(TileMask{raster.key(tx, ty), std::move(cells)});
+      }
+    }
+  };
+  const unsigned workers = static_cast<unsigned>(std::clamp<size_t>(threads, 1, std::max<size_t>(order.size(), 1)));
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < workers; ++t) pool.emplace_back(worker);
+  worker();
+  for (auto& th : pool) th.join();
+
+  WaterMaskStats st;
+  for (size_t b = 0; b < order.size(); ++b) {
+    st.runs += runCounts[b];
+    for (auto& m : masks[b]) {
+      TileData& td = tiles[m.key];
+      td.key = unpackTileKey(m.key);
+      td.bbox = tileBounds(td.key);
+      td.water_depth = static_cast<uint8_t>(depth);
+      ++st.tiles;
+      if (m.cells.size() == 1 && m.cells[0] == 1) ++st.full_tiles;
+      st.bytes += m.cells.size();
+      td.water_cells = std::move(m.cells);
+    }
+  }
+  return st;
+}
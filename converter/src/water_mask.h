@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "pbf_reader.h"
+#include "water_areas.h"
+
+// Маска открытой воды для water_tiles.
+//
+// Полигоны воды (water_areas.h) и береговая линия растеризуются сканирующей
+// строкой в общую сетку Web Mercator: тайл зума zoom делится на 2^depth x 2^depth
+// ячеек. Полигон — по правилу чёт/нечет по всем его кольцам (острова вычитаются),
+// береговая линия — по направлению пересечения (вода справа по ходу пути), так что
+// незамкнутые в пределах выгрузки куски береговой линии тоже дают море.
+//
+// Рёбра раскладываются по строкам тайлов; каждую строку тайлов поток растеризует
+// независимо в отрезки воды (RLE: строка ячеек, [x0, x1)) по тайлам и сразу
+// сжимает их в квадродерево (LandTile.water_cells): открытая вода даёт одну
+// ячейку на тайл, мелкие ячейки остаются только у берега. По этому же дереву
+// ядро отвечает «вода ли точка» спуском на depth уровней.
+//
+// Ограничение: строки без пересечений с береговой линией считаются сушей.
+constexpr int kWaterMaskDepth = 8; // ~9.5 м на экваторе при zoom 14
+
+struct WaterMaskStats {
+  uint64_t tiles {0};       // тайлов с водой
+  uint64_t full_tiles {0};  // целиком вода (одна ячейка)
+  uint64_t bytes {0};       // суммарный размер water_cells
+  uint64_t runs {0};        // отрезков воды до сжатия в квадродеревья
+};
+
+// Заполняет water_depth/water_cells в tiles; тайлы без рёбер создаются.
+WaterMaskStats buildWaterMasks(const std::vector<WaterArea>& areas, int zoom, int depth, unsigned threads,
+                               std::unordered_map<long long, TileData>& tiles);
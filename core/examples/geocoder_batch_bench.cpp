@@ -0,0 +1,134 @@
+// Пропускная способность Geocoder::searchBatch на синтетическом импорте адресов.
+// Адреса берутся из geo_entities пакета (kind=ADDRESS) и записываются так, как
+// их присылают в CSV: "улица дом", "улица дом, город", в нижнем регистре, с
+// лишней пунктуацией; выборка с повторами — как повторные доставки по адресу.
+// Для каждого числа потоков: запросов в секунду, ускорение к первому прогону
+// и доля запросов, где первый результат — тот же дом (улица + номер).
+//
+//   geocoder_batch_bench liechtenstein.routingdb [count=100000] [threads=1,2,4,8] [--snap]
+//
+// --snap — ещё и привязка найденных точек к дорогам (Router::snapBatch, авто).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "routing_core/geocoder.h"
+#include "routing_core/profile.h"
+#include "routing_core/router.h"
+
+using namespace routing_core;
+
+struct Address {
+  std::string street;
+  std::string housenumber;
+  std::string city;
+};
+
+static std::vector<Address> loadAddresses(const std::string& db) {
+  std::vector<Address> out;
+  sqlite3* h = nullptr;
+  sqlite3_stmt* st = nullptr;
+  if (sqlite3_open_v2(db.c_str(), &h, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK &&
+      sqlite3_prepare_v2(h, "SELECT street, housenumber, ifnull(city, '') FROM geo_entities WHERE kind=3;", -1, &st,
+                         nullptr) == SQLITE_OK) {
+    while (sqlite3_step(st) == SQLITE_ROW) {
+      out.push_back(Address{reinterpret_cast<const char*>(sqlite3_column_text(st, 0)),
+                            reinterpret_cast<const char*>(sqlite3_column_text(st, 1)),
+                            reinterpret_cast<const char*>(sqlite3_column_text(st, 2))});
+    }
+  }
+  sqlite3_finalize(st);
+  sqlite3_close(h);
+  return out;
+}
+
+static std::string lowerAscii(std::string s) {
+  for (char& c : s) {
+    if (c >= 'A' && c <= 'Z') c = static_cast<char>(c + 32);
+  }
+  return s;
+}
+
+static std::string spell(const Address& a, int variant) {
+  switch (variant) {
+    case 0: return a.street + " " + a.housenumber;
+    case 1: return a.city.empty() ? a.street + " " + a.housenumber : a.street + " " + a.housenumber + ", " + a.city;
+    case 2: return lowerAscii(a.street) + " " + a.housenumber;
+    default: return "\"" + a.street + "\"; " + a.housenumber + ".";
+  }
+}
+
+int main(int argc, char** argv) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  const bool snap = std::find(args.begin(), args.end(), "--snap") != args.end();
+  args.erase(std::remove(args.begin(), args.end(), "--snap"), args.end());
+  if (args.empty()) {
+    std::fprintf(stderr, "Usage: %s routingdb [count=100000] [threads=1,2,4,8] [--snap]\n", argv[0]);
+    return 1;
+  }
+  const std::string db = args[0];
+  const size_t count = args.size() > 1 ? static_cast<size_t>(std::max(1, std::atoi(args[1].c_str()))) : 100000;
+  std::vector<unsigned> threadCounts;
+  {
+    std::stringstream ss(args.size() > 2 ? args[2] : "1,2,4,8");
+    for (std::string t; std::getline(ss, t, ',');) threadCounts.push_back(static_cast<unsigned>(std::max(1, std::atoi(t.c_str()))));
+  }
+
+  const auto addresses = loadAddresses(db);
+  if (addresses.empty()) {
+    std::fprintf(stderr, "No addresses in %s (converter --no-geocoder?)\n", db.c_str());
+    return 2;
+  }
+  std::mt19937_64 rng(1);
+  std::vector<std::string> queries;
+  std::vector<size_t> source;
+  queries.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    const size_t a = static_cast<size_t>(rng() % addresses.size());
+    queries.push_back(spell(addresses[a], static_cast<int>(rng() % 4)));
+    source.push_back(a);
+  }
+  std::printf("%zu queries over %zu addresses\n", queries.size(), addresses.size());
+
+  std::unique_ptr<Router> router;
+  const ProfileSettings car = makeCarProfile();
+  if (snap) router = std::make_unique<Router>(db);
+
+  double base = 0.0;
+  for (unsigned threads : threadCounts) {
+    Geocoder geocoder(db); // свежие рабочие соединения: прогрев входит в замер
+    GeoBatchOptions opt;
+    opt.threads = threads;
+    if (router) {
+      opt.snapRouter = router.get();
+      opt.snapProfile = &car;
+    }
+    size_t hits = 0, snapped = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    geocoder.searchBatch(queries, opt, [&](size_t i, GeoBatchItem&& item) {
+      const Address& a = addresses[source[i]];
+      if (!item.results.empty() && item.results.front().street == a.street &&
+          item.results.front().housenumber == a.housenumber) {
+        ++hits;
+      }
+      snapped += item.edge_id != kNoEdge;
+    });
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (base == 0.0) base = s;
+    std::printf("threads=%-2u %.2fs %.0f q/s speedup=%.2f hit@1=%.1f%%", threads, s,
+                static_cast<double>(queries.size()) / s, base / s,
+                100.0 * static_cast<double>(hits) / static_cast<double>(queries.size()));
+    if (router) std::printf(" snapped=%.1f%%", 100.0 * static_cast<double>(snapped) / static_cast<double>(queries.size()));
+    std::printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,212 @@
+// Задержка Geocoder::search (первые 10 результатов) по корпусу запросов.
+// Корпус — файл по строке на запрос: "текст" или "текст<TAB>lat_min,lon_min,lat_max,lon_max".
+// Без файла запросы строятся по случайным объектам пакета: полное имя, набираемый
+// префикс и полное имя в рамке ~2 км вокруг объекта; для них считается, нашёлся
+// ли сам объект в первой десятке. Если рядом лежит файл подсказок <пакет>.ac,
+// те же запросы прогоняются через AutocompleteIndex (near — центр рамки).
+// Центры рамок (точки рядом с объектами) идут и в Geocoder::reverse: холодный
+// проход и повторный, из кэша клеток.
+//
+//   geocoder_bench liechtenstein.routingdb [queries.txt|-] [count=300] [seed=1]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "routing_core/autocomplete.h"
+#include "routing_core/geocoder.h"
+
+using namespace routing_core;
+
+struct Query {
+  std::string text;
+  std::optional<GeoBBox> bbox;
+  int64_t expect {0}; // id объекта, который должен попасть в выдачу (0 — не проверяется)
+  int group {0};
+};
+
+static const char* kGroupNames[] = {"file", "full name", "prefix", "name+bbox"};
+
+static std::vector<Query> readCorpus(const std::string& path) {
+  std::vector<Query> out;
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    Query q;
+    const size_t tab = line.find('\t');
+    q.text = line.substr(0, tab);
+    GeoBBox b;
+    if (tab != std::string::npos &&
+        std::sscanf(line.c_str() + tab + 1, "%lf,%lf,%lf,%lf", &b.lat_min, &b.lon_min, &b.lat_max, &b.lon_max) == 4) {
+      q.bbox = b;
+    }
+    out.push_back(std::move(q));
+  }
+  return out;
+}
+
+// Первые n символов UTF-8 начиная с from
+static size_t advanceChars(const std::string& s, size_t from, int n) {
+  size_t i = from;
+  for (int k = 0; k < n && i < s.size(); ++k) {
+    ++i;
+    while (i < s.size() && (static_cast<unsigned char>(s[i]) & 0xC0) == 0x80) ++i;
+  }
+  return i;
+}
+
+// Как запрос в момент набора: первое слово и 3 буквы второго, либо 4 буквы единственного
+static std::string typingPrefix(const std::string& name) {
+  const std::string norm = normalizeGeoText(name);
+  const size_t sp = norm.find(' ');
+  return norm.substr(0, sp == std::string::npos ? advanceChars(norm, 0, 4) : advanceChars(norm, sp + 1, 3));
+}
+
+static std::vector<Query> sampleCorpus(const std::string& db, int count, unsigned seed) {
+  std::vector<Query> out;
+  sqlite3* h = nullptr;
+  if (sqlite3_open_v2(db.c_str(), &h, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+    sqlite3_close(h);
+    return out;
+  }
+  sqlite3_stmt* maxId = nullptr;
+  sqlite3_stmt* byId = nullptr;
+  int64_t maxRow = 0;
+  if (sqlite3_prepare_v2(h, "SELECT MAX(id) FROM geo_entities;", -1, &maxId, nullptr) == SQLITE_OK &&
+      sqlite3_step(maxId) == SQLITE_ROW) {
+    maxRow = sqlite3_column_int64(maxId, 0);
+  }
+  sqlite3_finalize(maxId);
+  if (maxRow > 0 && sqlite3_prepare_v2(h, "SELECT name, lat, lon FROM geo_entities WHERE id=?;", -1, &byId, nullptr) == SQLITE_OK) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int64_t> pick(1, maxRow);
+    constexpr double kHalfBoxDeg = 0.01; // ~1 км по широте в каждую сторону
+    for (int i = 0; i < count; ++i) {
+      const int64_t id = pick(rng);
+      sqlite3_bind_int64(byId, 1, id);
+      if (sqlite3_step(byId) == SQLITE_ROW) {
+        const std::string name = reinterpret_cast<const char*>(sqlite3_column_text(byId, 0));
+        const double lat = sqlite3_column_double(byId, 1);
+        const double lon = sqlite3_column_double(byId, 2);
+        out.push_back(Query{name, std::nullopt, id, 1});
+        out.push_back(Query{typingPrefix(name), std::nullopt, 0, 2});
+        out.push_back(Query{name, GeoBBox{lat - kHalfBoxDeg, lon - kHalfBoxDeg * 2, lat + kHalfBoxDeg, lon + kHalfBoxDeg * 2},
+                            id, 3});
+      }
+      sqlite3_reset(byId);
+    }
+  }
+  sqlite3_finalize(byId);
+  sqlite3_close(h);
+  return out;
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+  return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())))];
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "Usage: %s routingdb [queries.txt|-] [count=300] [seed=1]\n", argv[0]);
+    return 1;
+  }
+  const std::string db = argv[1];
+  const std::string corpus = argc > 2 ? argv[2] : "-";
+  const int count = argc > 3 ? std::max(1, std::atoi(argv[3])) : 300;
+  const unsigned seed = argc > 4 ? static_cast<unsigned>(std::atoi(argv[4])) : 1u;
+
+  Geocoder geocoder(db);
+  if (!geocoder.available()) {
+    std::fprintf(stderr, "No geocoder index in %s (converter --no-geocoder?)\n", db.c_str());
+    return 2;
+  }
+  const auto queries = corpus == "-" ? sampleCorpus(db, count, seed) : readCorpus(corpus);
+  if (queries.empty()) {
+    std::fprintf(stderr, "Empty query corpus\n");
+    return 2;
+  }
+
+  geocoder.search(queries.front().text, queries.front().bbox); // прогрев страниц SQLite
+  std::vector<std::vector<double>> ms(4);
+  std::vector<size_t> checked(4, 0), found(4, 0), empty(4, 0);
+  for (const auto& q : queries) {
+    const auto t0 = std::chrono::steady_clock::now();
+    const auto results = geocoder.search(q.text, q.bbox, 10);
+    ms[q.group].push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+    empty[q.group] += results.empty();
+    if (q.expect) {
+      ++checked[q.group];
+      found[q.group] += std::any_of(results.begin(), results.end(), [&](const GeoResult& r) { return r.id == q.expect; });
+    }
+  }
+
+  auto report = [&](const char* title) {
+    std::printf("%s\n", title);
+    for (int g = 0; g < 4; ++g) {
+      auto& v = ms[g];
+      if (v.empty()) continue;
+      std::sort(v.begin(), v.end());
+      const auto under = static_cast<size_t>(std::lower_bound(v.begin(), v.end(), 100.0) - v.begin());
+      std::printf("%-10s n=%zu p50=%.2fms p95=%.2fms p99=%.2fms max=%.2fms <100ms=%.1f%% empty=%zu",
+                  kGroupNames[g], v.size(), percentile(v, 0.50), percentile(v, 0.95), percentile(v, 0.99), v.back(),
+                  100.0 * static_cast<double>(under) / static_cast<double>(v.size()), empty[g]);
+      if (checked[g]) std::printf(" hit@10=%.1f%%", 100.0 * static_cast<double>(found[g]) / static_cast<double>(checked[g]));
+      std::printf("\n");
+    }
+  };
+  report("search:");
+
+  std::vector<Coord> points;
+  for (const auto& q : queries) {
+    if (q.bbox) points.push_back(Coord{(q.bbox->lat_min + q.bbox->lat_max) * 0.5, (q.bbox->lon_min + q.bbox->lon_max) * 0.5});
+  }
+  for (const char* pass : {"reverse cold", "reverse warm"}) {
+    if (points.empty()) break;
+    std::vector<double> v;
+    size_t found = 0;
+    for (const auto& p : points) {
+      const auto t0 = std::chrono::steady_clock::now();
+      const auto a = geocoder.reverse(p);
+      v.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+      found += a.has_value();
+    }
+    std::sort(v.begin(), v.end());
+    std::printf("%-12s n=%zu p50=%.3fms p95=%.3fms p99=%.3fms max=%.3fms found=%zu\n", pass, v.size(),
+                percentile(v, 0.50), percentile(v, 0.95), percentile(v, 0.99), v.back(), found);
+  }
+
+  std::unique_ptr<AutocompleteIndex> ac;
+  try {
+    ac = std::make_unique<AutocompleteIndex>(db + ".ac");
+  } catch (const std::exception&) {
+    return 0;
+  }
+  for (int g = 0; g < 4; ++g) {
+    ms[g].clear();
+    checked[g] = found[g] = empty[g] = 0;
+  }
+  for (const auto& q : queries) {
+    std::optional<Coord> near;
+    if (q.bbox) near = Coord{(q.bbox->lat_min + q.bbox->lat_max) * 0.5, (q.bbox->lon_min + q.bbox->lon_max) * 0.5};
+    const auto t0 = std::chrono::steady_clock::now();
+    const auto results = ac->autocomplete(q.text, near, 10);
+    ms[q.group].push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+    empty[q.group] += results.empty();
+    if (q.expect) {
+      ++checked[q.group];
+      found[q.group] += std::any_of(results.begin(), results.end(), [&](const AutocompleteHit& r) { return r.id == q.expect; });
+    }
+  }
+  report("autocomplete:");
+  return 0;
+}
@@ -14,9 +14,13 @@ using namespace routing_core;
 int main(int argc, char** argv) {
   if (argc < 6) {
     std::fprintf(stderr,
-      "Usage: %s routingdb lat1 lon1 lat2 lon2 [profile] [--dump]\n"
-      "profile: car|foot (default car)\n"
-      "--dump  : dump info about tile edges\n",
+      "Usage: %s routingdb lat1 lon1 lat2 lon2 [profile] [--dump] [--traffic file]\n"
+      "       [--exclude edge_id]... [--avoid lat,lon;lat,lon;lat,lon]...\n"
+      "profile: car|foot|boat (default car; boat needs a package built with --profiles ...,boat)\n"
+      "--dump  : dump info about tile edges\n"
+      "--traffic: overlay of edge speed factors (lines \"edge_id factor\")\n"
+      "--exclude: closed edge (id from a previous route)\n"
+      "--avoid  : polygon to route around\n",
       argv[0]);
     return 1;
   }
@@ -26,19 +30,41 @@ int main(int argc, char** argv) {
   auto profile = makeCarProfile();
   bool dump = false;
   int zoomOpt = 14;
+  std::string trafficPath;
+  RouteOptions ro;
   // простенький парсер дополнительных флагов
   for (int i = 6; i < argc; ++i) {
     std::string arg = argv[i];
     if (arg == "car") profile = makeCarProfile();
     else if (arg == "foot") profile = makeFootProfile();
+    else if (arg == "boat") profile = makeBoatProfile();
     else if (arg == "--dump") dump = true;
     else if (arg == "--z" && i+1 < argc) { zoomOpt = std::atoi(argv[++i]); }
+    else if (arg == "--traffic" && i+1 < argc) { trafficPath = argv[++i]; }
+    else if (arg == "--exclude" && i+1 < argc) { ro.excludedEdges.push_back(std::strtoull(argv[++i], nullptr, 0)); }
+    else if (arg == "--avoid" && i+1 < argc) {
+      std::vector<Coord> ring;
+      const char* p = argv[++i];
+      double la, lo; int n = 0;
+      while (std::sscanf(p, "%lf,%lf%n", &la, &lo, &n) == 2) {
+        ring.push_back(Coord{la, lo});
+        p += n;
+        if (*p == ';') ++p;
+      }
+      ro.avoidPolygons.push_back(std::move(ring));
+    }
   }
 
   RouterOptions opt;
   opt.tileZoom = zoomOpt;     // можно менять
   opt.tileCacheCapacity = 128;
   Router r(db, opt);
+  if (!trafficPath.empty()) {
+    auto overlay = loadTrafficOverlay(trafficPath);
+    if (!overlay) { std::fprintf(stderr, "Failed to read traffic file %s\n", trafficPath.c_str()); return 1; }
+    std::fprintf(stderr, "Traffic: %zu edges in %zu tiles\n", overlay->edgeCount(), overlay->tileCount());
+    r.setTrafficOverlay(std::move(overlay));
+  }
 
   // Покажем тайлы обеих точек
   auto keyA = webTileKeyFor(a.lat, a.lon, opt.tileZoom);
@@ -49,7 +75,7 @@ int main(int argc, char** argv) {
                keyB.z, keyB.x, keyB.y);
 
   // Загрузим тайл старта для проверки
-  TileStore store(db, 1);
+  TileStore store(db, 1, profile.layer == TileLayer::WATER ? "water_tiles" : "land_tiles");
   auto blob = store.load(keyA.z, keyA.x, keyA.y);
   if (blob) {
     TileView view(blob->buffer);
@@ -59,9 +85,9 @@ int main(int argc, char** argv) {
       for (int ei = 0; ei < view.edgeCount(); ++ei) {
         auto* e = view.edgeAt(ei);
         std::fprintf(stderr,
-          "edge %d from=%u to=%u len=%.1fm speed=%.1fm/s foot=%.1fm/s access_mask=%u oneway=%d\n",
+          "edge %d from=%u to=%u len=%.1fm speed=%.1fm/s foot=%.1fm/s flow=%.1fm/s access_mask=%u oneway=%d\n",
           ei, e->from_node(), e->to_node(),
-          e->length_m(), e->speed_mps(), e->foot_speed_mps(),
+          e->length_m(), e->speed_mps(), e->foot_speed_mps(), e->flow_mps(),
           e->access_mask(), e->oneway());
       }
     }
@@ -70,7 +96,7 @@ int main(int argc, char** argv) {
   }
 
   // Вызываем роутер
-  auto res = r.route(profile, {a, b});
+  auto res = r.route(profile, {a, b}, ro);
   if (res.status != RouteStatus::OK) {
     const char* st = "";
     switch (res.status) {
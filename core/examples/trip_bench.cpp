@@ -0,0 +1,108 @@
+// Время Router::trip на случайных наборах остановок — как у доставки: адреса
+// из geo_entities пакета (kind=ADDRESS). Берутся только адреса, связанные с
+// первым в обе стороны (остальные привязываются к оторванным кускам дорог, и
+// trip с ними — NO_ROUTE). Для каждого размера набора: время вызова целиком и
+// по фазам (граф запроса, поиск), длительность объезда.
+//
+//   trip_bench liechtenstein.routingdb [stops=10,50,100,200] [runs=10] [seed=1]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "routing_core/profile.h"
+#include "routing_core/router.h"
+
+using namespace routing_core;
+
+static std::vector<Coord> loadAddresses(const std::string& db) {
+  std::vector<Coord> out;
+  sqlite3* h = nullptr;
+  sqlite3_stmt* st = nullptr;
+  if (sqlite3_open_v2(db.c_str(), &h, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK &&
+      sqlite3_prepare_v2(h, "SELECT lat, lon FROM geo_entities WHERE kind=3;", -1, &st, nullptr) == SQLITE_OK) {
+    while (sqlite3_step(st) == SQLITE_ROW) out.push_back(Coord{sqlite3_column_double(st, 0), sqlite3_column_double(st, 1)});
+  }
+  sqlite3_finalize(st);
+  sqlite3_close(h);
+  return out;
+}
+
+static std::vector<size_t> parseList(const std::string& s) {
+  std::vector<size_t> out;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (std::atoi(item.c_str()) > 1) out.push_back(static_cast<size_t>(std::atoi(item.c_str())));
+  }
+  return out;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "Usage: %s routingdb [stops=10,50,100,200] [runs=10] [seed=1]\n", argv[0]);
+    return 1;
+  }
+  const std::string db = argv[1];
+  const auto sizes = parseList(argc > 2 ? argv[2] : "10,50,100,200");
+  const int runs = argc > 3 ? std::max(1, std::atoi(argv[3])) : 10;
+  const unsigned seed = argc > 4 ? static_cast<unsigned>(std::atoi(argv[4])) : 1u;
+
+  const auto addresses = loadAddresses(db);
+  if (addresses.empty()) {
+    std::fprintf(stderr, "No addresses in %s (build the package with the geocoder stage)\n", db.c_str());
+    return 2;
+  }
+
+  Router router(db);
+  const auto profile = makeCarProfile();
+  std::vector<Coord> reachable;
+  {
+    const auto out = router.nearest(profile, addresses.front(), addresses, addresses.size());
+    const auto in = router.nearest(profile, addresses.front(), addresses, addresses.size(), SearchDirection::TO_ORIGIN);
+    std::vector<uint8_t> both(addresses.size(), 0);
+    for (const auto& hit : out.hits) both[hit.candidate] |= 1;
+    for (const auto& hit : in.hits) both[hit.candidate] |= 2;
+    for (size_t i = 0; i < addresses.size(); ++i) {
+      if (both[i] == 3) reachable.push_back(addresses[i]);
+    }
+  }
+  std::printf("addresses: %zu, connected: %zu\n", addresses.size(), reachable.size());
+  if (reachable.size() < 2) return 2;
+
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<size_t> pick(0, reachable.size() - 1);
+  for (size_t n : sizes) {
+    std::vector<double> ms;
+    double graphMs = 0, searchMs = 0, tripS = 0;
+    size_t ok = 0;
+    for (int r = 0; r < runs; ++r) {
+      std::vector<Coord> stops;
+      for (size_t i = 0; i < n; ++i) stops.push_back(reachable[pick(rng)]);
+      const auto t0 = std::chrono::steady_clock::now();
+      const TripResult tr = router.trip(profile, stops);
+      ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+      const QueryStats& qs = router.lastQueryStats();
+      graphMs += qs.graphMs;
+      searchMs += qs.searchMs;
+      if (tr.status == RouteStatus::OK) {
+        ++ok;
+        tripS += tr.duration_s;
+      }
+    }
+    std::sort(ms.begin(), ms.end());
+    double sum = 0;
+    for (double v : ms) sum += v;
+    std::printf("stops=%-4zu ok=%zu/%d mean=%.1fms p50=%.1fms max=%.1fms (graph %.1fms, search %.1fms) trip=%.0fs\n", n, ok,
+                runs, sum / runs, ms[ms.size() / 2], ms.back(), graphMs / runs, searchMs / runs,
+                ok ? tripS / static_cast<double>(ok) : 0.0);
+  }
+  return 0;
+}
@@ -0,0 +1,124 @@
+// Сравнение поиска с запретами манёвров и без (RouterOptions::turnRestrictions).
+// Случайные пары точек внутри охвата пакета, профиль car.
+//
+//   turn_restrictions_bench liechtenstein.routingdb [pairs] [seed]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "routing_core/router.h"
+#include "routing_core/profile.h"
+
+using namespace routing_core;
+
+struct Extent { double lat_min, lon_min, lat_max, lon_max; };
+
+static bool readExtent(const std::string& db, int zoom, Extent& out) {
+  sqlite3* h = nullptr;
+  if (sqlite3_open_v2(db.c_str(), &h, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+    sqlite3_close(h);
+    return false;
+  }
+  sqlite3_stmt* st = nullptr;
+  bool ok = false;
+  if (sqlite3_prepare_v2(h, "SELECT MIN(lat_min), MIN(lon_min), MAX(lat_max), MAX(lon_max) FROM land_tiles WHERE z=?;",
+                         -1, &st, nullptr) == SQLITE_OK) {
+    sqlite3_bind_int(st, 1, zoom);
+    if (sqlite3_step(st) == SQLITE_ROW && sqlite3_column_type(st, 0) != SQLITE_NULL) {
+      out = Extent{sqlite3_column_double(st, 0), sqlite3_column_double(st, 1),
+                   sqlite3_column_double(st, 2), sqlite3_column_double(st, 3)};
+      ok = true;
+    }
+  }
+  sqlite3_finalize(st);
+  sqlite3_close(h);
+  return ok;
+}
+
+struct Run {
+  std::vector<double> ms;
+  std::vector<RouteResult> results;
+};
+
+// Оба роутера по очереди на каждой паре (порядок чередуется): дрейф частоты
+// и соседей по машине одинаково ложится на обе серии
+static void runAll(const std::string& db, const std::vector<std::pair<Coord,Coord>>& pairs, Run& nodeBased, Run& hybrid) {
+  RouterOptions off, on;
+  off.turnRestrictions = false;
+  on.turnRestrictions = true;
+  Router routerOff(db, off), routerOn(db, on);
+  const auto profile = makeCarProfile();
+  routerOff.route(profile, {pairs.front().first, pairs.front().second}); // прогрев кэша тайлов
+  routerOn.route(profile, {pairs.front().first, pairs.front().second});
+  auto once = [&](Router& router, Run& run, const std::pair<Coord,Coord>& p) {
+    const auto t0 = std::chrono::steady_clock::now();
+    run.results.push_back(router.route(profile, {p.first, p.second}));
+    run.ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+  };
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    if (i % 2 == 0) {
+      once(routerOff, nodeBased, pairs[i]);
+      once(routerOn, hybrid, pairs[i]);
+    } else {
+      once(routerOn, hybrid, pairs[i]);
+      once(routerOff, nodeBased, pairs[i]);
+    }
+  }
+}
+
+static void report(const char* name, Run run) {
+  size_t ok = 0;
+  for (const auto& r : run.results) ok += r.status == RouteStatus::OK;
+  std::sort(run.ms.begin(), run.ms.end());
+  double sum = 0;
+  for (double v : run.ms) sum += v;
+  std::printf("%-16s ok=%zu/%zu mean=%.2fms p50=%.2fms p95=%.2fms max=%.2fms\n", name, ok, run.ms.size(),
+              sum / static_cast<double>(run.ms.size()), run.ms[run.ms.size() / 2],
+              run.ms[std::min(run.ms.size() - 1, run.ms.size() * 95 / 100)], run.ms.back());
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::fprintf(stderr, "Usage: %s routingdb [pairs=200] [seed=1]\n", argv[0]);
+    return 1;
+  }
+  const std::string db = argv[1];
+  const int pairsCount = argc > 2 ? std::max(1, std::atoi(argv[2])) : 200;
+  const unsigned seed = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : 1u;
+
+  Extent ext{};
+  if (!readExtent(db, RouterOptions{}.tileZoom, ext)) {
+    std::fprintf(stderr, "No tiles in %s\n", db.c_str());
+    return 2;
+  }
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> lat(ext.lat_min, ext.lat_max), lon(ext.lon_min, ext.lon_max);
+  std::vector<std::pair<Coord,Coord>> pairs;
+  for (int i = 0; i < pairsCount; ++i) pairs.push_back({Coord{lat(rng), lon(rng)}, Coord{lat(rng), lon(rng)}});
+
+  Run nodeBased, hybrid;
+  runAll(db, pairs, nodeBased, hybrid);
+
+  size_t changed = 0;
+  double extra_s = 0;
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    const auto& a = nodeBased.results[i];
+    const auto& b = hybrid.results[i];
+    if (a.status == RouteStatus::OK && b.status == RouteStatus::OK && a.edge_ids != b.edge_ids) {
+      ++changed;
+      extra_s += b.duration_s - a.duration_s;
+    }
+  }
+  report("node-based", nodeBased);
+  report("restrictions", hybrid);
+  std::printf("routes changed by restrictions: %zu (avg +%.1fs)\n", changed,
+              changed ? extra_s / static_cast<double>(changed) : 0.0);
+  return 0;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "routing_core/geocoder.h"
+#include "routing_core/router.h"
+
+namespace routing_core {
+
+// Формат файла подсказок (<пакет>.ac), пишет стадия geocoder конвертера.
+// Все секции выровнены по 4 байта, числа little-endian; файл читается через
+// mmap без разбора и копирования.
+namespace acformat {
+
+constexpr uint32_t kMagic = 0x4341584C; // "LXAC"
+constexpr uint32_t kVersion = 1;
+constexpr int kCellZoom = 10;           // клетки постингов: тайлы Web Mercator z10
+constexpr uint32_t kTermBlock = 16;     // слов в блоке префиксного сжатия
+constexpr size_t kMaxTermBytes = 64;
+
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t cell_zoom;
+  uint32_t term_count;
+  uint32_t block_count;
+  uint32_t entity_count;
+  uint32_t cell_count;
+  uint32_t alphabet_size;
+  uint64_t off_blocks;        // uint32[block_count + 1] — смещения блоков в term_bytes
+  uint64_t off_term_bytes;    // блоки: [len][bytes], затем [общий префикс][len суффикса][суффикс]
+  uint64_t off_postings_idx;  // uint32[term_count + 1]
+  uint64_t off_postings;      // uint32 индексы объектов, по каждому слову — по возрастанию
+  uint64_t off_cells;         // CellDir[cell_count + 1], последний — ограничитель
+  uint64_t off_cell_entries;  // CellEntry, внутри клетки по (term, entity)
+  uint64_t off_entities;      // Entity[entity_count + 1], последний — ограничитель
+  uint64_t off_names;         // UTF-8 имена подряд
+  uint64_t off_entity_terms;  // uint32 слова объекта, по возрастанию
+  uint64_t off_alphabet;      // uint32[alphabet_size] — кодовые точки слов, для опечаток
+  uint64_t file_size;
+};
+
+struct CellDir {
+  uint32_t cell; // (x << kCellZoom) | y
+  uint32_t start;
+};
+
+struct CellEntry {
+  uint32_t term;
+  uint32_t entity;
+};
+
+struct Entity {
+  int32_t lat_e6;
+  int32_t lon_e6;
+  uint32_t name_off;
+  uint32_t terms_off;
+  uint8_t kind;       // GeoKind
+  uint8_t importance; // 0..255
+  uint16_t reserved;
+};
+
+static_assert(sizeof(Header) == 8 * 4 + 11 * 8, "acformat::Header layout");
+static_assert(sizeof(Entity) == 20, "acformat::Entity layout");
+
+} // namespace acformat
+
+struct AutocompleteHit {
+  int64_t id {0};    // id в geo_entities пакета
+  GeoKind kind {GeoKind::POI};
+  std::string name;
+  double lat {0.0};
+  double lon {0.0};
+  double score {0.0};
+  int edits {0};     // 1 — найдено с опечаткой
+};
+
+// Подсказки при наборе: все слова запроса, кроме последнего, — целые,
+// последнее — префикс (если строка не кончается пробелом). Файл отображается
+// в память только для чтения, поэтому один объект можно звать из любых потоков.
+class AutocompleteIndex {
+public:
+  // Исключение, если файл не открылся или это не индекс подсказок
+  explicit AutocompleteIndex(const std::string& path);
+  ~AutocompleteIndex();
+  AutocompleteIndex(const AutocompleteIndex&) = delete;
+  AutocompleteIndex& operator=(const AutocompleteIndex&) = delete;
+
+  size_t entityCount() const { return header_->entity_count; }
+  size_t termCount() const { return header_->term_count; }
+
+  // near — сначала объекты вокруг точки (клетки z10 вокруг неё), потом
+  // важные по всему пакету. Если точных совпадений меньше k — добор
+  // с одной опечаткой (замена, вставка, удаление, перестановка).
+  std::vector<AutocompleteHit> autocomplete(const std::string& prefix,
+                                            const std::optional<Coord>& near = std::nullopt,
+                                            size_t k = 10) const;
+
+private:
+  struct TermRange {
+    uint32_t lo;
+    uint32_t hi;
+  };
+  struct Query;
+
+  const uint8_t* base_ {nullptr};
+  size_t size_ {0};
+  const acformat::Header* header_ {nullptr};
+  const uint32_t* blocks_ {nullptr};
+  const uint8_t* term_bytes_ {nullptr};
+  const uint32_t* postings_idx_ {nullptr};
+  const uint32_t* postings_ {nullptr};
+  const acformat::CellDir* cells_ {nullptr};
+  const acformat::CellEntry* cell_entries_ {nullptr};
+  const acformat::Entity* entities_ {nullptr};
+  const char* names_ {nullptr};
+  const uint32_t* entity_terms_ {nullptr};
+  const uint32_t* alphabet_ {nullptr};
+
+  std::string termAt(uint32_t id) const;
+  // Слова с данным префиксом — непрерывный диапазон номеров
+  TermRange prefixRange(const std::string& prefix) const;
+  std::optional<uint32_t> findTerm(const std::string& word) const;
+  void collect(const Query& q, std::vector<AutocompleteHit>& out) const;
+};
+
+// Запись файла подсказок по объектам в порядке их id (id = позиция + 1).
+// Слова — из имени и addr:city после geoIndexText. Возвращает размер файла.
+struct AutocompleteSource {
+  GeoKind kind;
+  std::string name;
+  std::string city;
+  double lat;
+  double lon;
+  double importance; // 0..1
+};
+size_t writeAutocompleteIndex(const std::vector<AutocompleteSource>& entities, const std::string& path);
+
+} // namespace routing_core
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace routing_core {
+
+// Потоковый SHA-256 (контрольные суммы тайлов и входных файлов).
+class Sha256 {
+public:
+  Sha256();
+  void update(const void* data, size_t size);
+  // Завершает вычисление и возвращает hex-строку (64 символа).
+  std::string finishHex();
+
+private:
+  void compress(const uint8_t* block);
+
+  uint32_t state_[8];
+  uint64_t total_ {0};
+  uint8_t buffer_[64];
+  size_t buffered_ {0};
+};
+
+// SHA-256 одного буфера в hex (колонка land_tiles.checksum).
+std::string sha256Hex(const void* data, size_t size);
+
+} // namespace routing_core
@@ -5,6 +5,9 @@
 namespace routing_core::edgeid {
 
 // 64 бита: [z:8][x:20][y:20][edgeIdx:16]
+// Рёбер в тайле не больше kMaxTileEdges: иначе индексы совпадут по модулю 2^16
+constexpr uint32_t kMaxTileEdges = 0x10000;
+
 inline uint64_t make(int z, uint32_t x, uint32_t y, uint32_t edgeIdx) {
   uint64_t id = 0;
   id |= (static_cast<uint64_t>(z & 0xFF) << 56);
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <sqlite3.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace routing_core {
+
+struct Coord; // routing_core/router.h
+class Router;
+struct ProfileSettings;
+
+// Тип объекта (колонка geo_entities.kind)
+enum class GeoKind : int {
+  PLACE = 1,   // place=city/town/village/...
+  STREET = 2,  // именованная highway=*
+  ADDRESS = 3, // addr:housenumber без имени
+  POI = 4,     // amenity/shop/tourism/... с именем
+};
+
+struct GeoBBox {
+  double lat_min {0.0};
+  double lon_min {0.0};
+  double lat_max {0.0};
+  double lon_max {0.0};
+};
+
+struct GeoResult {
+  int64_t id {0};
+  GeoKind kind {GeoKind::POI};
+  std::string name;
+  std::string street;
+  std::string housenumber;
+  std::string city;
+  std::string postcode;
+  std::string category; // "amenity=cafe", "place=town", "highway=residential"
+  double lat {0.0};
+  double lon {0.0};
+  double score {0.0};   // больше — лучше
+};
+
+// Ответ обратного геокодинга
+struct GeoAddress {
+  std::string street;
+  std::string housenumber;  // пусто — рядом нет дома на этой улице
+  std::string city;
+  std::string postcode;
+  std::string formatted;    // "улица Ленина, 5, Москва"
+  double lat {0.0};         // адресная точка или проекция на улицу
+  double lon {0.0};
+  double distance_m {0.0};  // от центра клетки кэша (~11 м), в которую попал запрос
+  int64_t id {0};           // geo_entities.id адресной точки; 0 — найдена только улица
+};
+
+// Пакетный поиск (импорт списка адресов)
+struct GeoBatchOptions {
+  unsigned threads {0};            // 0 — по числу ядер
+  size_t limit {1};                // результатов на запрос
+  std::optional<GeoBBox> bbox;     // общая рамка (регион импорта)
+  // Привязка первого результата к дороге через Router::snapBatch; nullptr — без неё
+  Router* snapRouter {nullptr};
+  const ProfileSettings* snapProfile {nullptr};
+};
+
+struct GeoBatchItem {
+  std::vector<GeoResult> results;
+  uint64_t edge_id {~0ull};        // kNoEdge — не привязан (нет результата или дороги рядом)
+  double snap_lat {0.0};
+  double snap_lon {0.0};
+  double snap_distance_m {0.0};
+};
+
+// Нормализация названий для индекса и запросов: нижний регистр (латиница
+// и кириллица), ё -> е, пунктуация -> пробел, один пробел между словами.
+// Прочие символы UTF-8 остаются как есть — их сворачивает токенайзер FTS5.
+std::string normalizeGeoText(const std::string& text);
+
+// Типы улиц и служебные слова адреса ("улица", "ул", "проспект", "дом", "street"...):
+// есть почти в каждом адресе, поэтому в индекс не попадают и в запросе
+// пропускаются.
+bool isGeoStopword(const std::string& normalizedWord);
+// Текст для колонок FTS: нормализованный, без служебных слов (если остаётся хоть одно)
+std::string geoIndexText(const std::string& text);
+
+// Офлайн-поиск по таблицам geo_entities / geo_fts / geo_rtree пакета
+// (стадия geocoder конвертера). Подготовленные запросы живут всё время
+// жизни объекта. Не потокобезопасен: по экземпляру на поток.
+class Geocoder {
+public:
+  // Исключение, если файл не открылся
+  explicit Geocoder(const std::string& db_path);
+  ~Geocoder();
+  Geocoder(const Geocoder&) = delete;
+  Geocoder& operator=(const Geocoder&) = delete;
+
+  // false — в пакете нет индекса геокодера (или SQLite собран без FTS5/R-tree)
+  bool available() const { return stmt_ranked_ != nullptr; }
+
+  // Поиск по префиксу последнего слова и целым остальным. С bbox — только
+  // объекты внутри рамки, ближние к её центру выше.
+  std::vector<GeoResult> search(const std::string& text,
+                                const std::optional<GeoBBox>& bbox = std::nullopt,
+                                size_t limit = 10);
+
+  // Что здесь: ближайшая именованная дорога — по индексу сегментов тайлов, как
+  // у снапа Router, дом — по geo_rtree. Дом берётся, если он на той же улице
+  // или ближе неё. Ответы кэшируются по клеткам ~11 м, индексы — по тайлам.
+  // nullopt — рядом нет ни улицы, ни дома.
+  std::optional<GeoAddress> reverse(const Coord& at);
+
+  // Тысячи запросов в несколько потоков: у каждого потока свой Geocoder (своё
+  // read-only соединение и подготовленные запросы, живут между вызовами),
+  // одинаковые после normalizeGeoText запросы ищутся один раз. sink вызывается
+  // из вызывающего потока строго в порядке queries, по мере готовности;
+  // потоки уходят вперёд не больше чем на окно в несколько тысяч запросов.
+  void searchBatch(const std::vector<std::string>& queries, const GeoBatchOptions& options,
+                   const std::function<void(size_t index, GeoBatchItem&& item)>& sink);
+  std::vector<GeoBatchItem> searchBatch(const std::vector<std::string>& queries,
+                                        const GeoBatchOptions& options = {});
+
+private:
+  std::string db_path_;
+  std::vector<std::unique_ptr<Geocoder>> workers_; // для searchBatch, создаются по требованию
+
+  struct ReverseState;
+  std::unique_ptr<ReverseState> reverse_;
+
+  sqlite3* db_ {nullptr};
+  // Ранжированный поиск по имени и добор по всем колонкам; каждый — с рамкой и без
+  sqlite3_stmt* stmt_ranked_ {nullptr};
+  sqlite3_stmt* stmt_ranked_bbox_ {nullptr};
+  sqlite3_stmt* stmt_any_ {nullptr};
+  sqlite3_stmt* stmt_any_bbox_ {nullptr};
+  sqlite3_stmt* stmt_box_count_ {nullptr}; // объекты рамки из R-tree
+  sqlite3_stmt* stmt_box_ {nullptr};
+};
+
+} // namespace routing_core
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace routing_core {
+
+// Ячейки метрик разнесены по шардам размером в строку кэша: поток пишет
+// в свой шард, и рабочие потоки сервера не гоняют одну линию между ядрами.
+constexpr size_t kMetricShards = 16;
+
+// Шард текущего потока: назначается при первом обращении по кругу
+size_t metricShardIndex();
+
+// Монотонный счётчик: relaxed fetch_add, сумма по шардам — только при чтении
+class Counter {
+public:
+  void inc(uint64_t n = 1) {
+    shards_[metricShardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+  uint64_t value() const;
+
+private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> value {0};
+  };
+  std::array<Shard, kMetricShards> shards_;
+};
+
+// Текущее значение (запросы в работе, тайлы в кэше)
+class Gauge {
+public:
+  void add(int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+  void set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+  int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<int64_t> value_ {0};
+};
+
+// Гистограмма с фиксированными верхними границами корзин (le, по возрастанию).
+// observe — поиск корзины и два relaxed-сложения в шарде потока.
+class Histogram {
+public:
+  explicit Histogram(std::vector<double> bounds);
+
+  void observe(double v);
+
+  struct Snapshot {
+    std::vector<uint64_t> buckets; // по корзинам, последняя — +Inf; не накопительно
+    uint64_t count {0};
+    double sum {0.0};
+  };
+  Snapshot snapshot() const;
+  const std::vector<double>& bounds() const { return bounds_; }
+
+  // start, start*factor, ... — count границ
+  static std::vector<double> exponentialBuckets(double start, double factor, size_t count);
+
+private:
+  struct alignas(64) Shard {
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+    std::atomic<double> sum {0.0};
+  };
+  std::vector<double> bounds_;
+  std::array<Shard, kMetricShards> shards_;
+};
+
+// Реестр метрик процесса и выдача в текстовом формате Prometheus (0.0.4).
+//
+// Метрика — имя и набор меток готовой строкой без скобок
+// (endpoint="route",code="200"). Регистрация под мьютексом, ожидается при
+// старте: запись на горячем пути идёт по ссылке, без поиска по имени.
+// Ссылки стабильны, пока жив реестр; повторная регистрация той же пары
+// имя+метки возвращает ту же метрику, смена типа — исключение.
+class MetricsRegistry {
+public:
+  Counter& counter(const std::string& name, const std::string& help, const std::string& labels = {});
+  Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = {});
+  Histogram& histogram(const std::string& name, const std::string& help, std::vector<double> bounds,
+                       const std::string& labels = {});
+
+  // Семейства в порядке регистрации, внутри — ряды в порядке регистрации
+  void renderPrometheus(std::string& out) const;
+
+private:
+  enum class Type { COUNTER, GAUGE, HISTOGRAM };
+  struct Series {
+    std::string labels;
+    std::unique_ptr<Counter> counter;
+    std::unique_ptr<Gauge> gauge;
+    std::unique_ptr<Histogram> histogram;
+  };
+  struct Family {
+    std::string name;
+    std::string help;
+    Type type;
+    std::vector<Series> series;
+  };
+
+  Series& series(const std::string& name, const std::string& help, Type type, const std::string& labels);
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Family>> families_;
+};
+
+} // namespace routing_core
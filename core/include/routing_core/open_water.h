@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "routing_core/router.h"
+#include "routing_core/tile_store.h"
+
+namespace routing_core {
+
+// Квадродерево открытой воды одного тайла (LandTile.water_cells).
+// Координаты — в ячейках максимальной глубины: 0..2^depth по каждой оси.
+class WaterQuadtree {
+public:
+  struct Leaf { uint32_t x, y, size; };
+  // Узел дерева, содержащий ячейку: водный лист (leaf >= 0) или суша (-1)
+  struct Cell { int32_t leaf; uint32_t x, y, size; };
+
+  WaterQuadtree(uint8_t depth, const uint8_t* cells, size_t size);
+
+  bool valid() const { return valid_; }
+  int depth() const { return depth_; }
+  uint32_t side() const { return 1u << depth_; }
+  Cell find(uint32_t x, uint32_t y) const;
+  const std::vector<Leaf>& leaves() const { return leaves_; }
+
+private:
+  int32_t decode(const uint8_t* cells, size_t size, size_t& pos, uint32_t x, uint32_t y, uint32_t s);
+
+  // Слот: >= 0 — внутренний узел, -1 — суша, -2-i — водный лист i
+  std::vector<std::array<int32_t, 4>> nodes_;
+  std::vector<Leaf> leaves_;
+  int32_t root_ {-1};
+  int depth_ {0};
+  bool valid_ {true};
+};
+
+// Маршруты по открытой воде (озёра, море) для профилей с open_water_speed_mps.
+//
+// A* идёт по водным листьям квадродеревьев соседних тайлов: вдали от берега
+// лист — целый тайл, у берега — ячейки в несколько метров, так что детальная
+// сетка участвует в поиске только у препятствий. Путь по центрам листьев
+// затем спрямляется (string pulling): точка остаётся, только если прямая
+// от предыдущей оставленной до следующей задевает сушу.
+//
+// Декодированные деревья кэшируются между запросами; не потокобезопасен,
+// как и TileStore, через который читает тайлы.
+class OpenWaterPlanner {
+public:
+  OpenWaterPlanner(TileStore& store, int zoom) : store_(store), zoom_(zoom) {}
+
+  // Точка попадает в водный лист маски тайла
+  bool isWater(const Coord& c);
+  RouteResult route(const Coord& from, const Coord& to, double speed_mps);
+  // Листьев, снятых с очереди за последний route() (все проходы грубо-точно)
+  size_t lastSettled() const { return lastSettled_; }
+
+  static constexpr size_t kMaxSettled = 200000;
+  static constexpr size_t kMaxCachedTiles = 4096;
+
+private:
+  struct Tile {
+    uint32_t id;
+    int x, y;
+    WaterQuadtree tree;
+  };
+  // Лист или суша в координатах тайлов зума (u — восток, v — юг)
+  struct Hit {
+    const Tile* tile {nullptr};
+    int32_t leaf {-1};
+    double u0 {0}, v0 {0}, u1 {0}, v1 {0};
+  };
+
+  const Tile* tile(int x, int y);
+  Hit locate(double u, double v);
+  // Водные листья, смежные с прямоугольником листа по сторонам и углам
+  void neighbours(double u0, double v0, double u1, double v1, std::vector<Hit>& out);
+  bool lineOfSight(double ua, double va, double ub, double vb);
+  // A* по водным листьям не мельче minSize (в долях тайла; у концов — любые).
+  // path — точки (u, v) от старта до финиша.
+  bool search(const Hit& start, const Hit& goal, double ua, double va, double ub, double vb,
+              double minSize, std::vector<std::pair<double, double>>& path, size_t& settled);
+  double metres(double ua, double va, double ub, double vb) const;
+
+  TileStore& store_;
+  int zoom_;
+  std::unordered_map<uint64_t, std::unique_ptr<Tile>> tiles_; // nullptr — в тайле нет воды
+  std::vector<const Tile*> byId_;
+  // Рамка тайлов текущего запроса: за ней — суша
+  int minX_ {0}, minY_ {0}, maxX_ {-1}, maxY_ {-1};
+  size_t lastSettled_ {0};
+};
+
+} // namespace routing_core
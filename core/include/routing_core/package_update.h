@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace routing_core {
+
+// Операции дельта-пакета (таблица delta_tiles.op)
+enum class DeltaOp : int {
+  PUT = 1,    // новый или полностью заменённый тайл (data = FlatBuffers blob)
+  PATCH = 2,  // data = бинарный дифф (tile_delta.h) относительно base_checksum
+  REMOVE = 3  // тайл удалён
+};
+
+struct DeltaApplyResult {
+  bool ok {false};
+  size_t put {0};
+  size_t patched {0};
+  size_t removed {0};
+  std::string error_message;
+};
+
+// Атомарно применяет дельта-пакет (routingdb-diff) к routingdb на устройстве:
+// все тайлы проверяются по SHA-256 и пишутся одной транзакцией SQLite;
+// при любой ошибке пакет остаётся в исходном состоянии. Индекс геокодера дельта
+// не несёт: он остаётся прежним, его версия — metadata.geocoder_data_version.
+// Открытые на этот файл Router/TileStore после обновления нужно пересоздать (LRU-кэш).
+DeltaApplyResult applyDeltaPackage(const std::string& db_path, const std::string& delta_path);
+
+} // namespace routing_core
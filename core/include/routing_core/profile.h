@@ -7,14 +7,34 @@
 
 namespace routing_core {
 
+// Слой тайлов, по которому ищет профиль: дорожный граф (land_tiles)
+// или водный (water_tiles, конвертер с --profiles ...,boat)
+enum class TileLayer : uint8_t {
+  LAND,
+  WATER
+};
+
 struct ProfileSettings {
   uint16_t access_mask {0};
-  std::array<double, static_cast<int>(Routing::RoadClass::STEPS)+1> speeds_mps {};
+  // По классу дороги; у авто (бит 0x1) это потолок: Edge.speed_mps ребра
+  // (maxspeed или типичная скорость highway=*) ниже него побеждает
+  std::array<double, static_cast<int>(Routing::RoadClass::CANAL)+1> speeds_mps {};
+  bool use_traffic {false}; // учитывать оверлей пробок Router::setTrafficOverlay
+  TileLayer layer {TileLayer::LAND};
+  // Водный слой: скорость speeds_mps — относительно воды; к ней прибавляется
+  // течение ребра (flow_mps * flow_factor) по течению и вычитается против.
+  // Ниже min_speed_mps относительно берега ребро непроходимо.
+  double flow_factor {0.0};
+  double min_speed_mps {0.5};
+  // Открытая вода (маска water_cells в water_tiles): скорость по прямой
+  // между точками на воде; 0 — только граф рек и каналов
+  double open_water_speed_mps {0.0};
 };
 
 inline ProfileSettings makeCarProfile() {
   ProfileSettings p;
   p.access_mask = 1; // cars
+  p.use_traffic = true;
   auto& s = p.speeds_mps;
   s[static_cast<int>(Routing::RoadClass::MOTORWAY)]    = 30.0;
   s[static_cast<int>(Routing::RoadClass::PRIMARY)]     = 25.0;
@@ -40,6 +60,19 @@ inline ProfileSettings makeFootProfile() {
   return p;
 }
 
+// Моторная лодка по рекам, каналам и открытой воде (только water_tiles)
+inline ProfileSettings makeBoatProfile() {
+  ProfileSettings p;
+  p.access_mask = 4; // boat
+  p.layer = TileLayer::WATER;
+  p.flow_factor = 1.0;
+  p.open_water_speed_mps = 6.0; // ~22 км/ч по озеру или заливу
+  auto& s = p.speeds_mps;
+  s[static_cast<int>(Routing::RoadClass::RIVER)] = 4.2; // ~15 км/ч
+  s[static_cast<int>(Routing::RoadClass::CANAL)] = 2.2; // ~8 км/ч, ограничения в каналах строже
+  return p;
+}
+
 } // namespace routing_core
 
 
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <flatbuffers/flatbuffers.h>
+
+#include "routing_core/router.h"
+
+namespace routing_core {
+
+// Сборка Routing.RouteResponse (core/src/route_result.fbs) прямо из
+// результатов Router. Полилиния и матрица пишутся на место в буфер
+// строителя (CreateUninitializedVector*), без промежуточных векторов.
+// fbb очищается перед сборкой: один строитель на поток переиспользует память.
+// Результат — fbb.GetBufferPointer() / fbb.GetSize().
+void buildRouteResponse(flatbuffers::FlatBufferBuilder& fbb, const RouteResult& rr);
+void buildTripResponse(flatbuffers::FlatBufferBuilder& fbb, const TripResult& tr);
+void buildMatrixResponse(flatbuffers::FlatBufferBuilder& fbb, const MatrixResult& m);
+
+} // namespace routing_core
@@ -6,6 +6,7 @@
 #include <memory>
 
 #include "routing_core/profile.h"
+#include "routing_core/traffic.h"
 
 namespace routing_core {
 
@@ -34,6 +35,87 @@ struct RouteResult {
 struct RouterOptions {
   int tileZoom = 14;                  // уровень тайла (совпадает с конвертером)
   size_t tileCacheCapacity = 128;     // LRU-кэш тайлов
+  // Обзорный слой (конвертер --overview-z): только магистрали на грубом зуме.
+  // Дальние маршруты ищутся по нему, детальный слой грузится лишь у концов.
+  int overviewZoom = 10;              // 0 — не использовать
+  double overviewMinDistanceM = 30000.0; // с какого расстояния (по прямой) включать
+  int overviewDetailFrame = 2;        // рамка детальных тайлов вокруг старта/финиша
+  // Запреты манёвров из тайлов (для авто). Граф становится рёберным только
+  // в узлах-via: узел расщепляется по входящим рёбрам "from".
+  bool turnRestrictions = true;
+  unsigned workerThreads = 8;         // пул для строк матрицы trip() и snapBatch()
+  double tripImproveBudgetMs = 150.0; // бюджет улучшения порядка trip() (2-opt/Or-opt)
+  // Потолок тайлов на запрос nearest/trip/matrix и плечо route (прямоугольник точек с рамкой);
+  // больше — INTERNAL_ERROR без загрузки. 0 — без лимита
+  size_t maxQueryTiles = 4096;
+};
+
+// Исключения на один запрос: перекрытые рёбра и зоны объезда.
+// Пакет и профиль не меняются; рёбра отсекаются битовой маской при сборке графа.
+struct RouteOptions {
+  std::vector<uint64_t> excludedEdges;            // edge_id из RouteResult::edge_ids (оба направления)
+  std::vector<std::vector<Coord>> avoidPolygons;  // кольца lat/lon, замыкаются автоматически
+
+  bool empty() const { return excludedEdges.empty() && avoidPolygons.empty(); }
+};
+
+enum class SearchDirection {
+  FROM_ORIGIN, // от origin к кандидатам (ближайшая заправка)
+  TO_ORIGIN    // от кандидатов к origin (ближайшая машина к точке подачи)
+};
+
+struct NearestHit {
+  size_t candidate {0};   // индекс во входном списке
+  double duration_s {0.0};
+};
+
+struct NearestResult {
+  RouteStatus status {RouteStatus::INTERNAL_ERROR};
+  std::vector<NearestHit> hits;  // по возрастанию времени, не больше k
+  std::string error_message;
+};
+
+struct TripResult {
+  RouteStatus status {RouteStatus::INTERNAL_ERROR};
+  std::vector<size_t> order;       // индексы stops в порядке обхода
+  std::vector<RouteResult> legs;   // order.size()-1 плеч
+  double distance_m {0.0};
+  double duration_s {0.0};
+  std::string error_message;
+};
+
+// Матрица времени sources × targets по строкам: durations_s[i * targets + j].
+// Недостижимые пары и точки без дороги рядом — +inf.
+struct MatrixResult {
+  RouteStatus status {RouteStatus::INTERNAL_ERROR};
+  size_t sources {0};
+  size_t targets {0};
+  std::vector<double> durations_s;
+  std::string error_message;
+};
+
+// Трудоёмкость последнего запроса Router (route/nearest/trip/matrix/snapBatch):
+// для метрик сервера и журнала медленных запросов. Время — по фазам, мс.
+struct QueryStats {
+  size_t tilesLoaded {0};     // тайлов в наборе запроса (все попытки, вкл. обзорный слой)
+  size_t tileCacheHits {0};
+  size_t tileCacheMisses {0}; // чтения BLOB из SQLite
+  size_t graphNodes {0};      // вершин графа запроса
+  size_t settledNodes {0};    // вершин (листьев открытой воды), снятых с очередей поиска
+  double tilesMs {0.0};       // чтение тайлов
+  double graphMs {0.0};       // граф запроса, привязка точек, запреты манёвров
+  double searchMs {0.0};      // A* / Дейкстра
+  double geometryMs {0.0};    // геометрия и длины по рёбрам пути
+};
+
+// Результат пакетного снапа: плоские массивы по индексу входной точки
+constexpr uint64_t kNoEdge = ~0ull;
+
+struct SnapBatchResult {
+  std::vector<uint64_t> edge_ids;    // kNoEdge — рядом нет доступной профилю дороги
+  std::vector<double> offsets;       // доля длины ребра от from_node, [0..1]
+  std::vector<double> distances_m;   // от точки до проекции
+  std::vector<Coord> projected;      // проекция на ребро
 };
 
 class Router {
@@ -41,8 +123,62 @@ public:
   explicit Router(const std::string& db_path, RouterOptions opt = {});
   ~Router();
 
-  // Маршрут через start..waypoints..end (в v1 — все точки в одном тайле)
+  // Маршрут через start..waypoints..end: каждое плечо ищется отдельно, полилиния,
+  // edge_ids, дистанция и время склеиваются. Ошибка плеча k — "leg k: ...".
+  // Профиль с layer == TileLayer::WATER (makeBoatProfile) ищет по water_tiles пакета;
+  // это касается и nearest/trip/snapBatch. Если обе точки на открытой воде
+  // (маска тайла, open_water_speed_mps > 0), маршрут строится по ней, без рёбер.
   RouteResult route(const ProfileSettings& profile, const std::vector<Coord>& waypoints);
+  // То же с исключениями. Рёбра детального зума отключают для запроса обзорный слой:
+  // те же дороги в нём лежат под другими edge_id. По той же причине плечо идёт мимо
+  // обзорного слоя, если у профиля use_traffic и в его коридоре есть множители пробок.
+  RouteResult route(const ProfileSettings& profile, const std::vector<Coord>& waypoints,
+                    const RouteOptions& routeOptions);
+  // Плечо, которому нужно больше maxQueryTiles тайлов: дальнее считается по
+  // обзорному прямоугольнику, ближнее — по детальному. route() с таким плечом
+  // возвращает INTERNAL_ERROR без загрузки; проверка до запроса — для ответа 400.
+  bool routeTooLarge(const ProfileSettings& profile, const std::vector<Coord>& waypoints,
+                     const RouteOptions& routeOptions, std::string& error) const;
+
+  // Точка на открытой воде по маске water_tiles: спуск по квадродереву одного
+  // тайла, декодированные тайлы кэшируются. false, если в пакете нет маски.
+  bool isOpenWater(const Coord& c);
+
+  // k ближайших по времени кандидатов одним ограниченным поиском вместо N маршрутов.
+  // Тайлы грузятся кольцами от origin, пока k ближайших не доказаны, а не весь
+  // прямоугольник кандидатов. Кандидаты без дороги рядом пропускаются.
+  // Геометрию пути к выбранному кандидату даёт обычный route().
+  NearestResult nearest(const ProfileSettings& profile, const Coord& origin,
+                        const std::vector<Coord>& candidates, size_t k,
+                        SearchDirection dir = SearchDirection::FROM_ORIGIN,
+                        const RouteOptions& routeOptions = {});
+
+  // Привязка тысяч точек к ближайшим рёбрам: точки группируются по тайлам,
+  // каждый тайл грузится и индексируется один раз, группы идут параллельно.
+  SnapBatchResult snapBatch(const ProfileSettings& profile, const std::vector<Coord>& points);
+
+  // Порядок объезда точек (10–200): матрица времени по одному графу на все точки,
+  // затем вставка ближайшего + 2-opt/Or-opt в пределах tripImproveBudgetMs.
+  // fixedStart — первой идёт stops.front(), fixedEnd — последней stops.back().
+  TripResult trip(const ProfileSettings& profile, const std::vector<Coord>& stops,
+                  bool fixedStart = true, bool fixedEnd = false,
+                  const RouteOptions& routeOptions = {});
+
+  // Матрица времени: один граф запроса на все точки, строка — Дейкстра от
+  // источника до оседания всех целей; строки идут на пуле workerThreads.
+  MatrixResult matrix(const ProfileSettings& profile, const std::vector<Coord>& sources,
+                      const std::vector<Coord>& targets, const RouteOptions& routeOptions = {});
+
+  // Пробки (для профилей с use_traffic). Запрос берёт снимок оверлея в начале
+  // и работает с ним до конца, поэтому публиковать новый можно из другого
+  // потока во время route(). nullptr — выключить.
+  void setTrafficOverlay(std::shared_ptr<const TrafficOverlay> overlay);
+  std::shared_ptr<const TrafficOverlay> trafficOverlay() const;
+  // Применить пачку к текущему снимку и опубликовать результат
+  void updateTraffic(std::vector<TrafficUpdate> updates);
+
+  // Статистика последнего запроса; обнуляется в начале каждого
+  const QueryStats& lastQueryStats() const;
 
 private:
   struct Impl;
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "routing_core/tile_store.h"
+#include "routing_core/tile_view.h"
+#include "routing_core/tiler.h"
+
+namespace routing_core {
+
+// Сегменты форм рёбер одного тайла в плоских массивах для поиска ближайшего:
+// x = lon * cos(широты центра тайла), y = lat. Общий для снапа маршрутизатора
+// (рёбра профиля) и обратного геокодинга (именованные рёбра).
+struct TileSegmentIndex {
+  double kx {1.0};
+  std::vector<double> ax, ay, dx, dy, inv2; // начало, направление, 1/|d|^2 (0 для вырожденных)
+  std::vector<uint32_t> edge;               // индекс ребра в тайле
+  std::vector<double> along;                // длина ребра до начала сегмента
+  std::unordered_map<uint32_t,double> edgeLen;
+
+  // keep(edge) — брать ли ребро в индекс
+  template <typename Keep>
+  void build(const TileView& view, const TileKey& key, Keep&& keep) {
+    double latMin, lonMin, latMax, lonMax;
+    webTileBounds(key.z, key.x, key.y, latMin, lonMin, latMax, lonMax);
+    kx = std::cos((latMin + latMax) * 0.5 * M_PI / 180.0);
+    std::vector<std::pair<double,double>> pts;
+    for (int ei = 0; ei < view.edgeCount(); ++ei) {
+      if (!keep(static_cast<uint32_t>(ei))) continue;
+      pts.clear();
+      view.appendEdgeShape(static_cast<uint32_t>(ei), pts, /*skipFirst*/false);
+      double len = 0.0;
+      for (size_t k = 0; k + 1 < pts.size(); ++k) {
+        const double x0 = pts[k].second * kx, y0 = pts[k].first;
+        const double ddx = pts[k+1].second * kx - x0, ddy = pts[k+1].first - y0;
+        const double l2 = ddx*ddx + ddy*ddy;
+        ax.push_back(x0); ay.push_back(y0); dx.push_back(ddx); dy.push_back(ddy);
+        inv2.push_back(l2 > 1e-18 ? 1.0 / l2 : 0.0);
+        edge.push_back(static_cast<uint32_t>(ei));
+        along.push_back(len);
+        len += std::sqrt(l2);
+      }
+      if (len > 0.0) edgeLen[static_cast<uint32_t>(ei)] = len;
+    }
+  }
+
+  // Ближайший сегмент: плотный цикл по массивам, без ветвлений кроме выбора минимума
+  bool nearest(double lat, double lon, size_t& bestSeg, double& bestT, double& bestD2) const {
+    const double px = lon * kx, py = lat;
+    const size_t n = ax.size();
+    bestD2 = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < n; ++i) {
+      const double wx = px - ax[i], wy = py - ay[i];
+      const double t = std::clamp((wx*dx[i] + wy*dy[i]) * inv2[i], 0.0, 1.0);
+      const double ex = wx - t*dx[i], ey = wy - t*dy[i];
+      const double d2 = ex*ex + ey*ey;
+      if (d2 < bestD2) { bestD2 = d2; bestSeg = i; bestT = t; }
+    }
+    return n > 0;
+  }
+
+  // Проекция на сегмент seg с параметром t
+  double projLat(size_t seg, double t) const { return ay[seg] + t * dy[seg]; }
+  double projLon(size_t seg, double t) const { return (ax[seg] + t * dx[seg]) / kx; }
+};
+
+} // namespace routing_core
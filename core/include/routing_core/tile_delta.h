@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace routing_core {
+
+// Бинарный дифф BLOB'а тайла относительно старой версии.
+// Формат: "LXD1", varint(new_size), затем операции
+//   0x00 varint(offset) varint(len) — копия из старого BLOB'а
+//   0x01 varint(len) bytes          — вставка новых байт
+std::vector<uint8_t> encodeBinaryDelta(const uint8_t* oldData, size_t oldSize,
+                                       const uint8_t* newData, size_t newSize);
+
+// false при повреждённом диффе или выходе за границы старого BLOB'а.
+bool applyBinaryDelta(const uint8_t* oldData, size_t oldSize,
+                      const uint8_t* delta, size_t deltaSize,
+                      std::vector<uint8_t>& out);
+
+} // namespace routing_core
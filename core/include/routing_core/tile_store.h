@@ -26,7 +26,8 @@ struct TileBlob {
 
 class TileStore {
 public:
-  TileStore(const std::string& db_path, size_t cacheCapacity);
+  // table — land_tiles или water_tiles (одна схема и формат BLOB)
+  TileStore(const std::string& db_path, size_t cacheCapacity, const std::string& table = "land_tiles");
   ~TileStore();
 
   // Загружает BLOB тайла по ключу (LRU-кэш). nullptr при отсутствии.
@@ -35,6 +36,11 @@ public:
   int zoom() const { return zoom_; }
   void setZoom(int z) { zoom_ = z; }
 
+  // Счётчики с момента открытия: промах — чтение BLOB из SQLite (есть тайл или нет)
+  uint64_t cacheHits() const { return hits_; }
+  uint64_t cacheMisses() const { return misses_; }
+  size_t cachedTiles() const { return map_.size(); }
+
 private:
   // LRU
   using ListIt = std::list<TileKey>::iterator;
@@ -48,9 +54,12 @@ private:
 
 private:
   sqlite3* db_ {nullptr};
+  std::string select_sql_;
   int zoom_ {14};
 
   size_t capacity_;
+  uint64_t hits_ {0};
+  uint64_t misses_ {0};
   std::list<TileKey> lru_; // front = most recent
   std::unordered_map<TileKey, CacheEntry, TileKeyHash> map_;
 };
@@ -4,6 +4,7 @@
 #include <memory>
 #include <vector>
 #include <optional>
+#include <string_view>
 
 #include "land_tile_generated.h"
 
@@ -26,6 +27,16 @@ public:
   inline int edgeCount() const {
     return root_->edges() ? static_cast<int>(root_->edges()->size()) : 0;
   }
+  // Профили, для которых в тайле есть рёбра (0 — не задано, старые пакеты)
+  inline uint32_t profileMask() const { return root_->profile_mask(); }
+
+  // Запреты манёвров (по квантованным координатам, отсортированы по via)
+  inline int restrictionCount() const {
+    return root_->restrictions() ? static_cast<int>(root_->restrictions()->size()) : 0;
+  }
+  inline const Routing::TurnRestriction* restrictionAt(int idx) const {
+    return root_->restrictions()->Get(static_cast<flatbuffers::uoffset_t>(idx));
+  }
 
   // Координаты узла (квантованные в схеме)
   inline double nodeLat(int idx) const {
@@ -57,6 +68,11 @@ public:
   inline const Routing::Edge* edgeAt(uint32_t edgeIdx) const {
     return root_->edges()->Get(static_cast<flatbuffers::uoffset_t>(edgeIdx));
   }
+  // name пути ребра; пусто — без имени или пакет старше поля
+  inline std::string_view edgeName(uint32_t edgeIdx) const {
+    const auto* s = edgeAt(edgeIdx)->name();
+    return s ? std::string_view(s->c_str(), s->size()) : std::string_view();
+  }
 
   // Входящие рёбра (для обратного фронта bi-A*)
   const std::vector<uint32_t>& inEdgesOf(int nodeIdx) const {
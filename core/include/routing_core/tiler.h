@@ -17,4 +17,14 @@ inline WebTileKey webTileKeyFor(double lat_deg, double lon_deg, int z) {
   return {z, x, y};
 }
 
+// Границы тайла в градусах (обратная проекция Web Mercator)
+inline void webTileBounds(int z, int x, int y, double& lat_min, double& lon_min, double& lat_max, double& lon_max) {
+  const double n = static_cast<double>(1 << z);
+  auto lat = [&](double ty) { return std::atan(std::sinh(M_PI * (1.0 - 2.0 * ty / n))) * 180.0 / M_PI; };
+  lon_min = x / n * 360.0 - 180.0;
+  lon_max = (x + 1) / n * 360.0 - 180.0;
+  lat_max = lat(y);
+  lat_min = lat(y + 1);
+}
+
 } // namespace routing_core
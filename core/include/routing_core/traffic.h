@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace routing_core {
+
+// Обновление одного ребра: edge_id из RouteResult::edge_ids и множитель
+// к скорости профиля. 0 — ребро перекрыто, < 0 — убрать ребро из оверлея.
+struct TrafficUpdate {
+  uint64_t edge_id {0};
+  double factor {1.0};
+};
+
+// Неизменяемый снимок пробок. Тайлы пакета не трогаются: множители лежат
+// отдельно, по тайлам, в двух параллельных отсортированных массивах.
+// Новая версия разделяет с предыдущей все тайлы, которых не коснулись обновления.
+class TrafficOverlay {
+public:
+  struct TileFactors {
+    std::vector<uint16_t> edges;  // индексы рёбер в тайле, по возрастанию
+    std::vector<uint8_t> factors; // множитель в сотых (0..255)
+
+    // Множитель ребра или -1, если ребра в оверлее нет
+    double factor(uint32_t edgeIdx) const;
+  };
+
+  static constexpr double kMaxFactor = 2.55;
+
+  // nullptr, если для тайла нет данных
+  const TileFactors* tile(int z, int x, int y) const;
+  // 1.0 для рёбер вне оверлея
+  double factor(uint64_t edgeId) const;
+
+  // Есть ли множители в тайлах зума z внутри [minX..maxX] × [minY..maxY]
+  bool hasTilesIn(int z, int minX, int minY, int maxX, int maxY) const;
+
+  size_t edgeCount() const { return edge_count_; }
+  size_t tileCount() const { return tiles_.size(); }
+
+  std::shared_ptr<const TrafficOverlay> withUpdates(std::vector<TrafficUpdate> updates) const;
+
+private:
+  // ключ — edge_id с обнулённым индексом ребра
+  std::unordered_map<uint64_t, std::shared_ptr<const TileFactors>> tiles_;
+  size_t edge_count_ {0};
+};
+
+// Формат ленты: строка "edge_id factor", edge_id десятичный или 0x-hex,
+// '#' — комментарий. Пустая строка в потоке закрывает пачку.
+bool parseTrafficLine(const std::string& line, TrafficUpdate& out);
+std::vector<TrafficUpdate> readTrafficUpdates(std::istream& in);
+
+// Снимок из файла; nullptr, если файл не открылся
+std::shared_ptr<const TrafficOverlay> loadTrafficOverlay(const std::string& path);
+
+// Чтение ленты из дескриптора (сокет, pipe, файл) до EOF. Пачка отдаётся
+// в onBatch по пустой строке, по достижении maxBatch строк и в конце потока.
+// Блокирующий вызов — для отдельного потока. Возвращает число принятых строк.
+size_t readTrafficFeed(int fd, const std::function<void(std::vector<TrafficUpdate>&&)>& onBatch,
+                       size_t maxBatch = 100000);
+
+} // namespace routing_core
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace routing_core {
+
+// Порядок обхода точек по матрице времени (несимметричной, inf — недостижимо).
+// Путь без возврата: fixedStart закрепляет точку 0 первой, fixedEnd — точку n-1 последней.
+// Вставка ближайшего, затем 2-opt и Or-opt (перенос цепочек 1..3), пока есть
+// улучшения и не вышел бюджет времени.
+std::vector<size_t> solveTripOrder(const std::vector<std::vector<double>>& duration,
+                                   bool fixedStart, bool fixedEnd, double timeBudgetMs);
+
+// Длительность пути в заданном порядке
+double tripCost(const std::vector<std::vector<double>>& duration, const std::vector<size_t>& order);
+
+} // namespace routing_core
@@ -0,0 +1,627 @@
+#include "routing_core/autocomplete.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "routing_core/tiler.h"
+
+namespace routing_core {
+
+using namespace acformat;
+
+namespace {
+
+constexpr size_t kMaxScan = 20000;       // проверенных постингов на один проход
+constexpr size_t kCellLists = 64;        // слов префикса в клетке, сливаемых по важности
+constexpr size_t kCellScan = 512;        // записей остальных слов клетки
+constexpr size_t kMaxMergeLists = 4096;  // слов префикса для слияния постингов
+constexpr size_t kAlphabetMax = 128;     // самые частые буквы — для вариантов с опечаткой
+constexpr double kNearRadiusKm = 50.0;   // ~ 3x3 клетки z10 на средних широтах
+constexpr double kImportanceWeight = 2.0;
+constexpr double kNearWeight = 2.0;
+constexpr double kExactWordBonus = 0.5;  // префикс совпал со словом целиком
+constexpr double kEditPenalty = 1.5;
+
+std::vector<std::string> splitWords(const std::string& normalized) {
+  std::vector<std::string> out;
+  size_t i = 0;
+  while (i < normalized.size()) {
+    size_t j = normalized.find(' ', i);
+    if (j == std::string::npos) j = normalized.size();
+    if (j > i) out.push_back(normalized.substr(i, j - i));
+    i = j + 1;
+  }
+  return out;
+}
+
+std::vector<uint32_t> decodeUtf8(const std::string& s) {
+  std::vector<uint32_t> out;
+  for (size_t i = 0; i < s.size();) {
+    const auto c = static_cast<unsigned char>(s[i]);
+    const int len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 1;
+    uint32_t cp = len == 1 ? c : c & (0x7F >> len);
+    for (int k = 1; k < len && i + k < s.size(); ++k) cp = (cp << 6) | (static_cast<unsigned char>(s[i + k]) & 0x3F);
+    out.push_back(cp);
+    i += static_cast<size_t>(len);
+  }
+  return out;
+}
+
+std::string encodeUtf8(const std::vector<uint32_t>& cps) {
+  std::string out;
+  for (uint32_t cp : cps) {
+    if (cp < 0x80) {
+      out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+      out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+      out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+      out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+      out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+      out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+      out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+      out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+      out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+      out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+  }
+  return out;
+}
+
+// Обрезка по границе символа UTF-8
+std::string clipTerm(const std::string& w) {
+  if (w.size() <= kMaxTermBytes) return w;
+  size_t n = kMaxTermBytes;
+  while (n > 0 && (static_cast<unsigned char>(w[n]) & 0xC0) == 0x80) --n;
+  return w.substr(0, n);
+}
+
+uint32_t cellOf(double lat, double lon) {
+  const WebTileKey t = webTileKeyFor(lat, lon, kCellZoom);
+  return (static_cast<uint32_t>(t.x) << kCellZoom) | static_cast<uint32_t>(t.y);
+}
+
+double distanceKm(double lat1, double lon1, double lat2, double lon2) {
+  constexpr double kKmPerDeg = 111.32;
+  const double dx = (lon2 - lon1) * std::cos((lat1 + lat2) * 0.5 * M_PI / 180.0);
+  const double dy = lat2 - lat1;
+  return std::sqrt(dx * dx + dy * dy) * kKmPerDeg;
+}
+
+// Слияние списков, упорядоченных по номеру объекта (= по убыванию важности):
+// важные первыми; стоп после want принятых или когда кончился бюджет просмотра
+template <typename T, typename EntityOf, typename Accept>
+void mergeByEntity(const std::vector<std::pair<const T*, const T*>>& lists, size_t want, size_t& budget,
+                   EntityOf entityOf, Accept&& accept) {
+  using Cursor = std::tuple<uint32_t, const T*, const T*>; // (объект, позиция, конец списка)
+  std::vector<Cursor> heap;
+  heap.reserve(lists.size());
+  for (const auto& [b, e] : lists) heap.emplace_back(entityOf(*b), b, e);
+  std::make_heap(heap.begin(), heap.end(), std::greater<>());
+  size_t accepted = 0;
+  while (!heap.empty() && budget > 0 && accepted < want) {
+    std::pop_heap(heap.begin(), heap.end(), std::greater<>());
+    auto& [entity, pos, end] = heap.back();
+    --budget;
+    if (accept(entity)) ++accepted;
+    if (++pos != end) {
+      entity = entityOf(*pos);
+      std::push_heap(heap.begin(), heap.end(), std::greater<>());
+    } else {
+      heap.pop_back();
+    }
+  }
+}
+
+template <typename T>
+void writeVector(std::ofstream& out, const std::vector<T>& v) {
+  if (!v.empty()) out.write(reinterpret_cast<const char*>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(T)));
+}
+
+uint64_t alignedPos(std::ofstream& out) {
+  static const char zeros[4] = {0, 0, 0, 0};
+  const auto pos = static_cast<uint64_t>(out.tellp());
+  if (pos % 4) out.write(zeros, static_cast<std::streamsize>(4 - pos % 4));
+  return static_cast<uint64_t>(out.tellp());
+}
+
+} // namespace
+
+size_t writeAutocompleteIndex(const std::vector<AutocompleteSource>& entities, const std::string& path) {
+  const auto n = static_cast<uint32_t>(entities.size());
+
+  // Слова объектов и словарь
+  std::vector<std::vector<std::string>> words(n);
+  std::vector<std::string> dict;
+  for (uint32_t i = 0; i < n; ++i) {
+    auto w = splitWords(geoIndexText(entities[i].name));
+    if (!entities[i].city.empty()) {
+      for (auto& c : splitWords(geoIndexText(entities[i].city))) w.push_back(std::move(c));
+    }
+    for (auto& x : w) x = clipTerm(x);
+    std::sort(w.begin(), w.end());
+    w.erase(std::unique(w.begin(), w.end()), w.end());
+    dict.insert(dict.end(), w.begin(), w.end());
+    words[i] = std::move(w);
+  }
+  std::sort(dict.begin(), dict.end());
+  dict.erase(std::unique(dict.begin(), dict.end()), dict.end());
+  auto termId = [&](const std::string& w) {
+    return static_cast<uint32_t>(std::lower_bound(dict.begin(), dict.end(), w) - dict.begin());
+  };
+
+  // Прямой индекс (объект -> слова) и обратный по словам
+  std::vector<Entity> ents(n + 1, Entity{});
+  std::vector<uint32_t> entityTerms;
+  std::vector<uint32_t> postingsIdx(dict.size() + 1, 0);
+  std::string names;
+  std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> cellEntries; // (cell, term, entity)
+  for (uint32_t i = 0; i < n; ++i) {
+    const auto& src = entities[i];
+    Entity& e = ents[i];
+    e.lat_e6 = static_cast<int32_t>(std::lround(src.lat * 1e6));
+    e.lon_e6 = static_cast<int32_t>(std::lround(src.lon * 1e6));
+    e.name_off = static_cast<uint32_t>(names.size());
+    e.terms_off = static_cast<uint32_t>(entityTerms.size());
+    e.kind = static_cast<uint8_t>(src.kind);
+    e.importance = static_cast<uint8_t>(std::lround(std::clamp(src.importance, 0.0, 1.0) * 255.0));
+    names += src.name;
+    const uint32_t cell = cellOf(src.lat, src.lon);
+    for (const auto& w : words[i]) {
+      const uint32_t t = termId(w);
+      entityTerms.push_back(t);
+      ++postingsIdx[t + 1];
+      cellEntries.emplace_back(cell, t, i);
+    }
+    std::sort(entityTerms.begin() + e.terms_off, entityTerms.end());
+  }
+  ents[n].name_off = static_cast<uint32_t>(names.size());
+  ents[n].terms_off = static_cast<uint32_t>(entityTerms.size());
+  words.clear();
+
+  for (size_t t = 0; t < dict.size(); ++t) postingsIdx[t + 1] += postingsIdx[t];
+  std::vector<uint32_t> postings(postingsIdx.back());
+  {
+    std::vector<uint32_t> fill(postingsIdx.begin(), postingsIdx.end() - 1);
+    for (uint32_t i = 0; i < n; ++i) {
+      for (uint32_t k = ents[i].terms_off; k < ents[i + 1].terms_off; ++k) postings[fill[entityTerms[k]]++] = i;
+    }
+  }
+
+  std::sort(cellEntries.begin(), cellEntries.end());
+  std::vector<CellDir> cells;
+  std::vector<CellEntry> entries;
+  entries.reserve(cellEntries.size());
+  for (size_t k = 0; k < cellEntries.size(); ++k) {
+    const auto& [cell, term, entity] = cellEntries[k];
+    if (cells.empty() || cells.back().cell != cell) cells.push_back(CellDir{cell, static_cast<uint32_t>(k)});
+    entries.push_back(CellEntry{term, entity});
+  }
+  cells.push_back(CellDir{0xFFFFFFFFu, static_cast<uint32_t>(entries.size())});
+  cellEntries.clear();
+  cellEntries.shrink_to_fit();
+
+  // Префиксное сжатие словаря блоками по kTermBlock; частые буквы — алфавит опечаток
+  std::vector<uint32_t> blocks;
+  std::vector<uint8_t> termBytes;
+  std::map<uint32_t, uint64_t> letters;
+  for (size_t t = 0; t < dict.size(); ++t) {
+    const std::string& w = dict[t];
+    if (t % kTermBlock == 0) {
+      blocks.push_back(static_cast<uint32_t>(termBytes.size()));
+      termBytes.push_back(static_cast<uint8_t>(w.size()));
+      termBytes.insert(termBytes.end(), w.begin(), w.end());
+    } else {
+      const std::string& prev = dict[t - 1];
+      size_t shared = 0;
+      while (shared < prev.size() && shared < w.size() && prev[shared] == w[shared]) ++shared;
+      termBytes.push_back(static_cast<uint8_t>(shared));
+      termBytes.push_back(static_cast<uint8_t>(w.size() - shared));
+      termBytes.insert(termBytes.end(), w.begin() + static_cast<std::ptrdiff_t>(shared), w.end());
+    }
+    for (uint32_t cp : decodeUtf8(w)) ++letters[cp];
+  }
+  blocks.push_back(static_cast<uint32_t>(termBytes.size()));
+  std::vector<std::pair<uint64_t, uint32_t>> byFreq;
+  for (const auto& [cp, cnt] : letters) byFreq.emplace_back(cnt, cp);
+  std::sort(byFreq.rbegin(), byFreq.rend());
+  std::vector<uint32_t> alphabet;
+  for (size_t i = 0; i < byFreq.size() && i < kAlphabetMax; ++i) alphabet.push_back(byFreq[i].second);
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) throw std::runtime_error("Failed to create autocomplete index: " + path);
+  Header h{};
+  h.magic = kMagic;
+  h.version = kVersion;
+  h.cell_zoom = kCellZoom;
+  h.term_count = static_cast<uint32_t>(dict.size());
+  h.block_count = static_cast<uint32_t>(blocks.size() - 1);
+  h.entity_count = n;
+  h.cell_count = static_cast<uint32_t>(cells.size() - 1);
+  h.alphabet_size = static_cast<uint32_t>(alphabet.size());
+  out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  h.off_blocks = alignedPos(out);
+  writeVector(out, blocks);
+  h.off_term_bytes = alignedPos(out);
+  writeVector(out, termBytes);
+  h.off_postings_idx = alignedPos(out);
+  writeVector(out, postingsIdx);
+  h.off_postings = alignedPos(out);
+  writeVector(out, postings);
+  h.off_cells = alignedPos(out);
+  writeVector(out, cells);
+  h.off_cell_entries = alignedPos(out);
+  writeVector(out, entries);
+  h.off_entities = alignedPos(out);
+  writeVector(out, ents);
+  h.off_names = alignedPos(out);
+  out.write(names.data(), static_cast<std::streamsize>(names.size()));
+  h.off_entity_terms = alignedPos(out);
+  writeVector(out, entityTerms);
+  h.off_alphabet = alignedPos(out);
+  writeVector(out, alphabet);
+  h.file_size = alignedPos(out);
+  out.seekp(0);
+  out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  out.close();
+  if (!out) throw std::runtime_error("Failed to write autocomplete index: " + path);
+  return static_cast<size_t>(h.file_size);
+}
+
+// Разобранный запрос одного прохода (точного или с опечаткой)
+struct AutocompleteIndex::Query {
+  std::vector<TermRange> prefix;              // последнее слово; пусто — все слова целые
+  std::vector<std::vector<uint32_t>> words;   // на каждое целое слово — допустимые номера слов
+  std::optional<uint32_t> exact;              // слово, равное префиксу целиком
+  std::optional<Coord> near;
+  size_t k {10};
+  int edits {0};
+};
+
+AutocompleteIndex::AutocompleteIndex(const std::string& path) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) throw std::runtime_error("Failed to open autocomplete index: " + path);
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+    ::close(fd);
+    throw std::runtime_error("Bad autocomplete index: " + path);
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) throw std::runtime_error("Failed to map autocomplete index: " + path);
+  base_ = static_cast<const uint8_t*>(p);
+  header_ = reinterpret_cast<const Header*>(base_);
+
+  const Header& h = *header_;
+  const uint64_t offs[] = {h.off_blocks, h.off_term_bytes, h.off_postings_idx, h.off_postings, h.off_cells,
+                           h.off_cell_entries, h.off_entities, h.off_names, h.off_entity_terms, h.off_alphabet};
+  bool ok = h.magic == kMagic && h.version == kVersion && h.cell_zoom == static_cast<uint32_t>(kCellZoom) &&
+            h.file_size == size_;
+  for (uint64_t off : offs) ok = ok && off <= size_ && off % 4 == 0;
+  if (!ok) {
+    ::munmap(const_cast<uint8_t*>(base_), size_);
+    throw std::runtime_error("Bad autocomplete index: " + path);
+  }
+  blocks_ = reinterpret_cast<const uint32_t*>(base_ + h.off_blocks);
+  term_bytes_ = base_ + h.off_term_bytes;
+  postings_idx_ = reinterpret_cast<const uint32_t*>(base_ + h.off_postings_idx);
+  postings_ = reinterpret_cast<const uint32_t*>(base_ + h.off_postings);
+  cells_ = reinterpret_cast<const CellDir*>(base_ + h.off_cells);
+  cell_entries_ = reinterpret_cast<const CellEntry*>(base_ + h.off_cell_entries);
+  entities_ = reinterpret_cast<const Entity*>(base_ + h.off_entities);
+  names_ = reinterpret_cast<const char*>(base_ + h.off_names);
+  entity_terms_ = reinterpret_cast<const uint32_t*>(base_ + h.off_entity_terms);
+  alphabet_ = reinterpret_cast<const uint32_t*>(base_ + h.off_alphabet);
+}
+
+AutocompleteIndex::~AutocompleteIndex() {
+  if (base_) ::munmap(const_cast<uint8_t*>(base_), size_);
+}
+
+std::string AutocompleteIndex::termAt(uint32_t id) const {
+  const uint8_t* p = term_bytes_ + blocks_[id / kTermBlock];
+  std::string term(reinterpret_cast<const char*>(p + 1), p[0]);
+  p += 1 + p[0];
+  for (uint32_t j = 0; j < id % kTermBlock; ++j) {
+    term.resize(p[0]);
+    term.append(reinterpret_cast<const char*>(p + 2), p[1]);
+    p += 2 + p[1];
+  }
+  return term;
+}
+
+AutocompleteIndex::TermRange AutocompleteIndex::prefixRange(const std::string& prefix) const {
+  // Первый номер слова >= s: бинарный поиск по первым словам блоков, затем блок целиком
+  auto lowerBound = [&](std::string_view s) -> uint32_t {
+    uint32_t lo = 0, hi = header_->block_count;
+    while (lo < hi) {
+      const uint32_t mid = (lo + hi) / 2;
+      const uint8_t* p = term_bytes_ + blocks_[mid];
+      if (std::string_view(reinterpret_cast<const char*>(p + 1), p[0]) < s) lo = mid + 1;
+      else hi = mid;
+    }
+    if (lo == 0) return 0;
+    const uint32_t block = lo - 1;
+    uint32_t id = block * kTermBlock;
+    const uint32_t end = std::min(id + kTermBlock, header_->term_count);
+    const uint8_t* p = term_bytes_ + blocks_[block];
+    std::string term(reinterpret_cast<const char*>(p + 1), p[0]);
+    p += 1 + p[0];
+    while (term < s && ++id < end) {
+      term.resize(p[0]);
+      term.append(reinterpret_cast<const char*>(p + 2), p[1]);
+      p += 2 + p[1];
+    }
+    return id;
+  };
+  // 0xFF не встречается в UTF-8: всё, что начинается с prefix, меньше prefix + "\xFF"
+  return TermRange{lowerBound(prefix), lowerBound(prefix + '\xFF')};
+}
+
+std::optional<uint32_t> AutocompleteIndex::findTerm(const std::string& word) const {
+  const TermRange r = prefixRange(word);
+  if (r.lo < r.hi && termAt(r.lo) == word) return r.lo;
+  return std::nullopt;
+}
+
+void AutocompleteIndex::collect(const Query& q, std::vector<AutocompleteHit>& out) const {
+  struct Scored {
+    double score;
+    uint32_t entity;
+  };
+  std::vector<Scored> found;
+  std::unordered_set<uint32_t> seen;
+  for (const auto& h : out) seen.insert(static_cast<uint32_t>(h.id - 1));
+  auto hasAny = [&](const Entity& e, const Entity& next, const std::vector<uint32_t>& allowed) {
+    const uint32_t* b = entity_terms_ + e.terms_off;
+    const uint32_t* en = entity_terms_ + next.terms_off;
+    return std::any_of(allowed.begin(), allowed.end(), [&](uint32_t t) { return std::binary_search(b, en, t); });
+  };
+  // Проверка объекта против всех слов запроса и оценка; false — не подходит или уже взят
+  auto consider = [&](uint32_t entity) {
+    const Entity& e = entities_[entity];
+    const Entity& next = entities_[entity + 1];
+    const uint32_t* b = entity_terms_ + e.terms_off;
+    const uint32_t* en = entity_terms_ + next.terms_off;
+    if (!q.prefix.empty()) {
+      const bool inRange = std::any_of(q.prefix.begin(), q.prefix.end(), [&](const TermRange& r) {
+        const uint32_t* it = std::lower_bound(b, en, r.lo);
+        return it != en && *it < r.hi;
+      });
+      if (!inRange) return false;
+    }
+    for (const auto& w : q.words) {
+      if (!hasAny(e, next, w)) return false;
+    }
+    if (!seen.insert(entity).second) return false;
+    double score = kImportanceWeight * e.importance / 255.0 - kEditPenalty * q.edits;
+    if (q.exact && std::binary_search(b, en, *q.exact)) score += kExactWordBonus;
+    if (q.near) {
+      const double d = distanceKm(q.near->lat, q.near->lon, e.lat_e6 * 1e-6, e.lon_e6 * 1e-6);
+      score += kNearWeight * (1.0 - std::min(1.0, d / kNearRadiusKm));
+    }
+    found.push_back(Scored{score, entity});
+    return true;
+  };
+
+  // Ведущий список — самый короткий: диапазон префикса или одно из целых слов
+  std::vector<TermRange> driver = q.prefix;
+  auto postingsOf = [&](const std::vector<TermRange>& ranges) {
+    size_t total = 0;
+    for (const auto& r : ranges) total += postings_idx_[r.hi] - postings_idx_[r.lo];
+    return total;
+  };
+  size_t driverSize = driver.empty() ? SIZE_MAX : postingsOf(driver);
+  for (const auto& w : q.words) {
+    std::vector<TermRange> ranges;
+    for (uint32_t t : w) ranges.push_back(TermRange{t, t + 1});
+    const size_t size = postingsOf(ranges);
+    if (size < driverSize) {
+      driver = std::move(ranges);
+      driverSize = size;
+    }
+  }
+  if (driver.empty()) return;
+
+  // 1) Клетки вокруг near: записи клетки отсортированы по (слово, объект), каждое
+  //    слово диапазона — свой список; с каждой клетки — самые важные
+  size_t budget = kMaxScan;
+  if (q.near) {
+    const WebTileKey c = webTileKeyFor(q.near->lat, q.near->lon, kCellZoom);
+    const int n = 1 << kCellZoom;
+    std::vector<std::pair<const CellEntry*, const CellEntry*>> lists;
+    for (int dx = -1; dx <= 1; ++dx) {
+      for (int dy = -1; dy <= 1; ++dy) {
+        const int x = c.x + dx, y = c.y + dy;
+        if (x < 0 || y < 0 || x >= n || y >= n) continue;
+        const uint32_t key = (static_cast<uint32_t>(x) << kCellZoom) | static_cast<uint32_t>(y);
+        const CellDir* dir = std::lower_bound(cells_, cells_ + header_->cell_count, key,
+                                              [](const CellDir& d, uint32_t k) { return d.cell < k; });
+        if (dir == cells_ + header_->cell_count || dir->cell != key) continue;
+        const CellEntry* first = cell_entries_ + dir->start;
+        const CellEntry* last = cell_entries_ + (dir + 1)->start;
+        lists.clear();
+        for (const auto& r : driver) {
+          auto byTerm = [](const CellEntry& e, uint32_t t) { return e.term < t; };
+          const CellEntry* it = std::lower_bound(first, last, r.lo, byTerm);
+          const CellEntry* end = std::lower_bound(it, last, r.hi, byTerm);
+          while (it != end && lists.size() < kCellLists) {
+            const CellEntry* next = std::upper_bound(it, end, it->term, [](uint32_t t, const CellEntry& e) { return t < e.term; });
+            lists.emplace_back(it, next);
+            it = next;
+          }
+          // Короткий префикс с тысячами слов в клетке: остаток без слияния, сколько влезет
+          for (size_t n = 0; it != end && budget > 0 && n < kCellScan; ++it, --budget, ++n) consider(it->entity);
+        }
+        mergeByEntity(lists, q.k * 2, budget, [](const CellEntry& e) { return e.entity; }, consider);
+      }
+    }
+  }
+
+  // 2) Весь пакет: важные объекты издалека тоже соперничают с ближними
+  const size_t want = q.near ? q.k : q.k * 4; // без near порядок уже почти окончательный
+  size_t termCount = 0;
+  for (const auto& r : driver) termCount += r.hi - r.lo;
+  if (termCount > kMaxMergeLists) {
+    // Под префикс попадает большая доля объектов: проще идти по ним в порядке важности
+    size_t accepted = 0;
+    for (uint32_t e = 0; e < header_->entity_count && budget > 0 && accepted < want; ++e, --budget) {
+      if (consider(e)) ++accepted;
+    }
+  } else {
+    std::vector<std::pair<const uint32_t*, const uint32_t*>> lists;
+    for (const auto& r : driver) {
+      for (uint32_t t = r.lo; t < r.hi; ++t) lists.emplace_back(postings_ + postings_idx_[t], postings_ + postings_idx_[t + 1]);
+    }
+    mergeByEntity(lists, want, budget, [](uint32_t e) { return e; }, consider);
+  }
+
+  std::sort(found.begin(), found.end(), [](const Scored& a, const Scored& b) {
+    return a.score != b.score ? a.score > b.score : a.entity < b.entity;
+  });
+  for (const auto& s : found) {
+    if (out.size() >= q.k) break;
+    const Entity& e = entities_[s.entity];
+    AutocompleteHit hit;
+    hit.id = static_cast<int64_t>(s.entity) + 1;
+    hit.kind = static_cast<GeoKind>(e.kind);
+    hit.name.assign(names_ + e.name_off, entities_[s.entity + 1].name_off - e.name_off);
+    hit.lat = e.lat_e6 * 1e-6;
+    hit.lon = e.lon_e6 * 1e-6;
+    hit.score = s.score;
+    hit.edits = q.edits;
+    out.push_back(std::move(hit));
+  }
+}
+
+std::vector<AutocompleteHit> AutocompleteIndex::autocomplete(const std::string& prefix, const std::optional<Coord>& near,
+                                                             size_t k) const {
+  std::vector<AutocompleteHit> out;
+  if (k == 0 || header_->term_count == 0) return out;
+  const bool typing = !prefix.empty() && prefix.back() != ' ';
+  const auto all = splitWords(normalizeGeoText(prefix));
+  std::vector<std::string> words;
+  for (const auto& w : all) {
+    if (!isGeoStopword(w)) words.push_back(clipTerm(w));
+  }
+  // Служебное слово в конце ("ленина ул") отбрасывается, одно ("ул") — ещё набирается
+  bool lastIsPrefix = typing && !words.empty() && !isGeoStopword(all.back());
+  if (words.empty()) {
+    if (!typing || all.empty()) return out;
+    words.push_back(all.back());
+    lastIsPrefix = true;
+  }
+  std::string last;
+  if (lastIsPrefix) {
+    last = words.back();
+    words.pop_back();
+  }
+
+  // Точный проход
+  Query exact;
+  exact.near = near;
+  exact.k = k;
+  bool exactPossible = true;
+  for (const auto& w : words) {
+    const auto t = findTerm(w);
+    if (!t) { exactPossible = false; break; }
+    exact.words.push_back({*t});
+  }
+  if (!last.empty()) {
+    const TermRange r = prefixRange(last);
+    if (r.lo < r.hi) exact.prefix.push_back(r);
+    else exactPossible = false;
+    exact.exact = findTerm(last);
+  }
+  if (exactPossible) collect(exact, out);
+  if (out.size() >= k) return out;
+
+  // Добор с опечаткой: варианты слова на расстоянии 1 по алфавиту частых букв.
+  // Удаление последней буквы префикса дало бы всё, что начинается с укороченного
+  // префикса, поэтому такой вариант ищется как целое слово.
+  auto variants = [&](const std::vector<uint32_t>& cps, bool prefixWord,
+                      std::vector<TermRange>& ranges) {
+    auto add = [&](const std::vector<uint32_t>& v, bool asPrefix) {
+      if (v.empty()) return;
+      const std::string s = encodeUtf8(v);
+      if (asPrefix) {
+        const TermRange r = prefixRange(s);
+        if (r.lo < r.hi) ranges.push_back(r);
+      } else if (const auto t = findTerm(s)) {
+        ranges.push_back(TermRange{*t, *t + 1});
+      }
+    };
+    const size_t len = cps.size();
+    for (size_t i = 0; i < len; ++i) {
+      std::vector<uint32_t> v = cps;
+      v.erase(v.begin() + static_cast<std::ptrdiff_t>(i));
+      add(v, prefixWord && i + 1 < len);
+      if (i + 1 < len && cps[i] != cps[i + 1]) {
+        v = cps;
+        std::swap(v[i], v[i + 1]);
+        add(v, prefixWord);
+      }
+    }
+    for (uint32_t a = 0; a < header_->alphabet_size; ++a) {
+      const uint32_t ch = alphabet_[a];
+      for (size_t i = 0; i <= len; ++i) {
+        std::vector<uint32_t> v = cps;
+        if (i < len) {
+          if (v[i] == ch) continue;
+          v[i] = ch;
+          add(v, prefixWord);
+        }
+        v = cps;
+        v.insert(v.begin() + static_cast<std::ptrdiff_t>(i), ch);
+        add(v, prefixWord);
+      }
+    }
+    // Пересечения диапазонов объединяются
+    std::sort(ranges.begin(), ranges.end(), [](const TermRange& a, const TermRange& b) { return a.lo < b.lo; });
+    std::vector<TermRange> merged;
+    for (const auto& r : ranges) {
+      if (!merged.empty() && r.lo <= merged.back().hi) merged.back().hi = std::max(merged.back().hi, r.hi);
+      else merged.push_back(r);
+    }
+    ranges.swap(merged);
+  };
+
+  Query fuzzy;
+  fuzzy.near = near;
+  fuzzy.k = k;
+  fuzzy.edits = 1;
+  for (const auto& w : words) {
+    std::vector<TermRange> ranges;
+    if (const auto t = findTerm(w)) ranges.push_back(TermRange{*t, *t + 1});
+    const auto cps = decodeUtf8(w);
+    if (cps.size() >= 3) variants(cps, false, ranges); // в коротком слове опечатка неотличима от другого слова
+    std::vector<uint32_t> allowed;
+    for (const auto& r : ranges) {
+      for (uint32_t t = r.lo; t < r.hi; ++t) allowed.push_back(t);
+    }
+    if (allowed.empty()) return out;
+    fuzzy.words.push_back(std::move(allowed));
+  }
+  if (!last.empty()) {
+    const auto cps = decodeUtf8(last);
+    if (cps.size() >= 3) variants(cps, true, fuzzy.prefix);
+    if (fuzzy.prefix.empty()) return out;
+  }
+  collect(fuzzy, out);
+  return out;
+}
+
+} // namespace routing_core
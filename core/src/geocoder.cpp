@@ -0,0 +1,687 @@
+#include "routing_core/geocoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#include "routing_core/router.h"
+#include "routing_core/segment_index.h"
+#include "routing_core/tile_store.h"
+#include "routing_core/tile_view.h"
+#include "routing_core/tiler.h"
+
+namespace routing_core {
+
+namespace {
+
+// Поиск в два прохода:
+//  1) по колонке name с сортировкой bm25;
+//  2) если имён не хватило — по всем колонкам без сортировки и без bm25: тот
+//     считает IDF по всему списку документов слова, а совпадения только по
+//     адресу и так ранжируются важностью и расстоянием.
+// FTS5 отдаёт строки в порядке rowid и останавливается на LIMIT, а конвертер
+// нумерует объекты по убыванию важности — поэтому первый проход ранжирует
+// не все совпадения (десятки тысяч "Пятёрочек"), а пул из kRankPool первых,
+// самых важных, и время запроса не растёт с размером индекса.
+// Рамка в FTS-запросе — по координатам geo_entities (поиск по rowid дешевле, чем
+// по id в R-tree); CROSS JOIN держит FTS внешним циклом, иначе планировщик
+// перебирает точки и запускает MATCH на каждую.
+std::string searchSql(bool ranked, bool bbox) {
+  std::string match = ranked ? "SELECT geo_fts.rowid AS id, bm25(geo_fts, 4.0, 1.0) AS r FROM geo_fts\n"
+                             : "SELECT geo_fts.rowid AS id, 0.0 AS r FROM geo_fts\n";
+  if (bbox) {
+    match += "  CROSS JOIN geo_entities b ON b.id = geo_fts.rowid\n"
+             "  WHERE geo_fts MATCH ?1 AND b.lat BETWEEN ?3 AND ?5 AND b.lon BETWEEN ?4 AND ?6\n";
+  } else {
+    match += "  WHERE geo_fts MATCH ?1\n";
+  }
+  match += ranked ? "  LIMIT ?7" : "  LIMIT ?2";
+  const std::string pool = ranked ? "(SELECT id, r FROM (" + match + ") ORDER BY r LIMIT ?2)" : "(" + match + ")";
+  return "SELECT e.id, e.kind, e.name, e.street, e.housenumber, e.city, e.postcode, e.category,\n"
+         "       e.lat, e.lon, e.importance, m.r\n"
+         "FROM " + pool + " m\n"
+         "JOIN geo_entities e ON e.id = m.id;";
+}
+
+constexpr int kRankPool = 2000;
+// В рамке пул меньше: близость к центру весит наравне с текстом, а каждый
+// кандидат рамки стоит лишнего чтения geo_entities
+constexpr int kRankPoolBBox = 500;
+
+// Маленькая рамка (экран карты на крупном масштабе): объекты берутся из R-tree
+// и сверяются со словами запроса здесь, без прохода по всем совпадениям FTS.
+const char* kBoxCountSql =
+    "SELECT count(*) FROM (SELECT 1 FROM geo_rtree\n"
+    "  WHERE lat_max >= ?1 AND lat_min <= ?3 AND lon_max >= ?2 AND lon_min <= ?4 LIMIT ?5);";
+const char* kBoxSql =
+    "SELECT e.id, e.kind, e.name, e.street, e.housenumber, e.city, e.postcode, e.category,\n"
+    "       e.lat, e.lon, e.importance\n"
+    "FROM geo_rtree r CROSS JOIN geo_entities e ON e.id = r.id\n"
+    "WHERE r.lat_max >= ?1 AND r.lat_min <= ?3 AND r.lon_max >= ?2 AND r.lon_min <= ?4;";
+constexpr int kBoxScanLimit = 3000;
+
+// Обратный геокодинг: дома и точки улиц вокруг запроса из R-tree
+const char* kNearAddressSql =
+    "SELECT e.id, e.street, e.housenumber, e.city, e.postcode, e.lat, e.lon\n"
+    "FROM geo_rtree r CROSS JOIN geo_entities e ON e.id = r.id\n"
+    "WHERE r.lat_max >= ?1 AND r.lat_min <= ?3 AND r.lon_max >= ?2 AND r.lon_min <= ?4\n"
+    "  AND e.housenumber IS NOT NULL AND e.street IS NOT NULL;";
+const char* kNearStreetSql =
+    "SELECT e.name, e.lat, e.lon\n"
+    "FROM geo_rtree r CROSS JOIN geo_entities e ON e.id = r.id\n"
+    "WHERE r.lat_max >= ?1 AND r.lat_min <= ?3 AND r.lon_max >= ?2 AND r.lon_min <= ?4 AND e.kind = 2;";
+constexpr double kReverseCellDeg = 1e-4;      // клетка кэша ответов, ~11 м по широте
+constexpr size_t kReverseCacheCells = 4096;   // на поколение; старое поколение выбрасывается целиком
+constexpr size_t kReverseTiles = 16;          // индексов именованных рёбер в памяти
+constexpr double kStreetRadiusM = 150.0;
+constexpr double kAddressRadiusM = 80.0;
+constexpr double kStreetPointRadiusM = 300.0; // точки улиц — для пакетов без имён в тайлах
+constexpr double kMetersPerDeg = 111320.0;
+
+// searchBatch: запросы раздаются кусками; потоки не уходят дальше окна от выданного
+// sink, а привязка к дорогам идёт блоками — snapBatch выгоден на многих точках
+constexpr size_t kBatchChunk = 64;
+constexpr size_t kBatchWindow = 8192;
+constexpr size_t kSnapBlock = 1024;
+constexpr double kDegToRad = 3.14159265358979323846 / 180.0;
+constexpr double kImportanceWeight = 2.0;
+constexpr double kExactNameBonus = 3.0;
+constexpr double kPrefixNameBonus = 1.0;
+constexpr double kProximityWeight = 2.0;
+
+// Отсортированы для binary_search
+const char* const kStopwords[] = {
+  "ave", "avenue", "rd", "road", "st", "street",
+  "б", "бульвар", "д", "дом", "корп", "корпус", "наб", "набережная", "пер", "переулок",
+  "пл", "площадь", "пр", "пркт", "проезд", "проспект", "ул", "улица", "ш", "шоссе",
+};
+
+size_t utf8Length(const std::string& s) {
+  size_t n = 0;
+  for (unsigned char c : s) n += (c & 0xC0) != 0x80;
+  return n;
+}
+
+std::vector<std::string> splitTokens(const std::string& normalized) {
+  std::vector<std::string> out;
+  size_t i = 0;
+  while (i < normalized.size()) {
+    size_t j = normalized.find(' ', i);
+    if (j == std::string::npos) j = normalized.size();
+    if (j > i) out.push_back(normalized.substr(i, j - i));
+    i = j + 1;
+  }
+  return out;
+}
+
+std::string columnText(sqlite3_stmt* st, int col) {
+  const auto* t = sqlite3_column_text(st, col);
+  return t ? std::string(reinterpret_cast<const char*>(t)) : std::string();
+}
+
+// Совпадение слов запроса со словами текста по правилам buildMatch. Диакритику,
+// в отличие от unicode61, не снимает — для рамки на экран этого хватает.
+bool hasWord(const std::vector<std::string>& words, const std::string& token, bool prefix) {
+  return std::any_of(words.begin(), words.end(), [&](const std::string& w) {
+    return prefix ? w.compare(0, token.size(), token) == 0 : w == token;
+  });
+}
+
+bool isPrefixToken(const std::vector<std::string>& tokens, size_t i) {
+  return i + 1 == tokens.size() && utf8Length(tokens[i]) >= 2;
+}
+
+// Все слова обязательны; последнее — префикс, пока пользователь его дописывает.
+// Однобуквенный префикс не раскрываем: он совпал бы с половиной индекса.
+// column — ограничить фразы одной колонкой FTS.
+std::string buildMatch(const std::vector<std::string>& tokens, const char* column) {
+  std::string q;
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    if (i) q += ' ';
+    if (column) {
+      q += column;
+      q += " : ";
+    }
+    q += '"';
+    q += tokens[i];
+    q += '"';
+    if (isPrefixToken(tokens, i)) q += '*';
+  }
+  return q;
+}
+
+struct Candidate {
+  GeoResult result;
+  double importance {0.0};
+  double bm25 {0.0}; // отрицательный, меньше — лучше
+};
+
+// Колонки 0..10 — общая часть всех запросов
+Candidate readCandidate(sqlite3_stmt* st) {
+  Candidate c;
+  GeoResult& r = c.result;
+  r.id = sqlite3_column_int64(st, 0);
+  r.kind = static_cast<GeoKind>(sqlite3_column_int(st, 1));
+  r.name = columnText(st, 2);
+  r.street = columnText(st, 3);
+  r.housenumber = columnText(st, 4);
+  r.city = columnText(st, 5);
+  r.postcode = columnText(st, 6);
+  r.category = columnText(st, 7);
+  r.lat = sqlite3_column_double(st, 8);
+  r.lon = sqlite3_column_double(st, 9);
+  c.importance = sqlite3_column_double(st, 10);
+  return c;
+}
+
+void runQuery(sqlite3_stmt* st, const std::string& match, int fetch, const std::optional<GeoBBox>& bbox,
+              std::vector<Candidate>& out) {
+  sqlite3_bind_text(st, 1, match.c_str(), static_cast<int>(match.size()), SQLITE_TRANSIENT);
+  sqlite3_bind_int(st, 2, fetch);
+  if (sqlite3_bind_parameter_count(st) >= 7) sqlite3_bind_int(st, 7, bbox ? kRankPoolBBox : kRankPool);
+  if (bbox) {
+    sqlite3_bind_double(st, 3, bbox->lat_min);
+    sqlite3_bind_double(st, 4, bbox->lon_min);
+    sqlite3_bind_double(st, 5, bbox->lat_max);
+    sqlite3_bind_double(st, 6, bbox->lon_max);
+  }
+  while (sqlite3_step(st) == SQLITE_ROW) {
+    Candidate c = readCandidate(st);
+    c.bm25 = sqlite3_column_double(st, 11);
+    out.push_back(std::move(c));
+  }
+  sqlite3_reset(st);
+  sqlite3_clear_bindings(st);
+}
+
+double distanceDeg(double lat1, double lon1, double lat2, double lon2) {
+  const double dx = (lon2 - lon1) * std::cos((lat1 + lat2) * 0.5 * kDegToRad);
+  const double dy = lat2 - lat1;
+  return std::sqrt(dx * dx + dy * dy);
+}
+
+// Рамка radius_m вокруг точки в параметрах ?1..?4
+void bindBox(sqlite3_stmt* st, double lat, double lon, double radius_m) {
+  const double dLat = radius_m / kMetersPerDeg;
+  const double dLon = dLat / std::max(0.01, std::cos(lat * kDegToRad));
+  sqlite3_bind_double(st, 1, lat - dLat);
+  sqlite3_bind_double(st, 2, lon - dLon);
+  sqlite3_bind_double(st, 3, lat + dLat);
+  sqlite3_bind_double(st, 4, lon + dLon);
+}
+
+} // namespace
+
+// Индексы именованных рёбер по тайлам и кэш ответов reverse()
+struct Geocoder::ReverseState {
+  struct Tile {
+    std::shared_ptr<TileBlob> blob; // nullptr — тайла в пакете нет
+    TileSegmentIndex index;
+    uint64_t used {0};
+  };
+
+  explicit ReverseState(const std::string& db_path) : store(db_path, 0) {}
+  ~ReverseState() {
+    sqlite3_finalize(addresses);
+    sqlite3_finalize(streets);
+  }
+
+  // Индекс строится при первом обращении; вытесняется давно не нужный
+  const Tile& tile(const TileKey& key) {
+    ++tick;
+    auto it = tiles.find(key);
+    if (it == tiles.end()) {
+      if (tiles.size() >= kReverseTiles) {
+        tiles.erase(std::min_element(tiles.begin(), tiles.end(),
+                                     [](const auto& a, const auto& b) { return a.second.used < b.second.used; }));
+      }
+      it = tiles.emplace(key, Tile{}).first;
+      Tile& t = it->second;
+      t.blob = store.load(key.z, key.x, key.y);
+      if (t.blob) {
+        const TileView view(t.blob->buffer);
+        if (view.valid()) t.index.build(view, key, [&](uint32_t ei) { return !view.edgeName(ei).empty(); });
+      }
+    }
+    it->second.used = tick;
+    return it->second;
+  }
+
+  TileStore store; // без своего кэша: нужны только индексы
+  int zoom {14};
+  sqlite3_stmt* addresses {nullptr};
+  sqlite3_stmt* streets {nullptr};
+  std::unordered_map<TileKey, Tile, TileKeyHash> tiles;
+  uint64_t tick {0};
+  std::unordered_map<uint64_t, std::optional<GeoAddress>> cache, older;
+};
+
+std::string normalizeGeoText(const std::string& text) {
+  std::string out;
+  out.reserve(text.size());
+  bool space = true; // не начинать с пробела
+  auto putSpace = [&] {
+    if (!space) { out.push_back(' '); space = true; }
+  };
+  const size_t n = text.size();
+  for (size_t i = 0; i < n; ++i) {
+    const auto c = static_cast<unsigned char>(text[i]);
+    if (c < 0x80) {
+      if (c >= 'A' && c <= 'Z') { out.push_back(static_cast<char>(c + 32)); space = false; }
+      else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) { out.push_back(static_cast<char>(c)); space = false; }
+      else putSpace();
+      continue;
+    }
+    if ((c == 0xD0 || c == 0xD1) && i + 1 < n) {
+      const auto d = static_cast<unsigned char>(text[i + 1]);
+      ++i;
+      space = false;
+      if (c == 0xD0 && d >= 0x90 && d <= 0x9F) { out.push_back('\xD0'); out.push_back(static_cast<char>(d + 0x20)); } // А..П
+      else if (c == 0xD0 && d >= 0xA0 && d <= 0xAF) { out.push_back('\xD1'); out.push_back(static_cast<char>(d - 0x20)); } // Р..Я
+      else if ((c == 0xD0 && d == 0x81) || (c == 0xD1 && d == 0x91)) { out.push_back('\xD0'); out.push_back('\xB5'); } // Ё, ё
+      else { out.push_back(static_cast<char>(c)); out.push_back(static_cast<char>(d)); }
+      continue;
+    }
+    if (c == 0xC2 && i + 1 < n) { // U+0080..U+00BF: «», NBSP, ·
+      ++i;
+      putSpace();
+      continue;
+    }
+    if (c == 0xE2 && i + 2 < n && static_cast<unsigned char>(text[i + 1]) == 0x80) { // U+2000..U+203F: пробелы, тире, кавычки
+      i += 2;
+      putSpace();
+      continue;
+    }
+    out.push_back(static_cast<char>(c));
+    space = false;
+  }
+  if (!out.empty() && out.back() == ' ') out.pop_back();
+  return out;
+}
+
+bool isGeoStopword(const std::string& normalizedWord) {
+  return std::binary_search(std::begin(kStopwords), std::end(kStopwords), normalizedWord,
+                            [](const std::string& a, const std::string& b) { return a < b; });
+}
+
+std::string geoIndexText(const std::string& text) {
+  const std::string normalized = normalizeGeoText(text);
+  std::string out;
+  for (const auto& w : splitTokens(normalized)) {
+    if (isGeoStopword(w)) continue;
+    if (!out.empty()) out += ' ';
+    out += w;
+  }
+  return out.empty() ? normalized : out; // "Набережная улица" — имя целиком из служебных слов
+}
+
+Geocoder::Geocoder(const std::string& db_path) : db_path_(db_path) {
+  if (sqlite3_open_v2(db_path.c_str(), &db_, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+    std::string msg = std::string("Failed to open routingdb: ") + sqlite3_errmsg(db_);
+    sqlite3_close(db_);
+    db_ = nullptr;
+    throw std::runtime_error(msg);
+  }
+  // Без таблиц геокодера (или без FTS5/R-tree в сборке SQLite) подготовка не пройдёт
+  sqlite3_stmt** stmts[] = {&stmt_ranked_, &stmt_ranked_bbox_, &stmt_any_, &stmt_any_bbox_,
+                            &stmt_box_count_, &stmt_box_};
+  bool ok = true;
+  for (int i = 0; i < 4 && ok; ++i) {
+    const std::string sql = searchSql(i < 2, i % 2 == 1);
+    ok = sqlite3_prepare_v3(db_, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, stmts[i], nullptr) == SQLITE_OK;
+  }
+  ok = ok && sqlite3_prepare_v3(db_, kBoxCountSql, -1, SQLITE_PREPARE_PERSISTENT, &stmt_box_count_, nullptr) == SQLITE_OK;
+  ok = ok && sqlite3_prepare_v3(db_, kBoxSql, -1, SQLITE_PREPARE_PERSISTENT, &stmt_box_, nullptr) == SQLITE_OK;
+  if (!ok) {
+    for (auto* st : stmts) {
+      sqlite3_finalize(*st);
+      *st = nullptr;
+    }
+  }
+
+  // Улицы reverse() берёт из тайлов, поэтому он работает и без таблиц геокодера
+  reverse_ = std::make_unique<ReverseState>(db_path);
+  sqlite3_stmt* zoom = nullptr;
+  if (sqlite3_prepare_v2(db_, "SELECT value FROM metadata WHERE key='tile_zoom';", -1, &zoom, nullptr) == SQLITE_OK &&
+      sqlite3_step(zoom) == SQLITE_ROW) {
+    reverse_->zoom = sqlite3_column_int(zoom, 0);
+  }
+  sqlite3_finalize(zoom);
+  if (sqlite3_prepare_v3(db_, kNearAddressSql, -1, SQLITE_PREPARE_PERSISTENT, &reverse_->addresses, nullptr) != SQLITE_OK ||
+      sqlite3_prepare_v3(db_, kNearStreetSql, -1, SQLITE_PREPARE_PERSISTENT, &reverse_->streets, nullptr) != SQLITE_OK) {
+    sqlite3_finalize(reverse_->addresses);
+    reverse_->addresses = nullptr;
+    reverse_->streets = nullptr;
+  }
+}
+
+Geocoder::~Geocoder() {
+  sqlite3_finalize(stmt_ranked_);
+  sqlite3_finalize(stmt_ranked_bbox_);
+  sqlite3_finalize(stmt_any_);
+  sqlite3_finalize(stmt_any_bbox_);
+  sqlite3_finalize(stmt_box_count_);
+  sqlite3_finalize(stmt_box_);
+  reverse_.reset();
+  if (db_) sqlite3_close(db_);
+}
+
+std::vector<GeoResult> Geocoder::search(const std::string& text, const std::optional<GeoBBox>& bbox, size_t limit) {
+  std::vector<GeoResult> out;
+  if (!available() || limit == 0) return out;
+  std::vector<std::string> tokens;
+  const auto words = splitTokens(normalizeGeoText(text));
+  for (const auto& w : words) {
+    if (!isGeoStopword(w)) tokens.push_back(w);
+  }
+  // Запрос из одних служебных слов ("ул") — последнее остаётся префиксом
+  if (tokens.empty() && !words.empty()) tokens.push_back(words.back());
+  if (tokens.empty()) return out;
+  std::string query;
+  for (const auto& t : tokens) query += (query.empty() ? "" : " ") + t;
+
+  // Кандидатов с запасом: bm25 не знает о важности и расстоянии
+  const int fetch = static_cast<int>(std::max<size_t>(limit * 4, 40));
+  std::vector<Candidate> candidates;
+  bool smallBox = false;
+  if (bbox) {
+    auto bindBox = [&](sqlite3_stmt* st) {
+      sqlite3_bind_double(st, 1, bbox->lat_min);
+      sqlite3_bind_double(st, 2, bbox->lon_min);
+      sqlite3_bind_double(st, 3, bbox->lat_max);
+      sqlite3_bind_double(st, 4, bbox->lon_max);
+    };
+    bindBox(stmt_box_count_);
+    sqlite3_bind_int(stmt_box_count_, 5, kBoxScanLimit + 1);
+    if (sqlite3_step(stmt_box_count_) == SQLITE_ROW) smallBox = sqlite3_column_int(stmt_box_count_, 0) <= kBoxScanLimit;
+    sqlite3_reset(stmt_box_count_);
+    if (smallBox) {
+      std::vector<Candidate> inBox;
+      bindBox(stmt_box_);
+      while (sqlite3_step(stmt_box_) == SQLITE_ROW) inBox.push_back(readCandidate(stmt_box_));
+      sqlite3_reset(stmt_box_);
+      // Вместо bm25 — доля слов имени, покрытых запросом (короткое точное имя выше)
+      for (auto& c : inBox) {
+        const GeoResult& r = c.result;
+        const auto nameWords = splitTokens(geoIndexText(r.name));
+        const auto allWords = splitTokens(geoIndexText(r.name + " " + r.street + " " + r.housenumber + " " +
+                                                       r.city + " " + r.postcode));
+        size_t inAll = 0, inName = 0;
+        for (size_t i = 0; i < tokens.size(); ++i) {
+          const bool prefix = isPrefixToken(tokens, i);
+          inAll += hasWord(allWords, tokens[i], prefix);
+          inName += hasWord(nameWords, tokens[i], prefix);
+        }
+        if (inAll < tokens.size()) continue;
+        c.bm25 = -4.0 * static_cast<double>(inName) / static_cast<double>(std::max<size_t>(1, nameWords.size()));
+        candidates.push_back(std::move(c));
+      }
+    }
+  }
+  if (!smallBox) runQuery(bbox ? stmt_ranked_bbox_ : stmt_ranked_, buildMatch(tokens, "name"), fetch, bbox, candidates);
+  if (!smallBox && candidates.size() < limit) {
+    std::vector<Candidate> more;
+    runQuery(bbox ? stmt_any_bbox_ : stmt_any_, buildMatch(tokens, nullptr), fetch, bbox, more);
+    for (auto& c : more) {
+      const bool seen = std::any_of(candidates.begin(), candidates.end(),
+                                    [&](const Candidate& x) { return x.result.id == c.result.id; });
+      if (!seen) candidates.push_back(std::move(c));
+    }
+  }
+
+  double cLat = 0.0, cLon = 0.0, radius = 1.0;
+  if (bbox) {
+    cLat = 0.5 * (bbox->lat_min + bbox->lat_max);
+    cLon = 0.5 * (bbox->lon_min + bbox->lon_max);
+    radius = std::max(1e-6, distanceDeg(cLat, cLon, bbox->lat_max, bbox->lon_max));
+  }
+  out.reserve(candidates.size());
+  for (auto& c : candidates) {
+    GeoResult& r = c.result;
+    double score = -c.bm25 + kImportanceWeight * c.importance;
+    const std::string name = geoIndexText(r.name);
+    if (name == query) score += kExactNameBonus;
+    else if (name.compare(0, query.size(), query) == 0) score += kPrefixNameBonus;
+    if (bbox) {
+      const double d = distanceDeg(cLat, cLon, r.lat, r.lon);
+      score += kProximityWeight * (1.0 - std::min(1.0, d / radius));
+    }
+    r.score = score;
+    out.push_back(std::move(r));
+  }
+
+  const size_t keep = std::min(limit, out.size());
+  std::partial_sort(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(keep), out.end(),
+                    [](const GeoResult& a, const GeoResult& b) {
+                      return a.score != b.score ? a.score > b.score : a.id < b.id;
+                    });
+  out.resize(keep);
+  return out;
+}
+
+std::optional<GeoAddress> Geocoder::reverse(const Coord& at) {
+  ReverseState& rs = *reverse_;
+  const auto qlat = static_cast<int32_t>(std::floor(at.lat / kReverseCellDeg));
+  const auto qlon = static_cast<int32_t>(std::floor(at.lon / kReverseCellDeg));
+  const uint64_t cell = (static_cast<uint64_t>(static_cast<uint32_t>(qlat)) << 32) | static_cast<uint32_t>(qlon);
+  if (auto it = rs.cache.find(cell); it != rs.cache.end()) return it->second;
+  std::optional<GeoAddress> result;
+  if (auto it = rs.older.find(cell); it != rs.older.end()) {
+    result = it->second;
+  } else {
+    // Ответ считается для центра клетки: иначе он зависел бы от того, какая точка пришла первой
+    const double lat = (qlat + 0.5) * kReverseCellDeg;
+    const double lon = (qlon + 0.5) * kReverseCellDeg;
+    auto metersTo = [&](double lat2, double lon2) { return distanceDeg(lat, lon, lat2, lon2) * kMetersPerDeg; };
+
+    // Улица: ближайший сегмент именованного ребра; соседние тайлы — если до края ближе найденного
+    struct Near {
+      std::string name;
+      double lat {0.0}, lon {0.0};
+      double dist {std::numeric_limits<double>::infinity()};
+    } street;
+    auto probe = [&](const TileKey& key) {
+      const auto& t = rs.tile(key);
+      size_t seg = 0;
+      double tt = 0.0, d2 = 0.0;
+      if (!t.blob || !t.index.nearest(lat, lon, seg, tt, d2)) return;
+      const double plat = t.index.projLat(seg, tt), plon = t.index.projLon(seg, tt);
+      const double d = metersTo(plat, plon);
+      if (d >= street.dist) return;
+      street = Near{std::string(TileView(t.blob->buffer).edgeName(t.index.edge[seg])), plat, plon, d};
+    };
+    const WebTileKey wk = webTileKeyFor(lat, lon, rs.zoom);
+    probe(TileKey{wk.z, wk.x, wk.y});
+    double latMin, lonMin, latMax, lonMax;
+    webTileBounds(wk.z, wk.x, wk.y, latMin, lonMin, latMax, lonMax);
+    const double toEdge = std::min({metersTo(latMin, lon), metersTo(latMax, lon), metersTo(lat, lonMin), metersTo(lat, lonMax)});
+    if (street.dist > toEdge && toEdge < kStreetRadiusM) {
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+          if (dx || dy) probe(TileKey{wk.z, wk.x + dx, wk.y + dy});
+        }
+      }
+    }
+    if (street.dist > kStreetRadiusM) street = Near{};
+    if (street.name.empty() && rs.streets) {
+      bindBox(rs.streets, lat, lon, kStreetPointRadiusM);
+      while (sqlite3_step(rs.streets) == SQLITE_ROW) {
+        const double slat = sqlite3_column_double(rs.streets, 1), slon = sqlite3_column_double(rs.streets, 2);
+        const double d = metersTo(slat, slon);
+        if (d <= kStreetPointRadiusM && d < street.dist) street = Near{columnText(rs.streets, 0), slat, slon, d};
+      }
+      sqlite3_reset(rs.streets);
+    }
+
+    // Дом: ближайшая адресная точка
+    GeoAddress house;
+    double houseDist = std::numeric_limits<double>::infinity();
+    if (rs.addresses) {
+      bindBox(rs.addresses, lat, lon, kAddressRadiusM);
+      while (sqlite3_step(rs.addresses) == SQLITE_ROW) {
+        const double hlat = sqlite3_column_double(rs.addresses, 5), hlon = sqlite3_column_double(rs.addresses, 6);
+        const double d = metersTo(hlat, hlon);
+        if (d > kAddressRadiusM || d >= houseDist) continue;
+        houseDist = d;
+        house.id = sqlite3_column_int64(rs.addresses, 0);
+        house.street = columnText(rs.addresses, 1);
+        house.housenumber = columnText(rs.addresses, 2);
+        house.city = columnText(rs.addresses, 3);
+        house.postcode = columnText(rs.addresses, 4);
+        house.lat = hlat;
+        house.lon = hlon;
+        house.distance_m = d;
+      }
+      sqlite3_reset(rs.addresses);
+    }
+
+    // Дом на другой улице берётся, только если он ближе дороги (точка на здании, а не на проезжей части)
+    const bool sameStreet = house.id && !street.name.empty() && geoIndexText(house.street) == geoIndexText(street.name);
+    if (house.id && (street.name.empty() || sameStreet || houseDist <= street.dist)) {
+      result = std::move(house);
+    } else if (!street.name.empty()) {
+      GeoAddress a;
+      a.street = street.name;
+      a.city = house.city; // город ближайшего дома, если он есть
+      a.lat = street.lat;
+      a.lon = street.lon;
+      a.distance_m = street.dist;
+      result = std::move(a);
+    }
+    if (result) {
+      result->formatted = result->street;
+      for (const std::string* part : {&result->housenumber, &result->city}) {
+        if (!part->empty()) result->formatted += ", " + *part;
+      }
+    }
+  }
+  if (rs.cache.size() >= kReverseCacheCells) {
+    rs.older = std::move(rs.cache);
+    rs.cache.clear();
+  }
+  rs.cache.emplace(cell, result);
+  return result;
+}
+
+void Geocoder::searchBatch(const std::vector<std::string>& queries, const GeoBatchOptions& options,
+                           const std::function<void(size_t, GeoBatchItem&&)>& sink) {
+  const size_t n = queries.size();
+  if (n == 0) return;
+  const unsigned cores = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+  const size_t threads = std::min<size_t>(cores, (n + kBatchChunk - 1) / kBatchChunk);
+  while (workers_.size() < threads) workers_.push_back(std::make_unique<Geocoder>(db_path_));
+
+  std::vector<GeoBatchItem> items(n);
+  std::vector<uint8_t> done(n, 0);
+  std::mutex m;
+  std::condition_variable ready, space;
+  size_t next = 0, emitted = 0;
+  bool stop = false;
+  std::mutex cacheMutex;
+  std::unordered_map<std::string, std::vector<GeoResult>> cache; // нормализованный запрос -> ответ
+
+  auto work = [&](Geocoder& g) {
+    for (;;) {
+      size_t begin;
+      {
+        std::unique_lock<std::mutex> lk(m);
+        space.wait(lk, [&] { return stop || next >= n || next < emitted + kBatchWindow; });
+        if (stop || next >= n) return;
+        begin = next;
+        next += kBatchChunk;
+      }
+      const size_t end = std::min(n, begin + kBatchChunk);
+      for (size_t i = begin; i < end; ++i) {
+        const std::string key = normalizeGeoText(queries[i]);
+        {
+          std::lock_guard<std::mutex> lk(cacheMutex);
+          if (auto it = cache.find(key); it != cache.end()) {
+            items[i].results = it->second;
+            continue;
+          }
+        }
+        items[i].results = g.search(queries[i], options.bbox, options.limit);
+        std::lock_guard<std::mutex> lk(cacheMutex);
+        cache.emplace(key, items[i].results);
+      }
+      {
+        std::lock_guard<std::mutex> lk(m);
+        std::fill(done.begin() + static_cast<std::ptrdiff_t>(begin), done.begin() + static_cast<std::ptrdiff_t>(end), 1);
+      }
+      ready.notify_one();
+    }
+  };
+  std::vector<std::thread> pool;
+  pool.reserve(threads);
+  for (size_t t = 0; t < threads; ++t) pool.emplace_back(work, std::ref(*workers_[t]));
+  auto finish = [&] {
+    {
+      std::lock_guard<std::mutex> lk(m);
+      stop = true;
+    }
+    space.notify_all();
+    for (auto& t : pool) t.join();
+  };
+
+  const bool snap = options.snapRouter && options.snapProfile;
+  try {
+    size_t from = 0;
+    while (from < n) {
+      // Готовый префикс; для привязки — целый блок, чтобы snapBatch не звался на единицах точек
+      const size_t want = snap ? std::min(n, from + kSnapBlock) : from + 1;
+      size_t to = from;
+      {
+        std::unique_lock<std::mutex> lk(m);
+        ready.wait(lk, [&] {
+          while (to < n && done[to]) ++to;
+          return to >= want;
+        });
+      }
+      if (snap) {
+        std::vector<Coord> points;
+        std::vector<size_t> owners;
+        for (size_t i = from; i < to; ++i) {
+          if (items[i].results.empty()) continue;
+          points.push_back(Coord{items[i].results.front().lat, items[i].results.front().lon});
+          owners.push_back(i);
+        }
+        if (!points.empty()) {
+          const SnapBatchResult s = options.snapRouter->snapBatch(*options.snapProfile, points);
+          for (size_t k = 0; k < owners.size(); ++k) {
+            GeoBatchItem& item = items[owners[k]];
+            item.edge_id = s.edge_ids[k];
+            if (item.edge_id == kNoEdge) continue;
+            item.snap_lat = s.projected[k].lat;
+            item.snap_lon = s.projected[k].lon;
+            item.snap_distance_m = s.distances_m[k];
+          }
+        }
+      }
+      for (size_t i = from; i < to; ++i) sink(i, std::move(items[i]));
+      {
+        std::lock_guard<std::mutex> lk(m);
+        emitted = to;
+      }
+      space.notify_all();
+      from = to;
+    }
+  } catch (...) {
+    finish();
+    throw;
+  }
+  finish();
+}
+
+std::vector<GeoBatchItem> Geocoder::searchBatch(const std::vector<std::string>& queries, const GeoBatchOptions& options) {
+  std::vector<GeoBatchItem> out(queries.size());
+  searchBatch(queries, options, [&](size_t i, GeoBatchItem&& item) { out[i] = std::move(item); });
+  return out;
+}
+
+} // namespace routing_core
@@ -0,0 +1,162 @@
+#include "routing_core/metrics.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+
+namespace routing_core {
+
+size_t metricShardIndex() {
+  static std::atomic<size_t> next {0};
+  thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+  return index;
+}
+
+uint64_t Counter::value() const {
+  uint64_t sum = 0;
+  for (const auto& s : shards_) sum += s.value.load(std::memory_order_relaxed);
+  return sum;
+}
+
+Histogram::Histogram(std::vector<double> bounds) : bounds_(std::move(bounds)) {
+  std::sort(bounds_.begin(), bounds_.end());
+  bounds_.erase(std::unique(bounds_.begin(), bounds_.end()), bounds_.end());
+  for (auto& s : shards_) {
+    s.buckets = std::make_unique<std::atomic<uint64_t>[]>(bounds_.size() + 1);
+  }
+}
+
+void Histogram::observe(double v) {
+  // le: первая граница, не меньшая значения; за последней — +Inf
+  const size_t bucket = static_cast<size_t>(std::lower_bound(bounds_.begin(), bounds_.end(), v) - bounds_.begin());
+  Shard& s = shards_[metricShardIndex()];
+  s.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  s.sum.fetch_add(v, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+  Snapshot out;
+  out.buckets.assign(bounds_.size() + 1, 0);
+  for (const auto& s : shards_) {
+    for (size_t i = 0; i < out.buckets.size(); ++i) out.buckets[i] += s.buckets[i].load(std::memory_order_relaxed);
+    out.sum += s.sum.load(std::memory_order_relaxed);
+  }
+  for (uint64_t n : out.buckets) out.count += n;
+  return out;
+}
+
+std::vector<double> Histogram::exponentialBuckets(double start, double factor, size_t count) {
+  std::vector<double> out;
+  out.reserve(count);
+  for (double b = start; out.size() < count; b *= factor) out.push_back(b);
+  return out;
+}
+
+MetricsRegistry::Series& MetricsRegistry::series(const std::string& name, const std::string& help, Type type,
+                                                 const std::string& labels) {
+  auto it = std::find_if(families_.begin(), families_.end(), [&](const auto& f) { return f->name == name; });
+  if (it == families_.end()) {
+    families_.push_back(std::make_unique<Family>(Family{name, help, type, {}}));
+    it = families_.end() - 1;
+  } else if ((*it)->type != type) {
+    throw std::runtime_error("metric " + name + " is already registered with another type");
+  }
+  auto& list = (*it)->series;
+  auto s = std::find_if(list.begin(), list.end(), [&](const Series& x) { return x.labels == labels; });
+  if (s != list.end()) return *s;
+  list.push_back(Series{labels, nullptr, nullptr, nullptr});
+  return list.back();
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Series& s = series(name, help, Type::COUNTER, labels);
+  if (!s.counter) s.counter = std::make_unique<Counter>();
+  return *s.counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Series& s = series(name, help, Type::GAUGE, labels);
+  if (!s.gauge) s.gauge = std::make_unique<Gauge>();
+  return *s.gauge;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, std::vector<double> bounds,
+                                      const std::string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Series& s = series(name, help, Type::HISTOGRAM, labels);
+  if (!s.histogram) s.histogram = std::make_unique<Histogram>(std::move(bounds));
+  return *s.histogram;
+}
+
+namespace {
+
+void appendNumber(std::string& out, double v) {
+  if (std::isinf(v)) { out += v > 0 ? "+Inf" : "-Inf"; return; }
+  if (std::isnan(v)) { out += "NaN"; return; }
+  char buf[32];
+  auto [p, ec] = std::to_chars(buf, buf + sizeof(buf), v);
+  out.append(buf, ec == std::errc() ? p : buf);
+}
+
+void appendNumber(std::string& out, uint64_t v) {
+  char buf[24];
+  auto [p, ec] = std::to_chars(buf, buf + sizeof(buf), v);
+  out.append(buf, ec == std::errc() ? p : buf);
+}
+
+// name{labels,extra} — extra уже в виде le="..."
+void appendSeries(std::string& out, const std::string& name, const char* suffix, const std::string& labels,
+                  const std::string& extra = {}) {
+  out += name;
+  out += suffix;
+  if (labels.empty() && extra.empty()) { out += ' '; return; }
+  out += '{';
+  out += labels;
+  if (!labels.empty() && !extra.empty()) out += ',';
+  out += extra;
+  out += "} ";
+}
+
+} // namespace
+
+void MetricsRegistry::renderPrometheus(std::string& out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& f : families_) {
+    out += "# HELP " + f->name + ' ' + f->help + '\n';
+    out += "# TYPE " + f->name + ' ';
+    out += f->type == Type::COUNTER ? "counter\n" : f->type == Type::GAUGE ? "gauge\n" : "histogram\n";
+    for (const auto& s : f->series) {
+      if (s.counter) {
+        appendSeries(out, f->name, "", s.labels);
+        appendNumber(out, s.counter->value());
+      } else if (s.gauge) {
+        appendSeries(out, f->name, "", s.labels);
+        out += std::to_string(s.gauge->value());
+      } else if (s.histogram) {
+        const auto snap = s.histogram->snapshot();
+        const auto& bounds = s.histogram->bounds();
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i <= bounds.size(); ++i) {
+          cumulative += snap.buckets[i];
+          std::string le = "le=\"";
+          if (i < bounds.size()) appendNumber(le, bounds[i]); else le += "+Inf";
+          le += '"';
+          appendSeries(out, f->name, "_bucket", s.labels, le);
+          appendNumber(out, cumulative);
+          out += '\n';
+        }
+        appendSeries(out, f->name, "_sum", s.labels);
+        appendNumber(out, snap.sum);
+        out += '\n';
+        appendSeries(out, f->name, "_count", s.labels);
+        appendNumber(out, cumulative);
+      }
+      out += '\n';
+    }
+  }
+}
+
+} // namespace routing_core
@@ -0,0 +1,324 @@
+#include "routing_core/open_water.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#include <flatbuffers/flatbuffers.h>
+#include "land_tile_generated.h"
+
+namespace routing_core {
+
+namespace {
+
+constexpr int kMaxWaterDepth = 16;
+// Шаг за границу узла при поиске соседа: меньше ячейки любой допустимой глубины
+constexpr double kEps = 1.0 / (1 << (kMaxWaterDepth + 4));
+
+double haversine(double lat1, double lon1, double lat2, double lon2) {
+  constexpr double R = 6371000.0;
+  const double p1 = lat1 * M_PI / 180.0;
+  const double p2 = lat2 * M_PI / 180.0;
+  const double dphi = (lat2 - lat1) * M_PI / 180.0;
+  const double dl = (lon2 - lon1) * M_PI / 180.0;
+  const double a = std::sin(dphi / 2) * std::sin(dphi / 2) + std::cos(p1) * std::cos(p2) * std::sin(dl / 2) * std::sin(dl / 2);
+  return R * 2 * std::atan2(std::sqrt(a), std::sqrt(1 - a));
+}
+
+} // namespace
+
+WaterQuadtree::WaterQuadtree(uint8_t depth, const uint8_t* cells, size_t size) : depth_(depth) {
+  if (depth > kMaxWaterDepth || !cells || size == 0) {
+    valid_ = false;
+    return;
+  }
+  size_t pos = 0;
+  root_ = decode(cells, size, pos, 0, 0, side());
+}
+
+int32_t WaterQuadtree::decode(const uint8_t* cells, size_t size, size_t& pos, uint32_t x, uint32_t y, uint32_t s) {
+  if (pos >= size * 4) {
+    valid_ = false;
+    return -1;
+  }
+  const uint8_t code = (cells[pos >> 2] >> ((pos & 3) * 2)) & 3;
+  ++pos;
+  if (code == 0) return -1;
+  if (code == 1) {
+    leaves_.push_back(Leaf{x, y, s});
+    return -2 - static_cast<int32_t>(leaves_.size() - 1);
+  }
+  if (code != 2 || s == 1) {
+    valid_ = false;
+    return -1;
+  }
+  const int32_t idx = static_cast<int32_t>(nodes_.size());
+  nodes_.push_back({-1, -1, -1, -1});
+  const uint32_t h = s / 2;
+  const int32_t nw = decode(cells, size, pos, x, y, h);
+  const int32_t ne = decode(cells, size, pos, x + h, y, h);
+  const int32_t sw = decode(cells, size, pos, x, y + h, h);
+  const int32_t se = decode(cells, size, pos, x + h, y + h, h);
+  nodes_[static_cast<size_t>(idx)] = {nw, ne, sw, se};
+  return idx;
+}
+
+WaterQuadtree::Cell WaterQuadtree::find(uint32_t x, uint32_t y) const {
+  Cell c{-1, 0, 0, side()};
+  int32_t slot = root_;
+  while (slot >= 0) {
+    const uint32_t h = c.size / 2;
+    const int q = (x >= c.x + h ? 1 : 0) + (y >= c.y + h ? 2 : 0);
+    if (q & 1) c.x += h;
+    if (q & 2) c.y += h;
+    c.size = h;
+    slot = nodes_[static_cast<size_t>(slot)][static_cast<size_t>(q)];
+  }
+  c.leaf = slot == -1 ? -1 : -2 - slot;
+  return c;
+}
+
+const OpenWaterPlanner::Tile* OpenWaterPlanner::tile(int x, int y) {
+  const uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+  auto it = tiles_.find(key);
+  if (it != tiles_.end()) return it->second.get();
+
+  std::unique_ptr<Tile> t;
+  if (auto blob = store_.load(zoom_, x, y)) {
+    const auto* root = flatbuffers::GetRoot<Routing::LandTile>(blob->buffer->data());
+    if (root && root->water_cells() && root->water_cells()->size() > 0) {
+      t.reset(new Tile{static_cast<uint32_t>(byId_.size()), x, y,
+                       WaterQuadtree(root->water_depth(), root->water_cells()->data(), root->water_cells()->size())});
+      if (t->tree.valid()) byId_.push_back(t.get());
+      else t.reset();
+    }
+  }
+  return tiles_.emplace(key, std::move(t)).first->second.get();
+}
+
+OpenWaterPlanner::Hit OpenWaterPlanner::locate(double u, double v) {
+  const int tx = static_cast<int>(std::floor(u));
+  const int ty = static_cast<int>(std::floor(v));
+  Hit h;
+  h.u0 = tx; h.v0 = ty; h.u1 = tx + 1; h.v1 = ty + 1;
+  const int n = 1 << zoom_;
+  if (tx < 0 || ty < 0 || tx >= n || ty >= n) return h;
+  if (maxX_ >= minX_ && (tx < minX_ || tx > maxX_ || ty < minY_ || ty > maxY_)) return h;
+  const Tile* t = tile(tx, ty);
+  if (!t) return h;
+  const uint32_t side = t->tree.side();
+  const double s = static_cast<double>(side);
+  const uint32_t cx = std::min(side - 1, static_cast<uint32_t>((u - tx) * s));
+  const uint32_t cy = std::min(side - 1, static_cast<uint32_t>((v - ty) * s));
+  const WaterQuadtree::Cell c = t->tree.find(cx, cy);
+  h.tile = t;
+  h.leaf = c.leaf;
+  h.u0 = tx + c.x / s;
+  h.v0 = ty + c.y / s;
+  h.u1 = tx + (c.x + c.size) / s;
+  h.v1 = ty + (c.y + c.size) / s;
+  return h;
+}
+
+void OpenWaterPlanner::neighbours(double u0, double v0, double u1, double v1, std::vector<Hit>& out) {
+  // Вдоль стороны шагаем до конца найденного узла: крупный сосед — одна проба
+  for (int sideIdx = 0; sideIdx < 4; ++sideIdx) {
+    const bool alongV = sideIdx < 2; // запад/восток
+    const double fixed = sideIdx == 0 ? u0 - kEps : sideIdx == 1 ? u1 + kEps : sideIdx == 2 ? v0 - kEps : v1 + kEps;
+    double p = alongV ? v0 : u0;
+    const double end = alongV ? v1 : u1;
+    while (p < end) {
+      const Hit h = alongV ? locate(fixed, p + kEps) : locate(p + kEps, fixed);
+      if (h.leaf >= 0) out.push_back(h);
+      const double next = alongV ? h.v1 : h.u1;
+      p = next > p ? next : end;
+    }
+  }
+  for (const auto& [u, v] : {std::pair{u0 - kEps, v0 - kEps}, std::pair{u1 + kEps, v0 - kEps},
+                             std::pair{u0 - kEps, v1 + kEps}, std::pair{u1 + kEps, v1 + kEps}}) {
+    const Hit h = locate(u, v);
+    if (h.leaf >= 0) out.push_back(h);
+  }
+}
+
+double OpenWaterPlanner::metres(double ua, double va, double ub, double vb) const {
+  // Масштаб Меркатора у средней широты отрезка: для шагов между соседними листьями точен
+  const double n = std::ldexp(1.0, zoom_);
+  const double cosLat = 1.0 / std::cosh(M_PI * (1.0 - (va + vb) / n));
+  return std::hypot(ub - ua, vb - va) * (2.0 * M_PI * 6371000.0 / n) * cosLat;
+}
+
+bool OpenWaterPlanner::lineOfSight(double ua, double va, double ub, double vb) {
+  const double du = ub - ua, dv = vb - va;
+  const double len = std::hypot(du, dv);
+  if (len == 0.0) return locate(ua, va).leaf >= 0;
+  const double eu = du / len * kEps, ev = dv / len * kEps;
+  double t = 0.0;
+  // Отрезок проходит узлы дерева по очереди: проба чуть за точкой выхода из предыдущего
+  for (size_t step = 0; step < kMaxSettled; ++step) {
+    const Hit h = locate(ua + du * t + eu, va + dv * t + ev);
+    if (h.leaf < 0) return false;
+    double exit = std::numeric_limits<double>::infinity();
+    if (du > 0) exit = std::min(exit, (h.u1 - ua) / du);
+    else if (du < 0) exit = std::min(exit, (h.u0 - ua) / du);
+    if (dv > 0) exit = std::min(exit, (h.v1 - va) / dv);
+    else if (dv < 0) exit = std::min(exit, (h.v0 - va) / dv);
+    if (exit >= 1.0) return true;
+    t = std::max(exit, t);
+  }
+  return false;
+}
+
+bool OpenWaterPlanner::isWater(const Coord& c) {
+  const double n = std::ldexp(1.0, zoom_);
+  const double r = c.lat * M_PI / 180.0;
+  return locate((c.lon + 180.0) / 360.0 * n, (1.0 - std::log(std::tan(r) + 1.0 / std::cos(r)) / M_PI) / 2.0 * n).leaf >= 0;
+}
+
+bool OpenWaterPlanner::search(const Hit& start, const Hit& goal, double ua, double va, double ub, double vb,
+                              double minSize, std::vector<std::pair<double, double>>& path, size_t& settled) {
+  auto keyOf = [](const Hit& h) { return (static_cast<uint64_t>(h.tile->id) << 32) | static_cast<uint32_t>(h.leaf); };
+  const uint64_t startKey = keyOf(start);
+  const uint64_t goalKey = keyOf(goal);
+  const double near = 4.0 * minSize;
+  auto allowed = [&](const Hit& h) {
+    if (h.u1 - h.u0 >= minSize) return true;
+    const double cu = 0.5 * (h.u0 + h.u1), cv = 0.5 * (h.v0 + h.v1);
+    return std::max(std::abs(cu - ua), std::abs(cv - va)) <= near ||
+           std::max(std::abs(cu - ub), std::abs(cv - vb)) <= near;
+  };
+
+  // A* по листьям; позиция листа — центр, у стартового и финишного — сами точки
+  struct State {
+    double u, v, g;
+    uint64_t parent;
+    bool closed;
+  };
+  std::unordered_map<uint64_t, State> states;
+  states.reserve(4096);
+  using QE = std::pair<double, uint64_t>;
+  std::priority_queue<QE, std::vector<QE>, std::greater<QE>> open;
+  states[startKey] = State{ua, va, 0.0, startKey, false};
+  open.push({metres(ua, va, ub, vb), startKey});
+  std::vector<Hit> around;
+  settled = 0;
+  bool found = false;
+  while (!open.empty()) {
+    const uint64_t k = open.top().second;
+    open.pop();
+    State& cur = states[k];
+    if (cur.closed) continue;
+    cur.closed = true;
+    if (k == goalKey) {
+      found = true;
+      break;
+    }
+    if (++settled > kMaxSettled) break;
+    const double cu = cur.u, cv = cur.v, cg = cur.g;
+    const Tile* t = byId_[static_cast<size_t>(k >> 32)];
+    const auto& leaf = t->tree.leaves()[static_cast<size_t>(k & 0xffffffffu)];
+    const double s = t->tree.side();
+    around.clear();
+    neighbours(t->x + leaf.x / s, t->y + leaf.y / s, t->x + (leaf.x + leaf.size) / s, t->y + (leaf.y + leaf.size) / s,
+               around);
+    for (const Hit& h : around) {
+      const uint64_t nk = keyOf(h);
+      if (nk != goalKey && !allowed(h)) continue;
+      const double nu = nk == goalKey ? ub : 0.5 * (h.u0 + h.u1);
+      const double nv = nk == goalKey ? vb : 0.5 * (h.v0 + h.v1);
+      const double g = cg + metres(cu, cv, nu, nv);
+      auto it = states.find(nk);
+      if (it == states.end()) {
+        it = states.emplace(nk, State{nu, nv, std::numeric_limits<double>::infinity(), 0, false}).first;
+      } else if (it->second.closed || it->second.g <= g) {
+        continue;
+      }
+      it->second.g = g;
+      it->second.parent = k;
+      open.push({g + metres(nu, nv, ub, vb), nk});
+    }
+  }
+  if (!found) return false;
+
+  path.clear();
+  for (uint64_t k = goalKey;; k = states[k].parent) {
+    path.push_back({states[k].u, states[k].v});
+    if (k == startKey) break;
+  }
+  std::reverse(path.begin(), path.end());
+  if (path.size() == 1) path.push_back({ub, vb});
+  return true;
+}
+
+RouteResult OpenWaterPlanner::route(const Coord& from, const Coord& to, double speed_mps) {
+  RouteResult rr;
+  lastSettled_ = 0;
+  if (tiles_.size() > kMaxCachedTiles) {
+    tiles_.clear();
+    byId_.clear();
+  }
+  const double n = std::ldexp(1.0, zoom_);
+  auto toU = [&](const Coord& c) { return (c.lon + 180.0) / 360.0 * n; };
+  auto toV = [&](const Coord& c) {
+    const double r = c.lat * M_PI / 180.0;
+    return (1.0 - std::log(std::tan(r) + 1.0 / std::cos(r)) / M_PI) / 2.0 * n;
+  };
+  const double ua = toU(from), va = toV(from), ub = toU(to), vb = toV(to);
+
+  // Рамка тайлов: обход мыса или острова может уйти от прямой на половину её длины
+  const int ax = static_cast<int>(std::floor(ua)), ay = static_cast<int>(std::floor(va));
+  const int bx = static_cast<int>(std::floor(ub)), by = static_cast<int>(std::floor(vb));
+  const int frame = 2 + std::max(std::abs(bx - ax), std::abs(by - ay)) / 2;
+  minX_ = std::min(ax, bx) - frame; maxX_ = std::max(ax, bx) + frame;
+  minY_ = std::min(ay, by) - frame; maxY_ = std::max(ay, by) + frame;
+  struct FrameReset {
+    OpenWaterPlanner* p;
+    ~FrameReset() { p->maxX_ = p->minX_ - 1; }
+  } frameReset{this};
+
+  const Hit start = locate(ua, va);
+  const Hit goal = locate(ub, vb);
+  if (start.leaf < 0 || goal.leaf < 0) {
+    rr.status = RouteStatus::NO_ROUTE;
+    rr.error_message = "point is not in open water";
+    return rr;
+  }
+  // Грубо-точно: сначала только крупные листья (мелкие — лишь у концов маршрута,
+  // чтобы выйти от берега), мелкие подключаются, если узкий проход необходим
+  std::vector<std::pair<double, double>> path;
+  size_t settled = 0;
+  bool found = false;
+  for (const double minSize : {1.0 / 16, 1.0 / 128, 0.0}) {
+    found = search(start, goal, ua, va, ub, vb, minSize, path, settled);
+    lastSettled_ += settled;
+    if (found) break;
+  }
+  if (!found) {
+    rr.status = RouteStatus::NO_ROUTE;
+    rr.error_message = settled > kMaxSettled ? "open-water search limit reached" : "no open-water path";
+    return rr;
+  }
+
+  // String pulling: от опорной точки тянем прямую как можно дальше по пути
+  std::vector<std::pair<double, double>> pulled{path.front()};
+  size_t anchor = 0;
+  for (size_t i = 2; i < path.size(); ++i) {
+    if (lineOfSight(path[anchor].first, path[anchor].second, path[i].first, path[i].second)) continue;
+    anchor = i - 1;
+    pulled.push_back(path[anchor]);
+  }
+  pulled.push_back(path.back());
+
+  for (const auto& [u, v] : pulled) {
+    const Coord c{std::atan(std::sinh(M_PI * (1.0 - 2.0 * v / n))) * 180.0 / M_PI, u / n * 360.0 - 180.0};
+    if (!rr.polyline.empty()) rr.distance_m += haversine(rr.polyline.back().lat, rr.polyline.back().lon, c.lat, c.lon);
+    rr.polyline.push_back(c);
+  }
+  rr.duration_s = speed_mps > 0.0 ? rr.distance_m / speed_mps : 0.0;
+  rr.status = RouteStatus::OK;
+  return rr;
+}
+
+} // namespace routing_core
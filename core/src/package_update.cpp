@@ -0,0 +1,219 @@
+#include "routing_core/package_update.h"
+
+#include <sqlite3.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "routing_core/checksum.h"
+#include "routing_core/tile_delta.h"
+
+namespace routing_core {
+
+namespace {
+
+class Db {
+public:
+  explicit Db(const std::string& path) {
+    if (sqlite3_open_v2(path.c_str(), &db_, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+      std::string msg = std::string("Failed to open routingdb: ") + sqlite3_errmsg(db_);
+      sqlite3_close(db_);
+      db_ = nullptr;
+      throw std::runtime_error(msg);
+    }
+  }
+  ~Db() { if (db_) sqlite3_close(db_); }
+
+  void exec(const std::string& sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+      std::string msg = "SQLite error: ";
+      if (err) { msg += err; sqlite3_free(err); }
+      throw std::runtime_error(msg);
+    }
+  }
+
+  sqlite3_stmt* prepare(const char* sql) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+      throw std::runtime_error(std::string("Failed to prepare statement: ") + sqlite3_errmsg(db_));
+    }
+    return stmt;
+  }
+
+  void stepDone(sqlite3_stmt* stmt) {
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    if (rc != SQLITE_DONE) throw std::runtime_error(std::string("SQLite step failed: ") + sqlite3_errmsg(db_));
+  }
+
+  sqlite3* handle() const { return db_; }
+
+private:
+  sqlite3* db_ {nullptr};
+};
+
+struct Stmt {
+  sqlite3_stmt* s {nullptr};
+  explicit Stmt(sqlite3_stmt* st) : s(st) {}
+  ~Stmt() { if (s) sqlite3_finalize(s); }
+};
+
+std::string metadataValue(Db& db, const char* table, const char* key) {
+  std::string sql = std::string("SELECT value FROM ") + table + " WHERE key=?;";
+  Stmt st(db.prepare(sql.c_str()));
+  sqlite3_bind_text(st.s, 1, key, -1, SQLITE_TRANSIENT);
+  std::string out;
+  if (sqlite3_step(st.s) == SQLITE_ROW && sqlite3_column_text(st.s, 0)) {
+    out = reinterpret_cast<const char*>(sqlite3_column_text(st.s, 0));
+  }
+  return out;
+}
+
+std::string quoteSql(const std::string& s) {
+  std::string out = "'";
+  for (char c : s) { if (c == '\'') out += '\''; out += c; }
+  out += '\'';
+  return out;
+}
+
+bool hasTable(Db& db, const char* schema, const char* table) {
+  Stmt st(db.prepare((std::string("SELECT 1 FROM ") + schema + ".sqlite_master WHERE type='table' AND name=?;").c_str()));
+  sqlite3_bind_text(st.s, 1, table, -1, SQLITE_TRANSIENT);
+  return sqlite3_step(st.s) == SQLITE_ROW;
+}
+
+// Тайлы таблицы deltaTable (схема delta_tiles) в mainTable; checksum каждого проверяется
+void applyTiles(Db& db, const std::string& deltaTable, const std::string& mainTable, DeltaApplyResult& res) {
+  Stmt sel(db.prepare((std::string(
+      "SELECT z,x,y,op,lat_min,lon_min,lat_max,lon_max,version,checksum,profile_mask,base_checksum,data "
+      "FROM ") + deltaTable + ";").c_str()));
+  Stmt cur_blob(db.prepare(("SELECT data FROM " + mainTable + " WHERE z=? AND x=? AND y=?;").c_str()));
+  Stmt upsert(db.prepare(("INSERT INTO " + mainTable +
+      "(z,x,y,lat_min,lon_min,lat_max,lon_max,version,checksum,profile_mask,data) "
+      "VALUES(?,?,?,?,?,?,?,?,?,?,?) "
+      "ON CONFLICT(z,x,y) DO UPDATE SET version=excluded.version, checksum=excluded.checksum, "
+      "profile_mask=excluded.profile_mask, data=excluded.data;").c_str()));
+  Stmt del(db.prepare(("DELETE FROM " + mainTable + " WHERE z=? AND x=? AND y=?;").c_str()));
+
+  std::vector<uint8_t> patched;
+  int rc;
+  while ((rc = sqlite3_step(sel.s)) == SQLITE_ROW) {
+    const int z = sqlite3_column_int(sel.s, 0);
+    const int x = sqlite3_column_int(sel.s, 1);
+    const int y = sqlite3_column_int(sel.s, 2);
+    const auto op = static_cast<DeltaOp>(sqlite3_column_int(sel.s, 3));
+    const auto* checksumText = sqlite3_column_text(sel.s, 9);
+    const std::string checksum = checksumText ? reinterpret_cast<const char*>(checksumText) : "";
+    const auto* data = static_cast<const uint8_t*>(sqlite3_column_blob(sel.s, 12));
+    const size_t dataSize = static_cast<size_t>(sqlite3_column_bytes(sel.s, 12));
+
+    if (op == DeltaOp::REMOVE) {
+      sqlite3_bind_int(del.s, 1, z);
+      sqlite3_bind_int(del.s, 2, x);
+      sqlite3_bind_int(del.s, 3, y);
+      db.stepDone(del.s);
+      ++res.removed;
+      continue;
+    }
+
+    const uint8_t* blob = data;
+    size_t blobSize = dataSize;
+    if (op == DeltaOp::PATCH) {
+      sqlite3_bind_int(cur_blob.s, 1, z);
+      sqlite3_bind_int(cur_blob.s, 2, x);
+      sqlite3_bind_int(cur_blob.s, 3, y);
+      if (sqlite3_step(cur_blob.s) != SQLITE_ROW) {
+        sqlite3_reset(cur_blob.s);
+        throw std::runtime_error("patch base tile missing");
+      }
+      const auto* base = static_cast<const uint8_t*>(sqlite3_column_blob(cur_blob.s, 0));
+      const size_t baseSize = static_cast<size_t>(sqlite3_column_bytes(cur_blob.s, 0));
+      const auto* baseChecksum = sqlite3_column_text(sel.s, 11);
+      const bool baseOk = baseChecksum &&
+          sha256Hex(base, baseSize) == reinterpret_cast<const char*>(baseChecksum);
+      const bool applied = baseOk && applyBinaryDelta(base, baseSize, data, dataSize, patched);
+      sqlite3_reset(cur_blob.s);
+      if (!baseOk) throw std::runtime_error("patch base checksum mismatch");
+      if (!applied) throw std::runtime_error("corrupted binary delta");
+      blob = patched.data();
+      blobSize = patched.size();
+    } else if (op != DeltaOp::PUT) {
+      throw std::runtime_error("unknown delta op");
+    }
+    if (!blob || blobSize == 0 || sha256Hex(blob, blobSize) != checksum) {
+      throw std::runtime_error("tile checksum mismatch");
+    }
+
+    sqlite3_bind_int(upsert.s, 1, z);
+    sqlite3_bind_int(upsert.s, 2, x);
+    sqlite3_bind_int(upsert.s, 3, y);
+    for (int c = 4; c <= 7; ++c) sqlite3_bind_double(upsert.s, c, sqlite3_column_double(sel.s, c));
+    sqlite3_bind_int(upsert.s, 8, sqlite3_column_int(sel.s, 8));
+    sqlite3_bind_text(upsert.s, 9, checksum.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(upsert.s, 10, sqlite3_column_int(sel.s, 10));
+    sqlite3_bind_blob(upsert.s, 11, blob, static_cast<int>(blobSize), SQLITE_TRANSIENT);
+    db.stepDone(upsert.s);
+    if (op == DeltaOp::PATCH) ++res.patched; else ++res.put;
+  }
+  if (rc != SQLITE_DONE) throw std::runtime_error(std::string("failed to read delta: ") + sqlite3_errmsg(db.handle()));
+}
+
+} // namespace
+
+DeltaApplyResult applyDeltaPackage(const std::string& db_path, const std::string& delta_path) {
+  DeltaApplyResult res;
+  try {
+    Db db(db_path);
+    db.exec("ATTACH DATABASE " + quoteSql(delta_path) + " AS delta;");
+    db.exec("BEGIN IMMEDIATE;");
+    try {
+      const std::string from = metadataValue(db, "delta.delta_metadata", "from_data_version");
+      const std::string to   = metadataValue(db, "delta.delta_metadata", "to_data_version");
+      const std::string cur  = metadataValue(db, "main.metadata", "data_version");
+      if (!from.empty() && from != (cur.empty() ? std::string("1") : cur)) {
+        throw std::runtime_error("delta is for data_version " + from + ", package has " + cur);
+      }
+
+      applyTiles(db, "delta.delta_tiles", "main.land_tiles", res);
+      // Водный слой: delta_water_tiles пишут только дельты пакетов с water_tiles
+      if (hasTable(db, "delta", "delta_water_tiles")) {
+        if (!hasTable(db, "main", "water_tiles")) throw std::runtime_error("delta has water tiles, package has none");
+        applyTiles(db, "delta.delta_water_tiles", "main.water_tiles", res);
+        db.exec("UPDATE main.metadata SET value=(SELECT count(*) FROM main.water_tiles) WHERE key='water_tiles';");
+      }
+
+      // Дельта несёт только тайлы: индекс геокодера остаётся от прежней версии,
+      // и пакет помнит, от какой (у старых сборок ключа нет — это текущая)
+      if (!metadataValue(db, "main.metadata", "geocoder_entities").empty() &&
+          metadataValue(db, "main.metadata", "geocoder_data_version").empty()) {
+        Stmt meta(db.prepare("INSERT INTO main.metadata(key, value) VALUES('geocoder_data_version', ?);"));
+        const std::string built = cur.empty() ? std::string("1") : cur;
+        sqlite3_bind_text(meta.s, 1, built.c_str(), -1, SQLITE_TRANSIENT);
+        db.stepDone(meta.s);
+      }
+      if (!to.empty()) {
+        Stmt meta(db.prepare(
+            "INSERT INTO main.metadata(key, value) VALUES('data_version', ?) "
+            "ON CONFLICT(key) DO UPDATE SET value=excluded.value;"));
+        sqlite3_bind_text(meta.s, 1, to.c_str(), -1, SQLITE_TRANSIENT);
+        db.stepDone(meta.s);
+      }
+    } catch (...) {
+      sqlite3_exec(db.handle(), "ROLLBACK;", nullptr, nullptr, nullptr);
+      sqlite3_exec(db.handle(), "DETACH DATABASE delta;", nullptr, nullptr, nullptr);
+      throw;
+    }
+    db.exec("COMMIT;");
+    db.exec("DETACH DATABASE delta;");
+    res.ok = true;
+  } catch (const std::exception& ex) {
+    res = DeltaApplyResult{};
+    res.error_message = ex.what();
+  }
+  return res;
+}
+
+} // namespace routing_core
@@ -0,0 +1,103 @@
+#include "routing_core/route_result_buffer.h"
+
+#include <cmath>
+
+#include "route_result_generated.h"
+
+namespace routing_core {
+
+namespace {
+
+// Значения ResultStatus совпадают с RouteStatus
+Routing::ResultStatus statusOf(RouteStatus s) {
+  return static_cast<Routing::ResultStatus>(static_cast<int8_t>(s));
+}
+
+int32_t quantize(double deg) {
+  return static_cast<int32_t>(std::lround(deg * 1e6));
+}
+
+flatbuffers::Offset<flatbuffers::String> errorOf(flatbuffers::FlatBufferBuilder& fbb, RouteStatus s,
+                                                 const std::string& message) {
+  if (s == RouteStatus::OK || message.empty()) return 0;
+  return fbb.CreateString(message.data(), message.size());
+}
+
+} // namespace
+
+void buildRouteResponse(flatbuffers::FlatBufferBuilder& fbb, const RouteResult& rr) {
+  fbb.Clear();
+  flatbuffers::Offset<Routing::Route> route;
+  if (rr.status == RouteStatus::OK) {
+    Routing::PointQ* pts = nullptr;
+    auto polyline = fbb.CreateUninitializedVectorOfStructs(rr.polyline.size(), &pts);
+    for (const auto& c : rr.polyline) *pts++ = Routing::PointQ(quantize(c.lat), quantize(c.lon));
+    auto edges = fbb.CreateVector(rr.edge_ids);
+    route = Routing::CreateRoute(fbb, rr.distance_m, rr.duration_s, polyline, edges);
+  }
+  auto error = errorOf(fbb, rr.status, rr.error_message);
+  Routing::FinishRouteResponseBuffer(fbb, Routing::CreateRouteResponse(fbb, statusOf(rr.status), error, route));
+}
+
+void buildTripResponse(flatbuffers::FlatBufferBuilder& fbb, const TripResult& tr) {
+  fbb.Clear();
+  flatbuffers::Offset<Routing::Route> route;
+  if (tr.status == RouteStatus::OK) {
+    // Плечи стыкуются в общей точке: она пишется один раз
+    size_t pointCount = 0, edgeCount = 0;
+    for (size_t k = 0; k < tr.legs.size(); ++k) {
+      pointCount += tr.legs[k].polyline.size() - (k > 0 && !tr.legs[k].polyline.empty() ? 1 : 0);
+      edgeCount += tr.legs[k].edge_ids.size();
+    }
+    std::vector<flatbuffers::Offset<Routing::RouteLeg>> legs;
+    legs.reserve(tr.legs.size());
+    uint32_t firstPoint = 0, firstEdge = 0;
+    for (size_t k = 0; k < tr.legs.size(); ++k) {
+      const auto& leg = tr.legs[k];
+      const uint32_t shared = k > 0 && !leg.polyline.empty() ? 1 : 0;
+      const uint32_t points = static_cast<uint32_t>(leg.polyline.size());
+      legs.push_back(Routing::CreateRouteLeg(fbb, leg.distance_m, leg.duration_s, firstPoint - shared, points,
+                                             firstEdge, static_cast<uint32_t>(leg.edge_ids.size())));
+      firstPoint += points - shared;
+      firstEdge += static_cast<uint32_t>(leg.edge_ids.size());
+    }
+    auto legsVec = fbb.CreateVector(legs);
+
+    uint32_t* order = nullptr;
+    auto orderVec = fbb.CreateUninitializedVector(tr.order.size(), &order);
+    for (size_t i : tr.order) *order++ = static_cast<uint32_t>(i);
+
+    uint64_t* ids = nullptr;
+    auto edges = fbb.CreateUninitializedVector(edgeCount, &ids);
+    for (const auto& leg : tr.legs) {
+      for (uint64_t id : leg.edge_ids) *ids++ = id;
+    }
+
+    Routing::PointQ* pts = nullptr;
+    auto polyline = fbb.CreateUninitializedVectorOfStructs(pointCount, &pts);
+    for (size_t k = 0; k < tr.legs.size(); ++k) {
+      const auto& line = tr.legs[k].polyline;
+      for (size_t i = (k > 0 && !line.empty()) ? 1 : 0; i < line.size(); ++i) {
+        *pts++ = Routing::PointQ(quantize(line[i].lat), quantize(line[i].lon));
+      }
+    }
+    route = Routing::CreateRoute(fbb, tr.distance_m, tr.duration_s, polyline, edges, legsVec, orderVec);
+  }
+  auto error = errorOf(fbb, tr.status, tr.error_message);
+  Routing::FinishRouteResponseBuffer(fbb, Routing::CreateRouteResponse(fbb, statusOf(tr.status), error, route));
+}
+
+void buildMatrixResponse(flatbuffers::FlatBufferBuilder& fbb, const MatrixResult& m) {
+  fbb.Clear();
+  flatbuffers::Offset<Routing::Matrix> matrix;
+  if (m.status == RouteStatus::OK) {
+    float* cells = nullptr;
+    auto durations = fbb.CreateUninitializedVector(m.durations_s.size(), &cells);
+    for (double d : m.durations_s) *cells++ = static_cast<float>(d);
+    matrix = Routing::CreateMatrix(fbb, static_cast<uint32_t>(m.sources), static_cast<uint32_t>(m.targets), durations);
+  }
+  auto error = errorOf(fbb, m.status, m.error_message);
+  Routing::FinishRouteResponseBuffer(fbb, Routing::CreateRouteResponse(fbb, statusOf(m.status), error, 0, matrix));
+}
+
+} // namespace routing_core
@@ -7,26 +7,56 @@
 #include <stdexcept>
 #include <queue>
 #include <algorithm>
+#include <chrono>
 #include <limits>
 #include <optional>
 #include <unordered_map>
+#include <unordered_set>
 #include <map>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <thread>
 
 #include "land_tile_generated.h"
 #include "routing_core/tile_view.h"
 #include "routing_core/tiler.h"
 #include "routing_core/edge_id.h"
 #include "routing_core/profile.h"
+#include "routing_core/segment_index.h"
+#include "routing_core/trip_solver.h"
+#include "routing_core/open_water.h"
 
 namespace routing_core {
 
 struct Router::Impl {
   TileStore store;
+  TileStore waterStore; // водный граф (water_tiles), для профилей TileLayer::WATER
   int tileZoom;
+  OpenWaterPlanner openWater; // маски открытой воды тех же water_tiles
+  RouterOptions options;
+
+  // Снимок пробок: читатель копирует shared_ptr под коротким локом,
+  // писатель собирает новую версию вне его и подменяет указатель.
+  mutable std::mutex trafficMutex;
+  std::mutex trafficWriteMutex; // последовательные updateTraffic
+  std::shared_ptr<const TrafficOverlay> traffic;
+
+  QueryStats stats; // текущего запроса
 
   explicit Impl(const std::string& db, const RouterOptions& opt)
-    : store(db, opt.tileCacheCapacity), tileZoom(opt.tileZoom) {
+    : store(db, opt.tileCacheCapacity), waterStore(db, opt.tileCacheCapacity, "water_tiles"),
+      tileZoom(opt.tileZoom), openWater(waterStore, opt.tileZoom), options(opt) {
     store.setZoom(tileZoom);
+    waterStore.setZoom(tileZoom);
+  }
+
+  TileStore& storeFor(const ProfileSettings& profile) {
+    return profile.layer == TileLayer::WATER ? waterStore : store;
+  }
+
+  static double msSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
   }
 
   // --- геодезия ---
@@ -45,6 +75,125 @@ struct Router::Impl {
   static uint64_t makeEdgeId(int z, uint32_t x, uint32_t y, uint32_t edgeIdx) { return edgeid::make(z,x,y,edgeIdx); }
   static void parseEdgeId(uint64_t id, int& z, uint32_t& x, uint32_t& y, uint32_t& edgeIdx) { edgeid::parse(id,z,x,y,edgeIdx); }
 
+  // --- исключения запроса: бит на ребро, маски по индексу тайла в наборе ---
+  using EdgeMasks = std::vector<std::vector<uint64_t>>;
+
+  static bool isExcluded(const uint64_t* mask, uint32_t edgeIdx) {
+    return (mask[edgeIdx >> 6] >> (edgeIdx & 63)) & 1u;
+  }
+  static const uint64_t* tileMask(const EdgeMasks* masks, size_t tileIdx) {
+    if (!masks || (*masks)[tileIdx].empty()) return nullptr;
+    return (*masks)[tileIdx].data();
+  }
+
+  struct AvoidPolygon {
+    std::vector<Coord> ring;
+    double lat_min, lon_min, lat_max, lon_max;
+  };
+
+  // Чётно-нечётное правило в плоскости (lon, lat): для зон объезда в пределах города достаточно
+  static bool pointInRing(const std::vector<Coord>& ring, double lat, double lon) {
+    bool inside = false;
+    for (size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++) {
+      const auto& a = ring[i]; const auto& b = ring[j];
+      if ((a.lat > lat) != (b.lat > lat) &&
+          lon < (b.lon - a.lon) * (lat - a.lat) / (b.lat - a.lat) + a.lon) inside = !inside;
+    }
+    return inside;
+  }
+
+  static bool segmentsCross(double ax, double ay, double bx, double by,
+                            double cx, double cy, double dx, double dy) {
+    auto orient = [](double px, double py, double qx, double qy, double rx, double ry) {
+      double v = (qx - px) * (ry - py) - (qy - py) * (rx - px);
+      return (v > 0) - (v < 0);
+    };
+    int o1 = orient(ax, ay, bx, by, cx, cy), o2 = orient(ax, ay, bx, by, dx, dy);
+    int o3 = orient(cx, cy, dx, dy, ax, ay), o4 = orient(cx, cy, dx, dy, bx, by);
+    return o1 != o2 && o3 != o4;
+  }
+
+  // Ребро задето зоной: точка формы внутри кольца или сегмент пересекает его сторону
+  static bool shapeTouches(const AvoidPolygon& poly, const std::vector<std::pair<double,double>>& pts) {
+    for (const auto& p : pts) {
+      if (pointInRing(poly.ring, p.first, p.second)) return true;
+    }
+    const auto& r = poly.ring;
+    for (size_t k = 0; k + 1 < pts.size(); ++k) {
+      for (size_t i = 0, j = r.size() - 1; i < r.size(); j = i++) {
+        if (segmentsCross(pts[k].second, pts[k].first, pts[k+1].second, pts[k+1].first,
+                          r[j].lon, r[j].lat, r[i].lon, r[i].lat)) return true;
+      }
+    }
+    return false;
+  }
+
+  // Растеризация исключений в маски рёбер набора тайлов (один раз на запрос).
+  // Полигон проверяется только в тайлах, чьи границы пересекают его рамку,
+  // а внутри тайла — только рёбра с пересекающейся рамкой формы.
+  static EdgeMasks buildExclusionMasks(const std::vector<std::pair<TileKey,TileView>>& tiles,
+                                       const RouteOptions& ro) {
+    EdgeMasks masks(tiles.size());
+    auto bitsFor = [&](size_t ti) -> std::vector<uint64_t>& {
+      auto& m = masks[ti];
+      if (m.empty()) m.assign((static_cast<size_t>(tiles[ti].second.edgeCount()) + 63) / 64, 0);
+      return m;
+    };
+
+    for (uint64_t id : ro.excludedEdges) {
+      int z; uint32_t x, y, ei; parseEdgeId(id, z, x, y, ei);
+      for (size_t ti = 0; ti < tiles.size(); ++ti) {
+        const auto& k = tiles[ti].first;
+        if (k.z != z || k.x != static_cast<int>(x) || k.y != static_cast<int>(y)) continue;
+        if (ei < static_cast<uint32_t>(tiles[ti].second.edgeCount())) bitsFor(ti)[ei >> 6] |= (1ull << (ei & 63));
+        break;
+      }
+    }
+
+    std::vector<AvoidPolygon> polys;
+    for (const auto& ring : ro.avoidPolygons) {
+      if (ring.size() < 3) continue;
+      AvoidPolygon p{ring, 90.0, 180.0, -90.0, -180.0};
+      for (const auto& c : ring) {
+        p.lat_min = std::min(p.lat_min, c.lat); p.lat_max = std::max(p.lat_max, c.lat);
+        p.lon_min = std::min(p.lon_min, c.lon); p.lon_max = std::max(p.lon_max, c.lon);
+      }
+      polys.push_back(std::move(p));
+    }
+    if (polys.empty()) return masks;
+
+    std::vector<std::pair<double,double>> pts;
+    std::vector<const AvoidPolygon*> hit;
+    for (size_t ti = 0; ti < tiles.size(); ++ti) {
+      const auto& k = tiles[ti].first; const auto& view = tiles[ti].second;
+      double tLatMin, tLonMin, tLatMax, tLonMax;
+      webTileBounds(k.z, k.x, k.y, tLatMin, tLonMin, tLatMax, tLonMax);
+      hit.clear();
+      for (const auto& p : polys) {
+        if (p.lat_max >= tLatMin && p.lat_min <= tLatMax && p.lon_max >= tLonMin && p.lon_min <= tLonMax) hit.push_back(&p);
+      }
+      if (hit.empty()) continue;
+      for (int ei = 0; ei < view.edgeCount(); ++ei) {
+        pts.clear();
+        view.appendEdgeShape(static_cast<uint32_t>(ei), pts, /*skipFirst*/false);
+        if (pts.empty()) continue;
+        double eLatMin = pts[0].first, eLatMax = pts[0].first, eLonMin = pts[0].second, eLonMax = pts[0].second;
+        for (const auto& q : pts) {
+          eLatMin = std::min(eLatMin, q.first); eLatMax = std::max(eLatMax, q.first);
+          eLonMin = std::min(eLonMin, q.second); eLonMax = std::max(eLonMax, q.second);
+        }
+        for (const auto* p : hit) {
+          if (p->lat_max < eLatMin || p->lat_min > eLatMax || p->lon_max < eLonMin || p->lon_min > eLonMax) continue;
+          if (shapeTouches(*p, pts)) {
+            bitsFor(ti)[static_cast<size_t>(ei) >> 6] |= (1ull << (ei & 63));
+            break;
+          }
+        }
+      }
+    }
+    return masks;
+  }
+
   // --- снап к ребру ---
   struct EdgeSnap {
     uint32_t edgeIdx{0};
@@ -69,7 +218,8 @@ struct Router::Impl {
     outY = ay + t*vy;
   }
 
-  static std::optional<EdgeSnap> snapToEdge(const TileView& view, double lat, double lon, const ProfileSettings& profile) {
+  static std::optional<EdgeSnap> snapToEdge(const TileView& view, double lat, double lon, const ProfileSettings& profile,
+                                            const uint64_t* excluded = nullptr) {
     if (!view.valid() || view.edgeCount() == 0) return std::nullopt;
     EdgeSnap best;
     bool has = false;
@@ -85,6 +235,7 @@ struct Router::Impl {
       double sp = profile.speeds_mps[rc];
       bool allowed = (profile.access_mask & e->access_mask()) != 0;
       if (!allowed || sp <= 0.0) continue;
+      if (excluded && isExcluded(excluded, static_cast<uint32_t>(ei))) continue;
       view.appendEdgeShape(static_cast<uint32_t>(ei), tmp, /*skipFirst*/false);
       if (tmp.size() < 2) continue;
       for (int k = 0; k+1 < static_cast<int>(tmp.size()); ++k) {
@@ -122,13 +273,41 @@ struct Router::Impl {
     return true;
   }
 
-  static double edgeTraversalTimeSec(const Routing::Edge* e, const ProfileSettings& profile) {
+  // against — проход to -> from. На суше время от направления не зависит;
+  // авто едет не быстрее Edge.speed_mps (maxspeed или типичная скорость highway=*
+  // из конвертера). На воде скорость относительно берега — своя скорость ± течение
+  // ребра, не выше maxspeed (Edge.speed_mps).
+  static double edgeTraversalTimeSec(const Routing::Edge* e, const ProfileSettings& profile, bool against = false) {
     auto rc = static_cast<int>(e->road_class());
     double speed = profile.speeds_mps[rc];
     if (speed <= 0.0) return std::numeric_limits<double>::infinity();
+    if (profile.layer == TileLayer::LAND) {
+      if ((profile.access_mask & 0x1) && e->speed_mps() > 0.0f) speed = std::min(speed, static_cast<double>(e->speed_mps()));
+    } else {
+      const double flow = profile.flow_factor * e->flow_mps();
+      speed += against ? -flow : flow;
+      if (e->speed_mps() > 0.0f) speed = std::min(speed, static_cast<double>(e->speed_mps()));
+      if (speed < profile.min_speed_mps) return std::numeric_limits<double>::infinity();
+    }
     return e->length_m() / speed;
   }
 
+  // Время с учётом пробок: множитель делит время, 0 — ребро перекрыто
+  static double edgeTimeWithTraffic(const Routing::Edge* e, const ProfileSettings& profile,
+                                    const TrafficOverlay::TileFactors* tf, uint32_t edgeIdx,
+                                    bool against = false) {
+    double w = edgeTraversalTimeSec(e, profile, against);
+    if (!tf || !std::isfinite(w)) return w;
+    double f = tf->factor(edgeIdx);
+    if (f < 0.0) return w;
+    if (f == 0.0) return std::numeric_limits<double>::infinity();
+    return w / f;
+  }
+
+  static const TrafficOverlay::TileFactors* trafficTile(const TrafficOverlay* traffic, const TileKey& k) {
+    return traffic ? traffic->tile(k.z, k.x, k.y) : nullptr;
+  }
+
   // --- виртуальные рёбра/узлы для снапа ---
   struct VirtualEdge {
     int from{-1};
@@ -481,7 +660,7 @@ struct Router::Impl {
   }
 
   // ---- Мультитайловый граф (с коннекторами по lat_q/lon_q) ----
-  struct GlobalEdge { int to; double w; uint8_t isVirt; uint32_t tileX, tileY, edgeIdx; };
+  struct GlobalEdge { int to; double w; uint8_t isVirt; uint8_t tileZ; uint32_t tileX, tileY, edgeIdx; };
   struct GlobalNode { double lat, lon; };
 
   // key for quantized coordinate
@@ -490,19 +669,61 @@ struct Router::Impl {
   struct QKeyEq { bool operator()(const QKey& a, const QKey& b) const noexcept { return a.lat_q==b.lat_q && a.lon_q==b.lon_q; } };
 
   // Сбор прямоугольника тайлов (с рамкой)
-  void collectTileRange(const Coord& a, const Coord& b, int frame,
-                        std::vector<TileKey>& out) {
-    auto ka = webTileKeyFor(a.lat, a.lon, tileZoom);
-    auto kb = webTileKeyFor(b.lat, b.lon, tileZoom);
+  static void collectTileRange(const Coord& a, const Coord& b, int z, int frame,
+                               std::vector<TileKey>& out) {
+    auto ka = webTileKeyFor(a.lat, a.lon, z);
+    auto kb = webTileKeyFor(b.lat, b.lon, z);
     int minx = std::min(ka.x, kb.x) - frame;
     int maxx = std::max(ka.x, kb.x) + frame;
     int miny = std::min(ka.y, kb.y) - frame;
     int maxy = std::max(ka.y, kb.y) + frame;
     for (int y=miny;y<=maxy;++y) {
-      for (int x=minx;x<=maxx;++x) {
-        out.push_back(TileKey{tileZoom,x,y});
-      }
+      for (int x=minx;x<=maxx;++x) out.push_back(TileKey{z,x,y});
+    }
+  }
+
+  // Загрузка тайлов; пустые/битые и тайлы чужих профилей пропускаем
+  std::vector<std::pair<TileKey,TileView>> loadTiles(const std::vector<TileKey>& trefs,
+                                                     const ProfileSettings& profile) {
+    const auto t0 = std::chrono::steady_clock::now();
+    TileStore& ts = storeFor(profile);
+    const uint64_t hits0 = ts.cacheHits(), misses0 = ts.cacheMisses();
+    std::vector<std::pair<TileKey,TileView>> tiles;
+    tiles.reserve(trefs.size());
+    for (auto& tr : trefs) {
+      auto b = ts.load(tr.z, tr.x, tr.y);
+      if (!b) continue;
+      TileView v(b->buffer);
+      if (!v.valid() || v.edgeCount()==0 || v.nodeCount()<2) continue;
+      if (v.profileMask() != 0 && (v.profileMask() & profile.access_mask) == 0) continue;
+      tiles.emplace_back(tr, std::move(v));
     }
+    stats.tilesLoaded += tiles.size();
+    stats.tileCacheHits += ts.cacheHits() - hits0;
+    stats.tileCacheMisses += ts.cacheMisses() - misses0;
+    stats.tilesMs += msSince(t0);
+    return tiles;
+  }
+
+  // Иерархический набор: детальный слой вокруг концов маршрута,
+  // обзорный (только магистрали) — на всём прямоугольнике между ними.
+  // Слои стыкуются через общие узлы (одинаковые lat_q/lon_q).
+  bool useOverview(double dist_m) const {
+    return options.overviewZoom > 0 && options.overviewZoom < tileZoom &&
+           dist_m >= options.overviewMinDistanceM;
+  }
+
+  std::vector<TileKey> collectHierarchyTiles(const Coord& a, const Coord& b) const {
+    std::vector<TileKey> out;
+    collectTileRange(a, a, tileZoom, options.overviewDetailFrame, out);
+    collectTileRange(b, b, tileZoom, options.overviewDetailFrame, out);
+    collectTileRange(a, b, options.overviewZoom, 1, out);
+    // рамки концов перекрываются у близких точек: дубли убираем с сохранением порядка
+    std::unordered_set<TileKey, TileKeyHash> seen;
+    seen.reserve(out.size());
+    out.erase(std::remove_if(out.begin(), out.end(), [&](const TileKey& k) { return !seen.insert(k).second; }),
+              out.end());
+    return out;
   }
 
   // Построение глобального графа из набора тайлов
@@ -511,7 +732,9 @@ struct Router::Impl {
                         std::vector<GlobalNode>& nodes,
                         std::vector<std::vector<GlobalEdge>>& adj,
                         std::vector<std::vector<std::pair<int,int>>>& revAdj,
-                        std::unordered_map<uint64_t,int>& q2node) {
+                        std::unordered_map<uint64_t,int>& q2node,
+                        const TrafficOverlay* traffic,
+                        const EdgeMasks* masks) {
     nodes.clear(); adj.clear(); revAdj.clear(); q2node.clear();
 
     auto nodeIdFor = [&](int32_t lat_q, int32_t lon_q, double lat, double lon) {
@@ -526,9 +749,11 @@ struct Router::Impl {
       return id;
     };
 
-    for (auto& tv : tiles) {
-      const auto& tref = tv.first; const auto& view = tv.second;
+    for (size_t ti = 0; ti < tiles.size(); ++ti) {
+      const auto& tref = tiles[ti].first; const auto& view = tiles[ti].second;
       int N = view.nodeCount(); int E = view.edgeCount();
+      const auto* tf = trafficTile(traffic, tref);
+      const uint64_t* mask = tileMask(masks, ti);
       // предварительно создать все ноды
       std::vector<int> local2global(N, -1);
       for (int i=0;i<N;++i) {
@@ -536,19 +761,23 @@ struct Router::Impl {
       }
       // добавить рёбра
       for (int ei=0; ei<E; ++ei) {
+        if (mask && isExcluded(mask, static_cast<uint32_t>(ei))) continue;
         const auto* e = view.edgeAt(static_cast<uint32_t>(ei));
         if (!edgeAllowed(e, profile, static_cast<int>(e->from_node()))) continue;
-        double w = edgeTraversalTimeSec(e, profile);
-        if (!std::isfinite(w)) continue;
+        // веса по направлениям различаются только на воде (течение)
+        double w = edgeTimeWithTraffic(e, profile, tf, static_cast<uint32_t>(ei));
+        double wBack = edgeTimeWithTraffic(e, profile, tf, static_cast<uint32_t>(ei), /*against*/true);
         int u = local2global[static_cast<int>(e->from_node())];
         int v = local2global[static_cast<int>(e->to_node())];
-        adj[u].push_back(GlobalEdge{v, w, 0u, static_cast<uint32_t>(tref.x), static_cast<uint32_t>(tref.y), static_cast<uint32_t>(ei)});
-        revAdj[v].push_back({u, static_cast<int>(adj[u].size()-1)});
+        if (std::isfinite(w)) {
+          adj[u].push_back(GlobalEdge{v, w, 0u, static_cast<uint8_t>(tref.z), static_cast<uint32_t>(tref.x), static_cast<uint32_t>(tref.y), static_cast<uint32_t>(ei)});
+          revAdj[v].push_back({u, static_cast<int>(adj[u].size()-1)});
+        }
         // если не oneway — добавить обратное ребро
-        if (!e->oneway()) {
+        if (!e->oneway() && std::isfinite(wBack)) {
           // обратный проход допустим только если профилю разрешено
           if (edgeAllowed(e, profile, static_cast<int>(e->to_node()))) {
-            adj[v].push_back(GlobalEdge{u, w, 0u, static_cast<uint32_t>(tref.x), static_cast<uint32_t>(tref.y), static_cast<uint32_t>(ei)});
+            adj[v].push_back(GlobalEdge{u, wBack, 0u, static_cast<uint8_t>(tref.z), static_cast<uint32_t>(tref.x), static_cast<uint32_t>(tref.y), static_cast<uint32_t>(ei)});
             revAdj[u].push_back({v, static_cast<int>(adj[v].size()-1)});
           }
         }
@@ -556,6 +785,147 @@ struct Router::Impl {
     }
   }
 
+  // Виртуальный узел точки на ребре from–via: его выход v -> via — поворот в via
+  // с ребра from, хотя сам v в таблицах запретов не встречается
+  struct SnapApproach { int v; int via; int from; };
+  // И наоборот: вход via -> v точки на ребре via–to — поворот в via на ребро to
+  struct SnapExit { int v; int via; int to; };
+
+  static void addSnapApproaches(int v, const TileView& view, const EdgeSnap& snap,
+                                const std::unordered_map<uint64_t,int>& q2node, std::vector<SnapApproach>& out) {
+    const int from = globalNodeOf(view, snap.fromNode, q2node);
+    const int to = globalNodeOf(view, snap.toNode, q2node);
+    if (from < 0 || to < 0) return;
+    out.push_back(SnapApproach{v, to, from});
+    out.push_back(SnapApproach{v, from, to});
+  }
+
+  static void addSnapExits(int v, const TileView& view, const EdgeSnap& snap,
+                           const std::unordered_map<uint64_t,int>& q2node, std::vector<SnapExit>& out) {
+    const int from = globalNodeOf(view, snap.fromNode, q2node);
+    const int to = globalNodeOf(view, snap.toNode, q2node);
+    if (from < 0 || to < 0) return;
+    out.push_back(SnapExit{v, from, to});
+    out.push_back(SnapExit{v, to, from});
+  }
+
+  // Запреты манёвров: для каждого via и входящего "from"-узла u создаётся копия
+  // via (состояние "пришли по ребру u->via") с отфильтрованными исходящими рёбрами;
+  // рёбра u->via перенаправляются в копию. Остальные узлы остаются узловыми.
+  // Виртуальные узлы снапа (approaches) ведут в копию via своего ребра, а рёбра
+  // копии в узлы снапа (exits) фильтруются как поворот на их ребро.
+  void applyTurnRestrictions(const std::vector<std::pair<TileKey,TileView>>& tiles,
+                             std::vector<GlobalNode>& nodes,
+                             std::vector<std::vector<GlobalEdge>>& adj,
+                             const std::unordered_map<uint64_t,int>& q2node,
+                             const std::vector<SnapApproach>& approaches,
+                             const std::vector<SnapExit>& exits) {
+    auto qnode = [&](int32_t lat_q, int32_t lon_q) {
+      auto it = q2node.find((static_cast<uint64_t>(static_cast<uint32_t>(lat_q))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(lon_q)));
+      return it == q2node.end() ? -1 : it->second;
+    };
+    struct Turn { int to; bool only; };
+    // (via, from) -> манёвры
+    std::map<std::pair<int,int>, std::vector<Turn>> turns;
+    for (const auto& tv : tiles) {
+      const auto& view = tv.second;
+      for (int i = 0; i < view.restrictionCount(); ++i) {
+        const auto* r = view.restrictionAt(i);
+        int via = qnode(r->via_lat_q(), r->via_lon_q());
+        int from = qnode(r->from_lat_q(), r->from_lon_q());
+        int to = qnode(r->to_lat_q(), r->to_lon_q());
+        if (via < 0 || from < 0 || to < 0) continue;
+        auto& list = turns[{via, from}];
+        bool dup = false;
+        for (const auto& t : list) dup = dup || (t.to == to && t.only == r->only());
+        if (!dup) list.push_back(Turn{to, r->only()});
+      }
+    }
+    if (turns.empty()) return;
+
+    std::map<std::pair<int,int>, int> exitTo; // (via, узел снапа) -> сосед via на ребре снапа
+    for (const auto& x : exits) exitTo.emplace(std::pair{x.via, x.v}, x.to);
+
+    // Копии via: исходящие рёбра исходного узла минус запрещённые (only_* — только разрешённый)
+    std::map<std::pair<int,int>, int> split; // (via, from) -> копия
+    std::vector<int> origin(nodes.size());
+    for (size_t i = 0; i < origin.size(); ++i) origin[i] = static_cast<int>(i);
+    for (const auto& [key, list] : turns) {
+      const int via = key.first;
+      bool hasOnly = false;
+      for (const auto& t : list) hasOnly = hasOnly || t.only;
+      const int copy = static_cast<int>(nodes.size());
+      nodes.push_back(nodes[via]);
+      origin.push_back(via);
+      std::vector<GlobalEdge> out;
+      for (const auto& e : adj[via]) {
+        int next = e.to;
+        if (e.isVirt) {
+          auto x = exitTo.find({via, e.to});
+          if (x == exitTo.end()) {
+            out.push_back(e);
+            continue;
+          }
+          next = x->second;
+        }
+        bool allowed = !hasOnly;
+        for (const auto& t : list) {
+          if (t.to != next) continue;
+          allowed = t.only;
+          if (t.only) break;
+        }
+        if (allowed) out.push_back(e);
+      }
+      adj.push_back(std::move(out));
+      split.emplace(key, copy);
+    }
+
+    // Перенаправить рёбра from->via (и из копий from) в копию via
+    for (size_t u = 0; u < adj.size(); ++u) {
+      for (auto& e : adj[u]) {
+        auto it = split.find({origin[static_cast<size_t>(e.to)], origin[u]});
+        if (it != split.end() && origin[static_cast<size_t>(e.to)] == e.to) e.to = it->second;
+      }
+    }
+    for (const auto& a : approaches) {
+      auto it = split.find({a.via, a.from});
+      if (it == split.end()) continue;
+      for (auto& e : adj[static_cast<size_t>(a.v)]) {
+        if (e.isVirt && e.to == a.via) e.to = it->second;
+      }
+    }
+  }
+
+  // Глобальный узел для локального узла тайла (-1, если тайл не попал в граф)
+  static int globalNodeOf(const TileView& view, int localNode, const std::unordered_map<uint64_t,int>& q2node) {
+    uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLatQ(localNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLonQ(localNode)));
+    auto it = q2node.find(key);
+    return it == q2node.end() ? -1 : it->second;
+  }
+
+  // Точка на ребре как источник: v -> to (доля 1-t), для двусторонних ещё v -> from (доля t).
+  // w — время ребра по направлению, wBack — против (различаются на воде).
+  static void attachSnapSource(int v, const TileView& view, const EdgeSnap& snap, double w, double wBack,
+                               std::vector<std::vector<GlobalEdge>>& adj, const std::unordered_map<uint64_t,int>& q2node) {
+    const auto* e = view.edgeAt(snap.edgeIdx);
+    double t = std::clamp(snap.t, 0.0, 1.0);
+    int to = globalNodeOf(view, snap.toNode, q2node);
+    int from = globalNodeOf(view, snap.fromNode, q2node);
+    if (to >= 0 && std::isfinite(w)) adj[v].push_back(GlobalEdge{to, (1.0-t)*w, 1u, 0,0,0,0});
+    if (from >= 0 && !e->oneway() && std::isfinite(wBack)) adj[v].push_back(GlobalEdge{from, t*wBack, 1u, 0,0,0,0});
+  }
+
+  // Точка на ребре как цель: from -> v (доля t), для двусторонних ещё to -> v (доля 1-t)
+  static void attachSnapTarget(int v, const TileView& view, const EdgeSnap& snap, double w, double wBack,
+                               std::vector<std::vector<GlobalEdge>>& adj, const std::unordered_map<uint64_t,int>& q2node) {
+    const auto* e = view.edgeAt(snap.edgeIdx);
+    double t = std::clamp(snap.t, 0.0, 1.0);
+    int from = globalNodeOf(view, snap.fromNode, q2node);
+    int to = globalNodeOf(view, snap.toNode, q2node);
+    if (from >= 0 && std::isfinite(w)) adj[from].push_back(GlobalEdge{v, t*w, 1u, 0,0,0,0});
+    if (to >= 0 && !e->oneway() && std::isfinite(wBack)) adj[to].push_back(GlobalEdge{v, (1.0-t)*wBack, 1u, 0,0,0,0});
+  }
+
   // bi-A* по глобальному графу
 bool astarGlobalBi(const std::vector<GlobalNode>& nodes,
                      const std::vector<std::vector<GlobalEdge>>& adj,
@@ -572,12 +942,12 @@ bool astarGlobalBi(const std::vector<GlobalNode>& nodes,
     double bestMu = std::numeric_limits<double>::infinity(); int meet=-1;
     while(!pqF.empty() || !pqB.empty()){
       if(!pqF.empty()){
-        auto q=pqF.top(); pqF.pop();
+        auto q=pqF.top(); pqF.pop(); ++stats.settledNodes;
         if (F[q.v].g + hF(q.v) > bestMu) break;
         for(size_t i=0;i<adj[q.v].size();++i){ const auto& e=adj[q.v][i]; double cand=F[q.v].g+e.w; if(cand<F[e.to].g){ F[e.to].g=cand; F[e.to].prev=q.v; F[e.to].prevEdge=static_cast<int>(i); pqF.push({e.to, cand + hF(e.to)}); if (B[e.to].g< std::numeric_limits<double>::infinity()){ double mu=cand+B[e.to].g; if(mu<bestMu){ bestMu=mu; meet=e.to; } } } }
       }
       if(!pqB.empty()){
-        auto q=pqB.top(); pqB.pop();
+        auto q=pqB.top(); pqB.pop(); ++stats.settledNodes;
         if (B[q.v].g + hB(q.v) > bestMu) break;
         for(const auto& re : revAdj[q.v]){ int from=re.first; int idx=re.second; const auto& e=adj[from][static_cast<size_t>(idx)]; double cand=B[q.v].g + e.w; if(cand<B[from].g){ B[from].g=cand; B[from].prev=q.v; B[from].prevEdge=idx; pqB.push({from, cand + hB(from)}); if (F[from].g< std::numeric_limits<double>::infinity()){ double mu=cand+F[from].g; if(mu<bestMu){ bestMu=mu; meet=from; } } } }
       }
@@ -590,12 +960,623 @@ bool astarGlobalBi(const std::vector<GlobalNode>& nodes,
     for(int v=meet; v!=t; v=B[v].prev){ int u=v; int idx=B[u].prevEdge; seq.emplace_back(u, idx); // edge u->B[u].prev
     }
     usedEdgeIds.clear(); uint64_t lastE=std::numeric_limits<uint64_t>::max();
-    for(auto& p: seq){ int u=p.first; int idx=p.second; if (idx<0) continue; const auto& ge=adj[u][static_cast<size_t>(idx)]; uint64_t id=makeEdgeId(tileZoom, ge.tileX, ge.tileY, ge.edgeIdx); if(id!=lastE){ usedEdgeIds.push_back(id); lastE=id; } }
+    for(auto& p: seq){ int u=p.first; int idx=p.second; if (idx<0) continue; const auto& ge=adj[u][static_cast<size_t>(idx)]; if (ge.isVirt) continue; uint64_t id=makeEdgeId(ge.tileZ, ge.tileX, ge.tileY, ge.edgeIdx); if(id!=lastE){ usedEdgeIds.push_back(id); lastE=id; } }
     // meetPath возвращать не обязательно для polyline, но заполним
     meetPath.clear(); meetPath.push_back(s); meetPath.push_back(meet); meetPath.push_back(t);
     return true;
   }
 
+  // Поиск пути по уже загруженному набору тайлов (один или несколько слоёв)
+  RouteResult routeOnTiles(const ProfileSettings& profile, const Coord& from, const Coord& to,
+                           const std::vector<std::pair<TileKey,TileView>>& tiles,
+                           const TrafficOverlay* traffic, const RouteOptions& ro) {
+    RouteResult rr;
+    if (tiles.empty()) { rr.status = RouteStatus::NO_TILE; rr.error_message = "no tiles in range"; return rr; }
+
+    auto t0 = std::chrono::steady_clock::now();
+    EdgeMasks masksStorage;
+    const EdgeMasks* masks = nullptr;
+    if (!ro.empty()) { masksStorage = buildExclusionMasks(tiles, ro); masks = &masksStorage; }
+
+    std::vector<Impl::GlobalNode> nodes; std::vector<std::vector<Impl::GlobalEdge>> adj; std::vector<std::vector<std::pair<int,int>>> revAdj; std::unordered_map<uint64_t,int> q2node;
+    buildGlobalGraph(profile, tiles, nodes, adj, revAdj, q2node, traffic, masks);
+
+    // снап по тайлам детального слоя: выберем ближайший edgeSnap
+    auto bestSnap = [&](const Coord& c){
+      std::optional<Impl::EdgeSnap> best; double bestD=std::numeric_limits<double>::infinity(); int bestTile=-1;
+      for (int i=0;i<(int)tiles.size();++i){ if (tiles[i].first.z!=tileZoom) continue; auto s=Impl::snapToEdge(tiles[i].second,c.lat,c.lon, profile, tileMask(masks, static_cast<size_t>(i))); if(!s) continue; if(s->dist_m<bestD){ best= s; bestD=s->dist_m; bestTile=i; } }
+      return std::tuple{best, bestTile}; };
+
+    auto [sSnap, sTile] = bestSnap(from);
+    auto [tSnap, tTile] = bestSnap(to);
+    if (!sSnap || !tSnap) { rr.status=RouteStatus::NO_ROUTE; rr.error_message="failed to snap (multi-tile)"; return rr; }
+
+    // глобальные узлы для старта/финиша — привяжем к ближайшим реальным узлам (from/to соответствующих рёбер)
+    auto& sView = tiles[sTile].second; auto& tView = tiles[tTile].second;
+    int sFrom = q2node[(static_cast<uint64_t>(static_cast<uint32_t>(sView.nodeLatQ(sSnap->fromNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(sView.nodeLonQ(sSnap->fromNode)))];
+    int sTo   = q2node[(static_cast<uint64_t>(static_cast<uint32_t>(sView.nodeLatQ(sSnap->toNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(sView.nodeLonQ(sSnap->toNode)))];
+    int tFrom = q2node[(static_cast<uint64_t>(static_cast<uint32_t>(tView.nodeLatQ(tSnap->fromNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(tView.nodeLonQ(tSnap->fromNode)))];
+    int tTo   = q2node[(static_cast<uint64_t>(static_cast<uint32_t>(tView.nodeLatQ(tSnap->toNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(tView.nodeLonQ(tSnap->toNode)))];
+
+    // выберем стартовый и конечный глобальные узлы как ближайшие из пары (from/to) по геометрии
+    auto pickClosest = [&](int a, int b, const Coord& c){ double da=Impl::haversine(nodes[a].lat,nodes[a].lon,c.lat,c.lon); double db=Impl::haversine(nodes[b].lat,nodes[b].lon,c.lat,c.lon); return (da<=db)?a:b; };
+    int sNode = pickClosest(sFrom, sTo, from);
+    int tNode = pickClosest(tFrom, tTo, to);
+
+    std::vector<int> gpath; std::vector<uint64_t> eids;
+    // Добавим виртуальные узлы vS,vE и полу-рёбра до ближайших узлов snapped-ребёр с учётом oneway
+    int vS = static_cast<int>(nodes.size());
+    nodes.push_back(Impl::GlobalNode{sSnap->projLat, sSnap->projLon});
+    adj.emplace_back();
+    int vE = static_cast<int>(nodes.size());
+    nodes.push_back(Impl::GlobalNode{tSnap->projLat, tSnap->projLon});
+    adj.emplace_back();
+
+    const auto* sTraffic = trafficTile(traffic, tiles[sTile].first);
+    const auto* tTraffic = trafficTile(traffic, tiles[tTile].first);
+
+    auto addVS = [&](const TileView& view, const Impl::EdgeSnap& snap){
+      const auto* e = view.edgeAt(snap.edgeIdx);
+      double w = edgeTimeWithTraffic(e, profile, sTraffic, snap.edgeIdx);
+      double wBack = edgeTimeWithTraffic(e, profile, sTraffic, snap.edgeIdx, /*against*/true);
+      if (!std::isfinite(w) && !std::isfinite(wBack)) return;
+      double t = std::clamp(snap.t, 0.0, 1.0);
+      // fromNode -> vS (доля t)
+      if (!e->oneway()) {
+        if (std::isfinite(w)) adj[sNode].push_back(Impl::GlobalEdge{vS, t*w, 1u, 0,0,0,0});
+      } else {
+        // oneway: допускаем вход в vS только если направление from->to
+        uint64_t kFrom = (static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLatQ(snap.fromNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLonQ(snap.fromNode)));
+        int fromGlobal = q2node[kFrom];
+        if (fromGlobal==sNode && std::isfinite(w)) adj[sNode].push_back(Impl::GlobalEdge{vS, t*w, 1u, 0,0,0,0});
+      }
+      // vS -> toNode (доля 1-t) всегда по направлению ребра
+      uint64_t kTo = (static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLatQ(snap.toNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLonQ(snap.toNode)));
+      int toGlobal = q2node[kTo];
+      if (std::isfinite(w)) adj[vS].push_back(Impl::GlobalEdge{toGlobal, (1.0-t)*w, 1u, 0,0,0,0});
+      // если не oneway — позволяем обратный ход vS->fromNode
+      if (!e->oneway() && std::isfinite(wBack)) {
+        uint64_t kFrom2 = (static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLatQ(snap.fromNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLonQ(snap.fromNode)));
+        int fromGlobal = q2node[kFrom2];
+        adj[vS].push_back(Impl::GlobalEdge{fromGlobal, t*wBack, 1u, 0,0,0,0});
+      }
+    };
+
+    auto addVE = [&](const TileView& view, const Impl::EdgeSnap& snap){
+      const auto* e = view.edgeAt(snap.edgeIdx);
+      attachSnapTarget(vE, view, snap, edgeTimeWithTraffic(e, profile, tTraffic, snap.edgeIdx),
+                       edgeTimeWithTraffic(e, profile, tTraffic, snap.edgeIdx, /*against*/true), adj, q2node);
+    };
+
+    addVS(sView, *sSnap);
+    addVE(tView, *tSnap);
+
+    if (options.turnRestrictions && (profile.access_mask & 0x1)) {
+      // старт на ребре from -> via: запрет в via действует и на первом повороте
+      std::vector<SnapApproach> approaches;
+      addSnapApproaches(vS, sView, *sSnap, q2node, approaches);
+      // и финиш на ребре via -> to: последний поворот тоже проверяется
+      std::vector<SnapExit> exits;
+      addSnapExits(vE, tView, *tSnap, q2node, exits);
+      applyTurnRestrictions(tiles, nodes, adj, q2node, approaches, exits);
+    }
+
+    // обратные списки должны видеть и виртуальные рёбра (vS/vE добавлены после buildGlobalGraph)
+    revAdj.assign(nodes.size(), {});
+    for (int u=0; u<(int)adj.size(); ++u) {
+      for (int i=0; i<(int)adj[u].size(); ++i) revAdj[adj[u][i].to].push_back({u, i});
+    }
+
+    stats.graphNodes += nodes.size();
+    stats.graphMs += msSince(t0);
+    t0 = std::chrono::steady_clock::now();
+    const bool found = astarGlobalBi(nodes, adj, revAdj, vS, vE, gpath, eids);
+    stats.searchMs += msSince(t0);
+    if (!found) { rr.status=RouteStatus::NO_ROUTE; rr.error_message="no path in multi-tile"; return rr; }
+
+    t0 = std::chrono::steady_clock::now();
+    fillRouteFromEdges(profile, eids, tiles, traffic, rr);
+    stats.geometryMs += msSince(t0);
+    return rr;
+  }
+
+  // polyline, длина и время маршрута по edge_ids
+  static void fillRouteFromEdges(const ProfileSettings& profile, const std::vector<uint64_t>& eids,
+                                 const std::vector<std::pair<TileKey,TileView>>& tiles,
+                                 const TrafficOverlay* traffic, RouteResult& rr) {
+    rr.polyline.clear(); rr.edge_ids = eids; rr.distance_m=0; rr.duration_s=0;
+    auto appendPoint=[&](double la,double lo){ if(!rr.polyline.empty()){ auto& L=rr.polyline.back(); rr.distance_m+=Impl::haversine(L.lat,L.lon,la,lo);} rr.polyline.push_back(Coord{la,lo}); };
+    struct Step { TileView const* view; const TrafficOverlay::TileFactors* tf; uint32_t ei; };
+    std::vector<Step> steps;
+    steps.reserve(eids.size());
+    for (auto id : eids){
+      int z; uint32_t x,y,ei; Impl::parseEdgeId(id, z, x, y, ei);
+      // найдём view по (z,x,y)
+      for (auto& pr: tiles){ if (pr.first.z==z && pr.first.x==(int)x && pr.first.y==(int)y){ steps.push_back(Step{&pr.second, trafficTile(traffic, pr.first), ei}); break; } }
+    }
+    auto nodeAt = [](const Step& st, bool to) {
+      const auto* e = st.view->edgeAt(st.ei);
+      const int n = static_cast<int>(to ? e->to_node() : e->from_node());
+      return Coord{st.view->nodeLat(n), st.view->nodeLon(n)};
+    };
+    auto d2 = [](const Coord& a, const Coord& b) { return (a.lat-b.lat)*(a.lat-b.lat) + (a.lon-b.lon)*(a.lon-b.lon); };
+    std::vector<std::pair<double,double>> pts;
+    for (size_t i = 0; i < steps.size(); ++i) {
+      const Step& st = steps[i];
+      // Ребро пройдено против from -> to, если стыкуется с уже собранной линией своим to
+      // (первое ребро — если со следующим у него общий from)
+      const Coord from = nodeAt(st, false), to = nodeAt(st, true);
+      bool against = false;
+      if (!rr.polyline.empty()) {
+        against = d2(rr.polyline.back(), to) < d2(rr.polyline.back(), from);
+      } else if (i + 1 < steps.size()) {
+        const Coord nf = nodeAt(steps[i+1], false), nt = nodeAt(steps[i+1], true);
+        against = std::min(d2(from, nf), d2(from, nt)) < std::min(d2(to, nf), d2(to, nt));
+      }
+      pts.clear();
+      st.view->appendEdgeShape(st.ei, pts, /*skipFirst*/false);
+      if (against) std::reverse(pts.begin(), pts.end());
+      for (size_t k = rr.polyline.empty() ? 0 : 1; k < pts.size(); ++k) appendPoint(pts[k].first, pts[k].second);
+      rr.duration_s += Impl::edgeTimeWithTraffic(st.view->edgeAt(st.ei), profile, st.tf, st.ei, against);
+    }
+    rr.status = RouteStatus::OK;
+  }
+
+  // Граф запроса для многих точек: тайлы + по виртуальному узлу на точку.
+  // Узел лежит на ребре и работает и как источник, и как цель; проход сквозь
+  // него стоит столько же, сколько само ребро. Точка снапится только в своём
+  // тайле (точки группируются по ключу тайла).
+  struct QueryGraph {
+    std::vector<GlobalNode> nodes;
+    std::vector<std::vector<GlobalEdge>> adj;
+    std::vector<std::vector<std::pair<int,int>>> revAdj;
+    std::unordered_map<uint64_t,int> q2node;
+    std::vector<int> pointNode; // -1 — точка не привязалась
+  };
+
+  QueryGraph buildQueryGraph(const ProfileSettings& profile, const std::vector<Coord>& points,
+                             const std::vector<std::pair<TileKey,TileView>>& tiles,
+                             const TrafficOverlay* traffic, const RouteOptions& ro) {
+    const auto t0 = std::chrono::steady_clock::now();
+    QueryGraph g;
+    EdgeMasks masksStorage;
+    const EdgeMasks* masks = nullptr;
+    if (!ro.empty()) { masksStorage = buildExclusionMasks(tiles, ro); masks = &masksStorage; }
+    buildGlobalGraph(profile, tiles, g.nodes, g.adj, g.revAdj, g.q2node, traffic, masks);
+
+    std::unordered_map<TileKey,size_t,TileKeyHash> tileIndex;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+      if (tiles[i].first.z == tileZoom) tileIndex.emplace(tiles[i].first, i);
+    }
+    g.pointNode.assign(points.size(), -1);
+    std::vector<SnapApproach> approaches;
+    std::vector<SnapExit> exits;
+    for (size_t pi = 0; pi < points.size(); ++pi) {
+      const auto& c = points[pi];
+      auto wk = webTileKeyFor(c.lat, c.lon, tileZoom);
+      auto it = tileIndex.find(TileKey{wk.z, wk.x, wk.y});
+      if (it == tileIndex.end()) continue;
+      const auto& view = tiles[it->second].second;
+      auto snap = snapToEdge(view, c.lat, c.lon, profile, tileMask(masks, it->second));
+      if (!snap) continue;
+      const auto* tf = trafficTile(traffic, tiles[it->second].first);
+      double w = edgeTimeWithTraffic(view.edgeAt(snap->edgeIdx), profile, tf, snap->edgeIdx);
+      double wBack = edgeTimeWithTraffic(view.edgeAt(snap->edgeIdx), profile, tf, snap->edgeIdx, /*against*/true);
+      if (!std::isfinite(w) && !std::isfinite(wBack)) continue;
+      int v = static_cast<int>(g.nodes.size());
+      g.nodes.push_back(GlobalNode{snap->projLat, snap->projLon});
+      g.adj.emplace_back();
+      attachSnapSource(v, view, *snap, w, wBack, g.adj, g.q2node);
+      attachSnapTarget(v, view, *snap, w, wBack, g.adj, g.q2node);
+      addSnapApproaches(v, view, *snap, g.q2node, approaches);
+      addSnapExits(v, view, *snap, g.q2node, exits);
+      g.pointNode[pi] = v;
+    }
+
+    if (options.turnRestrictions && (profile.access_mask & 0x1)) {
+      applyTurnRestrictions(tiles, g.nodes, g.adj, g.q2node, approaches, exits);
+    }
+    g.revAdj.assign(g.nodes.size(), {});
+    for (int u=0; u<(int)g.adj.size(); ++u) {
+      for (int i=0; i<(int)g.adj[u].size(); ++i) g.revAdj[g.adj[u][i].to].push_back({u, i});
+    }
+    stats.graphNodes += g.nodes.size();
+    stats.graphMs += msSince(t0);
+    return g;
+  }
+
+  // Дейкстра от s по прямым или обратным рёбрам; onSettle(v, g) == false — стоп.
+  // Возвращает число осевших вершин.
+  template <typename OnSettle>
+  static size_t dijkstra(const QueryGraph& g, int s, bool reverse, OnSettle&& onSettle) {
+    struct Q { int v; double g; }; struct C { bool operator()(const Q&a,const Q&b)const{return a.g>b.g;}};
+    std::vector<double> dist(g.nodes.size(), std::numeric_limits<double>::infinity());
+    std::vector<uint8_t> settled(g.nodes.size(), 0);
+    std::priority_queue<Q,std::vector<Q>,C> pq;
+    dist[static_cast<size_t>(s)] = 0.0; pq.push({s, 0.0});
+    auto relax = [&](int to, double cand) {
+      if (cand < dist[static_cast<size_t>(to)]) { dist[static_cast<size_t>(to)] = cand; pq.push({to, cand}); }
+    };
+    size_t count = 0;
+    while (!pq.empty()) {
+      auto q = pq.top(); pq.pop();
+      if (settled[static_cast<size_t>(q.v)]) continue;
+      settled[static_cast<size_t>(q.v)] = 1;
+      ++count;
+      if (!onSettle(q.v, q.g)) return count;
+      if (!reverse) {
+        for (const auto& e : g.adj[static_cast<size_t>(q.v)]) relax(e.to, q.g + e.w);
+      } else {
+        for (const auto& re : g.revAdj[static_cast<size_t>(q.v)]) relax(re.first, q.g + g.adj[static_cast<size_t>(re.first)][static_cast<size_t>(re.second)].w);
+      }
+    }
+    return count;
+  }
+
+  // Один Дейкстра от origin до k ближайших кандидатов: стоп, как только осели k из них.
+  // TO_ORIGIN — тот же поиск по обратным рёбрам (кто быстрее всех доедет до origin).
+  NearestResult nearestOnTiles(const ProfileSettings& profile, const Coord& origin,
+                               const std::vector<Coord>& candidates, size_t k, SearchDirection dir,
+                               const std::vector<std::pair<TileKey,TileView>>& tiles,
+                               const TrafficOverlay* traffic, const RouteOptions& ro) {
+    NearestResult res;
+    if (tiles.empty()) { res.status = RouteStatus::NO_TILE; res.error_message = "no tiles in range"; return res; }
+
+    std::vector<Coord> points;
+    points.reserve(candidates.size() + 1);
+    points.push_back(origin);
+    points.insert(points.end(), candidates.begin(), candidates.end());
+    QueryGraph g = buildQueryGraph(profile, points, tiles, traffic, ro);
+    if (g.pointNode[0] < 0) { res.status = RouteStatus::NO_ROUTE; res.error_message = "failed to snap origin"; return res; }
+
+    std::vector<int> candidateOf(g.nodes.size(), -1);
+    size_t snapped = 0;
+    for (size_t ci = 0; ci < candidates.size(); ++ci) {
+      int v = g.pointNode[ci + 1];
+      if (v < 0) continue;
+      candidateOf[static_cast<size_t>(v)] = static_cast<int>(ci);
+      ++snapped;
+    }
+    if (snapped == 0) { res.status = RouteStatus::NO_ROUTE; res.error_message = "no candidate could be snapped"; return res; }
+    k = std::min(k, snapped);
+
+    const auto t0 = std::chrono::steady_clock::now();
+    stats.settledNodes += dijkstra(g, g.pointNode[0], dir == SearchDirection::TO_ORIGIN, [&](int v, double d) {
+      int ci = candidateOf[static_cast<size_t>(v)];
+      if (ci >= 0) res.hits.push_back(NearestHit{static_cast<size_t>(ci), d});
+      return res.hits.size() < k;
+    });
+    stats.searchMs += msSince(t0);
+    res.status = res.hits.empty() ? RouteStatus::NO_ROUTE : RouteStatus::OK;
+    if (res.hits.empty()) res.error_message = "no candidate reachable";
+    return res;
+  }
+
+  // Матрица времени между точками графа запроса: строка — один Дейкстра до
+  // оседания всех точек; строки считаются параллельно (граф только читается).
+  std::vector<std::vector<double>> durationMatrix(const QueryGraph& g) {
+    const size_t n = g.pointNode.size();
+    std::vector<std::vector<double>> m(n, std::vector<double>(n, std::numeric_limits<double>::infinity()));
+    std::vector<int> pointOf(g.nodes.size(), -1);
+    for (size_t i = 0; i < n; ++i) pointOf[static_cast<size_t>(g.pointNode[i])] = static_cast<int>(i);
+
+    std::atomic<size_t> settled {0};
+    parallelFor(n, [&](size_t i) {
+      size_t left = n;
+      settled += dijkstra(g, g.pointNode[i], false, [&](int v, double d) {
+        int j = pointOf[static_cast<size_t>(v)];
+        if (j >= 0) { m[i][static_cast<size_t>(j)] = d; --left; }
+        return left > 0;
+      });
+    });
+    stats.settledNodes += settled;
+    return m;
+  }
+
+  MatrixResult matrixOnTiles(const ProfileSettings& profile, const std::vector<Coord>& sources,
+                             const std::vector<Coord>& targets,
+                             const std::vector<std::pair<TileKey,TileView>>& tiles,
+                             const TrafficOverlay* traffic, const RouteOptions& ro) {
+    MatrixResult res;
+    res.sources = sources.size();
+    res.targets = targets.size();
+    res.durations_s.assign(sources.size() * targets.size(), std::numeric_limits<double>::infinity());
+    if (tiles.empty()) { res.status = RouteStatus::NO_TILE; res.error_message = "no tiles in range"; return res; }
+
+    std::vector<Coord> points = sources;
+    points.insert(points.end(), targets.begin(), targets.end());
+    QueryGraph g = buildQueryGraph(profile, points, tiles, traffic, ro);
+    // у каждой точки своя виртуальная вершина, так что цель по вершине однозначна
+    std::vector<int> targetOf(g.nodes.size(), -1);
+    size_t snappedTargets = 0;
+    for (size_t j = 0; j < targets.size(); ++j) {
+      int v = g.pointNode[sources.size() + j];
+      if (v < 0) continue;
+      targetOf[static_cast<size_t>(v)] = static_cast<int>(j);
+      ++snappedTargets;
+    }
+    if (snappedTargets == 0) { res.status = RouteStatus::NO_ROUTE; res.error_message = "no target could be snapped"; return res; }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    std::atomic<size_t> settled {0};
+    parallelFor(sources.size(), [&](size_t i) {
+      if (g.pointNode[i] < 0) return;
+      double* row = res.durations_s.data() + i * targets.size();
+      size_t left = snappedTargets;
+      settled += dijkstra(g, g.pointNode[i], false, [&](int v, double d) {
+        int j = targetOf[static_cast<size_t>(v)];
+        if (j >= 0) { row[j] = d; --left; }
+        return left > 0;
+      });
+    });
+    stats.settledNodes += settled;
+    stats.searchMs += msSince(t0);
+    res.status = RouteStatus::OK;
+    return res;
+  }
+
+  // fn(i) для i в [0, n) на пуле из options.workerThreads потоков (текущий — один из них)
+  template <typename Fn>
+  void parallelFor(size_t n, Fn&& fn) const {
+    std::atomic<size_t> next {0};
+    auto worker = [&] { for (size_t i; (i = next.fetch_add(1)) < n; ) fn(i); };
+    size_t threads = std::min<size_t>(n, std::max(1u, std::min(options.workerThreads, std::thread::hardware_concurrency())));
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+  }
+
+  TripResult tripOnTiles(const ProfileSettings& profile, const std::vector<Coord>& stops,
+                         bool fixedStart, bool fixedEnd,
+                         const std::vector<std::pair<TileKey,TileView>>& tiles,
+                         const TrafficOverlay* traffic, const RouteOptions& ro) {
+    TripResult tr;
+    if (tiles.empty()) { tr.status = RouteStatus::NO_TILE; tr.error_message = "no tiles in range"; return tr; }
+    QueryGraph g = buildQueryGraph(profile, stops, tiles, traffic, ro);
+    for (size_t i = 0; i < stops.size(); ++i) {
+      if (g.pointNode[i] < 0) {
+        tr.status = RouteStatus::NO_ROUTE;
+        tr.error_message = "failed to snap stop " + std::to_string(i);
+        return tr;
+      }
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    auto m = durationMatrix(g);
+    tr.order = solveTripOrder(m, fixedStart, fixedEnd, options.tripImproveBudgetMs);
+    stats.searchMs += msSince(t0);
+    if (!std::isfinite(tripCost(m, tr.order))) {
+      tr.status = RouteStatus::NO_ROUTE;
+      tr.error_message = "some stops are unreachable from each other";
+      return tr;
+    }
+
+    // плечи — bi-A* по тому же графу
+    for (size_t k = 1; k < tr.order.size(); ++k) {
+      RouteResult leg;
+      std::vector<int> gpath; std::vector<uint64_t> eids;
+      t0 = std::chrono::steady_clock::now();
+      const bool found = astarGlobalBi(g.nodes, g.adj, g.revAdj, g.pointNode[tr.order[k-1]], g.pointNode[tr.order[k]], gpath, eids);
+      stats.searchMs += msSince(t0);
+      if (!found) {
+        tr.status = RouteStatus::NO_ROUTE;
+        tr.error_message = "no path for leg " + std::to_string(k);
+        return tr;
+      }
+      t0 = std::chrono::steady_clock::now();
+      fillRouteFromEdges(profile, eids, tiles, traffic, leg);
+      stats.geometryMs += msSince(t0);
+      tr.distance_m += leg.distance_m;
+      tr.duration_s += leg.duration_s;
+      tr.legs.push_back(std::move(leg));
+    }
+    tr.status = RouteStatus::OK;
+    return tr;
+  }
+
+  SnapBatchResult snapBatch(const ProfileSettings& profile, const std::vector<Coord>& points) {
+    SnapBatchResult res;
+    const size_t n = points.size();
+    res.edge_ids.assign(n, kNoEdge);
+    res.offsets.assign(n, 0.0);
+    res.distances_m.assign(n, std::numeric_limits<double>::infinity());
+    res.projected.assign(n, Coord{});
+
+    // точки по тайлам; сами тайлы грузятся последовательно (TileStore не потокобезопасен)
+    std::unordered_map<TileKey, std::vector<size_t>, TileKeyHash> groups;
+    for (size_t i = 0; i < n; ++i) {
+      auto wk = webTileKeyFor(points[i].lat, points[i].lon, tileZoom);
+      groups[TileKey{wk.z, wk.x, wk.y}].push_back(i);
+    }
+    struct Group { TileKey key; std::vector<size_t> pts; };
+    std::vector<Group> order;
+    order.reserve(groups.size());
+    for (auto& kv : groups) order.push_back(Group{kv.first, std::move(kv.second)});
+
+    // индексы тайлов: свой тайл каждой группы и соседи (для точек у границы)
+    std::unordered_map<TileKey, std::unique_ptr<TileSegmentIndex>, TileKeyHash> index;
+    std::vector<std::pair<TileKey, std::shared_ptr<TileBlob>>> blobs;
+    for (const auto& gr : order) {
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+          TileKey k{gr.key.z, gr.key.x + dx, gr.key.y + dy};
+          if (index.count(k)) continue;
+          index.emplace(k, nullptr);
+          if (auto b = storeFor(profile).load(k.z, k.x, k.y)) blobs.emplace_back(k, std::move(b));
+        }
+      }
+    }
+    parallelFor(blobs.size(), [&](size_t i) {
+      TileView view(blobs[i].second->buffer);
+      if (!view.valid()) return;
+      if (view.profileMask() != 0 && (view.profileMask() & profile.access_mask) == 0) return;
+      // в индекс — только доступные профилю рёбра
+      auto idx = std::make_unique<TileSegmentIndex>();
+      idx->build(view, blobs[i].first, [&](uint32_t ei) {
+        const auto* e = view.edgeAt(ei);
+        return (profile.access_mask & e->access_mask()) != 0 && profile.speeds_mps[static_cast<int>(e->road_class())] > 0.0;
+      });
+      index.at(blobs[i].first) = std::move(idx); // ключ уже есть — map не перестраивается
+    });
+
+    auto project = [&](const TileKey& key, size_t pi) {
+      const auto* idx = index.at(key).get();
+      size_t seg = 0; double t = 0.0, d2 = 0.0;
+      if (!idx || !idx->nearest(points[pi].lat, points[pi].lon, seg, t, d2)) return;
+      const double lat = idx->projLat(seg, t);
+      const double lon = idx->projLon(seg, t);
+      const double d = haversine(points[pi].lat, points[pi].lon, lat, lon);
+      if (d >= res.distances_m[pi]) return;
+      const uint32_t ei = idx->edge[seg];
+      auto len = idx->edgeLen.find(ei);
+      const double segLen = std::sqrt(idx->dx[seg]*idx->dx[seg] + idx->dy[seg]*idx->dy[seg]);
+      res.edge_ids[pi] = makeEdgeId(key.z, static_cast<uint32_t>(key.x), static_cast<uint32_t>(key.y), ei);
+      res.offsets[pi] = len == idx->edgeLen.end() ? 0.0 : std::clamp((idx->along[seg] + t * segLen) / len->second, 0.0, 1.0);
+      res.distances_m[pi] = d;
+      res.projected[pi] = Coord{lat, lon};
+    };
+
+    parallelFor(order.size(), [&](size_t gi) {
+      const auto& gr = order[gi];
+      double latMin, lonMin, latMax, lonMax;
+      webTileBounds(gr.key.z, gr.key.x, gr.key.y, latMin, lonMin, latMax, lonMax);
+      for (size_t pi : gr.pts) {
+        project(gr.key, pi);
+        // ближайшая дорога может лежать в соседнем тайле, если до границы ближе, чем до найденной
+        const auto& c = points[pi];
+        const double toEdge = std::min({haversine(c.lat, c.lon, latMin, c.lon), haversine(c.lat, c.lon, latMax, c.lon),
+                                        haversine(c.lat, c.lon, c.lat, lonMin), haversine(c.lat, c.lon, c.lat, lonMax)});
+        if (res.distances_m[pi] <= toEdge) continue;
+        for (int dy = -1; dy <= 1; ++dy) {
+          for (int dx = -1; dx <= 1; ++dx) {
+            if (dx || dy) project(TileKey{gr.key.z, gr.key.x + dx, gr.key.y + dy}, pi);
+          }
+        }
+      }
+    });
+    return res;
+  }
+
+  // Маршрут между двумя точками: открытая вода, обзорный слой, детальный слой
+  RouteResult routeLeg(const ProfileSettings& profile, const Coord& from, const Coord& to,
+                       const TrafficOverlay* traffic, const RouteOptions& routeOptions) {
+    RouteResult rr;
+    // Обе точки на открытой воде — поиск по квадродеревьям масок; если по воде
+    // пути нет (другое озеро), остаётся граф рек и каналов
+    if (profile.layer == TileLayer::WATER && profile.open_water_speed_mps > 0.0 &&
+        openWater.isWater(from) && openWater.isWater(to)) {
+      const auto t0 = std::chrono::steady_clock::now();
+      rr = openWater.route(from, to, profile.open_water_speed_mps);
+      stats.searchMs += msSince(t0);
+      stats.settledNodes += openWater.lastSettled();
+      if (rr.status == RouteStatus::OK) return rr;
+    }
+
+    // Мультитайловая версия v1: прямоугольник тайлов + динамическая рамка по расстоянию
+    double dist_m_straight = haversine(from.lat, from.lon, to.lat, to.lon);
+
+    // Дальний маршрут: сначала пробуем обзорный слой. Если его нет в БД
+    // или через магистрали путь не нашёлся — обычный поиск по детальному слою.
+    const bool overview = overviewAllowed(profile, from, to, dist_m_straight, routeOptions, traffic);
+    if (overview) {
+      auto tiles = loadTiles(collectHierarchyTiles(from, to), profile);
+      bool hasOverview = std::any_of(tiles.begin(), tiles.end(), [&](const auto& t) {
+        return t.first.z == options.overviewZoom;
+      });
+      if (hasOverview) {
+        rr = routeOnTiles(profile, from, to, tiles, traffic, routeOptions);
+        if (rr.status == RouteStatus::OK) return rr;
+      }
+    }
+
+    const int dyn_frame = detailFrame(dist_m_straight);
+    // Дальнее плечо пропускается через legTooLarge по обзорному прямоугольнику;
+    // детальный на всё расстояние ему не по карману
+    std::string tooLarge;
+    if (tileRangeTooLarge(from, to, dyn_frame, tooLarge)) {
+      rr = RouteResult{};
+      rr.status = overview ? RouteStatus::NO_ROUTE : RouteStatus::INTERNAL_ERROR;
+      rr.error_message = overview ? "no route on the overview layer; detail search " + tooLarge : tooLarge;
+      return rr;
+    }
+    std::vector<TileKey> trefs;
+    collectTileRange(from, to, tileZoom, dyn_frame, trefs);
+    auto tiles = loadTiles(trefs, profile);
+    return routeOnTiles(profile, from, to, tiles, traffic, routeOptions);
+  }
+
+  // Обзорный слой для плеча: только суша (у водного слоя обзорных тайлов нет),
+  // дальние плечи, без исключённых рёбер детального зума и без пробок в коридоре.
+  // Исключения и оверлей заданы edge_id детального зума, а копии тех же дорог
+  // в обзорном слое лежат под другими id и их бы не увидели.
+  bool overviewAllowed(const ProfileSettings& profile, const Coord& from, const Coord& to, double dist_m,
+                       const RouteOptions& routeOptions, const TrafficOverlay* traffic) const {
+    if (profile.layer != TileLayer::LAND || !useOverview(dist_m)) return false;
+    const bool detailExclusions =
+      std::any_of(routeOptions.excludedEdges.begin(), routeOptions.excludedEdges.end(), [&](uint64_t id) {
+        int z; uint32_t x, y, ei; parseEdgeId(id, z, x, y, ei);
+        return z == tileZoom;
+      });
+    if (detailExclusions) return false;
+    if (!traffic || traffic->tileCount() == 0) return true;
+    // коридор обзорного поиска (прямоугольник с рамкой 1) в тайлах детального зума
+    const auto a = webTileKeyFor(from.lat, from.lon, options.overviewZoom);
+    const auto b = webTileKeyFor(to.lat, to.lon, options.overviewZoom);
+    const int shift = tileZoom - options.overviewZoom;
+    return !traffic->hasTilesIn(tileZoom, (std::min(a.x, b.x) - 1) << shift, (std::min(a.y, b.y) - 1) << shift,
+                                ((std::max(a.x, b.x) + 2) << shift) - 1, ((std::max(a.y, b.y) + 2) << shift) - 1);
+  }
+
+  // Рамка детального прямоугольника: тайл ~4 км на экваторе, запас +1, не больше 8
+  static int detailFrame(double dist_m) {
+    return std::clamp(static_cast<int>(std::ceil(dist_m / 4000.0)) + 1, 1, 8);
+  }
+
+  // Плечо, которое загрузит больше options.maxQueryTiles: дальнее — по обзорному
+  // прямоугольнику, прочие — по детальному с рамкой detailFrame
+  bool legTooLarge(const ProfileSettings& profile, const Coord& from, const Coord& to,
+                   const RouteOptions& routeOptions, const TrafficOverlay* traffic, std::string& error) const {
+    const double dist_m = haversine(from.lat, from.lon, to.lat, to.lon);
+    if (overviewAllowed(profile, from, to, dist_m, routeOptions, traffic)) {
+      return tileRangeTooLarge(from, to, 1, error, options.overviewZoom);
+    }
+    return tileRangeTooLarge(from, to, detailFrame(dist_m), error);
+  }
+
+  bool routeTooLarge(const ProfileSettings& profile, const std::vector<Coord>& waypoints,
+                     const RouteOptions& routeOptions, const TrafficOverlay* traffic, std::string& error) const {
+    for (size_t k = 1; k < waypoints.size(); ++k) {
+      if (legTooLarge(profile, waypoints[k - 1], waypoints[k], routeOptions, traffic, error)) {
+        if (waypoints.size() > 2) error = "leg " + std::to_string(k) + ": " + error;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Число тайлов прямоугольника точек с рамкой; больше options.maxQueryTiles — ошибка запроса
+  bool tileRangeTooLarge(const Coord& lo, const Coord& hi, int frame, std::string& error, int z = 0) const {
+    if (options.maxQueryTiles == 0) return false;
+    if (z == 0) z = tileZoom;
+    const auto a = webTileKeyFor(lo.lat, lo.lon, z);
+    const auto b = webTileKeyFor(hi.lat, hi.lon, z);
+    const size_t n = static_cast<size_t>(std::abs(a.x - b.x) + 1 + 2 * frame) *
+                     static_cast<size_t>(std::abs(a.y - b.y) + 1 + 2 * frame);
+    if (n <= options.maxQueryTiles) return false;
+    error = "points span " + std::to_string(n) + " tiles, limit " + std::to_string(options.maxQueryTiles);
+    return true;
+  }
+
+  // Верхняя граница скорости профиля: время до точки не меньше расстояния / vmax
+  static double maxSpeedMps(const ProfileSettings& profile, const TrafficOverlay* traffic) {
+    double v = *std::max_element(profile.speeds_mps.begin(), profile.speeds_mps.end());
+    // течение рек в тайлах не быстрее 1 м/с (serializer конвертера)
+    if (profile.layer == TileLayer::WATER) v += std::abs(profile.flow_factor) * 1.0;
+    if (traffic) v *= TrafficOverlay::kMaxFactor;
+    return v;
+  }
+
 }; // Impl
 
 Router::Router(const std::string& db_path, RouterOptions opt)
@@ -603,133 +1584,223 @@ Router::Router(const std::string& db_path, RouterOptions opt)
 
 Router::~Router() = default;
 
-RouteResult Router::route(const ProfileSettings& profile, const std::vector<Coord>& waypoints) {
-  RouteResult rr;
-  if (waypoints.size() < 2) {
-    rr.status = RouteStatus::INTERNAL_ERROR;
-    rr.error_message = "need at least 2 waypoints";
-    return rr;
+void Router::setTrafficOverlay(std::shared_ptr<const TrafficOverlay> overlay) {
+  std::lock_guard<std::mutex> lock(impl_->trafficMutex);
+  impl_->traffic = std::move(overlay);
+}
+
+std::shared_ptr<const TrafficOverlay> Router::trafficOverlay() const {
+  std::lock_guard<std::mutex> lock(impl_->trafficMutex);
+  return impl_->traffic;
+}
+
+void Router::updateTraffic(std::vector<TrafficUpdate> updates) {
+  std::lock_guard<std::mutex> writer(impl_->trafficWriteMutex);
+  auto base = trafficOverlay();
+  auto next = base ? base->withUpdates(std::move(updates)) : TrafficOverlay().withUpdates(std::move(updates));
+  setTrafficOverlay(std::move(next));
+}
+
+const QueryStats& Router::lastQueryStats() const {
+  return impl_->stats;
+}
+
+NearestResult Router::nearest(const ProfileSettings& profile, const Coord& origin,
+                              const std::vector<Coord>& candidates, size_t k,
+                              SearchDirection dir, const RouteOptions& routeOptions) {
+  impl_->stats = {};
+  NearestResult res;
+  if (candidates.empty() || k == 0) {
+    res.status = RouteStatus::INTERNAL_ERROR;
+    res.error_message = "need at least one candidate and k > 0";
+    return res;
+  }
+  std::shared_ptr<const TrafficOverlay> traffic;
+  if (profile.use_traffic) traffic = trafficOverlay();
+
+  // Окно тайлов растёт от origin (радиус удваивается), пока k ближайших не
+  // доказаны: время k-го * vmax не дальше зазора между тайлом origin и границей
+  // окна — любой путь за окно и любой кандидат вне его не быстрее. Окно не
+  // выходит за прямоугольник всех кандидатов с рамкой в тайл (прежний предел).
+  const int z = impl_->tileZoom;
+  const auto o = webTileKeyFor(origin.lat, origin.lon, z);
+  std::vector<WebTileKey> candidateTiles;
+  candidateTiles.reserve(candidates.size());
+  int minx = o.x, maxx = o.x, miny = o.y, maxy = o.y;
+  for (const auto& c : candidates) {
+    const auto t = webTileKeyFor(c.lat, c.lon, z);
+    candidateTiles.push_back(t);
+    minx = std::min(minx, t.x); maxx = std::max(maxx, t.x);
+    miny = std::min(miny, t.y); maxy = std::max(maxy, t.y);
   }
+  --minx; ++maxx; --miny; ++maxy;
+  const double vmax = Impl::maxSpeedMps(profile, traffic.get());
+  double oLatMin, oLonMin, oLatMax, oLonMax;
+  webTileBounds(z, o.x, o.y, oLatMin, oLonMin, oLatMax, oLonMax);
+
+  for (int r = 1;; r *= 2) {
+    const int x0 = std::max(minx, o.x - r), x1 = std::min(maxx, o.x + r);
+    const int y0 = std::max(miny, o.y - r), y1 = std::min(maxy, o.y + r);
+    const bool full = x0 == minx && x1 == maxx && y0 == miny && y1 == maxy;
+    const size_t windowTiles = static_cast<size_t>(x1 - x0 + 1) * static_cast<size_t>(y1 - y0 + 1);
+    if (impl_->options.maxQueryTiles > 0 && windowTiles > impl_->options.maxQueryTiles) {
+      res.status = RouteStatus::INTERNAL_ERROR;
+      res.error_message = "search area exceeds " + std::to_string(impl_->options.maxQueryTiles) + " tiles";
+      return res;
+    }
+    // кандидаты, у которых в окне есть и рамка в тайл
+    std::vector<Coord> inside;
+    std::vector<size_t> indexOf;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      const auto& t = candidateTiles[i];
+      if (t.x > x0 && t.x < x1 && t.y > y0 && t.y < y1) { inside.push_back(candidates[i]); indexOf.push_back(i); }
+    }
 
-  // Мультитайловая версия v1: прямоугольник тайлов + динамическая рамка по расстоянию
-  double dist_m_straight = Impl::haversine(waypoints.front().lat, waypoints.front().lon,
-                                           waypoints.back().lat,  waypoints.back().lon);
-  double dist_km = dist_m_straight / 1000.0;
-  // Эвристика: размер тайла ~4 км на экваторе; возьмём запас +1 и лимит сверху
-  int dyn_frame = static_cast<int>(std::ceil(dist_km / 4.0)) + 1;
-  if (dyn_frame < 1) dyn_frame = 1;
-  if (dyn_frame > 8) dyn_frame = 8;
-  std::vector<TileKey> trefs; impl_->collectTileRange(waypoints.front(), waypoints.back(), dyn_frame, trefs);
-  std::vector<std::pair<TileKey,TileView>> tiles;
-  tiles.reserve(trefs.size());
-  for (auto& tr : trefs) {
-    auto b = impl_->store.load(tr.z, tr.x, tr.y);
-    if (!b) continue;
-    TileView v(b->buffer);
-    if (!v.valid() || v.edgeCount()==0 || v.nodeCount()<2) continue;
-    tiles.emplace_back(tr, std::move(v));
-  }
-  if (tiles.empty()) { rr.status = RouteStatus::NO_TILE; rr.error_message = "no tiles in range"; return rr; }
-
-  std::vector<Impl::GlobalNode> nodes; std::vector<std::vector<Impl::GlobalEdge>> adj; std::vector<std::vector<std::pair<int,int>>> revAdj; std::unordered_map<uint64_t,int> q2node;
-  impl_->buildGlobalGraph(profile, tiles, nodes, adj, revAdj, q2node);
-
-  // снап по всем тайлам: просто выберем ближайший edgeSnap среди tiles[0..]
-  auto bestSnap = [&](const Coord& c){
-    std::optional<Impl::EdgeSnap> best; double bestD=std::numeric_limits<double>::infinity(); int bestTile=-1;
-    for (int i=0;i<(int)tiles.size();++i){ auto s=Impl::snapToEdge(tiles[i].second,c.lat,c.lon, profile); if(!s) continue; if(s->dist_m<bestD){ best= s; bestD=s->dist_m; bestTile=i; } }
-    return std::tuple{best, bestTile}; };
-
-  auto [sSnap, sTile] = bestSnap(waypoints.front());
-  auto [tSnap, tTile] = bestSnap(waypoints.back());
-  if (!sSnap || !tSnap) { rr.status=RouteStatus::NO_ROUTE; rr.error_message="failed to snap (multi-tile)"; return rr; }
-
-  // глобальные узлы для старта/финиша — привяжем к ближайшим реальным узлам (from/to соответствующих рёбер)
-  auto& sView = tiles[sTile].second; auto& tView = tiles[tTile].second;
-  int sFrom = q2node[(static_cast<uint64_t>(static_cast<uint32_t>(sView.nodeLatQ(sSnap->fromNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(sView.nodeLonQ(sSnap->fromNode)))];
-  int sTo   = q2node[(static_cast<uint64_t>(static_cast<uint32_t>(sView.nodeLatQ(sSnap->toNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(sView.nodeLonQ(sSnap->toNode)))];
-  int tFrom = q2node[(static_cast<uint64_t>(static_cast<uint32_t>(tView.nodeLatQ(tSnap->fromNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(tView.nodeLonQ(tSnap->fromNode)))];
-  int tTo   = q2node[(static_cast<uint64_t>(static_cast<uint32_t>(tView.nodeLatQ(tSnap->toNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(tView.nodeLonQ(tSnap->toNode)))];
-
-  // выберем стартовый и конечный глобальные узлы как ближайшие из пары (from/to) по геометрии
-  auto pickClosest = [&](int a, int b, const Coord& c){ double da=Impl::haversine(nodes[a].lat,nodes[a].lon,c.lat,c.lon); double db=Impl::haversine(nodes[b].lat,nodes[b].lon,c.lat,c.lon); return (da<=db)?a:b; };
-  int sNode = pickClosest(sFrom, sTo, waypoints.front());
-  int tNode = pickClosest(tFrom, tTo, waypoints.back());
-
-  std::vector<int> gpath; std::vector<uint64_t> eids;
-  // Добавим виртуальные узлы vS,vE и полу-рёбра до ближайших узлов snapped-ребёр с учётом oneway
-  int vS = static_cast<int>(nodes.size());
-  nodes.push_back(Impl::GlobalNode{sSnap->projLat, sSnap->projLon});
-  adj.emplace_back();
-  int vE = static_cast<int>(nodes.size());
-  nodes.push_back(Impl::GlobalNode{tSnap->projLat, tSnap->projLon});
-  adj.emplace_back();
-
-  auto addVS = [&](const TileView& view, const Impl::EdgeSnap& snap){
-    const auto* e = view.edgeAt(snap.edgeIdx);
-    double speed = profile.speeds_mps[static_cast<int>(e->road_class())];
-    if (speed<=0.0) return;
-    double w = e->length_m()/speed;
-    double t = std::clamp(snap.t, 0.0, 1.0);
-    // fromNode -> vS (доля t)
-    if (!e->oneway()) {
-      adj[sNode].push_back(Impl::GlobalEdge{vS, t*w, 1u, 0,0,0});
-    } else {
-      // oneway: допускаем вход в vS только если направление from->to
-      uint64_t kFrom = (static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLatQ(snap.fromNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLonQ(snap.fromNode)));
-      int fromGlobal = q2node[kFrom];
-      if (fromGlobal==sNode) adj[sNode].push_back(Impl::GlobalEdge{vS, t*w, 1u, 0,0,0});
-    }
-    // vS -> toNode (доля 1-t) всегда по направлению ребра
-    uint64_t kTo = (static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLatQ(snap.toNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLonQ(snap.toNode)));
-    int toGlobal = q2node[kTo];
-    adj[vS].push_back(Impl::GlobalEdge{toGlobal, (1.0-t)*w, 1u, 0,0,0});
-    // если не oneway — позволяем обратный ход vS->fromNode
-    if (!e->oneway()) {
-      uint64_t kFrom2 = (static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLatQ(snap.fromNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLonQ(snap.fromNode)));
-      int fromGlobal = q2node[kFrom2];
-      adj[vS].push_back(Impl::GlobalEdge{fromGlobal, t*w, 1u, 0,0,0});
+    NearestResult part;
+    if (!inside.empty()) {
+      std::vector<TileKey> trefs;
+      for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) trefs.push_back(TileKey{z, x, y});
+      }
+      auto tiles = impl_->loadTiles(trefs, profile);
+      part = impl_->nearestOnTiles(profile, origin, inside, std::min(k, inside.size()), dir, tiles,
+                                   traffic.get(), routeOptions);
+      for (auto& h : part.hits) h.candidate = indexOf[h.candidate];
     }
-  };
+    if (full) return part;
+    if (part.status != RouteStatus::OK || part.hits.size() < std::min(k, candidates.size())) continue;
 
-  auto addVE = [&](const TileView& view, const Impl::EdgeSnap& snap){
-    const auto* e = view.edgeAt(snap.edgeIdx);
-    double speed = profile.speeds_mps[static_cast<int>(e->road_class())];
-    if (speed<=0.0) return;
-    double w = e->length_m()/speed;
-    double t = std::clamp(snap.t, 0.0, 1.0);
-    // fromNode -> vE (доля t) по направлению ребра
-    uint64_t kFrom3 = (static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLatQ(snap.fromNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLonQ(snap.fromNode)));
-    int fromGlobal = q2node[kFrom3];
-    adj[fromGlobal].push_back(Impl::GlobalEdge{vE, t*w, 1u, 0,0,0});
-    // если не oneway — toNode -> vE (доля 1-t)
-    if (!e->oneway()) {
-      uint64_t kTo2 = (static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLatQ(snap.toNode)))<<32) ^ static_cast<uint64_t>(static_cast<uint32_t>(view.nodeLonQ(snap.toNode)));
-      int toGlobal = q2node[kTo2];
-      adj[toGlobal].push_back(Impl::GlobalEdge{vE, (1.0-t)*w, 1u, 0,0,0});
+    // зазор до внутренней границы окна; стороны, упёршиеся в предел, не считаются
+    double innerLatMin, innerLonMin, innerLatMax, innerLonMax, unused;
+    webTileBounds(z, x0 + 1, y1 - 1, innerLatMin, innerLonMin, unused, unused);
+    webTileBounds(z, x1 - 1, y0 + 1, unused, unused, innerLatMax, innerLonMax);
+    constexpr double R = 6371000.0;
+    const double phi = std::max(std::abs(innerLatMin), std::abs(innerLatMax)) * M_PI / 180.0;
+    auto meridianGap = [&](double dLonDeg) { return R * std::asin(std::cos(phi) * std::sin(dLonDeg * M_PI / 180.0)); };
+    double gap = std::numeric_limits<double>::infinity();
+    if (x0 > minx) gap = std::min(gap, meridianGap(oLonMin - innerLonMin));
+    if (x1 < maxx) gap = std::min(gap, meridianGap(innerLonMax - oLonMax));
+    if (y1 < maxy) gap = std::min(gap, R * (oLatMin - innerLatMin) * M_PI / 180.0);
+    if (y0 > miny) gap = std::min(gap, R * (innerLatMax - oLatMax) * M_PI / 180.0);
+    if (part.hits.back().duration_s * vmax <= gap) return part;
+  }
+}
+
+SnapBatchResult Router::snapBatch(const ProfileSettings& profile, const std::vector<Coord>& points) {
+  impl_->stats = {};
+  const TileStore& ts = impl_->storeFor(profile);
+  const uint64_t hits0 = ts.cacheHits(), misses0 = ts.cacheMisses();
+  auto res = impl_->snapBatch(profile, points);
+  impl_->stats.tileCacheHits = ts.cacheHits() - hits0;
+  impl_->stats.tileCacheMisses = ts.cacheMisses() - misses0;
+  return res;
+}
+
+TripResult Router::trip(const ProfileSettings& profile, const std::vector<Coord>& stops,
+                        bool fixedStart, bool fixedEnd, const RouteOptions& routeOptions) {
+  impl_->stats = {};
+  TripResult tr;
+  if (stops.size() < 2) {
+    tr.status = RouteStatus::INTERNAL_ERROR;
+    tr.error_message = "need at least 2 stops";
+    return tr;
+  }
+  std::shared_ptr<const TrafficOverlay> traffic;
+  if (profile.use_traffic) traffic = trafficOverlay();
+
+  Coord lo = stops.front(), hi = stops.front();
+  for (const auto& c : stops) {
+    lo.lat = std::min(lo.lat, c.lat); lo.lon = std::min(lo.lon, c.lon);
+    hi.lat = std::max(hi.lat, c.lat); hi.lon = std::max(hi.lon, c.lon);
+  }
+  if (impl_->tileRangeTooLarge(lo, hi, 1, tr.error_message)) {
+    tr.status = RouteStatus::INTERNAL_ERROR;
+    return tr;
+  }
+  std::vector<TileKey> trefs;
+  Impl::collectTileRange(lo, hi, impl_->tileZoom, 1, trefs);
+  auto tiles = impl_->loadTiles(trefs, profile);
+  return impl_->tripOnTiles(profile, stops, fixedStart, fixedEnd, tiles, traffic.get(), routeOptions);
+}
+
+MatrixResult Router::matrix(const ProfileSettings& profile, const std::vector<Coord>& sources,
+                            const std::vector<Coord>& targets, const RouteOptions& routeOptions) {
+  impl_->stats = {};
+  MatrixResult res;
+  if (sources.empty() || targets.empty()) {
+    res.status = RouteStatus::INTERNAL_ERROR;
+    res.error_message = "need at least one source and one target";
+    return res;
+  }
+  std::shared_ptr<const TrafficOverlay> traffic;
+  if (profile.use_traffic) traffic = trafficOverlay();
+
+  Coord lo = sources.front(), hi = sources.front();
+  for (const auto* list : {&sources, &targets}) {
+    for (const auto& c : *list) {
+      lo.lat = std::min(lo.lat, c.lat); lo.lon = std::min(lo.lon, c.lon);
+      hi.lat = std::max(hi.lat, c.lat); hi.lon = std::max(hi.lon, c.lon);
     }
-  };
+  }
+  if (impl_->tileRangeTooLarge(lo, hi, 1, res.error_message)) {
+    res.status = RouteStatus::INTERNAL_ERROR;
+    return res;
+  }
+  std::vector<TileKey> trefs;
+  Impl::collectTileRange(lo, hi, impl_->tileZoom, 1, trefs);
+  auto tiles = impl_->loadTiles(trefs, profile);
+  return impl_->matrixOnTiles(profile, sources, targets, tiles, traffic.get(), routeOptions);
+}
 
-  addVS(sView, *sSnap);
-  addVE(tView, *tSnap);
+RouteResult Router::route(const ProfileSettings& profile, const std::vector<Coord>& waypoints) {
+  return route(profile, waypoints, RouteOptions{});
+}
 
-  if (!impl_->astarGlobalBi(nodes, adj, revAdj, vS, vE, gpath, eids)) { rr.status=RouteStatus::NO_ROUTE; rr.error_message="no path in multi-tile"; return rr; }
+bool Router::routeTooLarge(const ProfileSettings& profile, const std::vector<Coord>& waypoints,
+                           const RouteOptions& routeOptions, std::string& error) const {
+  std::shared_ptr<const TrafficOverlay> traffic;
+  if (profile.use_traffic) traffic = trafficOverlay();
+  return impl_->routeTooLarge(profile, waypoints, routeOptions, traffic.get(), error);
+}
 
-  // собрать polyline по edgeIds
-  rr.polyline.clear(); rr.edge_ids = eids; rr.distance_m=0; rr.duration_s=0;
-  auto appendPoint=[&](double la,double lo){ if(!rr.polyline.empty()){ auto& L=rr.polyline.back(); rr.distance_m+=Impl::haversine(L.lat,L.lon,la,lo);} rr.polyline.push_back(Coord{la,lo}); };
-  for (auto id : eids){
-    int z; uint32_t x,y,ei; Impl::parseEdgeId(id, z, x, y, ei);
-    // найдём view по (x,y)
-    TileView const* vptr=nullptr;
-    for (auto& pr: tiles){ if (pr.first.x==(int)x && pr.first.y==(int)y){ vptr=&pr.second; break; } }
-    if (!vptr) continue;
-    std::vector<std::pair<double,double>> pts;
-    vptr->appendEdgeShape(static_cast<uint32_t>(ei), pts, /*skipFirst*/!rr.polyline.empty());
-    for (auto& p:pts) appendPoint(p.first,p.second);
-    rr.duration_s += Impl::edgeTraversalTimeSec(vptr->edgeAt(static_cast<uint32_t>(ei)), profile);
+bool Router::isOpenWater(const Coord& c) {
+  return impl_->openWater.isWater(c);
+}
+
+RouteResult Router::route(const ProfileSettings& profile, const std::vector<Coord>& waypoints,
+                          const RouteOptions& routeOptions) {
+  impl_->stats = {};
+  RouteResult rr;
+  if (waypoints.size() < 2) {
+    rr.status = RouteStatus::INTERNAL_ERROR;
+    rr.error_message = "need at least 2 waypoints";
+    return rr;
   }
+  // снимок пробок на весь запрос
+  std::shared_ptr<const TrafficOverlay> traffic;
+  if (profile.use_traffic) traffic = trafficOverlay();
+  if (impl_->routeTooLarge(profile, waypoints, routeOptions, traffic.get(), rr.error_message)) {
+    rr.status = RouteStatus::INTERNAL_ERROR;
+    return rr;
+  }
+  if (waypoints.size() == 2) {
+    return impl_->routeLeg(profile, waypoints.front(), waypoints.back(), traffic.get(), routeOptions);
+  }
+
+  // Промежуточные точки: плечо за плечом, геометрия склеивается в общей точке
   rr.status = RouteStatus::OK;
+  for (size_t k = 1; k < waypoints.size(); ++k) {
+    RouteResult leg = impl_->routeLeg(profile, waypoints[k - 1], waypoints[k], traffic.get(), routeOptions);
+    if (leg.status != RouteStatus::OK) {
+      leg.error_message = "leg " + std::to_string(k) + ": " + leg.error_message;
+      return leg;
+    }
+    const bool shared = !rr.polyline.empty() && !leg.polyline.empty();
+    rr.polyline.insert(rr.polyline.end(), leg.polyline.begin() + (shared ? 1 : 0), leg.polyline.end());
+    rr.edge_ids.insert(rr.edge_ids.end(), leg.edge_ids.begin(), leg.edge_ids.end());
+    rr.distance_m += leg.distance_m;
+    rr.duration_s += leg.duration_s;
+  }
   return rr;
 }
 
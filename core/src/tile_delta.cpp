@@ -0,0 +1,124 @@
+#include "routing_core/tile_delta.h"
+
+#include <cstring>
+#include <unordered_map>
+
+namespace routing_core {
+
+namespace {
+
+constexpr uint8_t kMagic[4] = {'L', 'X', 'D', '1'};
+constexpr size_t kBlock = 16;  // минимальная длина совпадения
+constexpr uint8_t kOpCopy = 0x00;
+constexpr uint8_t kOpInsert = 0x01;
+
+void putVarint(std::vector<uint8_t>& out, uint64_t v) {
+  while (v >= 0x80) {
+    out.push_back(static_cast<uint8_t>(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(v));
+}
+
+bool getVarint(const uint8_t* p, size_t size, size_t& pos, uint64_t& v) {
+  v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (pos >= size) return false;
+    uint8_t b = p[pos++];
+    v |= static_cast<uint64_t>(b & 0x7F) << shift;
+    if ((b & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+inline uint64_t blockHash(const uint8_t* p) {
+  uint64_t a, b;
+  std::memcpy(&a, p, 8);
+  std::memcpy(&b, p + 8, 8);
+  return (a * 0x9E3779B97F4A7C15ULL) ^ (b + 0x632BE59BD9B4E019ULL + (a >> 29));
+}
+
+} // namespace
+
+std::vector<uint8_t> encodeBinaryDelta(const uint8_t* oldData, size_t oldSize,
+                                       const uint8_t* newData, size_t newSize) {
+  std::vector<uint8_t> out(kMagic, kMagic + 4);
+  putVarint(out, newSize);
+
+  // Индекс блоков старого BLOB'а (шаг 8 байт — компромисс память/качество)
+  std::unordered_map<uint64_t, uint32_t> index;
+  if (oldSize >= kBlock) {
+    index.reserve(oldSize / 8 + 1);
+    for (size_t i = 0; i + kBlock <= oldSize; i += 8) {
+      index.emplace(blockHash(oldData + i), static_cast<uint32_t>(i));
+    }
+  }
+
+  size_t literalStart = 0;
+  auto flushLiteral = [&](size_t end) {
+    if (end <= literalStart) return;
+    out.push_back(kOpInsert);
+    putVarint(out, end - literalStart);
+    out.insert(out.end(), newData + literalStart, newData + end);
+  };
+
+  size_t pos = 0;
+  while (pos + kBlock <= newSize) {
+    auto it = index.find(blockHash(newData + pos));
+    if (it == index.end() || std::memcmp(oldData + it->second, newData + pos, kBlock) != 0) {
+      ++pos;
+      continue;
+    }
+    size_t oldPos = it->second;
+    size_t newPos = pos;
+    // расширяем совпадение назад (в пределах текущего литерала) и вперёд
+    while (newPos > literalStart && oldPos > 0 && oldData[oldPos - 1] == newData[newPos - 1]) {
+      --oldPos; --newPos;
+    }
+    size_t len = pos - newPos + kBlock;
+    while (newPos + len < newSize && oldPos + len < oldSize && oldData[oldPos + len] == newData[newPos + len]) {
+      ++len;
+    }
+    flushLiteral(newPos);
+    out.push_back(kOpCopy);
+    putVarint(out, oldPos);
+    putVarint(out, len);
+    pos = newPos + len;
+    literalStart = pos;
+  }
+  flushLiteral(newSize);
+  return out;
+}
+
+bool applyBinaryDelta(const uint8_t* oldData, size_t oldSize,
+                      const uint8_t* delta, size_t deltaSize,
+                      std::vector<uint8_t>& out) {
+  out.clear();
+  if (deltaSize < 4 || std::memcmp(delta, kMagic, 4) != 0) return false;
+  size_t pos = 4;
+  uint64_t newSize = 0;
+  if (!getVarint(delta, deltaSize, pos, newSize)) return false;
+  out.reserve(static_cast<size_t>(newSize));
+
+  while (pos < deltaSize) {
+    uint8_t op = delta[pos++];
+    if (op == kOpCopy) {
+      uint64_t off = 0, len = 0;
+      if (!getVarint(delta, deltaSize, pos, off) || !getVarint(delta, deltaSize, pos, len)) return false;
+      if (off > oldSize || len > oldSize - off) return false;
+      out.insert(out.end(), oldData + off, oldData + off + len);
+    } else if (op == kOpInsert) {
+      uint64_t len = 0;
+      if (!getVarint(delta, deltaSize, pos, len)) return false;
+      if (len > deltaSize - pos) return false;
+      out.insert(out.end(), delta + pos, delta + pos + len);
+      pos += static_cast<size_t>(len);
+    } else {
+      return false;
+    }
+    if (out.size() > newSize) return false;
+  }
+  return out.size() == newSize;
+}
+
+} // namespace routing_core
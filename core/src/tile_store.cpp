@@ -5,8 +5,9 @@
 
 using namespace routing_core;
 
-TileStore::TileStore(const std::string& db_path, size_t cacheCapacity)
-  : capacity_(cacheCapacity) {
+TileStore::TileStore(const std::string& db_path, size_t cacheCapacity, const std::string& table)
+  : select_sql_("SELECT data FROM " + table + " WHERE z=? AND x=? AND y=? LIMIT 1;"),
+    capacity_(cacheCapacity) {
   if (sqlite3_open(db_path.c_str(), &db_) != SQLITE_OK) {
     throw std::runtime_error(std::string("Failed to open routingdb: ") + sqlite3_errmsg(db_));
   }
@@ -27,9 +28,11 @@ std::shared_ptr<TileBlob> TileStore::load(int z, int x, int y) {
     lru_.erase(it->second.it);
     lru_.push_front(key);
     it->second.it = lru_.begin();
+    ++hits_;
     return it->second.blob;
   }
 
+  ++misses_;
   auto blob = loadFromDb(z,x,y);
   if (!blob) return nullptr;
   insertLRU(key, blob);
@@ -37,10 +40,9 @@ std::shared_ptr<TileBlob> TileStore::load(int z, int x, int y) {
 }
 
 std::shared_ptr<TileBlob> TileStore::loadFromDb(int z, int x, int y) {
-  static const char* sql =
-      "SELECT data FROM land_tiles WHERE z=? AND x=? AND y=? LIMIT 1;";
   sqlite3_stmt* stmt = nullptr;
-  if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+  // нет таблицы (пакет без водного слоя) — тайла просто нет
+  if (sqlite3_prepare_v2(db_, select_sql_.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
     return nullptr;
   }
   sqlite3_bind_int(stmt, 1, z);
@@ -0,0 +1,180 @@
+#include "routing_core/traffic.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+
+#include <unistd.h>
+
+#include "routing_core/edge_id.h"
+
+namespace routing_core {
+
+namespace {
+
+constexpr uint64_t kEdgeIdxMask = 0xFFFFull;
+
+uint8_t quantizeFactor(double f) {
+  if (!(f > 0.0)) return 0;
+  double q = std::round(std::min(f, TrafficOverlay::kMaxFactor) * 100.0);
+  return static_cast<uint8_t>(std::clamp(q, 1.0, 255.0)); // положительный множитель не превращается в перекрытие
+}
+
+} // namespace
+
+double TrafficOverlay::TileFactors::factor(uint32_t edgeIdx) const {
+  auto it = std::lower_bound(edges.begin(), edges.end(), static_cast<uint16_t>(edgeIdx));
+  if (it == edges.end() || *it != edgeIdx) return -1.0;
+  return factors[static_cast<size_t>(it - edges.begin())] / 100.0;
+}
+
+const TrafficOverlay::TileFactors* TrafficOverlay::tile(int z, int x, int y) const {
+  auto it = tiles_.find(edgeid::make(z, static_cast<uint32_t>(x), static_cast<uint32_t>(y), 0));
+  return it == tiles_.end() ? nullptr : it->second.get();
+}
+
+double TrafficOverlay::factor(uint64_t edgeId) const {
+  auto it = tiles_.find(edgeId & ~kEdgeIdxMask);
+  if (it == tiles_.end()) return 1.0;
+  double f = it->second->factor(static_cast<uint32_t>(edgeId & kEdgeIdxMask));
+  return f < 0.0 ? 1.0 : f;
+}
+
+bool TrafficOverlay::hasTilesIn(int z, int minX, int minY, int maxX, int maxY) const {
+  for (const auto& kv : tiles_) {
+    int tz; uint32_t x, y, idx;
+    edgeid::parse(kv.first, tz, x, y, idx);
+    if (tz != z || kv.second->edges.empty()) continue;
+    if (static_cast<int>(x) >= minX && static_cast<int>(x) <= maxX &&
+        static_cast<int>(y) >= minY && static_cast<int>(y) <= maxY) return true;
+  }
+  return false;
+}
+
+std::shared_ptr<const TrafficOverlay> TrafficOverlay::withUpdates(std::vector<TrafficUpdate> updates) const {
+  auto next = std::make_shared<TrafficOverlay>(*this);
+  // порядок edge_id = порядок (тайл, индекс ребра); при повторах побеждает последнее
+  std::stable_sort(updates.begin(), updates.end(),
+                   [](const TrafficUpdate& a, const TrafficUpdate& b) { return a.edge_id < b.edge_id; });
+
+  size_t i = 0;
+  while (i < updates.size()) {
+    const uint64_t tileKey = updates[i].edge_id & ~kEdgeIdxMask;
+    size_t end = i;
+    while (end < updates.size() && (updates[end].edge_id & ~kEdgeIdxMask) == tileKey) ++end;
+
+    auto found = next->tiles_.find(tileKey);
+    const TileFactors* old = found == next->tiles_.end() ? nullptr : found->second.get();
+    const size_t oldSize = old ? old->edges.size() : 0;
+
+    auto merged = std::make_shared<TileFactors>();
+    merged->edges.reserve(oldSize + (end - i));
+    merged->factors.reserve(oldSize + (end - i));
+    size_t k = 0;
+    for (size_t u = i; u < end; ++u) {
+      if (u + 1 < end && updates[u + 1].edge_id == updates[u].edge_id) continue;
+      const auto idx = static_cast<uint16_t>(updates[u].edge_id & kEdgeIdxMask);
+      while (k < oldSize && old->edges[k] < idx) {
+        merged->edges.push_back(old->edges[k]);
+        merged->factors.push_back(old->factors[k]);
+        ++k;
+      }
+      if (k < oldSize && old->edges[k] == idx) ++k;
+      if (updates[u].factor < 0.0) continue;
+      merged->edges.push_back(idx);
+      merged->factors.push_back(quantizeFactor(updates[u].factor));
+    }
+    for (; k < oldSize; ++k) {
+      merged->edges.push_back(old->edges[k]);
+      merged->factors.push_back(old->factors[k]);
+    }
+
+    next->edge_count_ = next->edge_count_ - oldSize + merged->edges.size();
+    if (merged->edges.empty()) {
+      if (found != next->tiles_.end()) next->tiles_.erase(found);
+    } else if (found != next->tiles_.end()) {
+      found->second = std::move(merged);
+    } else {
+      next->tiles_.emplace(tileKey, std::move(merged));
+    }
+    i = end;
+  }
+  return next;
+}
+
+bool parseTrafficLine(const std::string& line, TrafficUpdate& out) {
+  const char* p = line.c_str();
+  while (*p == ' ' || *p == '\t') ++p;
+  if (*p == '\0' || *p == '#' || *p == '\r') return false;
+
+  const bool hex = p[0] == '0' && (p[1] == 'x' || p[1] == 'X');
+  char* end = nullptr;
+  errno = 0;
+  unsigned long long id = std::strtoull(p, &end, hex ? 16 : 10);
+  if (end == p || errno == ERANGE) return false;
+  p = end;
+  double f = std::strtod(p, &end);
+  if (end == p || !std::isfinite(f)) return false;
+
+  out.edge_id = static_cast<uint64_t>(id);
+  out.factor = f;
+  return true;
+}
+
+std::vector<TrafficUpdate> readTrafficUpdates(std::istream& in) {
+  std::vector<TrafficUpdate> out;
+  std::string line;
+  TrafficUpdate u;
+  while (std::getline(in, line)) {
+    if (parseTrafficLine(line, u)) out.push_back(u);
+  }
+  return out;
+}
+
+std::shared_ptr<const TrafficOverlay> loadTrafficOverlay(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) return nullptr;
+  return TrafficOverlay().withUpdates(readTrafficUpdates(in));
+}
+
+size_t readTrafficFeed(int fd, const std::function<void(std::vector<TrafficUpdate>&&)>& onBatch,
+                       size_t maxBatch) {
+  std::vector<TrafficUpdate> batch;
+  std::string line;
+  size_t accepted = 0;
+  auto flush = [&] {
+    if (batch.empty()) return;
+    onBatch(std::move(batch));
+    batch.clear();
+  };
+  auto endLine = [&] {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    TrafficUpdate u;
+    if (line.empty()) {
+      flush();
+    } else if (parseTrafficLine(line, u)) {
+      batch.push_back(u);
+      ++accepted;
+      if (batch.size() >= maxBatch) flush();
+    }
+    line.clear();
+  };
+
+  char buf[64 * 1024];
+  for (;;) {
+    ssize_t n = ::read(fd, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    for (ssize_t i = 0; i < n; ++i) {
+      if (buf[i] == '\n') endLine();
+      else line.push_back(buf[i]);
+    }
+  }
+  if (!line.empty()) endLine();
+  flush();
+  return accepted;
+}
+
+} // namespace routing_core
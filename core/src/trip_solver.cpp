@@ -0,0 +1,159 @@
+#include "routing_core/trip_solver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace routing_core {
+
+namespace {
+
+constexpr double kUnreachable = 1e9; // штраф вместо inf, чтобы дельты оставались конечными
+constexpr double kEps = 1e-9;
+
+class Solver {
+public:
+  Solver(const std::vector<std::vector<double>>& m, bool fixedStart, bool fixedEnd, double budgetMs)
+    : m_(m), n_(m.size()), fixedStart_(fixedStart), fixedEnd_(fixedEnd && m.size() > 1),
+      deadline_(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                  std::chrono::duration<double, std::milli>(budgetMs))) {}
+
+  std::vector<size_t> run() {
+    if (n_ == 0) return {};
+    insertAll();
+    bool improved = true;
+    while (improved && !expired()) {
+      improved = twoOpt() || orOpt();
+    }
+    return seq_;
+  }
+
+private:
+  double c(size_t a, size_t b) const {
+    double v = m_[a][b];
+    return std::isfinite(v) ? v : kUnreachable;
+  }
+  bool expired() const { return std::chrono::steady_clock::now() >= deadline_; }
+
+  // Первая и последняя позиции, которые можно переставлять
+  size_t lo() const { return fixedStart_ ? 1 : 0; }
+  size_t hi() const { return fixedEnd_ ? seq_.size() - 2 : seq_.size() - 1; }
+
+  // Вставка ближайшего: следующая точка — ближайшая к уже построенному пути,
+  // место — с минимальным приростом длительности.
+  void insertAll() {
+    std::vector<uint8_t> in(n_, 0);
+    std::vector<double> nearest(n_, std::numeric_limits<double>::infinity());
+    auto add = [&](size_t pos, size_t u) {
+      seq_.insert(seq_.begin() + static_cast<std::ptrdiff_t>(pos), u);
+      in[u] = 1;
+      for (size_t v = 0; v < n_; ++v) nearest[v] = std::min({nearest[v], c(u, v), c(v, u)});
+    };
+    if (fixedStart_) add(0, 0);
+    if (fixedEnd_) add(seq_.size(), n_ - 1);
+    if (seq_.empty()) add(0, 0);
+
+    for (size_t placed = seq_.size(); placed < n_; ++placed) {
+      size_t u = n_;
+      for (size_t v = 0; v < n_; ++v) {
+        if (!in[v] && (u == n_ || nearest[v] < nearest[u])) u = v;
+      }
+      const size_t first = fixedStart_ ? 1 : 0;
+      const size_t last = fixedEnd_ ? seq_.size() - 1 : seq_.size();
+      size_t bestPos = first;
+      double bestDelta = std::numeric_limits<double>::infinity();
+      for (size_t p = first; p <= last; ++p) {
+        double d = 0.0;
+        if (p > 0) d += c(seq_[p - 1], u);
+        if (p < seq_.size()) d += c(u, seq_[p]);
+        if (p > 0 && p < seq_.size()) d -= c(seq_[p - 1], seq_[p]);
+        if (d < bestDelta) { bestDelta = d; bestPos = p; }
+      }
+      add(bestPos, u);
+    }
+  }
+
+  // 2-opt для несимметричной матрицы: разворот [i..j] меняет и внутренние рёбра,
+  // их стоимость берётся из префиксных сумм в обе стороны.
+  bool twoOpt() {
+    const size_t n = seq_.size();
+    if (n < 3) return false;
+    std::vector<double> fwd(n, 0.0), bwd(n, 0.0);
+    for (size_t k = 1; k < n; ++k) {
+      fwd[k] = fwd[k - 1] + c(seq_[k - 1], seq_[k]);
+      bwd[k] = bwd[k - 1] + c(seq_[k], seq_[k - 1]);
+    }
+    for (size_t i = lo(); i <= hi(); ++i) {
+      for (size_t j = i + 1; j <= hi(); ++j) {
+        double before = fwd[j] - fwd[i], after = bwd[j] - bwd[i];
+        if (i > 0) { before += c(seq_[i - 1], seq_[i]); after += c(seq_[i - 1], seq_[j]); }
+        if (j + 1 < n) { before += c(seq_[j], seq_[j + 1]); after += c(seq_[i], seq_[j + 1]); }
+        if (after + kEps < before) {
+          std::reverse(seq_.begin() + static_cast<std::ptrdiff_t>(i), seq_.begin() + static_cast<std::ptrdiff_t>(j) + 1);
+          return true;
+        }
+      }
+      if (expired()) return false;
+    }
+    return false;
+  }
+
+  // Or-opt: перенос цепочки из 1..3 точек без разворота в лучшее место
+  bool orOpt() {
+    const size_t n = seq_.size();
+    if (n < 3) return false;
+    std::vector<size_t> rest;
+    for (size_t len = 1; len <= 3; ++len) {
+      for (size_t i = lo(); i + len - 1 <= hi(); ++i) {
+        const size_t e = i + len - 1;
+        double removeGain = 0.0;
+        if (i > 0) removeGain += c(seq_[i - 1], seq_[i]);
+        if (e + 1 < n) removeGain += c(seq_[e], seq_[e + 1]);
+        if (i > 0 && e + 1 < n) removeGain -= c(seq_[i - 1], seq_[e + 1]);
+
+        rest.assign(seq_.begin(), seq_.begin() + static_cast<std::ptrdiff_t>(i));
+        rest.insert(rest.end(), seq_.begin() + static_cast<std::ptrdiff_t>(e) + 1, seq_.end());
+        const size_t first = fixedStart_ ? 1 : 0;
+        const size_t last = fixedEnd_ ? rest.size() - 1 : rest.size();
+        for (size_t g = first; g <= last; ++g) {
+          if (g == i) continue; // исходное место
+          double add = 0.0;
+          if (g > 0) add += c(rest[g - 1], seq_[i]);
+          if (g < rest.size()) add += c(seq_[e], rest[g]);
+          if (g > 0 && g < rest.size()) add -= c(rest[g - 1], rest[g]);
+          if (add + kEps < removeGain) {
+            std::vector<size_t> moved(seq_.begin() + static_cast<std::ptrdiff_t>(i), seq_.begin() + static_cast<std::ptrdiff_t>(e) + 1);
+            rest.insert(rest.begin() + static_cast<std::ptrdiff_t>(g), moved.begin(), moved.end());
+            seq_.swap(rest);
+            return true;
+          }
+        }
+      }
+      if (expired()) return false;
+    }
+    return false;
+  }
+
+  const std::vector<std::vector<double>>& m_;
+  size_t n_;
+  bool fixedStart_;
+  bool fixedEnd_;
+  std::chrono::steady_clock::time_point deadline_;
+  std::vector<size_t> seq_;
+};
+
+} // namespace
+
+std::vector<size_t> solveTripOrder(const std::vector<std::vector<double>>& duration,
+                                   bool fixedStart, bool fixedEnd, double timeBudgetMs) {
+  return Solver(duration, fixedStart, fixedEnd, timeBudgetMs).run();
+}
+
+double tripCost(const std::vector<std::vector<double>>& duration, const std::vector<size_t>& order) {
+  double sum = 0.0;
+  for (size_t k = 1; k < order.size(); ++k) sum += duration[order[k - 1]][order[k]];
+  return sum;
+}
+
+} // namespace routing_core
@@ -0,0 +1,427 @@
+#include "http_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr size_t kReadChunk = 16 * 1024;
+constexpr int kMaxEvents = 256;
+
+struct Connection {
+  int fd {-1};
+  std::string in;           // принятые, ещё не разобранные байты
+  std::string out;          // ответы к отправке
+  size_t outPos {0};
+  bool wantWrite {false};   // подписан на EPOLLOUT
+  bool readPaused {false};  // снят с EPOLLIN: ждём отправки ответов
+  bool closeAfterWrite {false};
+  bool continueSent {false};
+};
+
+bool iequals(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    char x = a[i], y = b[i];
+    if (x >= 'A' && x <= 'Z') x = static_cast<char>(x - 'A' + 'a');
+    if (y >= 'A' && y <= 'Z') y = static_cast<char>(y - 'A' + 'a');
+    if (x != y) return false;
+  }
+  return true;
+}
+
+std::string_view trim(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+  return s;
+}
+
+const char* reasonPhrase(int status) {
+  switch (status) {
+    case 100: return "Continue";
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 406: return "Not Acceptable";
+    case 413: return "Payload Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+  }
+}
+
+void appendResponse(std::string& out, const HttpResponse& resp, bool keepAlive) {
+  char head[256];
+  const int n = std::snprintf(head, sizeof(head),
+                              "HTTP/1.1 %d %s\r\nContent-Type: %.*s\r\nContent-Length: %zu\r\nConnection: %s\r\n\r\n",
+                              resp.status, reasonPhrase(resp.status), static_cast<int>(resp.contentType.size()),
+                              resp.contentType.data(), resp.body.size(), keepAlive ? "keep-alive" : "close");
+  out.append(head, static_cast<size_t>(n));
+  out += resp.body;
+}
+
+void protocolError(Connection& c, int status, const char* message) {
+  HttpResponse resp;
+  resp.status = status;
+  resp.contentType = "text/plain";
+  resp.body = message;
+  appendResponse(c.out, resp, false);
+  c.closeAfterWrite = true;
+}
+
+int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+} // namespace
+
+HttpServer::HttpServer(HttpServerOptions options, HttpHandler handler)
+  : options_(std::move(options)), handler_(std::move(handler)) {
+  if (options_.threads == 0) options_.threads = 1;
+  auto closeAll = [this] {
+    for (int fd : listenFds_) ::close(fd);
+    listenFds_.clear();
+  };
+
+  sockaddr_in addr {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(options_.port);
+  if (::inet_pton(AF_INET, options_.host.c_str(), &addr.sin_addr) != 1) {
+    throw std::runtime_error("invalid listen address: " + options_.host);
+  }
+  // По сокету на поток (SO_REUSEPORT): ядро раскладывает соединения по хешу
+  // адресов, и всплеск подключений не достаётся целиком одному потоку
+  for (unsigned t = 0; t < options_.threads; ++t) {
+    const int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      const std::string err = std::strerror(errno);
+      closeAll();
+      throw std::runtime_error("socket: " + err);
+    }
+    listenFds_.push_back(fd);
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+      const std::string err = std::strerror(errno);
+      closeAll();
+      throw std::runtime_error("cannot listen on " + options_.host + ":" + std::to_string(options_.port) + ": " + err);
+    }
+    // порт 0: остальные сокеты занимают тот же, что выдан первому
+    socklen_t len = sizeof(addr);
+    ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+  }
+  port_ = ntohs(addr.sin_port);
+
+  stopFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (stopFd_ < 0) {
+    const std::string err = std::strerror(errno);
+    closeAll();
+    throw std::runtime_error("eventfd: " + err);
+  }
+}
+
+HttpServer::~HttpServer() {
+  for (int fd : listenFds_) ::close(fd);
+  if (stopFd_ >= 0) ::close(stopFd_);
+}
+
+void HttpServer::stop() {
+  const uint64_t one = 1;
+  // eventfd не вычитывается: уровень остаётся взведённым и будит все потоки
+  [[maybe_unused]] ssize_t r = ::write(stopFd_, &one, sizeof(one));
+}
+
+void HttpServer::run() {
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < options_.threads; ++t) pool.emplace_back([this, t] { workerLoop(t); });
+  workerLoop(0);
+  for (auto& th : pool) th.join();
+}
+
+void HttpServer::workerLoop(unsigned worker) {
+  const int ep = ::epoll_create1(EPOLL_CLOEXEC);
+  if (ep < 0) return;
+  const int listenFd = listenFds_[worker];
+  epoll_event ev {};
+  ev.events = EPOLLIN;
+  ev.data.fd = listenFd;
+  ::epoll_ctl(ep, EPOLL_CTL_ADD, listenFd, &ev);
+  ev.events = EPOLLIN;
+  ev.data.fd = stopFd_;
+  ::epoll_ctl(ep, EPOLL_CTL_ADD, stopFd_, &ev);
+
+  std::unordered_map<int, std::unique_ptr<Connection>> conns;
+
+  auto closeConn = [&](Connection& c) {
+    ::epoll_ctl(ep, EPOLL_CTL_DEL, c.fd, nullptr);
+    ::close(c.fd);
+    conns.erase(c.fd);
+  };
+
+  // Подписка по состоянию буферов: EPOLLOUT, пока есть неотправленное;
+  // чтение приостановлено, пока неотправленного больше outputHighWaterBytes
+  // или после ошибки протокола (дальше соединение только дописывает ответ)
+  auto watch = [&](Connection& c) {
+    const size_t pending = c.out.size() - c.outPos;
+    const bool wantWrite = pending > 0;
+    const bool readPaused = c.closeAfterWrite || pending > options_.outputHighWaterBytes;
+    if (wantWrite == c.wantWrite && readPaused == c.readPaused) return;
+    epoll_event mod {};
+    mod.events = (readPaused ? 0u : static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP)) | (wantWrite ? EPOLLOUT : 0u);
+    mod.data.fd = c.fd;
+    ::epoll_ctl(ep, EPOLL_CTL_MOD, c.fd, &mod);
+    c.wantWrite = wantWrite;
+    c.readPaused = readPaused;
+  };
+
+  // false — соединение закрыто
+  auto flush = [&](Connection& c) {
+    while (c.outPos < c.out.size()) {
+      const ssize_t r = ::send(c.fd, c.out.data() + c.outPos, c.out.size() - c.outPos, MSG_NOSIGNAL);
+      if (r > 0) {
+        c.outPos += static_cast<size_t>(r);
+        continue;
+      }
+      if (r < 0 && errno == EINTR) continue;
+      if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        watch(c);
+        return true;
+      }
+      closeConn(c);
+      return false;
+    }
+    c.out.clear();
+    c.outPos = 0;
+    if (c.closeAfterWrite) {
+      closeConn(c);
+      return false;
+    }
+    watch(c);
+    return true;
+  };
+
+  // Разбор всех полных запросов в буфере (конвейер): ответы — в c.out по порядку
+  auto process = [&](Connection& c) {
+    size_t pos = 0;
+    while (!c.closeAfterWrite) {
+      const std::string_view data(c.in.data() + pos, c.in.size() - pos);
+      const size_t headerEnd = data.find("\r\n\r\n");
+      if (headerEnd == std::string_view::npos) {
+        if (data.size() > options_.maxHeaderBytes) protocolError(c, 431, "header too large");
+        break;
+      }
+      if (headerEnd > options_.maxHeaderBytes) {
+        protocolError(c, 431, "header too large");
+        break;
+      }
+
+      HttpRequest req;
+      std::string_view head = data.substr(0, headerEnd);
+      size_t lineEnd = head.find("\r\n");
+      std::string_view line = head.substr(0, lineEnd);
+      const size_t sp1 = line.find(' ');
+      const size_t sp2 = sp1 == std::string_view::npos ? sp1 : line.find(' ', sp1 + 1);
+      if (sp2 == std::string_view::npos) {
+        protocolError(c, 400, "malformed request line");
+        break;
+      }
+      req.method = line.substr(0, sp1);
+      std::string_view target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+      const std::string_view version = line.substr(sp2 + 1);
+      const size_t q = target.find('?');
+      req.path = target.substr(0, q);
+      if (q != std::string_view::npos) req.query = target.substr(q + 1);
+      req.keepAlive = version == "HTTP/1.1";
+
+      size_t contentLength = 0;
+      bool expectContinue = false;
+      bool chunked = false;
+      bool badLength = false;
+      while (lineEnd != std::string_view::npos) {
+        head.remove_prefix(lineEnd + 2);
+        lineEnd = head.find("\r\n");
+        line = head.substr(0, lineEnd);
+        const size_t colon = line.find(':');
+        if (colon == std::string_view::npos) continue;
+        const std::string_view name = line.substr(0, colon);
+        const std::string_view value = trim(line.substr(colon + 1));
+        if (iequals(name, "content-length")) {
+          auto [p, ec] = std::from_chars(value.data(), value.data() + value.size(), contentLength);
+          badLength = ec != std::errc() || p != value.data() + value.size();
+        } else if (iequals(name, "connection")) {
+          if (iequals(value, "close")) req.keepAlive = false;
+          else if (iequals(value, "keep-alive")) req.keepAlive = true;
+        } else if (iequals(name, "accept")) {
+          req.accept = value;
+        } else if (iequals(name, "expect")) {
+          expectContinue = iequals(value, "100-continue");
+        } else if (iequals(name, "transfer-encoding")) {
+          chunked = !iequals(value, "identity");
+        }
+      }
+      if (badLength) {
+        protocolError(c, 400, "bad Content-Length");
+        break;
+      }
+      if (chunked) {
+        protocolError(c, 501, "chunked request bodies are not supported");
+        break;
+      }
+      if (contentLength > options_.maxBodyBytes) {
+        protocolError(c, 413, "request body too large");
+        break;
+      }
+      const size_t total = headerEnd + 4 + contentLength;
+      if (data.size() < total) {
+        if (expectContinue && !c.continueSent) {
+          c.out += "HTTP/1.1 100 Continue\r\n\r\n";
+          c.continueSent = true;
+        }
+        break;
+      }
+      req.body = data.substr(headerEnd + 4, contentLength);
+
+      HttpResponse resp;
+      try {
+        handler_(worker, req, resp);
+      } catch (const std::exception& ex) {
+        resp = HttpResponse{};
+        resp.status = 500;
+        resp.contentType = "text/plain";
+        resp.body = ex.what();
+      }
+      appendResponse(c.out, resp, req.keepAlive);
+      if (!req.keepAlive) c.closeAfterWrite = true;
+      c.continueSent = false;
+      pos += total;
+    }
+    if (pos > 0) c.in.erase(0, pos);
+  };
+
+  // Больше во входном буфере не бывает полного запроса: дальше сокет не
+  // читается, пока process не разберёт накопленное
+  const size_t inputLimit = options_.maxHeaderBytes + 4 + options_.maxBodyBytes;
+
+  epoll_event events[kMaxEvents];
+  bool running = true;
+  while (running) {
+    const int n = ::epoll_wait(ep, events, kMaxEvents, -1);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    for (int i = 0; i < n; ++i) {
+      const int fd = events[i].data.fd;
+      if (fd == stopFd_) {
+        running = false;
+        break;
+      }
+      if (fd == listenFd) {
+        while (true) {
+          const int cfd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+          if (cfd < 0) break; // EAGAIN: очередь потока пуста
+          int one = 1;
+          ::setsockopt(cfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+          auto conn = std::make_unique<Connection>();
+          conn->fd = cfd;
+          epoll_event add {};
+          add.events = EPOLLIN | EPOLLRDHUP;
+          add.data.fd = cfd;
+          if (::epoll_ctl(ep, EPOLL_CTL_ADD, cfd, &add) != 0) {
+            ::close(cfd);
+            continue;
+          }
+          conns.emplace(cfd, std::move(conn));
+        }
+        continue;
+      }
+      auto it = conns.find(fd);
+      if (it == conns.end()) continue;
+      Connection& c = *it->second;
+      const uint32_t e = events[i].events;
+      if (e & EPOLLERR) {
+        closeConn(c);
+        continue;
+      }
+      if (e & EPOLLOUT) {
+        if (!flush(c)) continue;
+      }
+      if (e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+        // Событие могло прийти до снятия EPOLLIN: ждём, пока уйдут ответы
+        if (c.readPaused) {
+          if (e & EPOLLHUP) flush(c);
+          continue;
+        }
+        // Непрочитанное остаётся в сокете: EPOLLIN по уровню сработает снова
+        bool peerClosed = false;
+        while (c.in.size() < inputLimit) {
+          const size_t old = c.in.size();
+          const size_t chunk = std::min(kReadChunk, inputLimit - old);
+          c.in.resize(old + chunk);
+          const ssize_t r = ::recv(c.fd, c.in.data() + old, chunk, 0);
+          c.in.resize(old + (r > 0 ? static_cast<size_t>(r) : 0));
+          if (r > 0) continue;
+          if (r < 0 && errno == EINTR) continue;
+          if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) peerClosed = true;
+          break;
+        }
+        process(c);
+        if (!c.closeAfterWrite && c.in.size() >= inputLimit) protocolError(c, 413, "request too large");
+        if (peerClosed) c.closeAfterWrite = true;
+        flush(c);
+      }
+    }
+  }
+
+  for (auto& kv : conns) ::close(kv.first);
+  ::close(ep);
+}
+
+std::string queryParam(std::string_view query, std::string_view name) {
+  while (!query.empty()) {
+    const size_t amp = query.find('&');
+    const std::string_view pair = query.substr(0, amp);
+    query = amp == std::string_view::npos ? std::string_view() : query.substr(amp + 1);
+    const size_t eq = pair.find('=');
+    if (pair.substr(0, eq) != name) continue;
+    if (eq == std::string_view::npos) return {};
+    const std::string_view raw = pair.substr(eq + 1);
+    std::string out;
+    out.reserve(raw.size());
+    for (size_t i = 0; i < raw.size(); ++i) {
+      if (raw[i] == '+') {
+        out += ' ';
+      } else if (raw[i] == '%' && i + 2 < raw.size() && hexDigit(raw[i + 1]) >= 0 && hexDigit(raw[i + 2]) >= 0) {
+        out += static_cast<char>(hexDigit(raw[i + 1]) * 16 + hexDigit(raw[i + 2]));
+        i += 2;
+      } else {
+        out += raw[i];
+      }
+    }
+    return out;
+  }
+  return {};
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Разобранный запрос: все поля — string_view в буфер чтения соединения и
+// живут только на время вызова обработчика. Тело не копируется.
+struct HttpRequest {
+  std::string_view method;
+  std::string_view path;   // без строки запроса
+  std::string_view query;  // после '?', не декодирована
+  std::string_view accept;
+  std::string_view body;
+  bool keepAlive {true};
+};
+
+struct HttpResponse {
+  int status {200};
+  std::string_view contentType {"application/json"};
+  std::string body;
+};
+
+// worker — номер рабочего потока [0, threads): по нему обработчик выбирает своё
+// состояние (Router, Geocoder), так что внутри потока блокировки не нужны.
+using HttpHandler = std::function<void(unsigned worker, const HttpRequest& req, HttpResponse& resp)>;
+
+struct HttpServerOptions {
+  std::string host {"127.0.0.1"};
+  uint16_t port {8080};         // 0 — любой свободный, см. port()
+  unsigned threads {1};
+  size_t maxHeaderBytes {16 * 1024};
+  size_t maxBodyBytes {8 * 1024 * 1024};
+  // Пока неотправленных ответов больше, соединение не читается
+  size_t outputHighWaterBytes {4 * 1024 * 1024};
+};
+
+// HTTP/1.1 на epoll: keep-alive, конвейер запросов, Content-Length (без chunked).
+//
+// Фиксированный пул: у каждого потока свой epoll и свой слушающий сокет на
+// общем порту (SO_REUSEPORT, соединения делит ядро), и принятое соединение
+// живёт в своём потоке до закрытия — разбор, обработчик и запись ответа идут
+// без передачи между потоками. Долгий запрос задерживает только соединения
+// своего потока. Только Linux.
+class HttpServer {
+public:
+  // Исключение, если адрес не удалось занять
+  HttpServer(HttpServerOptions options, HttpHandler handler);
+  ~HttpServer();
+  HttpServer(const HttpServer&) = delete;
+  HttpServer& operator=(const HttpServer&) = delete;
+
+  uint16_t port() const { return port_; }
+  unsigned threads() const { return options_.threads; }
+
+  // Блокирует до stop(); обработчик вызывается из рабочих потоков
+  void run();
+  // Потокобезопасно и async-signal-safe (запись в eventfd)
+  void stop();
+
+private:
+  void workerLoop(unsigned worker);
+
+  HttpServerOptions options_;
+  HttpHandler handler_;
+  std::vector<int> listenFds_; // по сокету на поток
+  int stopFd_ {-1};
+  uint16_t port_ {0};
+};
+
+// Значение параметра строки запроса с раскрытием %XX и '+'; пусто, если нет
+std::string queryParam(std::string_view query, std::string_view name);
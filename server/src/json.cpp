@@ -0,0 +1,186 @@
+#include "json.h"
+
+#include <charconv>
+#include <cmath>
+
+namespace {
+
+constexpr int kMaxDepth = 64;
+
+class Parser {
+public:
+  Parser(std::string_view text, std::string& error) : s_(text), error_(error) {}
+
+  bool parse(JsonValue& out) {
+    if (!value(out, 0)) return false;
+    skipSpace();
+    if (pos_ != s_.size()) return fail("trailing characters");
+    return true;
+  }
+
+private:
+  bool fail(const char* what) {
+    error_ = std::string(what) + " at offset " + std::to_string(pos_);
+    return false;
+  }
+
+  void skipSpace() {
+    while (pos_ < s_.size() && (s_[pos_] == ' ' || s_[pos_] == '\t' || s_[pos_] == '\n' || s_[pos_] == '\r')) ++pos_;
+  }
+
+  bool literal(std::string_view word) {
+    if (s_.substr(pos_, word.size()) != word) return fail("invalid literal");
+    pos_ += word.size();
+    return true;
+  }
+
+  bool string(std::string_view& out) {
+    ++pos_; // открывающая кавычка
+    const size_t start = pos_;
+    while (pos_ < s_.size() && s_[pos_] != '"') {
+      if (s_[pos_] == '\\') ++pos_;
+      ++pos_;
+    }
+    if (pos_ >= s_.size()) return fail("unterminated string");
+    out = s_.substr(start, pos_ - start);
+    ++pos_;
+    return true;
+  }
+
+  bool value(JsonValue& out, int depth) {
+    if (depth > kMaxDepth) return fail("nesting too deep");
+    skipSpace();
+    if (pos_ >= s_.size()) return fail("unexpected end");
+    const char c = s_[pos_];
+    if (c == '{') {
+      out.type = JsonValue::Type::Object;
+      ++pos_;
+      skipSpace();
+      if (pos_ < s_.size() && s_[pos_] == '}') { ++pos_; return true; }
+      while (true) {
+        skipSpace();
+        if (pos_ >= s_.size() || s_[pos_] != '"') return fail("expected key");
+        std::string_view k;
+        if (!string(k)) return false;
+        skipSpace();
+        if (pos_ >= s_.size() || s_[pos_] != ':') return fail("expected ':'");
+        ++pos_;
+        out.members.emplace_back(k, JsonValue{});
+        if (!value(out.members.back().second, depth + 1)) return false;
+        skipSpace();
+        if (pos_ < s_.size() && s_[pos_] == ',') { ++pos_; continue; }
+        if (pos_ < s_.size() && s_[pos_] == '}') { ++pos_; return true; }
+        return fail("expected ',' or '}'");
+      }
+    }
+    if (c == '[') {
+      out.type = JsonValue::Type::Array;
+      ++pos_;
+      skipSpace();
+      if (pos_ < s_.size() && s_[pos_] == ']') { ++pos_; return true; }
+      while (true) {
+        out.items.emplace_back();
+        if (!value(out.items.back(), depth + 1)) return false;
+        skipSpace();
+        if (pos_ < s_.size() && s_[pos_] == ',') { ++pos_; continue; }
+        if (pos_ < s_.size() && s_[pos_] == ']') { ++pos_; return true; }
+        return fail("expected ',' or ']'");
+      }
+    }
+    if (c == '"') {
+      out.type = JsonValue::Type::String;
+      return string(out.string);
+    }
+    if (c == 't' || c == 'f') {
+      out.type = JsonValue::Type::Bool;
+      out.boolean = c == 't';
+      return literal(out.boolean ? "true" : "false");
+    }
+    if (c == 'n') {
+      out.type = JsonValue::Type::Null;
+      return literal("null");
+    }
+    out.type = JsonValue::Type::Number;
+    const char* begin = s_.data() + pos_;
+    // from_chars не принимает ведущий '+', JSON тоже
+    auto [end, ec] = std::from_chars(begin, s_.data() + s_.size(), out.number);
+    if (ec != std::errc() || end == begin) return fail("invalid number");
+    out.string = std::string_view(begin, static_cast<size_t>(end - begin));
+    pos_ += static_cast<size_t>(end - begin);
+    return true;
+  }
+
+  std::string_view s_;
+  size_t pos_ {0};
+  std::string& error_;
+};
+
+} // namespace
+
+const JsonValue* JsonValue::find(std::string_view key) const {
+  for (const auto& [k, v] : members) {
+    if (k == key) return &v;
+  }
+  return nullptr;
+}
+
+bool parseJson(std::string_view text, JsonValue& out, std::string& error) {
+  out = JsonValue{};
+  return Parser(text, error).parse(out);
+}
+
+void JsonWriter::key(std::string_view k) {
+  value(k);
+  out_ += ':';
+  afterKey_ = true;
+}
+
+void JsonWriter::value(std::string_view s) {
+  separate();
+  out_ += '"';
+  size_t plain = 0;
+  for (size_t i = 0; i < s.size(); ++i) {
+    const unsigned char c = static_cast<unsigned char>(s[i]);
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+    out_.append(s.data() + plain, i - plain);
+    plain = i + 1;
+    switch (c) {
+      case '"': out_ += "\\\""; break;
+      case '\\': out_ += "\\\\"; break;
+      case '\n': out_ += "\\n"; break;
+      case '\r': out_ += "\\r"; break;
+      case '\t': out_ += "\\t"; break;
+      default: {
+        static const char kHex[] = "0123456789abcdef";
+        out_ += "\\u00";
+        out_ += kHex[c >> 4];
+        out_ += kHex[c & 15];
+      }
+    }
+  }
+  out_.append(s.data() + plain, s.size() - plain);
+  out_ += '"';
+}
+
+void JsonWriter::value(int64_t v) {
+  separate();
+  char buf[24];
+  auto r = std::to_chars(buf, buf + sizeof(buf), v);
+  out_.append(buf, r.ptr);
+}
+
+void JsonWriter::value(uint64_t v) {
+  separate();
+  char buf[24];
+  auto r = std::to_chars(buf, buf + sizeof(buf), v);
+  out_.append(buf, r.ptr);
+}
+
+void JsonWriter::value(double v, int digits) {
+  if (!std::isfinite(v)) return null();
+  separate();
+  char buf[64];
+  auto r = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::fixed, digits);
+  if (r.ec != std::errc()) r = std::to_chars(buf, buf + sizeof(buf), v);
+  out_.append(buf, r.ptr);
+}
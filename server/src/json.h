@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Значение JSON поверх буфера запроса: строки — string_view в тело без копий
+// и без раскрытия escape-последовательностей (ключи, профили и id — ASCII).
+struct JsonValue {
+  enum class Type : uint8_t { Null, Bool, Number, String, Array, Object };
+
+  Type type {Type::Null};
+  bool boolean {false};
+  double number {0.0};
+  std::string_view string;
+  std::vector<JsonValue> items;                                 // Array
+  std::vector<std::pair<std::string_view, JsonValue>> members;  // Object
+
+  const JsonValue* find(std::string_view key) const;
+  bool isNumber() const { return type == Type::Number; }
+  bool isString() const { return type == Type::String; }
+  bool isArray() const { return type == Type::Array; }
+  bool isObject() const { return type == Type::Object; }
+};
+
+// false — синтаксическая ошибка; error — причина и смещение
+bool parseJson(std::string_view text, JsonValue& out, std::string& error);
+
+// Потоковая запись JSON в строку ответа: числа — std::to_chars, запятые
+// расставляются по стеку вложенности. Нечисловые double пишутся как null.
+class JsonWriter {
+public:
+  explicit JsonWriter(std::string& out) : out_(out) {}
+
+  void beginObject() { separate(); out_ += '{'; first_.push_back(true); }
+  void endObject() { first_.pop_back(); out_ += '}'; }
+  void beginArray() { separate(); out_ += '['; first_.push_back(true); }
+  void endArray() { first_.pop_back(); out_ += ']'; }
+
+  void key(std::string_view k);
+  void value(std::string_view s);
+  void value(const char* s) { value(std::string_view(s)); }
+  void value(bool b) { separate(); out_ += b ? "true" : "false"; }
+  void value(int64_t v);
+  void value(uint64_t v);
+  void value(int v) { value(static_cast<int64_t>(v)); }
+  // digits — знаков после запятой (координаты — 6, ~0.1 м)
+  void value(double v, int digits = 3);
+  void null() { separate(); out_ += "null"; }
+
+private:
+  void separate() {
+    if (afterKey_) { afterKey_ = false; return; }
+    if (first_.empty()) return;
+    if (!first_.back()) out_ += ',';
+    first_.back() = false;
+  }
+
+  std::string& out_;
+  std::vector<bool> first_;
+  bool afterKey_ {false};
+};
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "http_server.h"
+#include "routing_service.h"
+
+namespace {
+
+HttpServer* gServer = nullptr;
+
+void onSignal(int) {
+  if (gServer) gServer->stop();
+}
+
+void printUsage(const char* argv0) {
+  std::fprintf(stderr,
+    "Usage: %s [--host 127.0.0.1] [--port 8080] [--threads N] [--tile-cache N]\n"
+    "          [--slow-ms MS] [--slow-log path] routingdb\n"
+    "--host      : listen address (default 127.0.0.1, local only)\n"
+    "--port      : listen port (default 8080, 0 = any free)\n"
+    "--threads   : worker threads, each with its own Router and Geocoder (default: all cores)\n"
+    "--tile-cache: decoded tiles cached per worker (default 1024)\n"
+    "--slow-ms   : log requests slower than MS with per-phase timings (coordinates coarsened to 0.01 deg)\n"
+    "--slow-log  : slow query log file, appended (default stderr)\n"
+    "Endpoints: POST /route, POST /matrix, GET /search, GET /health, GET /metrics (Prometheus)\n",
+    argv0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  HttpServerOptions http;
+  RoutingServiceOptions service;
+  http.threads = std::max(1u, std::thread::hardware_concurrency());
+  std::string dbPath;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--host" && hasValue) http.host = argv[++i];
+    else if (arg == "--port" && hasValue) http.port = static_cast<uint16_t>(std::stoul(argv[++i]));
+    else if (arg == "--threads" && hasValue) http.threads = std::max(1u, static_cast<unsigned>(std::stoul(argv[++i])));
+    else if (arg == "--tile-cache" && hasValue) service.tileCacheCapacity = std::stoul(argv[++i]);
+    else if (arg == "--slow-ms" && hasValue) service.slowQueryMs = std::stod(argv[++i]);
+    else if (arg == "--slow-log" && hasValue) service.slowQueryLog = argv[++i];
+    else if (!arg.empty() && arg[0] != '-' && dbPath.empty()) dbPath = arg;
+    else { printUsage(argv[0]); return 1; }
+  }
+  if (dbPath.empty()) { printUsage(argv[0]); return 1; }
+  service.workers = http.threads;
+
+  try {
+    RoutingService routing(dbPath, service);
+    HttpServer server(http, [&routing](unsigned worker, const HttpRequest& req, HttpResponse& resp) {
+      routing.handle(worker, req, resp);
+    });
+    gServer = &server;
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+    std::printf("Serving %s on http://%s:%u (%u workers, tile zoom %d, geocoder %s)\n", dbPath.c_str(),
+                http.host.c_str(), server.port(), server.threads(), routing.tileZoom(),
+                routing.geocoderAvailable() ? "on" : "off");
+    std::fflush(stdout);
+    server.run();
+    gServer = nullptr;
+    return 0;
+  } catch (const std::exception& ex) {
+    std::fprintf(stderr, "Error: %s\n", ex.what());
+    return 2;
+  }
+}
@@ -0,0 +1,535 @@
+// Нагрузочный прогон маршрутов: пропускная способность, перцентили задержки и
+// доля ошибок одним JSON-отчётом (для проверки целей спецификации в CI).
+//
+// Пары старт/финиш — случайные узлы рёбер пакета, доступных профилю (тайлы
+// по profile_mask; --weighted — с весами классов дорог, чтобы концы чаще
+// попадали на жилые улицы, чем на магистрали), либо журнал запросов --log
+// ("lat1 lon1 lat2 lon2 [profile]" в строке, '#' — комментарий).
+//
+// Цель — Router в процессе (по экземпляру на поток, как в routing_server) или
+// сервер --http host:port (по keep-alive соединению на поток). Режимы:
+// замкнутый цикл (--concurrency потоков без пауз) или фиксированная частота
+// --rate: запрос i запланирован на t0 + i/rate, задержка считается от плана,
+// так что очередь при перегрузке входит в перцентили. --flatbuffers просит
+// у сервера бинарный ответ (Accept: application/x-flatbuffers).
+//
+//   route_loadgen liechtenstein.routingdb --requests 5000 --concurrency 8 --max-km 10
+//   route_loadgen liechtenstein.routingdb --http 127.0.0.1:8080 --rate 2000 --duration 30
+//   route_loadgen --log queries.txt --http 127.0.0.1:8080 --max-p99-ms 150
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "json.h"
+#include "route_result_generated.h"
+#include "routing_core/profile.h"
+#include "routing_core/router.h"
+#include "routing_core/tile_store.h"
+#include "routing_core/tile_view.h"
+
+using namespace routing_core;
+using Clock = std::chrono::steady_clock;
+
+struct Pair {
+  Coord from, to;
+  std::string profile; // пусто — профиль прогона
+};
+
+struct Options {
+  std::string db;
+  std::string profile {"car"};
+  std::string logPath;
+  std::string http;          // host:port
+  bool flatbuffers {false};  // Accept: application/x-flatbuffers
+  std::string outPath;
+  size_t requests {1000};
+  double durationS {0.0};    // > 0 — по времени, пары идут по кругу
+  unsigned concurrency {0};  // 0 — по числу ядер
+  double rate {0.0};         // > 0 — фиксированная частота, иначе замкнутый цикл
+  size_t pairs {2000};
+  double maxKm {0.0};        // > 0 — финиш не дальше от старта
+  bool weighted {false};
+  uint64_t seed {1};
+  double maxP99Ms {0.0};
+  double maxErrorRate {-1.0};
+};
+
+// Результат одного запроса
+struct Sample {
+  double ms;
+  std::string error; // пусто — успех
+};
+
+static double haversineKm(const Coord& a, const Coord& b) {
+  const double p1 = a.lat * M_PI / 180.0, p2 = b.lat * M_PI / 180.0;
+  const double dp = p2 - p1, dl = (b.lon - a.lon) * M_PI / 180.0;
+  const double h = std::sin(dp / 2) * std::sin(dp / 2) + std::cos(p1) * std::cos(p2) * std::sin(dl / 2) * std::sin(dl / 2);
+  return 6371.0 * 2 * std::atan2(std::sqrt(h), std::sqrt(1 - h));
+}
+
+static ProfileSettings profileByName(const std::string& name) {
+  if (name == "foot") return makeFootProfile();
+  if (name == "boat") return makeBoatProfile();
+  return makeCarProfile();
+}
+
+static int metadataInt(sqlite3* db, const char* key, int fallback) {
+  int value = fallback;
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db, "SELECT value FROM metadata WHERE key=?;", -1, &stmt, nullptr) == SQLITE_OK) {
+    sqlite3_bind_text(stmt, 1, key, -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW) value = sqlite3_column_int(stmt, 0);
+  }
+  sqlite3_finalize(stmt);
+  return value;
+}
+
+// Вероятность оставить узел ребра класса (RoadClass): старты и финиши поездок
+// в основном на жилых улицах, на магистрали их почти нет
+static const double kClassWeight[] = {0.05, 0.4, 0.6, 1.0, 0.6, 0.3, 0.05, 1.0, 1.0};
+
+static std::vector<Coord> sampleNodes(const std::string& dbPath, const ProfileSettings& profile, size_t count,
+                                      bool weighted, std::mt19937_64& rng) {
+  sqlite3* db = nullptr;
+  if (sqlite3_open_v2(dbPath.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+    std::fprintf(stderr, "Error: cannot open %s\n", dbPath.c_str());
+    sqlite3_close(db);
+    return {};
+  }
+  const int zoom = metadataInt(db, "tile_zoom", 14);
+  const char* table = profile.layer == TileLayer::WATER ? "water_tiles" : "land_tiles";
+  std::vector<std::pair<int, int>> tiles;
+  sqlite3_stmt* stmt = nullptr;
+  const std::string sql = std::string("SELECT x, y FROM ") + table + " WHERE z=? AND (profile_mask=0 OR (profile_mask & ?) != 0);";
+  if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+    sqlite3_bind_int(stmt, 1, zoom);
+    sqlite3_bind_int(stmt, 2, profile.access_mask);
+    while (sqlite3_step(stmt) == SQLITE_ROW) tiles.emplace_back(sqlite3_column_int(stmt, 0), sqlite3_column_int(stmt, 1));
+  }
+  sqlite3_finalize(stmt);
+  sqlite3_close(db);
+  if (tiles.empty()) return {};
+
+  TileStore store(dbPath, 256, table);
+  std::uniform_real_distribution<double> coin(0.0, 1.0);
+  std::vector<Coord> out;
+  size_t attempts = 0;
+  while (out.size() < count && attempts++ < count * 200) {
+    const auto& [x, y] = tiles[rng() % tiles.size()];
+    auto blob = store.load(zoom, x, y);
+    if (!blob) continue;
+    TileView view(blob->buffer);
+    if (!view.valid() || view.edgeCount() == 0) continue;
+    const auto* e = view.edgeAt(static_cast<uint32_t>(rng() % static_cast<uint64_t>(view.edgeCount())));
+    if ((e->access_mask() & profile.access_mask) == 0) continue;
+    const int cls = static_cast<int>(e->road_class());
+    if (weighted && cls >= 0 && cls < 9 && coin(rng) > kClassWeight[cls]) continue;
+    const int node = static_cast<int>(e->from_node());
+    out.push_back(Coord{view.nodeLat(node), view.nodeLon(node)});
+  }
+  return out;
+}
+
+static std::vector<Pair> makePairs(const std::vector<Coord>& nodes, size_t count, double maxKm, std::mt19937_64& rng) {
+  std::vector<Pair> out;
+  if (nodes.size() < 2) return out;
+  for (size_t i = 0; i < count; ++i) {
+    const Coord& a = nodes[rng() % nodes.size()];
+    // финиш — первый подходящий узел от случайной позиции
+    const size_t start = rng() % nodes.size();
+    for (size_t k = 0; k < nodes.size(); ++k) {
+      const Coord& b = nodes[(start + k) % nodes.size()];
+      if (&a == &b) continue;
+      if (maxKm > 0.0 && haversineKm(a, b) > maxKm) continue;
+      out.push_back(Pair{a, b, {}});
+      break;
+    }
+  }
+  return out;
+}
+
+static std::vector<Pair> readLog(const std::string& path) {
+  std::vector<Pair> out;
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream ss(line);
+    Pair p;
+    if (!(ss >> p.from.lat >> p.from.lon >> p.to.lat >> p.to.lon)) continue;
+    ss >> p.profile;
+    out.push_back(std::move(p));
+  }
+  return out;
+}
+
+// Клиент HTTP/1.1 с одним keep-alive соединением; переподключается после ошибки
+class HttpClient {
+public:
+  HttpClient(std::string host, std::string port, std::string accept)
+    : host_(std::move(host)), port_(std::move(port)), accept_(std::move(accept)) {}
+  ~HttpClient() { disconnect(); }
+
+  // HTTP-код ответа; 0 — ошибка соединения
+  int post(const std::string& path, const std::string& body, std::string& response) {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+      if (fd_ < 0 && !connect()) return 0;
+      request_.clear();
+      request_ += "POST " + path + " HTTP/1.1\r\nHost: " + host_ + "\r\nAccept: " + accept_ +
+                  "\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+      request_ += body;
+      int code = 0;
+      if (sendAll(request_) && (code = readResponse(response)) > 0) return code;
+      disconnect(); // сервер мог закрыть простаивавшее соединение — одна повторная попытка
+    }
+    return 0;
+  }
+
+private:
+  bool connect() {
+    addrinfo hints {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (::getaddrinfo(host_.c_str(), port_.c_str(), &hints, &res) != 0) return false;
+    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+      fd_ = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+      if (fd_ < 0) continue;
+      if (::connect(fd_, ai->ai_addr, ai->ai_addrlen) == 0) break;
+      ::close(fd_);
+      fd_ = -1;
+    }
+    ::freeaddrinfo(res);
+    if (fd_ < 0) return false;
+    int one = 1;
+    ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    buffer_.clear();
+    return true;
+  }
+
+  void disconnect() {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+  }
+
+  bool sendAll(const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+      const ssize_t r = ::send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+      if (r <= 0) return false;
+      sent += static_cast<size_t>(r);
+    }
+    return true;
+  }
+
+  bool fill() {
+    char chunk[16384];
+    const ssize_t r = ::recv(fd_, chunk, sizeof(chunk), 0);
+    if (r <= 0) return false;
+    buffer_.append(chunk, static_cast<size_t>(r));
+    return true;
+  }
+
+  int readResponse(std::string& body) {
+    size_t headerEnd;
+    while ((headerEnd = buffer_.find("\r\n\r\n")) == std::string::npos) {
+      if (!fill()) return 0;
+    }
+    int code = 0;
+    if (std::sscanf(buffer_.c_str(), "HTTP/1.%*d %d", &code) != 1) return 0;
+    size_t length = 0;
+    bool close = false;
+    const std::string head = buffer_.substr(0, headerEnd);
+    std::istringstream lines(head);
+    std::string line;
+    while (std::getline(lines, line)) {
+      if (!line.empty() && line.back() == '\r') line.pop_back();
+      const size_t colon = line.find(':');
+      if (colon == std::string::npos) continue;
+      std::string name = line.substr(0, colon);
+      std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+      const std::string value = line.substr(line.find_first_not_of(' ', colon + 1) == std::string::npos
+                                                ? line.size() : line.find_first_not_of(' ', colon + 1));
+      if (name == "content-length") length = std::stoul(value);
+      else if (name == "connection" && value == "close") close = true;
+    }
+    while (buffer_.size() < headerEnd + 4 + length) {
+      if (!fill()) return 0;
+    }
+    body.assign(buffer_, headerEnd + 4, length);
+    buffer_.erase(0, headerEnd + 4 + length);
+    if (close) disconnect();
+    return code;
+  }
+
+  std::string host_, port_, accept_;
+  int fd_ {-1};
+  std::string request_;
+  std::string buffer_;
+};
+
+static std::string routeBody(const Pair& p, const std::string& profile) {
+  std::string body;
+  JsonWriter w(body);
+  w.beginObject();
+  w.key("profile"); w.value(p.profile.empty() ? profile : p.profile);
+  w.key("waypoints");
+  w.beginArray();
+  for (const Coord* c : {&p.from, &p.to}) {
+    w.beginArray();
+    w.value(c->lat, 6);
+    w.value(c->lon, 6);
+    w.endArray();
+  }
+  w.endArray();
+  w.endObject();
+  return body;
+}
+
+static const char* statusName(RouteStatus s) {
+  switch (s) {
+    case RouteStatus::OK: return "OK";
+    case RouteStatus::NO_ROUTE: return "NO_ROUTE";
+    case RouteStatus::NO_TILE: return "NO_TILE";
+    case RouteStatus::DATA_ERROR: return "DATA_ERROR";
+    case RouteStatus::INTERNAL_ERROR: return "INTERNAL_ERROR";
+  }
+  return "INTERNAL_ERROR";
+}
+
+// Ближайший ранг: наименьшее значение, не меньше которого доля p выборки
+static double percentile(const std::vector<double>& sorted, double p) {
+  if (sorted.empty()) return 0.0;
+  const size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+  return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+static void printUsage(const char* argv0) {
+  std::fprintf(stderr,
+    "Usage: %s [routingdb] [--profile car|foot|boat] [--log queries.txt] [--pairs N] [--weighted] [--max-km D]\n"
+    "          [--http host:port [--flatbuffers]] [--concurrency C] [--rate R] [--requests N | --duration S]\n"
+    "          [--seed S] [--out report.json] [--max-p99-ms X] [--max-error-rate F]\n"
+    "routingdb : package to sample pairs from and to route on in process (not needed with --log --http)\n"
+    "--log     : recorded queries \"lat1 lon1 lat2 lon2 [profile]\" instead of sampled pairs\n"
+    "--weighted: prefer residential streets over motorways when sampling endpoints\n"
+    "--max-km  : destination within this straight-line distance of the origin (city routes)\n"
+    "--http    : drive routing_server instead of an in-process Router\n"
+    "--flatbuffers: ask the server for binary responses (route_result.fbs)\n"
+    "--rate    : open loop at R requests/s (latency from schedule); default closed loop\n"
+    "--max-p99-ms, --max-error-rate: exit with 3 if the run misses these targets\n",
+    argv0);
+}
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--profile" && hasValue) opt.profile = argv[++i];
+    else if (arg == "--log" && hasValue) opt.logPath = argv[++i];
+    else if (arg == "--pairs" && hasValue) opt.pairs = std::stoul(argv[++i]);
+    else if (arg == "--weighted") opt.weighted = true;
+    else if (arg == "--max-km" && hasValue) opt.maxKm = std::stod(argv[++i]);
+    else if (arg == "--http" && hasValue) opt.http = argv[++i];
+    else if (arg == "--flatbuffers") opt.flatbuffers = true;
+    else if (arg == "--concurrency" && hasValue) opt.concurrency = static_cast<unsigned>(std::stoul(argv[++i]));
+    else if (arg == "--rate" && hasValue) opt.rate = std::stod(argv[++i]);
+    else if (arg == "--requests" && hasValue) opt.requests = std::stoul(argv[++i]);
+    else if (arg == "--duration" && hasValue) opt.durationS = std::stod(argv[++i]);
+    else if (arg == "--seed" && hasValue) opt.seed = std::stoull(argv[++i]);
+    else if (arg == "--out" && hasValue) opt.outPath = argv[++i];
+    else if (arg == "--max-p99-ms" && hasValue) opt.maxP99Ms = std::stod(argv[++i]);
+    else if (arg == "--max-error-rate" && hasValue) opt.maxErrorRate = std::stod(argv[++i]);
+    else if (!arg.empty() && arg[0] != '-' && opt.db.empty()) opt.db = arg;
+    else { printUsage(argv[0]); return 1; }
+  }
+  if (opt.db.empty() && (opt.logPath.empty() || opt.http.empty())) { printUsage(argv[0]); return 1; }
+  if (opt.concurrency == 0) opt.concurrency = std::max(1u, std::thread::hardware_concurrency());
+  const ProfileSettings profile = profileByName(opt.profile);
+
+  std::mt19937_64 rng(opt.seed);
+  std::vector<Pair> pairs;
+  if (!opt.logPath.empty()) {
+    pairs = readLog(opt.logPath);
+  } else {
+    const auto nodes = sampleNodes(opt.db, profile, std::max<size_t>(opt.pairs * 2, 2), opt.weighted, rng);
+    pairs = makePairs(nodes, opt.pairs, opt.maxKm, rng);
+  }
+  if (pairs.empty()) {
+    std::fprintf(stderr, "Error: no origin-destination pairs (empty log or no routable tiles)\n");
+    return 2;
+  }
+
+  std::string httpHost, httpPort;
+  if (!opt.http.empty()) {
+    const size_t colon = opt.http.rfind(':');
+    httpHost = opt.http.substr(0, colon);
+    httpPort = colon == std::string::npos ? "8080" : opt.http.substr(colon + 1);
+  }
+  RouterOptions ro;
+  if (opt.http.empty()) {
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(opt.db.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK) {
+      ro.tileZoom = metadataInt(db, "tile_zoom", 14);
+      ro.overviewZoom = metadataInt(db, "overview_zoom", 0);
+    }
+    sqlite3_close(db);
+    ro.tileCacheCapacity = 1024;
+    ro.workerThreads = 1;
+  }
+  std::vector<std::unique_ptr<Router>> routers;
+  try {
+    for (unsigned t = 0; opt.http.empty() && t < opt.concurrency; ++t) routers.push_back(std::make_unique<Router>(opt.db, ro));
+  } catch (const std::exception& ex) {
+    std::fprintf(stderr, "Error: %s\n", ex.what());
+    return 2;
+  }
+
+  const size_t total = opt.durationS > 0.0 ? SIZE_MAX : opt.requests;
+  std::atomic<size_t> next {0};
+  std::vector<std::vector<Sample>> samples(opt.concurrency);
+  const auto t0 = Clock::now();
+  const auto deadline = t0 + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.durationS));
+
+  auto worker = [&](unsigned t) {
+    Router* router = routers.empty() ? nullptr : routers[t].get();
+    std::unique_ptr<HttpClient> client;
+    if (!router) {
+      client = std::make_unique<HttpClient>(httpHost, httpPort,
+                                            opt.flatbuffers ? "application/x-flatbuffers" : "application/json");
+    }
+    std::string response;
+    for (size_t i = next.fetch_add(1); i < total; i = next.fetch_add(1)) {
+      auto start = Clock::now();
+      if (opt.rate > 0.0) {
+        const auto planned = t0 + std::chrono::duration_cast<Clock::duration>(
+                                      std::chrono::duration<double>(static_cast<double>(i) / opt.rate));
+        if (opt.durationS > 0.0 && planned >= deadline) break;
+        std::this_thread::sleep_until(planned);
+        start = planned;
+      } else if (opt.durationS > 0.0 && start >= deadline) {
+        break;
+      }
+      const Pair& p = pairs[i % pairs.size()];
+      Sample s {0.0, {}};
+      if (router) {
+        const ProfileSettings& pr = p.profile.empty() ? profile : profileByName(p.profile);
+        const RouteResult rr = router->route(pr, {p.from, p.to});
+        if (rr.status != RouteStatus::OK) s.error = statusName(rr.status);
+      } else {
+        const int code = client->post("/route", routeBody(p, opt.profile), response);
+        if (code == 0) {
+          s.error = "CONNECTION";
+        } else if (code != 200 && opt.flatbuffers) {
+          flatbuffers::Verifier verifier(reinterpret_cast<const uint8_t*>(response.data()), response.size());
+          s.error = Routing::VerifyRouteResponseBuffer(verifier)
+                        ? statusName(static_cast<RouteStatus>(Routing::GetRouteResponse(response.data())->status()))
+                        : "HTTP_" + std::to_string(code);
+        } else if (code != 200) {
+          JsonValue doc;
+          std::string err;
+          const JsonValue* st = parseJson(response, doc, err) ? doc.find("status") : nullptr;
+          s.error = st && st->isString() ? std::string(st->string) : "HTTP_" + std::to_string(code);
+        }
+      }
+      s.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+      samples[t].push_back(std::move(s));
+    }
+  };
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < opt.concurrency; ++t) pool.emplace_back(worker, t);
+  worker(0);
+  for (auto& th : pool) th.join();
+  const double elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+
+  std::vector<double> okMs;
+  std::map<std::string, uint64_t> errors;
+  uint64_t count = 0;
+  for (const auto& list : samples) {
+    for (const auto& s : list) {
+      ++count;
+      if (s.error.empty()) okMs.push_back(s.ms);
+      else ++errors[s.error];
+    }
+  }
+  std::sort(okMs.begin(), okMs.end());
+  const uint64_t failed = count - okMs.size();
+  const double errorRate = count ? static_cast<double>(failed) / static_cast<double>(count) : 0.0;
+  double mean = 0.0;
+  for (double v : okMs) mean += v;
+  if (!okMs.empty()) mean /= static_cast<double>(okMs.size());
+  const double p99 = percentile(okMs, 0.99);
+
+  std::string report;
+  JsonWriter w(report);
+  w.beginObject();
+  w.key("target"); w.value(opt.http.empty() ? "router" : "http");
+  if (!opt.http.empty()) { w.key("format"); w.value(opt.flatbuffers ? "flatbuffers" : "json"); }
+  w.key("mode"); w.value(opt.rate > 0.0 ? "rate" : "closed");
+  w.key("profile"); w.value(opt.profile);
+  w.key("pairs_source"); w.value(opt.logPath.empty() ? (opt.weighted ? "sampled_weighted" : "sampled") : "log");
+  w.key("pairs"); w.value(static_cast<uint64_t>(pairs.size()));
+  w.key("concurrency"); w.value(static_cast<int64_t>(opt.concurrency));
+  if (opt.rate > 0.0) { w.key("target_rate"); w.value(opt.rate, 1); }
+  w.key("requests"); w.value(count);
+  w.key("ok"); w.value(static_cast<uint64_t>(okMs.size()));
+  w.key("errors");
+  w.beginObject();
+  for (const auto& [name, n] : errors) { w.key(name); w.value(n); }
+  w.endObject();
+  w.key("error_rate"); w.value(errorRate, 5);
+  w.key("duration_s"); w.value(elapsed, 3);
+  w.key("throughput_rps"); w.value(elapsed > 0 ? static_cast<double>(count) / elapsed : 0.0, 1);
+  // задержка — по успешным запросам: быстрые NO_ROUTE не должны занижать хвост
+  w.key("latency_ms");
+  w.beginObject();
+  w.key("mean"); w.value(mean, 3);
+  w.key("p50"); w.value(percentile(okMs, 0.50), 3);
+  w.key("p90"); w.value(percentile(okMs, 0.90), 3);
+  w.key("p99"); w.value(p99, 3);
+  w.key("p999"); w.value(percentile(okMs, 0.999), 3);
+  w.key("max"); w.value(okMs.empty() ? 0.0 : okMs.back(), 3);
+  w.endObject();
+  w.endObject();
+  report += '\n';
+
+  if (opt.outPath.empty()) {
+    std::fputs(report.c_str(), stdout);
+  } else {
+    std::ofstream out(opt.outPath);
+    out << report;
+    std::fprintf(stderr, "Report: %s\n", opt.outPath.c_str());
+  }
+
+  bool pass = true;
+  if (opt.maxP99Ms > 0.0 && p99 > opt.maxP99Ms) {
+    std::fprintf(stderr, "FAIL: p99 %.1f ms > %.1f ms\n", p99, opt.maxP99Ms);
+    pass = false;
+  }
+  if (opt.maxErrorRate >= 0.0 && errorRate > opt.maxErrorRate) {
+    std::fprintf(stderr, "FAIL: error rate %.4f > %.4f\n", errorRate, opt.maxErrorRate);
+    pass = false;
+  }
+  return pass ? 0 : 3;
+}
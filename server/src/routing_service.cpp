@@ -0,0 +1,530 @@
+#include "routing_service.h"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <ctime>
+#include <stdexcept>
+
+#include "json.h"
+#include "routing_core/tiler.h"
+
+using namespace routing_core;
+
+namespace {
+
+// Целое из таблицы metadata пакета; fallback — если ключа нет
+int readMetadataInt(const std::string& db_path, const char* key, int fallback) {
+  sqlite3* db = nullptr;
+  if (sqlite3_open_v2(db_path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+    std::string err = db ? sqlite3_errmsg(db) : "out of memory";
+    sqlite3_close(db);
+    throw std::runtime_error("Failed to open routingdb: " + err);
+  }
+  int value = fallback;
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v2(db, "SELECT value FROM metadata WHERE key=?;", -1, &stmt, nullptr) == SQLITE_OK) {
+    sqlite3_bind_text(stmt, 1, key, -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW) value = sqlite3_column_int(stmt, 0);
+  }
+  sqlite3_finalize(stmt);
+  sqlite3_close(db);
+  return value;
+}
+
+// Тайлов зума z в прямоугольнике всех точек с рамкой в один тайл
+size_t matrixTileCount(const std::vector<Coord>& sources, const std::vector<Coord>& targets, int z) {
+  int minx = 0, maxx = 0, miny = 0, maxy = 0;
+  bool first = true;
+  for (const auto* list : {&sources, &targets}) {
+    for (const auto& c : *list) {
+      const auto k = webTileKeyFor(c.lat, c.lon, z);
+      if (first) { minx = maxx = k.x; miny = maxy = k.y; first = false; continue; }
+      minx = std::min(minx, k.x); maxx = std::max(maxx, k.x);
+      miny = std::min(miny, k.y); maxy = std::max(maxy, k.y);
+    }
+  }
+  return static_cast<size_t>(maxx - minx + 3) * static_cast<size_t>(maxy - miny + 3);
+}
+
+const char* statusName(RouteStatus s) {
+  switch (s) {
+    case RouteStatus::OK: return "OK";
+    case RouteStatus::NO_ROUTE: return "NO_ROUTE";
+    case RouteStatus::NO_TILE: return "NO_TILE";
+    case RouteStatus::DATA_ERROR: return "DATA_ERROR";
+    case RouteStatus::INTERNAL_ERROR: return "INTERNAL_ERROR";
+  }
+  return "INTERNAL_ERROR";
+}
+
+void errorResponse(HttpResponse& resp, int http, std::string_view status, std::string_view message) {
+  resp.status = http;
+  resp.contentType = "application/json";
+  resp.body.clear();
+  JsonWriter w(resp.body);
+  w.beginObject();
+  w.key("status"); w.value(status);
+  w.key("error"); w.value(message);
+  w.endObject();
+}
+
+int httpStatusOf(RouteStatus s) {
+  if (s == RouteStatus::OK) return 200;
+  return (s == RouteStatus::NO_ROUTE || s == RouteStatus::NO_TILE) ? 404 : 500;
+}
+
+void routeError(HttpResponse& resp, RouteStatus s, const std::string& message) {
+  errorResponse(resp, httpStatusOf(s), statusName(s), message);
+}
+
+bool wantsFlatbuffers(const HttpRequest& req) {
+  return req.accept.find("application/x-flatbuffers") != std::string_view::npos;
+}
+
+void flatbufferResponse(HttpResponse& resp, const flatbuffers::FlatBufferBuilder& fbb, RouteStatus s) {
+  resp.status = httpStatusOf(s);
+  resp.contentType = "application/x-flatbuffers";
+  resp.body.assign(reinterpret_cast<const char*>(fbb.GetBufferPointer()), fbb.GetSize());
+}
+
+// [lat, lon] или {"lat":..,"lon":..}
+bool parsePoint(const JsonValue& v, Coord& out) {
+  if (v.isArray() && v.items.size() == 2 && v.items[0].isNumber() && v.items[1].isNumber()) {
+    out = Coord{v.items[0].number, v.items[1].number};
+  } else if (v.isObject()) {
+    const JsonValue* lat = v.find("lat");
+    const JsonValue* lon = v.find("lon");
+    if (!lat || !lon || !lat->isNumber() || !lon->isNumber()) return false;
+    out = Coord{lat->number, lon->number};
+  } else {
+    return false;
+  }
+  return std::abs(out.lat) <= 90.0 && std::abs(out.lon) <= 180.0;
+}
+
+// false — поле не массив точек; error — для ответа 400
+bool parsePoints(const JsonValue* v, const char* field, std::vector<Coord>& out, std::string& error) {
+  if (!v || !v->isArray()) {
+    error = std::string("'") + field + "' must be an array of points";
+    return false;
+  }
+  out.resize(v->items.size());
+  for (size_t i = 0; i < v->items.size(); ++i) {
+    if (!parsePoint(v->items[i], out[i])) {
+      error = std::string("'") + field + "[" + std::to_string(i) + "]' is not a valid [lat, lon] point";
+      return false;
+    }
+  }
+  return true;
+}
+
+bool parseBody(const HttpRequest& req, HttpResponse& resp, JsonValue& doc) {
+  std::string error;
+  if (!parseJson(req.body, doc, error) || !doc.isObject()) {
+    errorResponse(resp, 400, "BAD_REQUEST", error.empty() ? "body must be a JSON object" : "invalid JSON: " + error);
+    return false;
+  }
+  return true;
+}
+
+// Точек запроса в журнале медленных запросов (матрица может быть большой)
+constexpr size_t kMaxLoggedPoints = 16;
+
+const char* const kEndpointNames[] = {"route", "matrix", "search", "health", "metrics", "other"};
+
+bool parseDouble(std::string_view s, double& out) {
+  auto [p, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+  return ec == std::errc() && p == s.data() + s.size();
+}
+
+} // namespace
+
+RoutingService::RoutingService(const std::string& db_path, RoutingServiceOptions options)
+  : options_(options), car_(makeCarProfile()), foot_(makeFootProfile()), boat_(makeBoatProfile()) {
+  if (options_.workers == 0) options_.workers = 1;
+  tileZoom_ = readMetadataInt(db_path, "tile_zoom", 14);
+
+  RouterOptions ro;
+  ro.tileZoom = tileZoom_;
+  ro.tileCacheCapacity = options_.tileCacheCapacity;
+  // пакет без обзорного слоя: не пытаться искать по нему дальние маршруты
+  ro.overviewZoom = readMetadataInt(db_path, "overview_zoom", 0);
+  // параллелизм — на уровне соединений: строки матрицы считает сам рабочий поток
+  ro.workerThreads = 1;
+
+  workspaces_.resize(options_.workers);
+  for (auto& ws : workspaces_) {
+    ws.router = std::make_unique<Router>(db_path, ro);
+    ws.geocoder = std::make_unique<Geocoder>(db_path);
+  }
+  geocoderAvailable_ = workspaces_.front().geocoder->available();
+  registerMetrics();
+
+  if (options_.slowQueryMs > 0.0) {
+    slowLog_ = options_.slowQueryLog.empty() ? stderr : std::fopen(options_.slowQueryLog.c_str(), "a");
+    if (!slowLog_) throw std::runtime_error("Failed to open slow query log: " + options_.slowQueryLog);
+  }
+}
+
+RoutingService::~RoutingService() {
+  if (slowLog_ && slowLog_ != stderr) std::fclose(slowLog_);
+}
+
+void RoutingService::registerMetrics() {
+  // 0.5 мс .. ~16 с
+  const auto latency = Histogram::exponentialBuckets(0.0005, 2.0, 16);
+  for (size_t e = 0; e < ENDPOINT_COUNT; ++e) {
+    const std::string ep = std::string("endpoint=\"") + kEndpointNames[e] + '"';
+    endpoints_[e].duration = &registry_.histogram("routing_request_duration_seconds",
+                                                  "Request handling time by endpoint", latency, ep);
+    for (size_t c = 0; c <= kCodes.size(); ++c) {
+      const std::string code = c < kCodes.size() ? std::to_string(kCodes[c]) : "other";
+      endpoints_[e].requests[c] = &registry_.counter("routing_requests_total", "Requests by endpoint and HTTP status",
+                                                     ep + ",code=\"" + code + '"');
+    }
+  }
+  inFlight_ = &registry_.gauge("routing_requests_in_flight", "Requests being handled by workers");
+  const char* phaseNames[] = {"tiles", "graph", "search", "geometry"};
+  for (size_t i = 0; i < phases_.size(); ++i) {
+    phases_[i] = &registry_.histogram("routing_query_phase_seconds", "Router time per query phase (route, matrix)",
+                                      Histogram::exponentialBuckets(0.0001, 2.0, 18),
+                                      std::string("phase=\"") + phaseNames[i] + '"');
+  }
+  settled_ = &registry_.histogram("routing_settled_nodes", "Search nodes settled per routing query",
+                                  Histogram::exponentialBuckets(64, 4.0, 10));
+  tilesLoaded_ = &registry_.counter("routing_tiles_loaded_total", "Tiles in routing query sets");
+  cacheHits_ = &registry_.counter("routing_tile_cache_hits_total", "Tile loads served by worker LRU caches");
+  cacheMisses_ = &registry_.counter("routing_tile_cache_misses_total", "Tile loads read from SQLite");
+  slowQueries_ = &registry_.counter("routing_slow_queries_total", "Requests over the slow query threshold");
+}
+
+double RoutingService::lap(Trace& t) {
+  const auto now = Clock::now();
+  const double ms = std::chrono::duration<double, std::milli>(now - t.lap).count();
+  t.lap = now;
+  return ms;
+}
+
+const ProfileSettings* RoutingService::profileFor(std::string_view name) const {
+  if (name.empty() || name == "car") return &car_;
+  if (name == "foot") return &foot_;
+  if (name == "boat") return &boat_;
+  return nullptr;
+}
+
+void RoutingService::handle(unsigned worker, const HttpRequest& req, HttpResponse& resp) {
+  Workspace& ws = workspaces_[worker % workspaces_.size()];
+  const auto start = Clock::now();
+  ws.trace.lap = start;
+  ws.trace.profile = {};
+  ws.trace.points.clear();
+  ws.trace.pointCount = 0;
+  ws.trace.queryLength = 0;
+  ws.trace.routed = false;
+  ws.trace.parseMs = ws.trace.coreMs = 0.0;
+
+  inFlight_->add(1);
+  const Endpoint endpoint = dispatch(ws, req, resp);
+  inFlight_->add(-1);
+  recordQuery(endpoint, ws, req, resp.status, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+}
+
+RoutingService::Endpoint RoutingService::dispatch(Workspace& ws, const HttpRequest& req, HttpResponse& resp) {
+  Endpoint endpoint = OTHER;
+  if (req.path == "/route") endpoint = ROUTE;
+  else if (req.path == "/matrix") endpoint = MATRIX;
+  else if (req.path == "/search") endpoint = SEARCH;
+  else if (req.path == "/health") endpoint = HEALTH;
+  else if (req.path == "/metrics") endpoint = METRICS;
+  if (endpoint == OTHER) {
+    errorResponse(resp, 404, "NOT_FOUND", "unknown endpoint");
+    return endpoint;
+  }
+  if (req.method != (endpoint == ROUTE || endpoint == MATRIX ? "POST" : "GET")) {
+    errorResponse(resp, 405, "METHOD_NOT_ALLOWED", "method not allowed for this endpoint");
+    return endpoint;
+  }
+  switch (endpoint) {
+    case ROUTE: route(ws, req, resp); break;
+    case MATRIX: matrix(ws, req, resp); break;
+    case SEARCH: search(ws, req, resp); break;
+    case HEALTH: health(resp); break;
+    default: metrics(resp); break;
+  }
+  return endpoint;
+}
+
+void RoutingService::recordQuery(Endpoint endpoint, Workspace& ws, const HttpRequest& req, int status, double ms) {
+  EndpointMetrics& em = endpoints_[endpoint];
+  em.duration->observe(ms / 1000.0);
+  em.requests[static_cast<size_t>(std::find(kCodes.begin(), kCodes.end(), status) - kCodes.begin())]->inc();
+
+  // с последней отметки обработчика — сборка ответа
+  const double serializeMs = lap(ws.trace);
+  if (ws.trace.routed) {
+    const QueryStats& qs = ws.router->lastQueryStats();
+    phases_[0]->observe(qs.tilesMs / 1000.0);
+    phases_[1]->observe(qs.graphMs / 1000.0);
+    phases_[2]->observe(qs.searchMs / 1000.0);
+    phases_[3]->observe(qs.geometryMs / 1000.0);
+    settled_->observe(static_cast<double>(qs.settledNodes));
+    tilesLoaded_->inc(qs.tilesLoaded);
+    cacheHits_->inc(qs.tileCacheHits);
+    cacheMisses_->inc(qs.tileCacheMisses);
+  }
+  if (slowLog_ && ms >= options_.slowQueryMs && endpoint != METRICS && endpoint != HEALTH) {
+    slowQueries_->inc();
+    logSlowQuery(ws, req, status, ms, serializeMs);
+  }
+}
+
+void RoutingService::logSlowQuery(const Workspace& ws, const HttpRequest& req, int status, double ms,
+                                  double serializeMs) {
+  const Trace& t = ws.trace;
+  char time[32];
+  const std::time_t now = std::time(nullptr);
+  std::tm tm {};
+  gmtime_r(&now, &tm);
+  std::strftime(time, sizeof(time), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+  std::string line;
+  JsonWriter w(line);
+  w.beginObject();
+  w.key("time"); w.value(time);
+  w.key("endpoint"); w.value(req.path);
+  w.key("status"); w.value(status);
+  w.key("ms"); w.value(ms, 1);
+  if (!t.profile.empty()) { w.key("profile"); w.value(t.profile); }
+  if (t.pointCount > 0) {
+    w.key("point_count"); w.value(static_cast<uint64_t>(t.pointCount));
+    w.key("points");
+    w.beginArray();
+    for (const auto& c : t.points) {
+      w.beginArray();
+      w.value(c.lat, 2);
+      w.value(c.lon, 2);
+      w.endArray();
+    }
+    w.endArray();
+  }
+  if (t.queryLength > 0) { w.key("query_length"); w.value(static_cast<uint64_t>(t.queryLength)); }
+  w.key("phases_ms");
+  w.beginObject();
+  w.key("parse"); w.value(t.parseMs, 2);
+  if (t.routed) {
+    const QueryStats& qs = ws.router->lastQueryStats();
+    w.key("tiles"); w.value(qs.tilesMs, 2);
+    w.key("graph"); w.value(qs.graphMs, 2);
+    w.key("search"); w.value(qs.searchMs, 2);
+    w.key("geometry"); w.value(qs.geometryMs, 2);
+  } else if (t.queryLength > 0) {
+    w.key("search"); w.value(t.coreMs, 2);
+  }
+  w.key("response"); w.value(serializeMs, 2);
+  w.endObject();
+  if (t.routed) {
+    const QueryStats& qs = ws.router->lastQueryStats();
+    w.key("tiles"); w.value(static_cast<uint64_t>(qs.tilesLoaded));
+    w.key("tile_cache_misses"); w.value(static_cast<uint64_t>(qs.tileCacheMisses));
+    w.key("graph_nodes"); w.value(static_cast<uint64_t>(qs.graphNodes));
+    w.key("settled_nodes"); w.value(static_cast<uint64_t>(qs.settledNodes));
+  }
+  w.endObject();
+  line += '\n';
+
+  std::lock_guard<std::mutex> lock(slowLogMutex_);
+  std::fwrite(line.data(), 1, line.size(), slowLog_);
+  std::fflush(slowLog_);
+}
+
+void RoutingService::metrics(HttpResponse& resp) {
+  resp.contentType = "text/plain; version=0.0.4";
+  registry_.renderPrometheus(resp.body);
+}
+
+void RoutingService::health(HttpResponse& resp) {
+  JsonWriter w(resp.body);
+  w.beginObject();
+  w.key("status"); w.value("ok");
+  w.key("workers"); w.value(static_cast<uint64_t>(workspaces_.size()));
+  w.key("tile_zoom"); w.value(tileZoom_);
+  w.key("geocoder"); w.value(geocoderAvailable_);
+  w.endObject();
+}
+
+void RoutingService::route(Workspace& ws, const HttpRequest& req, HttpResponse& resp) {
+  JsonValue doc;
+  if (!parseBody(req, resp, doc)) return;
+  const JsonValue* profileName = doc.find("profile");
+  const ProfileSettings* profile = profileFor(profileName && profileName->isString() ? profileName->string : "");
+  if (!profile) return errorResponse(resp, 400, "BAD_REQUEST", "unknown profile (car, foot, boat)");
+  std::vector<Coord> points;
+  std::string error;
+  if (!parsePoints(doc.find("waypoints"), "waypoints", points, error)) {
+    return errorResponse(resp, 400, "BAD_REQUEST", error);
+  }
+  if (points.size() < 2 || points.size() > options_.maxWaypoints) {
+    return errorResponse(resp, 400, "BAD_REQUEST",
+                         "need 2.." + std::to_string(options_.maxWaypoints) + " waypoints");
+  }
+  // плечо через полстраны загрузило бы миллионы детальных тайлов
+  if (ws.router->routeTooLarge(*profile, points, {}, error)) {
+    return errorResponse(resp, 400, "BAD_REQUEST", error);
+  }
+  const JsonValue* withEdges = doc.find("edge_ids");
+  ws.trace.profile = profileName && profileName->isString() ? profileName->string : "car";
+  ws.trace.points.assign(points.begin(), points.begin() + static_cast<std::ptrdiff_t>(std::min(points.size(), kMaxLoggedPoints)));
+  ws.trace.pointCount = points.size();
+  ws.trace.parseMs = lap(ws.trace);
+
+  const RouteResult rr = ws.router->route(*profile, points);
+  ws.trace.coreMs = lap(ws.trace);
+  ws.trace.routed = true;
+  if (wantsFlatbuffers(req)) {
+    buildRouteResponse(ws.fbb, rr);
+    return flatbufferResponse(resp, ws.fbb, rr.status);
+  }
+  if (rr.status != RouteStatus::OK) return routeError(resp, rr.status, rr.error_message);
+
+  resp.body.reserve(64 + rr.polyline.size() * 24);
+  JsonWriter w(resp.body);
+  w.beginObject();
+  w.key("status"); w.value("OK");
+  w.key("distance_m"); w.value(rr.distance_m, 1);
+  w.key("duration_s"); w.value(rr.duration_s, 1);
+  w.key("polyline");
+  w.beginArray();
+  for (const auto& c : rr.polyline) {
+    w.beginArray();
+    w.value(c.lat, 6);
+    w.value(c.lon, 6);
+    w.endArray();
+  }
+  w.endArray();
+  if (withEdges && withEdges->type == JsonValue::Type::Bool && withEdges->boolean) {
+    // 64-битные id не помещаются в double клиентов на JS — строками
+    w.key("edge_ids");
+    w.beginArray();
+    for (uint64_t id : rr.edge_ids) w.value(std::to_string(id));
+    w.endArray();
+  }
+  w.endObject();
+}
+
+void RoutingService::matrix(Workspace& ws, const HttpRequest& req, HttpResponse& resp) {
+  JsonValue doc;
+  if (!parseBody(req, resp, doc)) return;
+  const JsonValue* profileName = doc.find("profile");
+  const ProfileSettings* profile = profileFor(profileName && profileName->isString() ? profileName->string : "");
+  if (!profile) return errorResponse(resp, 400, "BAD_REQUEST", "unknown profile (car, foot, boat)");
+  std::vector<Coord> sources, targets;
+  std::string error;
+  if (!parsePoints(doc.find("sources"), "sources", sources, error)) {
+    return errorResponse(resp, 400, "BAD_REQUEST", error);
+  }
+  if (doc.find("targets")) {
+    if (!parsePoints(doc.find("targets"), "targets", targets, error)) {
+      return errorResponse(resp, 400, "BAD_REQUEST", error);
+    }
+  } else {
+    targets = sources;
+  }
+  if (sources.empty() || targets.empty() || sources.size() * targets.size() > options_.maxMatrixCells) {
+    return errorResponse(resp, 400, "BAD_REQUEST",
+                         "need 1.." + std::to_string(options_.maxMatrixCells) + " matrix cells");
+  }
+  // Router::matrix грузит все тайлы прямоугольника точек: разброс ограничен заранее
+  const size_t tiles = matrixTileCount(sources, targets, tileZoom_);
+  if (tiles > options_.maxMatrixTiles) {
+    return errorResponse(resp, 400, "BAD_REQUEST",
+                         "points span " + std::to_string(tiles) + " tiles, limit " +
+                         std::to_string(options_.maxMatrixTiles));
+  }
+
+  ws.trace.profile = profileName && profileName->isString() ? profileName->string : "car";
+  for (const auto* list : {&sources, &targets}) {
+    for (size_t i = 0; i < list->size() && ws.trace.points.size() < kMaxLoggedPoints; ++i) ws.trace.points.push_back((*list)[i]);
+  }
+  ws.trace.pointCount = sources.size() + targets.size();
+  ws.trace.parseMs = lap(ws.trace);
+
+  const MatrixResult m = ws.router->matrix(*profile, sources, targets);
+  ws.trace.coreMs = lap(ws.trace);
+  ws.trace.routed = true;
+  if (wantsFlatbuffers(req)) {
+    buildMatrixResponse(ws.fbb, m);
+    return flatbufferResponse(resp, ws.fbb, m.status);
+  }
+  if (m.status != RouteStatus::OK) return routeError(resp, m.status, m.error_message);
+
+  resp.body.reserve(64 + m.durations_s.size() * 8);
+  JsonWriter w(resp.body);
+  w.beginObject();
+  w.key("status"); w.value("OK");
+  w.key("durations_s");
+  w.beginArray();
+  for (size_t i = 0; i < m.sources; ++i) {
+    w.beginArray();
+    for (size_t j = 0; j < m.targets; ++j) w.value(m.durations_s[i * m.targets + j], 1);
+    w.endArray();
+  }
+  w.endArray();
+  w.endObject();
+}
+
+void RoutingService::search(Workspace& ws, const HttpRequest& req, HttpResponse& resp) {
+  if (!geocoderAvailable_) return errorResponse(resp, 501, "NO_GEOCODER", "package has no geocoder index");
+  const std::string q = queryParam(req.query, "q");
+  if (q.empty()) return errorResponse(resp, 400, "BAD_REQUEST", "missing 'q'");
+  size_t limit = 10;
+  const std::string limitText = queryParam(req.query, "limit");
+  if (!limitText.empty()) {
+    auto [p, ec] = std::from_chars(limitText.data(), limitText.data() + limitText.size(), limit);
+    if (ec != std::errc() || limit == 0) return errorResponse(resp, 400, "BAD_REQUEST", "bad 'limit'");
+    limit = std::min(limit, options_.maxSearchLimit);
+  }
+  std::optional<GeoBBox> bbox;
+  const std::string bboxText = queryParam(req.query, "bbox");
+  if (!bboxText.empty()) {
+    double v[4];
+    std::string_view rest = bboxText;
+    for (int i = 0; i < 4; ++i) {
+      const size_t comma = rest.find(',');
+      if ((i < 3) == (comma == std::string_view::npos) || !parseDouble(rest.substr(0, comma), v[i])) {
+        return errorResponse(resp, 400, "BAD_REQUEST", "bbox must be lon_min,lat_min,lon_max,lat_max");
+      }
+      if (i < 3) rest.remove_prefix(comma + 1);
+    }
+    bbox = GeoBBox{v[1], v[0], v[3], v[2]};
+  }
+
+  ws.trace.queryLength = q.size();
+  ws.trace.parseMs = lap(ws.trace);
+
+  const auto results = ws.geocoder->search(q, bbox, limit);
+  ws.trace.coreMs = lap(ws.trace);
+  JsonWriter w(resp.body);
+  w.beginObject();
+  w.key("results");
+  w.beginArray();
+  for (const auto& r : results) {
+    w.beginObject();
+    w.key("id"); w.value(static_cast<int64_t>(r.id));
+    w.key("kind"); w.value(static_cast<int>(r.kind));
+    w.key("name"); w.value(r.name);
+    if (!r.street.empty()) { w.key("street"); w.value(r.street); }
+    if (!r.housenumber.empty()) { w.key("housenumber"); w.value(r.housenumber); }
+    if (!r.city.empty()) { w.key("city"); w.value(r.city); }
+    if (!r.postcode.empty()) { w.key("postcode"); w.value(r.postcode); }
+    w.key("category"); w.value(r.category);
+    w.key("lat"); w.value(r.lat, 6);
+    w.key("lon"); w.value(r.lon, 6);
+    w.key("score"); w.value(r.score, 4);
+    w.endObject();
+  }
+  w.endArray();
+  w.endObject();
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "http_server.h"
+#include "routing_core/geocoder.h"
+#include "routing_core/metrics.h"
+#include "routing_core/route_result_buffer.h"
+#include "routing_core/profile.h"
+#include "routing_core/router.h"
+
+struct RoutingServiceOptions {
+  unsigned workers {1};
+  size_t tileCacheCapacity {1024}; // на поток
+  size_t maxWaypoints {50};
+  size_t maxMatrixCells {10000};   // sources × targets
+  size_t maxMatrixTiles {1024};    // тайлов в прямоугольнике точек (с рамкой 1, как у Router::matrix)
+  size_t maxSearchLimit {50};
+  double slowQueryMs {0.0};        // > 0 — писать в журнал запросы дольше порога
+  std::string slowQueryLog;        // файл журнала (дописывается); пусто — stderr
+};
+
+// Обработчики HTTP API поверх одного пакета routingdb.
+//
+// Router и Geocoder не потокобезопасны, поэтому у каждого рабочего потока
+// сервера своё рабочее место: Router (соединение SQLite, LRU-кэш тайлов,
+// планировщик открытой воды) и Geocoder. Пакет открыт только на чтение,
+// страницы файла потоки делят через кэш ОС.
+//
+//   POST /route  {"profile":"car","waypoints":[[lat,lon],...],"edge_ids":false}
+//   POST /matrix {"profile":"car","sources":[[lat,lon],...],"targets":[...]}
+//   GET  /search?q=...&limit=10&bbox=lon_min,lat_min,lon_max,lat_max
+//   GET  /health
+//   GET  /metrics — счётчики и гистограммы в текстовом формате Prometheus
+// Точки принимаются и как {"lat":..,"lon":..}. Ответы — JSON; ошибки —
+// {"status":"...","error":"..."} с кодом 400/404/500. С Accept:
+// application/x-flatbuffers /route и /matrix отвечают Routing.RouteResponse
+// (core/src/route_result.fbs), включая 404/500; edge_ids в нём всегда,
+// ошибки разбора запроса (400) остаются JSON.
+//
+// Журнал медленных запросов — JSON-строка на запрос дольше slowQueryMs:
+// время по фазам (разбор, тайлы, граф, поиск, геометрия, ответ) и трудоёмкость
+// из Router::lastQueryStats(). Координаты огрублены до 0.01° (~1 км),
+// текст поискового запроса не пишется — только длина.
+class RoutingService {
+public:
+  // Исключение, если пакет не открылся
+  RoutingService(const std::string& db_path, RoutingServiceOptions options);
+  ~RoutingService();
+
+  void handle(unsigned worker, const HttpRequest& req, HttpResponse& resp);
+
+  int tileZoom() const { return tileZoom_; }
+  bool geocoderAvailable() const { return geocoderAvailable_; }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  // Текущий запрос рабочего потока: для метрик и журнала медленных запросов
+  struct Trace {
+    Clock::time_point lap;
+    std::string_view profile;
+    std::vector<routing_core::Coord> points;
+    size_t pointCount {0};
+    size_t queryLength {0};
+    bool routed {false};        // был вызов Router — есть lastQueryStats()
+    double parseMs {0.0};
+    double coreMs {0.0};
+  };
+
+  struct Workspace {
+    std::unique_ptr<routing_core::Router> router;
+    std::unique_ptr<routing_core::Geocoder> geocoder;
+    flatbuffers::FlatBufferBuilder fbb; // бинарные ответы, память переиспользуется
+    Trace trace;
+  };
+
+  // Ряды метрик эндпоинта: ссылки берутся из реестра при старте,
+  // на горячем пути — только инкременты
+  enum Endpoint { ROUTE, MATRIX, SEARCH, HEALTH, METRICS, OTHER, ENDPOINT_COUNT };
+  static constexpr std::array<int, 6> kCodes {200, 400, 404, 405, 500, 501}; // и "other"
+  struct EndpointMetrics {
+    routing_core::Histogram* duration {nullptr};
+    std::array<routing_core::Counter*, kCodes.size() + 1> requests {};
+  };
+
+  Endpoint dispatch(Workspace& ws, const HttpRequest& req, HttpResponse& resp);
+  void route(Workspace& ws, const HttpRequest& req, HttpResponse& resp);
+  void matrix(Workspace& ws, const HttpRequest& req, HttpResponse& resp);
+  void search(Workspace& ws, const HttpRequest& req, HttpResponse& resp);
+  void health(HttpResponse& resp);
+  void metrics(HttpResponse& resp);
+  const routing_core::ProfileSettings* profileFor(std::string_view name) const;
+
+  static double lap(Trace& t);
+  void registerMetrics();
+  void recordQuery(Endpoint endpoint, Workspace& ws, const HttpRequest& req, int status, double ms);
+  void logSlowQuery(const Workspace& ws, const HttpRequest& req, int status, double ms, double serializeMs);
+
+  RoutingServiceOptions options_;
+  int tileZoom_ {14};
+  bool geocoderAvailable_ {false};
+  routing_core::ProfileSettings car_, foot_, boat_;
+  std::vector<Workspace> workspaces_;
+
+  routing_core::MetricsRegistry registry_;
+  std::array<EndpointMetrics, ENDPOINT_COUNT> endpoints_;
+  routing_core::Gauge* inFlight_ {nullptr};
+  std::array<routing_core::Histogram*, 4> phases_ {}; // tiles, graph, search, geometry
+  routing_core::Histogram* settled_ {nullptr};
+  routing_core::Counter* tilesLoaded_ {nullptr};
+  routing_core::Counter* cacheHits_ {nullptr};
+  routing_core::Counter* cacheMisses_ {nullptr};
+  routing_core::Counter* slowQueries_ {nullptr};
+
+  std::mutex slowLogMutex_;
+  FILE* slowLog_ {nullptr};
+};